@@ -24,24 +24,114 @@
 #include "log.h"
 #include "pl_thread.h"
 
+#if defined(PL_HAVE_WIN32)
+#include <windows.h>
+#elif defined(PL_HAVE_UNIX) || defined(PL_HAVE_APPLE)
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PL_HAVE_MMAP
+#endif
+
 const struct pl_cache_params pl_cache_default_params = {0};
 
-struct priv {
-    pl_log log;
+// Intrusive hash table entry, also linked into the LRU list
+typedef struct cache_node {
+    pl_cache_obj obj;
+    struct cache_node *hnext;       // next entry in the same hash bucket
+    struct cache_node *prev, *next; // LRU list, from oldest to newest
+    uint64_t hash;                  // expected checksum, if `unverified`
+    bool unverified;                // data not yet checked against `hash`
+} cache_node;
+
+// Independently locked partition of the cache, selected by key
+struct shard {
     pl_mutex lock;
-    PL_ARRAY(pl_cache_obj) objects;
+    cache_node **buckets;   // hash table, `num_buckets` is a power of two
+    int num_buckets;
+    int num_objects;
+    cache_node *oldest;     // least recently inserted/used object
+    cache_node *newest;     // most recently inserted/used object
+    cache_node *spare;      // free list of unused nodes
     size_t total_size;
+    size_t max_total_size;
+};
+
+struct mapping {
+    void *ptr;
+    size_t size;
 };
 
+struct priv {
+    pl_log log;
+    struct shard **shards;
+    int num_shards;         // power of two
+    int shard_bits;
+    _Atomic uint64_t contended;
+
+    pl_mutex lock;          // protects `mappings`, taken before shard locks
+    PL_ARRAY(struct mapping) mappings;
+};
+
+static void unmap_file(struct mapping map)
+{
+#if defined(PL_HAVE_WIN32)
+    UnmapViewOfFile(map.ptr);
+#elif defined(PL_HAVE_MMAP)
+    munmap(map.ptr, map.size);
+#endif
+}
+
+#define MIN_BUCKETS 64
+#define MAX_SHARDS  256
+
+static inline uint64_t mix_key(uint64_t key)
+{
+    // Keys are usually already hashes, but mix them anyway to guard against
+    // badly distributed user-provided keys
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+    return key;
+}
+
+static inline struct shard *get_shard(struct priv *p, uint64_t key)
+{
+    if (!p->shard_bits)
+        return p->shards[0];
+    return p->shards[mix_key(key) >> (64 - p->shard_bits)];
+}
+
+static inline cache_node **bucket(struct shard *s, uint64_t key)
+{
+    return &s->buckets[mix_key(key) & (s->num_buckets - 1)];
+}
+
+static void lock_shard(struct priv *p, struct shard *s)
+{
+    if (pl_mutex_trylock(&s->lock) == 0)
+        return;
+
+    atomic_fetch_add_explicit(&p->contended, 1, memory_order_relaxed);
+    pl_mutex_lock(&s->lock);
+}
+
 int pl_cache_objects(pl_cache cache)
 {
     if (!cache)
         return 0;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    int num = p->objects.num;
-    pl_mutex_unlock(&p->lock);
+    int num = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        lock_shard(p, s);
+        num += s->num_objects;
+        pl_mutex_unlock(&s->lock);
+    }
     return num;
 }
 
@@ -51,41 +141,139 @@ size_t pl_cache_size(pl_cache cache)
         return 0;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    size_t size = p->total_size;
-    pl_mutex_unlock(&p->lock);
+    size_t size = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        lock_shard(p, s);
+        size += s->total_size;
+        pl_mutex_unlock(&s->lock);
+    }
     return size;
 }
 
+uint64_t pl_cache_contention(pl_cache cache)
+{
+    if (!cache)
+        return 0;
+
+    struct priv *p = PL_PRIV(cache);
+    return atomic_load_explicit(&p->contended, memory_order_relaxed);
+}
+
 pl_cache pl_cache_create(const struct pl_cache_params *params)
 {
     struct pl_cache_t *cache = pl_zalloc_obj(NULL, cache, struct priv);
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_init(&p->lock);
     if (params) {
         cache->params = *params;
         p->log = params->log;
     }
 
+    // Round the number of shards up to the nearest power of two
+    int num_shards = PL_CLAMP(cache->params.num_shards, 1, MAX_SHARDS);
+    while ((1 << p->shard_bits) < num_shards)
+        p->shard_bits++;
+    p->num_shards = 1 << p->shard_bits;
+    cache->params.num_shards = p->num_shards;
+
     // Sanitize size limits
     size_t total_size  = PL_DEF(cache->params.max_total_size,  SIZE_MAX);
     size_t object_size = PL_DEF(cache->params.max_object_size, SIZE_MAX);
-    object_size = PL_MIN(total_size, object_size);
+    size_t shard_size  = total_size / p->num_shards;
+    object_size = PL_MIN(shard_size, object_size);
     cache->params.max_total_size  = total_size;
     cache->params.max_object_size = object_size;
 
+    atomic_init(&p->contended, 0);
+    pl_mutex_init(&p->lock);
+    p->shards = pl_calloc_ptr(cache, p->num_shards, p->shards);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i] = pl_zalloc_ptr(cache, s);
+        pl_mutex_init(&s->lock);
+        s->max_total_size = shard_size;
+        s->num_buckets = MIN_BUCKETS;
+        s->buckets = pl_calloc_ptr(s, s->num_buckets, s->buckets);
+    }
+
     return cache;
 }
 
-static void remove_obj(pl_cache cache, pl_cache_obj obj)
+static void grow_buckets(struct shard *s)
 {
-    struct priv *p = PL_PRIV(cache);
+    cache_node **old = s->buckets;
+    const int num_old = s->num_buckets;
+    if (num_old > INT_MAX / 2)
+        return;
+
+    s->num_buckets = num_old * 2;
+    s->buckets = pl_calloc_ptr(s, s->num_buckets, s->buckets);
+    for (int i = 0; i < num_old; i++) {
+        cache_node *node = old[i];
+        while (node) {
+            cache_node *next = node->hnext;
+            cache_node **head = bucket(s, node->obj.key);
+            node->hnext = *head;
+            *head = node;
+            node = next;
+        }
+    }
+
+    pl_free(old);
+}
 
-    p->total_size -= obj.size;
+// Unlinks a node from both the hash table and the LRU list, and returns it
+// to the free list. Does not touch the node's object.
+static void unlink_node(struct shard *s, cache_node **link)
+{
+    cache_node *node = *link;
+    *link = node->hnext;
+
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        s->oldest = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        s->newest = node->prev;
+    }
+
+    s->total_size -= node->obj.size;
+    s->num_objects--;
+    node->hnext = s->spare;
+    s->spare = node;
+}
+
+static cache_node **find_node(struct shard *s, uint64_t key)
+{
+    cache_node **link = bucket(s, key);
+    while (*link && (*link)->obj.key != key)
+        link = &(*link)->hnext;
+    return link;
+}
+
+static void free_obj(pl_cache_obj obj)
+{
     if (obj.free)
         obj.free(obj.data);
 }
 
+static void remove_all(struct shard *s)
+{
+    for (cache_node *node = s->oldest; node; node = node->next)
+        free_obj(node->obj);
+
+    for (int i = 0; i < s->num_buckets; i++) {
+        while (s->buckets[i])
+            unlink_node(s, &s->buckets[i]);
+    }
+
+    pl_assert(!s->oldest && !s->newest);
+    pl_assert(!s->num_objects);
+    pl_assert(s->total_size == 0);
+}
+
 void pl_cache_destroy(pl_cache *pcache)
 {
     pl_cache cache = *pcache;
@@ -93,10 +281,14 @@ void pl_cache_destroy(pl_cache *pcache)
          return;
 
     struct priv *p = PL_PRIV(cache);
-    for (int i = 0; i < p->objects.num; i++)
-        remove_obj(cache, p->objects.elem[i]);
+    for (int i = 0; i < p->num_shards; i++) {
+        remove_all(p->shards[i]);
+        pl_mutex_destroy(&p->shards[i]->lock);
+    }
+
+    for (int i = 0; i < p->mappings.num; i++)
+        unmap_file(p->mappings.elem[i]);
 
-    pl_assert(p->total_size == 0);
     pl_mutex_destroy(&p->lock);
     pl_free((void *) cache);
     *pcache = NULL;
@@ -109,26 +301,34 @@ void pl_cache_reset(pl_cache cache)
 
     struct priv *p = PL_PRIV(cache);
     pl_mutex_lock(&p->lock);
-    for (int i = 0; i < p->objects.num; i++)
-        remove_obj(cache, p->objects.elem[i]);
-    p->objects.num = 0;
-    pl_assert(p->total_size == 0);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        lock_shard(p, s);
+        remove_all(s);
+        pl_mutex_unlock(&s->lock);
+    }
+
+    // No objects reference the mapped files anymore
+    for (int i = 0; i < p->mappings.num; i++)
+        unmap_file(p->mappings.elem[i]);
+    p->mappings.num = 0;
     pl_mutex_unlock(&p->lock);
 }
 
-static bool try_set(pl_cache cache, pl_cache_obj obj)
+// Must be called with `s->lock` held. If `checksum` is non-NULL, the object
+// is verified against it lazily, before being returned by `pl_cache_get`.
+static bool try_set(pl_cache cache, struct shard *s, pl_cache_obj obj,
+                    const uint64_t *checksum)
 {
     struct priv *p = PL_PRIV(cache);
 
     // Remove any existing entry with this key
-    for (int i = p->objects.num - 1; i >= 0; i--) {
-        pl_cache_obj prev = p->objects.elem[i];
-        if (prev.key == obj.key) {
-            PL_TRACE(p, "Removing out-of-date object 0x%"PRIx64, prev.key);
-            remove_obj(cache, prev);
-            PL_ARRAY_REMOVE_AT(p->objects, i);
-            break;
-        }
+    cache_node **link = find_node(s, obj.key);
+    if (*link) {
+        pl_cache_obj prev = (*link)->obj;
+        PL_TRACE(p, "Removing out-of-date object 0x%"PRIx64, prev.key);
+        unlink_node(s, link);
+        free_obj(prev);
     }
 
     if (!obj.size) {
@@ -142,16 +342,16 @@ static bool try_set(pl_cache cache, pl_cache_obj obj)
         return false;
     }
 
-    // Make space by deleting old objects
-    while (p->total_size + obj.size > cache->params.max_total_size ||
-           p->objects.num == INT_MAX)
+    // Make space by deleting the least recently used objects
+    while (s->total_size + obj.size > s->max_total_size ||
+           s->num_objects == INT_MAX)
     {
-        pl_assert(p->objects.num);
-        pl_cache_obj old = p->objects.elem[0];
+        pl_assert(s->oldest);
+        pl_cache_obj old = s->oldest->obj;
         PL_TRACE(p, "Removing object 0x%"PRIx64" (size %zu) to make room",
                  old.key, old.size);
-        remove_obj(cache, old);
-        PL_ARRAY_REMOVE_AT(p->objects, 0);
+        unlink_node(s, find_node(s, old.key));
+        free_obj(old);
     }
 
     if (!obj.free) {
@@ -159,9 +359,35 @@ static bool try_set(pl_cache cache, pl_cache_obj obj)
         obj.free = pl_free;
     }
 
+    if (s->num_objects >= s->num_buckets)
+        grow_buckets(s);
+
+    cache_node *node = s->spare;
+    if (node) {
+        s->spare = node->hnext;
+    } else {
+        node = pl_alloc_ptr(s, node);
+    }
+
     PL_TRACE(p, "Inserting new object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
-    PL_ARRAY_APPEND((void *) cache, p->objects, obj);
-    p->total_size += obj.size;
+    cache_node **head = bucket(s, obj.key);
+    *node = (cache_node) {
+        .obj   = obj,
+        .hnext = *head,
+        .prev  = s->newest,
+        .hash  = checksum ? *checksum : 0,
+        .unverified = checksum != NULL,
+    };
+
+    *head = node;
+    if (s->newest) {
+        s->newest->next = node;
+    } else {
+        s->oldest = node;
+    }
+    s->newest = node;
+    s->total_size += obj.size;
+    s->num_objects++;
     return true;
 }
 
@@ -177,9 +403,10 @@ bool pl_cache_try_set(pl_cache cache, pl_cache_obj *pobj)
 
     pl_cache_obj obj = *pobj;
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    bool ok = try_set(cache, obj);
-    pl_mutex_unlock(&p->lock);
+    struct shard *s = get_shard(p, obj.key);
+    lock_shard(p, s);
+    bool ok = try_set(cache, s, obj, NULL);
+    pl_mutex_unlock(&s->lock);
     if (ok) {
         *pobj = strip_obj(obj); // ownership transfers, clear ptr
     } else {
@@ -211,22 +438,46 @@ bool pl_cache_get(pl_cache cache, pl_cache_obj *out_obj)
         goto fail;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-
-    // Search backwards to prioritize recently added entries
-    for (int i = p->objects.num - 1; i >= 0; i--) {
-        pl_cache_obj obj = p->objects.elem[i];
-        if (obj.key == key) {
-            PL_ARRAY_REMOVE_AT(p->objects, i);
-            p->total_size -= obj.size;
-            pl_mutex_unlock(&p->lock);
-            pl_assert(obj.free);
-            *out_obj = obj;
-            return true;
+    struct shard *s = get_shard(p, key);
+    lock_shard(p, s);
+
+    cache_node **link = find_node(s, key);
+    if (*link) {
+        cache_node *node = *link;
+        pl_cache_obj obj = node->obj;
+        const bool unverified = node->unverified;
+        const uint64_t hash = node->hash;
+        unlink_node(s, link);
+        pl_assert(obj.free);
+
+        // Objects indexed in-place by `pl_cache_load_mapped` point into memory
+        // owned by the cache, which may be released by `pl_cache_reset` or
+        // `pl_cache_destroy` while the object is still in use. Hand out a copy
+        // instead, made before unlocking so the memory can't go away first.
+        const bool mapped = obj.free == noop;
+        if (!mapped)
+            pl_mutex_unlock(&s->lock);
+        const bool ok = !unverified || pl_mem_hash(obj.data, obj.size) == hash;
+        if (ok && mapped) {
+            obj.data = pl_memdup(NULL, obj.data, obj.size);
+            obj.free = pl_free;
+        }
+        if (mapped)
+            pl_mutex_unlock(&s->lock);
+
+        if (!ok) {
+            PL_WARN(p, "Cache object 0x%"PRIx64" seems corrupt, checksum "
+                    "mismatch.. discarding", key);
+            obj.free(obj.data);
+            goto miss;
         }
+        *out_obj = obj;
+        return true;
     }
 
-    pl_mutex_unlock(&p->lock);
+    pl_mutex_unlock(&s->lock);
+
+miss:
     if (!cache->params.get)
         goto fail;
 
@@ -253,10 +504,13 @@ void pl_cache_iterate(pl_cache cache,
         return;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    for (int i = 0; i < p->objects.num; i++)
-        cb(priv, p->objects.elem[i]);
-    pl_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        lock_shard(p, s);
+        for (cache_node *node = s->oldest; node; node = node->next)
+            cb(priv, node->obj);
+        pl_mutex_unlock(&s->lock);
+    }
 }
 
 // --- Saving/loading
@@ -279,6 +533,31 @@ struct __attribute__((__packed__)) cache_entry {
 
 pl_static_assert(sizeof(struct cache_header) % alignof(struct cache_entry) == 0);
 
+// Lock all shards (in order) to get a consistent snapshot. Returns the total
+// number of objects, and their total size in `out_size`.
+static int lock_all(pl_cache cache, size_t *out_size)
+{
+    struct priv *p = PL_PRIV(cache);
+    int num_objects = 0;
+    size_t total_size = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        lock_shard(p, s);
+        num_objects += s->num_objects;
+        total_size += s->total_size;
+    }
+
+    *out_size = total_size;
+    return num_objects;
+}
+
+static void unlock_all(pl_cache cache)
+{
+    struct priv *p = PL_PRIV(cache);
+    for (int i = p->num_shards - 1; i >= 0; i--)
+        pl_mutex_unlock(&p->shards[i]->lock);
+}
+
 int pl_cache_save_ex(pl_cache cache,
                      void (*write)(void *priv, size_t size, const void *ptr),
                      void *priv)
@@ -287,31 +566,32 @@ int pl_cache_save_ex(pl_cache cache,
         return 0;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
+    size_t saved_bytes;
+    const int num_objects = lock_all(cache, &saved_bytes);
     pl_clock_t start = pl_clock_now();
-
-    const int num_objects = p->objects.num;
-    const size_t saved_bytes = p->total_size;
     write(priv, sizeof(struct cache_header), &(struct cache_header) {
         .magic       = CACHE_MAGIC,
         .version     = CACHE_VERSION,
         .num_entries = num_objects,
     });
 
-    for (int i = 0; i < num_objects; i++) {
-        pl_cache_obj obj = p->objects.elem[i];
-        PL_TRACE(p, "Saving object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
-        write(priv, sizeof(struct cache_entry), &(struct cache_entry) {
-            .key  = obj.key,
-            .size = obj.size,
-            .hash = pl_mem_hash(obj.data, obj.size),
-        });
-        static const uint8_t padding[PAD_ALIGN(1)] = {0};
-        write(priv, obj.size, obj.data);
-        write(priv, PAD_ALIGN(obj.size) - obj.size, padding);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        for (cache_node *node = s->oldest; node; node = node->next) {
+            pl_cache_obj obj = node->obj;
+            PL_TRACE(p, "Saving object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+            write(priv, sizeof(struct cache_entry), &(struct cache_entry) {
+                .key  = obj.key,
+                .size = obj.size,
+                .hash = pl_mem_hash(obj.data, obj.size),
+            });
+            static const uint8_t padding[PAD_ALIGN(1)] = {0};
+            write(priv, obj.size, obj.data);
+            write(priv, PAD_ALIGN(obj.size) - obj.size, padding);
+        }
     }
 
-    pl_mutex_unlock(&p->lock);
+    unlock_all(cache);
     pl_log_cpu_time(p->log, start, pl_clock_now(), "saving cache");
     if (num_objects)
         PL_DEBUG(p, "Saved %d objects, totalling %zu bytes", num_objects, saved_bytes);
@@ -348,7 +628,6 @@ int pl_cache_load_ex(pl_cache cache,
 
     int num_loaded = 0;
     size_t loaded_bytes = 0;
-    pl_mutex_lock(&p->lock);
     pl_clock_t start = pl_clock_now();
 
     for (int i = 0; i < header.num_entries; i++) {
@@ -386,7 +665,11 @@ int pl_cache_load_ex(pl_cache cache,
         };
 
         PL_TRACE(p, "Loading object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
-        if (try_set(cache, obj)) {
+        struct shard *s = get_shard(p, obj.key);
+        lock_shard(p, s);
+        bool ok = try_set(cache, s, obj, NULL);
+        pl_mutex_unlock(&s->lock);
+        if (ok) {
             num_loaded++;
             loaded_bytes += entry.size;
         } else {
@@ -400,7 +683,6 @@ int pl_cache_load_ex(pl_cache cache,
 
     // fall through
 error:
-    pl_mutex_unlock(&p->lock);
     return num_loaded;
 }
 
@@ -445,3 +727,241 @@ int pl_cache_load(pl_cache cache, const uint8_t *data, size_t size)
         .size = size,
     });
 }
+
+// --- Memory-mapped format
+
+#define MAPPED_VERSION 2
+#define MAPPED_ALIGN   64
+
+struct __attribute__((__packed__)) mapped_entry {
+    uint64_t key;
+    uint64_t offset; // relative to the start of the file
+    uint64_t size;
+    uint64_t hash;
+};
+
+pl_static_assert(sizeof(struct cache_header) % alignof(struct mapped_entry) == 0);
+
+int pl_cache_save_mapped_ex(pl_cache cache,
+                            void (*write)(void *priv, size_t size, const void *ptr),
+                            void *priv)
+{
+    if (!cache)
+        return 0;
+
+    struct priv *p = PL_PRIV(cache);
+    size_t saved_bytes;
+    const int num_objects = lock_all(cache, &saved_bytes);
+    pl_clock_t start = pl_clock_now();
+
+    write(priv, sizeof(struct cache_header), &(struct cache_header) {
+        .magic       = CACHE_MAGIC,
+        .version     = MAPPED_VERSION,
+        .num_entries = num_objects,
+    });
+
+    // Write the index first, so that loading only needs to touch the index
+    size_t index_end = sizeof(struct cache_header) +
+                       num_objects * sizeof(struct mapped_entry);
+    size_t offset = PL_ALIGN2(index_end, MAPPED_ALIGN);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        for (cache_node *node = s->oldest; node; node = node->next) {
+            pl_cache_obj obj = node->obj;
+            write(priv, sizeof(struct mapped_entry), &(struct mapped_entry) {
+                .key    = obj.key,
+                .offset = offset,
+                .size   = obj.size,
+                .hash   = node->unverified ? node->hash
+                                           : pl_mem_hash(obj.data, obj.size),
+            });
+            offset += PL_ALIGN2(obj.size, MAPPED_ALIGN);
+        }
+    }
+
+    static const uint8_t padding[MAPPED_ALIGN] = {0};
+    write(priv, PL_ALIGN2(index_end, MAPPED_ALIGN) - index_end, padding);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = p->shards[i];
+        for (cache_node *node = s->oldest; node; node = node->next) {
+            pl_cache_obj obj = node->obj;
+            PL_TRACE(p, "Saving object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+            write(priv, obj.size, obj.data);
+            write(priv, PL_ALIGN2(obj.size, MAPPED_ALIGN) - obj.size, padding);
+        }
+    }
+
+    unlock_all(cache);
+    pl_log_cpu_time(p->log, start, pl_clock_now(), "saving mapped cache");
+    if (num_objects)
+        PL_DEBUG(p, "Saved %d objects, totalling %zu bytes", num_objects, saved_bytes);
+
+    return num_objects;
+}
+
+int pl_cache_load_mapped(pl_cache cache, const uint8_t *data, size_t size)
+{
+    if (!cache)
+        return 0;
+
+    struct priv *p = PL_PRIV(cache);
+    struct cache_header header;
+    if (size < sizeof(header)) {
+        PL_ERR(p, "Failed loading cache: file seems empty or truncated");
+        return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0) {
+        PL_ERR(p, "Failed loading cache: invalid magic bytes");
+        return -1;
+    }
+    if (header.version == CACHE_VERSION) {
+        PL_DEBUG(p, "Cache is not in mapped format, falling back to copying");
+        return pl_cache_load(cache, data, size);
+    }
+    if (header.version != MAPPED_VERSION) {
+        PL_INFO(p, "Failed loading cache: wrong version... skipping");
+        return 0;
+    }
+    if (header.num_entries > INT_MAX) {
+        PL_ERR(p, "Failed loading cache: %"PRIu32" entries overflows int",
+               header.num_entries);
+        return 0;
+    }
+
+    const size_t max_entries = (size - sizeof(header)) / sizeof(struct mapped_entry);
+    int num_entries = header.num_entries;
+    if (num_entries > max_entries) {
+        PL_WARN(p, "Cache index seems truncated, missing objects.. ignoring rest");
+        num_entries = max_entries;
+    }
+
+    int num_loaded = 0;
+    size_t loaded_bytes = 0;
+    pl_clock_t start = pl_clock_now();
+    const uint8_t *index = data + sizeof(header);
+
+    for (int i = 0; i < num_entries; i++) {
+        struct mapped_entry entry;
+        memcpy(&entry, index + i * sizeof(entry), sizeof(entry));
+        if (entry.offset > size || entry.size > size - entry.offset) {
+            PL_WARN(p, "Cache seems truncated, missing objects.. ignoring rest");
+            break;
+        }
+        if (!entry.size)
+            continue;
+
+        pl_cache_obj obj = {
+            .key  = entry.key,
+            .size = entry.size,
+            .data = (void *) (data + entry.offset),
+            .free = noop,
+        };
+
+        PL_TRACE(p, "Indexing object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+        const uint64_t hash = entry.hash;
+        struct shard *s = get_shard(p, obj.key);
+        lock_shard(p, s);
+        bool ok = try_set(cache, s, obj, &hash);
+        pl_mutex_unlock(&s->lock);
+        if (ok) {
+            num_loaded++;
+            loaded_bytes += entry.size;
+        }
+    }
+
+    pl_log_cpu_time(p->log, start, pl_clock_now(), "indexing mapped cache");
+    if (num_loaded)
+        PL_DEBUG(p, "Indexed %d objects, totalling %zu bytes", num_loaded, loaded_bytes);
+
+    return num_loaded;
+}
+
+int pl_cache_load_mapped_file(pl_cache cache, const char *path)
+{
+    if (!cache)
+        return 0;
+
+    struct priv *p = PL_PRIV(cache);
+    struct mapping map = {0};
+
+#if defined(PL_HAVE_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        PL_ERR(p, "Failed opening cache file '%s'", path);
+        return -1;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart > SIZE_MAX) {
+        PL_ERR(p, "Failed querying size of cache file '%s'", path);
+        CloseHandle(file);
+        return -1;
+    }
+
+    map.size = file_size.QuadPart;
+    if (map.size) {
+        HANDLE handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (handle) {
+            map.ptr = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(handle);
+        }
+    }
+    CloseHandle(file);
+#elif defined(PL_HAVE_MMAP)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        PL_ERR(p, "Failed opening cache file '%s': %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size > SIZE_MAX) {
+        PL_ERR(p, "Failed querying size of cache file '%s'", path);
+        close(fd);
+        return -1;
+    }
+
+    map.size = st.st_size;
+    if (map.size) {
+        map.ptr = mmap(NULL, map.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map.ptr == MAP_FAILED) {
+            map.ptr = NULL;
+        } else {
+            // Objects are accessed individually, avoid reading ahead
+            posix_madvise(map.ptr, map.size, POSIX_MADV_RANDOM);
+        }
+    }
+    close(fd);
+#else
+    PL_ERR(p, "Memory-mapped cache files are not supported on this platform!");
+    return -1;
+#endif
+
+    if (!map.ptr) {
+        PL_ERR(p, "Failed loading cache: could not map '%s' into memory", path);
+        return -1;
+    }
+
+    // Hold the lock while indexing, to prevent a concurrent `pl_cache_reset`
+    // from missing either the objects or the mapping
+    pl_mutex_lock(&p->lock);
+    int num_loaded = pl_cache_load_mapped(cache, map.ptr, map.size);
+    const struct cache_header *header = map.ptr;
+    if (num_loaded <= 0 || map.size < sizeof(*header) ||
+        header->version != MAPPED_VERSION)
+    {
+        // Nothing references the mapping, either because no objects were
+        // loaded, or because they were copied from a legacy format file
+        pl_mutex_unlock(&p->lock);
+        unmap_file(map);
+        return num_loaded;
+    }
+
+    // Objects reference the mapping directly, so keep it alive until they're
+    // removed by `pl_cache_reset` or `pl_cache_destroy`
+    PL_ARRAY_APPEND((void *) cache, p->mappings, map);
+    pl_mutex_unlock(&p->lock);
+    return num_loaded;
+}
@@ -0,0 +1,564 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <limits.h>
+
+#include "common.h"
+#include "cache.h"
+#include "log.h"
+#include "pl_thread.h"
+
+#ifdef PL_HAVE_WIN32
+#define fseeko _fseeki64
+#define ftello _ftelli64
+typedef int64_t off_t;
+#endif
+
+const struct pl_cache_journal_params pl_cache_journal_default_params = { PL_CACHE_JOURNAL_DEFAULTS };
+
+#define JOURNAL_MAGIC   "pl_cjrnl"
+#define JOURNAL_VERSION 1
+#define PAD_ALIGN(x)    PL_ALIGN2(x, sizeof(uint32_t))
+
+struct __attribute__((__packed__)) journal_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Same layout as the entries written by `pl_cache_save`. Records with a size
+// of 0 mark deleted objects.
+struct __attribute__((__packed__)) journal_record {
+    uint64_t key;
+    uint64_t size;
+    uint64_t hash;
+};
+
+#define RECORD_SIZE(size) (sizeof(struct journal_record) + PAD_ALIGN(size))
+
+// In-memory index entry, pointing at the most recent record for a key
+struct jnode {
+    uint64_t key;
+    uint64_t hash;
+    size_t size;
+    off_t offset;           // offset of the record (not the data)
+    struct jnode *hnext;
+};
+
+// Snapshot of a live record, used during compaction
+struct jmove {
+    uint64_t key;
+    size_t size;
+    off_t old_offset;
+    off_t new_offset;
+};
+
+struct pl_cache_journal_t {
+    struct pl_cache_journal_params params;
+    pl_log log;
+    char *path;
+
+    pl_mutex lock;
+    pl_cond wakeup;
+    pl_thread thread;
+    bool thread_ok;
+    bool exit;
+    bool want_compact;
+    bool compacting;
+    bool broken;            // write error, stop appending
+
+    FILE *file;
+    off_t end;              // logical end of the journal
+    size_t live_bytes;      // size of all records referenced by the index
+    struct jnode **buckets; // power of two
+    int num_buckets;
+    int num_nodes;
+};
+
+static inline struct jnode **jbucket(pl_cache_journal j, uint64_t key)
+{
+    uint64_t h = key * UINT64_C(0x9e3779b97f4a7c15);
+    return &j->buckets[(h >> 32) & (j->num_buckets - 1)];
+}
+
+static struct jnode **jfind(pl_cache_journal j, uint64_t key)
+{
+    struct jnode **link = jbucket(j, key);
+    while (*link && (*link)->key != key)
+        link = &(*link)->hnext;
+    return link;
+}
+
+static void jremove(pl_cache_journal j, uint64_t key)
+{
+    struct jnode **link = jfind(j, key);
+    struct jnode *node = *link;
+    if (!node)
+        return;
+
+    *link = node->hnext;
+    j->live_bytes -= RECORD_SIZE(node->size);
+    j->num_nodes--;
+    pl_free(node);
+}
+
+static void jinsert(pl_cache_journal j, const struct journal_record *rec, off_t offset)
+{
+    jremove(j, rec->key);
+
+    if (j->num_nodes >= j->num_buckets) {
+        struct jnode **old = j->buckets;
+        const int num_old = j->num_buckets;
+        j->num_buckets *= 2;
+        j->buckets = pl_calloc_ptr(j, j->num_buckets, j->buckets);
+        for (int i = 0; i < num_old; i++) {
+            struct jnode *node = old[i];
+            while (node) {
+                struct jnode *next = node->hnext;
+                struct jnode **head = jbucket(j, node->key);
+                node->hnext = *head;
+                *head = node;
+                node = next;
+            }
+        }
+        pl_free(old);
+    }
+
+    struct jnode **head = jbucket(j, rec->key);
+    struct jnode *node = pl_alloc_ptr(j, node);
+    *node = (struct jnode) {
+        .key    = rec->key,
+        .hash   = rec->hash,
+        .size   = rec->size,
+        .offset = offset,
+        .hnext  = *head,
+    };
+    *head = node;
+    j->live_bytes += RECORD_SIZE(rec->size);
+    j->num_nodes++;
+}
+
+static inline size_t dead_bytes(pl_cache_journal j)
+{
+    return j->end - sizeof(struct journal_header) - j->live_bytes;
+}
+
+// Copy `size` bytes from the current position of `src` to `dst`
+static bool copy_bytes(FILE *dst, FILE *src, uint64_t size)
+{
+    uint8_t buf[64 << 10];
+    while (size) {
+        size_t chunk = PL_MIN(size, sizeof(buf));
+        if (fread(buf, 1, chunk, src) != chunk)
+            return false;
+        if (fwrite(buf, 1, chunk, dst) != chunk)
+            return false;
+        size -= chunk;
+    }
+    return true;
+}
+
+// Rewrites the journal, dropping all stale records. Must be called with
+// `j->lock` held, but releases it while copying the bulk of the data. Records
+// appended in the meantime are carried over afterwards.
+static bool compact(pl_cache_journal j)
+{
+    while (j->compacting)
+        pl_cond_wait(&j->wakeup, &j->lock);
+    if (j->broken)
+        return false;
+
+    j->compacting = true;
+    pl_clock_t start = pl_clock_now();
+    const size_t dead = dead_bytes(j);
+
+    // Snapshot all live records
+    const off_t snapshot_end = j->end;
+    struct jmove *moves = pl_calloc_ptr(NULL, j->num_nodes, moves);
+    int num_moves = 0;
+    off_t new_end = sizeof(struct journal_header);
+    for (int i = 0; i < j->num_buckets; i++) {
+        for (struct jnode *node = j->buckets[i]; node; node = node->hnext) {
+            moves[num_moves++] = (struct jmove) {
+                .key        = node->key,
+                .size       = node->size,
+                .old_offset = node->offset,
+                .new_offset = new_end,
+            };
+            new_end += RECORD_SIZE(node->size);
+        }
+    }
+    pl_mutex_unlock(&j->lock);
+
+    char *tmp_path = pl_asprintf(NULL, "%s.tmp", j->path);
+    FILE *src = fopen(j->path, "rb");
+    FILE *dst = fopen(tmp_path, "wb");
+    bool ok = src && dst;
+    if (ok) {
+        ok = fwrite(&(struct journal_header) {
+            .magic   = JOURNAL_MAGIC,
+            .version = JOURNAL_VERSION,
+        }, sizeof(struct journal_header), 1, dst) == 1;
+    }
+
+    for (int i = 0; ok && i < num_moves; i++) {
+        ok = fseeko(src, moves[i].old_offset, SEEK_SET) == 0 &&
+             copy_bytes(dst, src, RECORD_SIZE(moves[i].size));
+    }
+
+    if (src)
+        fclose(src);
+
+    pl_mutex_lock(&j->lock);
+
+    // Carry over records appended while the lock was released
+    const off_t tail_size = j->end - snapshot_end;
+    if (ok) {
+        ok = fseeko(j->file, snapshot_end, SEEK_SET) == 0 &&
+             copy_bytes(dst, j->file, tail_size) &&
+             fflush(dst) == 0;
+    }
+
+    if (dst)
+        ok &= fclose(dst) == 0;
+
+    if (ok) {
+        fclose(j->file);
+#ifdef PL_HAVE_WIN32
+        remove(j->path); // rename() does not overwrite on windows
+#endif
+        ok = rename(tmp_path, j->path) == 0;
+        j->file = fopen(j->path, "r+b");
+        if (!j->file) {
+            PL_ERR(j, "Failed re-opening cache journal '%s', disabling!", j->path);
+            j->broken = true;
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        // Rebase all offsets to the new file
+        for (int i = 0; i < num_moves; i++) {
+            struct jnode *node = *jfind(j, moves[i].key);
+            if (node && node->offset == moves[i].old_offset)
+                node->offset = moves[i].new_offset;
+        }
+        for (int i = 0; i < j->num_buckets; i++) {
+            for (struct jnode *node = j->buckets[i]; node; node = node->hnext) {
+                if (node->offset >= snapshot_end)
+                    node->offset += new_end - snapshot_end;
+            }
+        }
+
+        j->end = new_end + tail_size;
+        pl_log_cpu_time(j->log, start, pl_clock_now(), "compacting cache journal");
+        PL_DEBUG(j, "Compacted cache journal, reclaimed %zu bytes", dead);
+    } else {
+        PL_WARN(j, "Failed compacting cache journal '%s'", j->path);
+        remove(tmp_path);
+    }
+
+    pl_free(tmp_path);
+    pl_free(moves);
+    j->compacting = false;
+    pl_cond_broadcast(&j->wakeup);
+    return ok;
+}
+
+static PL_THREAD_VOID compact_thread(void *arg)
+{
+    pl_cache_journal j = arg;
+    pl_mutex_lock(&j->lock);
+    while (!j->exit) {
+        if (!j->want_compact) {
+            pl_cond_wait(&j->wakeup, &j->lock);
+            continue;
+        }
+
+        j->want_compact = false;
+        compact(j);
+    }
+    pl_mutex_unlock(&j->lock);
+    PL_THREAD_RETURN();
+}
+
+static void maybe_compact(pl_cache_journal j)
+{
+    if (!j->params.compact_threshold)
+        return;
+
+    size_t dead = dead_bytes(j);
+    if (dead < j->params.compact_threshold || dead < j->live_bytes)
+        return;
+    if (j->want_compact || j->compacting || !j->thread_ok)
+        return;
+
+    j->want_compact = true;
+    pl_cond_broadcast(&j->wakeup);
+}
+
+// Scans the existing journal and builds the index. Returns false if the
+// journal ended in a torn or corrupt record.
+static bool scan_journal(pl_cache_journal j, off_t file_size)
+{
+    off_t pos = sizeof(struct journal_header);
+    bool clean = true;
+    while (pos < file_size) {
+        struct journal_record rec;
+        if (fseeko(j->file, pos, SEEK_SET) != 0 ||
+            fread(&rec, sizeof(rec), 1, j->file) != 1)
+        {
+            clean = false;
+            break;
+        }
+
+        if (rec.size > file_size - pos - sizeof(rec) ||
+            RECORD_SIZE(rec.size) > file_size - pos)
+        {
+            clean = false;
+            break;
+        }
+
+        if (rec.size) {
+            jinsert(j, &rec, pos);
+        } else {
+            jremove(j, rec.key);
+        }
+        pos += RECORD_SIZE(rec.size);
+    }
+
+    j->end = pos;
+    if (!clean)
+        PL_WARN(j, "Cache journal '%s' seems truncated, discarding %"PRId64" bytes",
+                j->path, (int64_t) (file_size - pos));
+    return clean;
+}
+
+pl_cache_journal pl_cache_journal_create(const struct pl_cache_journal_params *params)
+{
+    pl_assert(params && params->path);
+    pl_cache_journal j = pl_zalloc_ptr(NULL, j);
+    j->params = *params;
+    j->log = params->log;
+    j->path = pl_str0dup0(j, params->path);
+    j->params.path = j->path;
+    j->num_buckets = 64;
+    j->buckets = pl_calloc_ptr(j, j->num_buckets, j->buckets);
+    pl_mutex_init(&j->lock);
+    pl_cond_init(&j->wakeup);
+
+    pl_clock_t start = pl_clock_now();
+    struct journal_header header = {0};
+    off_t file_size = 0;
+    j->file = fopen(j->path, "r+b");
+    if (j->file) {
+        if (fseeko(j->file, 0, SEEK_END) == 0)
+            file_size = ftello(j->file);
+        rewind(j->file);
+        if (file_size && fread(&header, sizeof(header), 1, j->file) == 1 &&
+            memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0)
+        {
+            PL_ERR(j, "File '%s' is not a cache journal, refusing to overwrite!",
+                   j->path);
+            goto error;
+        }
+    }
+
+    if (!j->file || header.version != JOURNAL_VERSION) {
+        if (j->file) {
+            if (file_size)
+                PL_INFO(j, "Cache journal '%s' has wrong version... discarding", j->path);
+            fclose(j->file);
+        }
+
+        j->file = fopen(j->path, "w+b");
+        if (!j->file) {
+            PL_ERR(j, "Failed creating cache journal '%s'", j->path);
+            goto error;
+        }
+
+        header = (struct journal_header) {
+            .magic   = JOURNAL_MAGIC,
+            .version = JOURNAL_VERSION,
+        };
+        if (fwrite(&header, sizeof(header), 1, j->file) != 1 || fflush(j->file) != 0) {
+            PL_ERR(j, "Failed writing cache journal '%s'", j->path);
+            goto error;
+        }
+        file_size = sizeof(header);
+    }
+
+    if (!scan_journal(j, file_size)) {
+        // Rewrite the journal to get rid of the garbage at the end
+        pl_mutex_lock(&j->lock);
+        bool ok = compact(j);
+        pl_mutex_unlock(&j->lock);
+        if (!ok)
+            goto error;
+    }
+
+    pl_log_cpu_time(j->log, start, pl_clock_now(), "opening cache journal");
+    PL_DEBUG(j, "Opened cache journal '%s' with %d objects, %zu stale bytes",
+             j->path, j->num_nodes, dead_bytes(j));
+
+    j->thread_ok = pl_thread_create(&j->thread, compact_thread, j) == 0;
+    if (!j->thread_ok)
+        PL_WARN(j, "Failed creating compaction thread, only compacting on demand");
+
+    return j;
+
+error:
+    if (j->file)
+        fclose(j->file);
+    pl_cond_destroy(&j->wakeup);
+    pl_mutex_destroy(&j->lock);
+    pl_free(j);
+    return NULL;
+}
+
+void pl_cache_journal_destroy(pl_cache_journal *pjournal)
+{
+    pl_cache_journal j = *pjournal;
+    if (!j)
+        return;
+
+    if (j->thread_ok) {
+        pl_mutex_lock(&j->lock);
+        j->exit = true;
+        pl_cond_broadcast(&j->wakeup);
+        pl_mutex_unlock(&j->lock);
+        pl_thread_join(j->thread);
+    }
+
+    if (j->file)
+        fclose(j->file);
+    pl_cond_destroy(&j->wakeup);
+    pl_mutex_destroy(&j->lock);
+    pl_free(j);
+    *pjournal = NULL;
+}
+
+// Appends a record (and its data, if any) at the end of the journal
+static bool append(pl_cache_journal j, const struct journal_record *rec,
+                   const void *data)
+{
+    static const uint8_t padding[PAD_ALIGN(1)] = {0};
+    const size_t pad = PAD_ALIGN(rec->size) - rec->size;
+    bool ok = fseeko(j->file, j->end, SEEK_SET) == 0 &&
+              fwrite(rec, sizeof(*rec), 1, j->file) == 1 &&
+              (!rec->size || fwrite(data, rec->size, 1, j->file) == 1) &&
+              (!pad || fwrite(padding, pad, 1, j->file) == 1) &&
+              fflush(j->file) == 0;
+
+    if (!ok) {
+        PL_ERR(j, "Failed writing to cache journal '%s', disabling!", j->path);
+        j->broken = true;
+        return false;
+    }
+
+    j->end += RECORD_SIZE(rec->size);
+    return true;
+}
+
+void pl_cache_journal_set(void *priv, pl_cache_obj obj)
+{
+    pl_cache_journal j = priv;
+    struct journal_record rec = {
+        .key  = obj.key,
+        .size = obj.size,
+        .hash = obj.size ? pl_mem_hash(obj.data, obj.size) : 0,
+    };
+
+    pl_mutex_lock(&j->lock);
+    if (j->broken)
+        goto done;
+
+    struct jnode *node = *jfind(j, obj.key);
+    if (!obj.size) {
+        if (node && append(j, &rec, NULL)) {
+            PL_TRACE(j, "Journaling deletion of object 0x%"PRIx64, obj.key);
+            jremove(j, obj.key);
+        }
+        goto done;
+    }
+
+    // Objects are usually re-inserted unmodified after use, skip those
+    if (node && node->size == rec.size && node->hash == rec.hash)
+        goto done;
+
+    const off_t offset = j->end;
+    if (append(j, &rec, obj.data)) {
+        PL_TRACE(j, "Journaling object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+        jinsert(j, &rec, offset);
+    }
+
+    // fall through
+done:
+    maybe_compact(j);
+    pl_mutex_unlock(&j->lock);
+}
+
+pl_cache_obj pl_cache_journal_get(void *priv, uint64_t key)
+{
+    pl_cache_journal j = priv;
+    pl_mutex_lock(&j->lock);
+    struct jnode *node = *jfind(j, key);
+    if (!node || j->broken) {
+        pl_mutex_unlock(&j->lock);
+        return (pl_cache_obj) { .key = key };
+    }
+
+    const uint64_t hash = node->hash;
+    const size_t size = node->size;
+    void *data = pl_alloc(NULL, size);
+    bool ok = fseeko(j->file, node->offset + sizeof(struct journal_record), SEEK_SET) == 0 &&
+              fread(data, size, 1, j->file) == 1;
+    pl_mutex_unlock(&j->lock);
+
+    if (!ok || pl_mem_hash(data, size) != hash) {
+        PL_WARN(j, "Cache journal object 0x%"PRIx64" seems corrupt.. ignoring", key);
+        pl_free(data);
+        return (pl_cache_obj) { .key = key };
+    }
+
+    PL_TRACE(j, "Loaded object 0x%"PRIx64" (size %zu) from journal", key, size);
+    return (pl_cache_obj) {
+        .key  = key,
+        .data = data,
+        .size = size,
+        .free = pl_free,
+    };
+}
+
+bool pl_cache_journal_compact(pl_cache_journal journal)
+{
+    pl_cache_journal j = journal;
+    pl_mutex_lock(&j->lock);
+    bool ok = compact(j);
+    pl_mutex_unlock(&j->lock);
+    return ok;
+}
+
+size_t pl_cache_journal_size(pl_cache_journal journal)
+{
+    pl_cache_journal j = journal;
+    pl_mutex_lock(&j->lock);
+    size_t size = j->end;
+    pl_mutex_unlock(&j->lock);
+    return size;
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Binary interface between the CPU backend and the shader modules it
+// compiles. The definitions are wrapped in a macro so the exact same text can
+// be embedded into the generated C++ code (see `pl_cpu_runtime`), which keeps
+// both sides from drifting apart. Only plain C types may be used here.
+#define PL_CPU_ABI(X) X(                                                        \
+                                                                                \
+    enum { PL_CPU_ABI_VERSION = 1 };                                            \
+                                                                                \
+    /* Texture bound to a sampler. `data` points to tightly packed RGBA     */  \
+    /* texels, stored as `float`, or as `int32_t` / `uint32_t` for integer  */  \
+    /* formats. Unused dimensions are 1.                                    */  \
+    struct pl_cpu_tex {                                                         \
+        const void *data;                                                       \
+        int w, h, d;                                                            \
+        int linear;     /* enum pl_tex_sample_mode */                           \
+        int address;    /* enum pl_tex_address_mode */                          \
+    };                                                                          \
+                                                                                \
+    /* Resources bound to a pass, in the order of `pl_pass_params`, with    */  \
+    /* texture array elements stored consecutively. `vars` points to the    */  \
+    /* host layout (see `pl_var_host_layout`) of each var.                  */  \
+    struct pl_cpu_bindings {                                                    \
+        const void *const *vars;                                                \
+        const struct pl_cpu_tex *descs;                                         \
+    };                                                                          \
+                                                                                \
+    /* Horizontal run of pixels to shade, all inside row `y`. `vary` holds  */  \
+    /* the varyings at the center of pixel `x0`, and `vary_dx` their        */  \
+    /* derivative along x. The fragment shader writes one RGBA color to     */  \
+    /* `out` and one coverage flag (0 for discarded pixels) to `mask` for   */  \
+    /* each pixel.                                                          */  \
+    struct pl_cpu_span {                                                        \
+        int x0, x1, y;                                                          \
+        const float *vary;                                                      \
+        const float *vary_dx;                                                   \
+        float *out;                                                             \
+        unsigned char *mask;                                                    \
+    };                                                                          \
+                                                                                \
+    /* Entry points of a compiled shader module, exported as the symbol     */  \
+    /* `pl_cpu_entry`. Shader instances are constructed in caller-provided  */  \
+    /* memory of `*_size` bytes, suitably aligned for any scalar type, and  */  \
+    /* must only be used by one thread at a time.                           */  \
+    struct pl_cpu_module {                                                      \
+        int abi_version;                                                        \
+        int num_varyings;   /* floats per vertex, excluding gl_Position */      \
+        unsigned long vert_size;                                                \
+        unsigned long frag_size;                                                \
+                                                                                \
+        /* `attribs` holds 4 floats per vertex attribute, and `out` is      */  \
+        /* filled with gl_Position followed by all varyings.                */  \
+        void (*vert_create)(void *mem, const struct pl_cpu_bindings *bind);     \
+        void (*vert_run)(void *vert, const float *attribs, float *out);         \
+        void (*vert_destroy)(void *vert);                                       \
+                                                                                \
+        void (*frag_create)(void *mem, const struct pl_cpu_bindings *bind);     \
+        void (*frag_run)(void *frag, const struct pl_cpu_span *span);           \
+        void (*frag_destroy)(void *frag);                                       \
+    };                                                                          \
+)
+
+#define PL_CPU_ABI_DEFINE(...) __VA_ARGS__
+#define PL_CPU_ABI_STRING(...) #__VA_ARGS__
+
+PL_CPU_ABI(PL_CPU_ABI_DEFINE)
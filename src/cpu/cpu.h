@@ -0,0 +1,48 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// CPU execution backend for the dummy GPU. Raster passes are executed by
+// translating their GLSL to C++ (see translate.c), compiling the result into
+// a shared object with the host C++ compiler, and rasterizing the geometry
+// on the CPU, spread across the shared thread pool.
+
+#include "gpu.h"
+#include "abi.h"
+
+// Source code of the C++ runtime, prepended to every translated shader
+extern const char pl_cpu_runtime[];
+
+// Translate a raster pass into C++ source code for a module implementing
+// `struct pl_cpu_module`, exported as `pl_cpu_entry`.
+pl_str pl_cpu_translate(void *alloc, const struct pl_pass_params *params);
+
+// Texel conversion helpers. `pl_cpu_decode` converts to RGBA, with missing
+// components filled in as (0, 0, 0, 1), as either normalized floats or raw
+// 32-bit integers depending on the format type; which is the layout expected
+// by `struct pl_cpu_tex`. `pl_cpu_decode_float` always produces floats.
+void pl_cpu_decode(pl_fmt fmt, const void *src, void *dst, size_t num);
+void pl_cpu_decode_float(pl_fmt fmt, const void *src, float *dst, size_t num);
+void pl_cpu_encode(pl_fmt fmt, const float *src, void *dst, size_t num);
+
+// Implementation of the `pl_pass` functions. `compiler` is the command line
+// used to invoke the C++ compiler.
+pl_pass pl_cpu_pass_create(pl_gpu gpu, const struct pl_pass_params *params,
+                           const char *compiler);
+void pl_cpu_pass_destroy(pl_gpu gpu, pl_pass pass);
+void pl_cpu_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params);
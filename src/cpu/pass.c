@@ -0,0 +1,661 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dlfcn.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "log.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
+#include "cpu.h"
+
+#include <libplacebo/dummy.h>
+
+extern char **environ;
+
+// Compiled shader module, shared by all passes in this process which were
+// created from the same source. These are deliberately only ever kept in
+// memory, and never stored in a `pl_cache`, since loading a module amounts to
+// running arbitrary native code.
+struct cpu_module {
+    struct cpu_module *next;
+    uint64_t key;
+    void *handle; // from dlopen()
+    const struct pl_cpu_module *mod;
+    int refs;
+};
+
+static pl_static_mutex module_lock = PL_STATIC_MUTEX_INITIALIZER;
+static struct cpu_module *modules;
+
+struct pl_pass_cpu {
+    struct cpu_module *module;
+    const struct pl_cpu_module *mod;
+    void **var_data; // current value of each variable, in host layout
+};
+
+// Temporary directory holding the files for one compilation
+struct workdir {
+    char dir[512];
+    char src[576];
+    char lib[576];
+    char log[576];
+};
+
+static bool workdir_create(pl_gpu gpu, struct workdir *wd)
+{
+    // Intentionally ignores $TMPDIR, the directory is private (0700) anyway
+    static const char tmp[] = "/tmp";
+    snprintf(wd->dir, sizeof(wd->dir), "%s/libplacebo-XXXXXX", tmp);
+    if (!mkdtemp(wd->dir)) {
+        PL_ERR(gpu, "Failed creating temporary directory in '%s': %s",
+               tmp, strerror(errno));
+        return false;
+    }
+
+    snprintf(wd->src, sizeof(wd->src), "%s/module.cc", wd->dir);
+    snprintf(wd->lib, sizeof(wd->lib), "%s/module.so", wd->dir);
+    snprintf(wd->log, sizeof(wd->log), "%s/compile.log", wd->dir);
+    return true;
+}
+
+static void workdir_destroy(struct workdir *wd)
+{
+    unlink(wd->src);
+    unlink(wd->lib);
+    unlink(wd->log);
+    rmdir(wd->dir);
+}
+
+static bool write_file(pl_gpu gpu, const char *path, pl_str data)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        PL_ERR(gpu, "Failed opening '%s' for writing: %s", path, strerror(errno));
+        return false;
+    }
+
+    bool ok = fwrite(data.buf, 1, data.len, f) == data.len;
+    ok &= fclose(f) == 0;
+    if (!ok)
+        PL_ERR(gpu, "Failed writing to '%s'", path);
+    return ok;
+}
+
+static bool read_file(void *alloc, const char *path, pl_str *out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+        pl_str_append(alloc, out, (pl_str) { (uint8_t *) buf, len });
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// Compiles `src` into a shared object at `wd->lib`, using the compiler
+// command line `compiler`
+static bool compile_module(pl_gpu gpu, const struct workdir *wd,
+                           const char *compiler, pl_str src)
+{
+    void *tmp = pl_tmp(NULL);
+    bool ok = false;
+
+    if (!write_file(gpu, wd->src, src))
+        goto done;
+
+    static const char *const flags[] = {
+        "-std=c++17", "-O2", "-fPIC", "-shared", "-fwrapv", "-fno-math-errno",
+        "-fvisibility=hidden", "-w", "-o",
+    };
+
+    PL_ARRAY(char *) argv = {0};
+    pl_str cmd = pl_str0(compiler);
+    while (cmd.len) {
+        pl_str arg = pl_str_split_chars(cmd, " \t", &cmd);
+        if (arg.len)
+            PL_ARRAY_APPEND(tmp, argv, pl_strdup0(tmp, arg));
+    }
+
+    if (!argv.num) {
+        PL_ERR(gpu, "Empty compiler command line!");
+        goto done;
+    }
+
+    for (int i = 0; i < PL_ARRAY_SIZE(flags); i++)
+        PL_ARRAY_APPEND(tmp, argv, (char *) flags[i]);
+    PL_ARRAY_APPEND(tmp, argv, (char *) wd->lib);
+    PL_ARRAY_APPEND(tmp, argv, (char *) wd->src);
+    PL_ARRAY_APPEND(tmp, argv, NULL);
+
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        goto done;
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, wd->log,
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv.elem[0], &actions, NULL, argv.elem, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err) {
+        PL_ERR(gpu, "Failed running C++ compiler '%s': %s", argv.elem[0], strerror(err));
+        goto done;
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            PL_ERR(gpu, "Failed waiting for C++ compiler: %s", strerror(errno));
+            goto done;
+        }
+    }
+
+    ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!ok) {
+        pl_str log = {0};
+        read_file(tmp, wd->log, &log);
+        PL_ERR(gpu, "Failed compiling shader module:\n%.*s", PL_STR_FMT(log));
+    }
+
+done:
+    pl_free(tmp);
+    return ok;
+}
+
+// Returns a new reference to the module with the given key, or NULL
+static struct cpu_module *module_ref(uint64_t key)
+{
+    pl_static_mutex_lock(&module_lock);
+    struct cpu_module *module = modules;
+    while (module && module->key != key)
+        module = module->next;
+    if (module)
+        module->refs++;
+    pl_static_mutex_unlock(&module_lock);
+    return module;
+}
+
+static void module_unref(struct cpu_module *module)
+{
+    if (!module)
+        return;
+
+    pl_static_mutex_lock(&module_lock);
+    bool last = --module->refs == 0;
+    if (last) {
+        struct cpu_module **prev = &modules;
+        while (*prev != module)
+            prev = &(*prev)->next;
+        *prev = module->next;
+    }
+    pl_static_mutex_unlock(&module_lock);
+
+    if (last) {
+        dlclose(module->handle);
+        pl_free(module);
+    }
+}
+
+// Loads the module at `path` and registers it under `key`, returning a new
+// reference to it. If another thread registered the same module in the
+// meantime, that one is returned instead.
+static struct cpu_module *module_load(pl_gpu gpu, uint64_t key, const char *path)
+{
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        PL_ERR(gpu, "Failed loading shader module: %s", dlerror());
+        return NULL;
+    }
+
+    const struct pl_cpu_module *mod = dlsym(handle, "pl_cpu_entry");
+    if (!mod || mod->abi_version != PL_CPU_ABI_VERSION) {
+        PL_ERR(gpu, "Shader module is missing a valid entry point!");
+        dlclose(handle);
+        return NULL;
+    }
+
+    struct cpu_module *module = module_ref(key);
+    if (module) {
+        dlclose(handle);
+        return module;
+    }
+
+    module = pl_alloc_ptr(NULL, module);
+    *module = (struct cpu_module) {
+        .key = key,
+        .handle = handle,
+        .mod = mod,
+        .refs = 1,
+    };
+
+    pl_static_mutex_lock(&module_lock);
+    module->next = modules;
+    modules = module;
+    pl_static_mutex_unlock(&module_lock);
+    return module;
+}
+
+pl_pass pl_cpu_pass_create(pl_gpu gpu, const struct pl_pass_params *params,
+                           const char *compiler)
+{
+    if (params->type != PL_PASS_RASTER) {
+        PL_ERR(gpu, "Only raster passes are supported by the CPU backend!");
+        return NULL;
+    }
+
+    for (int i = 0; i < params->num_descriptors; i++) {
+        if (params->descriptors[i].type != PL_DESC_SAMPLED_TEX) {
+            PL_ERR(gpu, "Descriptor '%s' has a type not supported by the CPU backend!",
+                   params->descriptors[i].name);
+            return NULL;
+        }
+    }
+
+    struct pl_pass_t *pass = pl_zalloc_obj(NULL, pass, struct pl_pass_cpu);
+    struct pl_pass_cpu *pass_cpu = PL_PRIV(pass);
+    pass->params = pl_pass_params_copy(pass, params);
+
+    pass_cpu->var_data = pl_calloc_ptr(pass, params->num_variables, pass_cpu->var_data);
+    for (int i = 0; i < params->num_variables; i++) {
+        struct pl_var_layout layout = pl_var_host_layout(0, &params->variables[i]);
+        pass_cpu->var_data[i] = pl_zalloc(pass, layout.size);
+    }
+
+    void *tmp = pl_tmp(NULL);
+    pl_str src = pl_cpu_translate(tmp, params);
+    uint64_t key = pl_str_hash(src);
+    pl_hash_merge(&key, pl_str0_hash(compiler));
+
+    pass_cpu->module = module_ref(key);
+    if (pass_cpu->module) {
+        PL_DEBUG(gpu, "Reusing already compiled shader module");
+    } else {
+        struct workdir wd;
+        if (!workdir_create(gpu, &wd))
+            goto error;
+
+        pl_clock_t start = pl_clock_now();
+        bool ok = compile_module(gpu, &wd, compiler, src);
+        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "compiling shader");
+        if (ok) {
+            pass_cpu->module = module_load(gpu, key, wd.lib);
+        } else {
+            PL_MSG(gpu, PL_LOG_DEBUG, "Translated shader source:");
+            pl_msg_source(gpu->log, PL_LOG_DEBUG, (const char *) src.buf);
+        }
+
+        workdir_destroy(&wd);
+        if (!pass_cpu->module)
+            goto error;
+    }
+
+    pass_cpu->mod = pass_cpu->module->mod;
+    pl_free(tmp);
+    return pass;
+
+error:
+    pl_free(tmp);
+    pl_cpu_pass_destroy(gpu, pass);
+    return NULL;
+}
+
+void pl_cpu_pass_destroy(pl_gpu gpu, pl_pass pass)
+{
+    struct pl_pass_cpu *pass_cpu = PL_PRIV(pass);
+    module_unref(pass_cpu->module);
+    pl_free((void *) pass);
+}
+
+// Screen space vertex, followed by the varyings
+struct vertex {
+    double x, y;
+    const float *vary;
+};
+
+struct triangle {
+    struct vertex v[3];
+    double area;
+    pl_rect2d bbox;
+};
+
+struct raster_args {
+    const struct pl_pass_run_params *params;
+    const struct pl_cpu_module *mod;
+    const struct pl_cpu_bindings *bind;
+    const struct triangle *tris;
+    int num_tris;
+    int num_varyings;
+    pl_rect2d rc;
+    uint8_t *data;
+    size_t stride;
+};
+
+// Edge function of the edge a -> b at point p. This is evaluated in the same
+// order for both directions of an edge, so pixels on an edge shared by two
+// triangles always end up in exactly one of them.
+static inline double edge(const struct vertex *a, const struct vertex *b,
+                          double px, double py)
+{
+    if (a->x > b->x || (a->x == b->x && a->y > b->y))
+        return -edge(b, a, px, py);
+    return (b->x - a->x) * (py - a->y) - (b->y - a->y) * (px - a->x);
+}
+
+// Tie-breaking rule for pixels exactly on an edge
+static inline bool edge_owned(const struct vertex *a, const struct vertex *b)
+{
+    const double dx = b->x - a->x, dy = b->y - a->y;
+    return dy > 0 || (dy == 0 && dx > 0);
+}
+
+static inline bool inside(const struct triangle *tri, double px, double py)
+{
+    for (int i = 0; i < 3; i++) {
+        const struct vertex *a = &tri->v[i], *b = &tri->v[(i + 1) % 3];
+        const double e = edge(a, b, px, py);
+        if (e < 0 || (e == 0 && !edge_owned(a, b)))
+            return false;
+    }
+
+    return true;
+}
+
+static inline float blend_factor(enum pl_blend_mode mode, float src_alpha)
+{
+    switch (mode) {
+    case PL_BLEND_ZERO: return 0.0f;
+    case PL_BLEND_ONE: return 1.0f;
+    case PL_BLEND_SRC_ALPHA: return src_alpha;
+    case PL_BLEND_ONE_MINUS_SRC_ALPHA: return 1.0f - src_alpha;
+    case PL_BLEND_MODE_COUNT: break;
+    }
+
+    pl_unreachable();
+}
+
+static void raster_rows(void *priv, int start, int end)
+{
+    const struct raster_args *args = priv;
+    const struct pl_cpu_module *mod = args->mod;
+    const struct pl_pass_params *pp = &args->params->pass->params;
+    const struct pl_blend_params *blend = pp->blend_params;
+    const pl_fmt fmt = pp->target_format;
+    const int width = pl_rect_w(args->rc), nv = args->num_varyings;
+
+    void *tmp = pl_tmp(NULL);
+    void *frag = pl_zalloc(tmp, PL_MAX(mod->frag_size, 1));
+    float *vary = pl_calloc(tmp, 2 * nv + 1, sizeof(float));
+    float *vary_dx = vary + nv;
+    float *out = pl_calloc(tmp, 4 * width, sizeof(float));
+    uint8_t *mask = pl_zalloc(tmp, width);
+    mod->frag_create(frag, args->bind);
+
+    for (int y = args->rc.y0 + start; y < args->rc.y0 + end; y++) {
+        const double py = y + 0.5;
+        uint8_t *row = args->data + y * args->stride;
+
+        for (int t = 0; t < args->num_tris; t++) {
+            const struct triangle *tri = &args->tris[t];
+            if (y < tri->bbox.y0 || y >= tri->bbox.y1)
+                continue;
+
+            // Triangles are convex, so the covered pixels are contiguous
+            int x0 = tri->bbox.x0, x1 = tri->bbox.x1;
+            while (x0 < x1 && !inside(tri, x0 + 0.5, py))
+                x0++;
+            while (x1 > x0 && !inside(tri, x1 - 0.5, py))
+                x1--;
+            if (x0 == x1)
+                continue;
+
+            // Interpolate the varyings linearly in screen space
+            const struct vertex *v = tri->v;
+            const double px = x0 + 0.5;
+            const double w1 = edge(&v[2], &v[0], px, py) / tri->area;
+            const double w2 = edge(&v[0], &v[1], px, py) / tri->area;
+            const double dw1 = (v[2].y - v[0].y) / tri->area;
+            const double dw2 = (v[0].y - v[1].y) / tri->area;
+            for (int i = 0; i < nv; i++) {
+                const double f0 = v[0].vary[i];
+                const double d1 = v[1].vary[i] - f0, d2 = v[2].vary[i] - f0;
+                vary[i] = f0 + w1 * d1 + w2 * d2;
+                vary_dx[i] = dw1 * d1 + dw2 * d2;
+            }
+
+            const struct pl_cpu_span span = {
+                .x0 = x0,
+                .x1 = x1,
+                .y = y,
+                .vary = vary,
+                .vary_dx = vary_dx,
+                .out = out,
+                .mask = mask,
+            };
+
+            mod->frag_run(frag, &span);
+
+            for (int i = 0; i < x1 - x0; i++) {
+                if (!mask[i])
+                    continue;
+
+                float *color = &out[4 * i];
+                uint8_t *dst = row + (x0 + i) * fmt->texel_size;
+                if (blend) {
+                    float cur[4];
+                    pl_cpu_decode_float(fmt, dst, cur, 1);
+                    const float a = color[3];
+                    for (int c = 0; c < 3; c++) {
+                        color[c] = color[c] * blend_factor(blend->src_rgb, a) +
+                                   cur[c] * blend_factor(blend->dst_rgb, a);
+                    }
+                    color[3] = a * blend_factor(blend->src_alpha, a) +
+                               cur[3] * blend_factor(blend->dst_alpha, a);
+                }
+
+                pl_cpu_encode(fmt, color, dst, 1);
+            }
+        }
+    }
+
+    mod->frag_destroy(frag);
+    pl_free(tmp);
+}
+
+static const void *get_buf_data(pl_buf buf, size_t offset, const void *ptr)
+{
+    return buf ? pl_buf_dummy_data(buf) + offset : ptr;
+}
+
+void pl_cpu_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
+{
+    pl_pass pass = params->pass;
+    struct pl_pass_cpu *pass_cpu = PL_PRIV(pass);
+    const struct pl_pass_params *pp = &pass->params;
+    const struct pl_cpu_module *mod = pass_cpu->mod;
+    pl_tex target = params->target;
+    void *tmp = pl_tmp(NULL);
+
+    for (int i = 0; i < params->num_var_updates; i++) {
+        const struct pl_var_update *vu = &params->var_updates[i];
+        struct pl_var_layout layout = pl_var_host_layout(0, &pp->variables[vu->index]);
+        memcpy(pass_cpu->var_data[vu->index], vu->data, layout.size);
+    }
+
+    // Convert all textures to the layout expected by the shader
+    int num_descs = 0;
+    for (int i = 0; i < pp->num_descriptors; i++)
+        num_descs += pl_desc_elems(&pp->descriptors[i]);
+
+    struct pl_cpu_tex *descs = pl_calloc_ptr(tmp, num_descs, descs);
+    for (int i = 0, idx = 0; i < pp->num_descriptors; i++) {
+        const struct pl_desc *desc = &pp->descriptors[i];
+        const struct pl_desc_binding *db = &params->desc_bindings[i];
+        for (int j = 0; j < pl_desc_elems(desc); j++, idx++) {
+            pl_tex tex = pl_desc_tex(desc, db, j);
+            if (j > 0 && tex == pl_desc_tex(desc, db, j - 1)) {
+                descs[idx] = descs[idx - 1]; // avoid decoding padding twice
+                continue;
+            }
+
+            const uint8_t *data = pl_tex_dummy_data(tex);
+            if (!data) {
+                PL_ERR(gpu, "Placeholder textures can not be sampled from!");
+                goto done;
+            }
+
+            descs[idx] = (struct pl_cpu_tex) {
+                .data = data,
+                .w = PL_DEF(tex->params.w, 1),
+                .h = PL_DEF(tex->params.h, 1),
+                .d = PL_DEF(tex->params.d, 1),
+                .linear = db->sample_mode == PL_TEX_SAMPLE_LINEAR,
+                .address = db->address_mode,
+            };
+
+            pl_fmt fmt = tex->params.format;
+            if (fmt->type != PL_FMT_FLOAT || fmt->texel_size != 4 * sizeof(float)) {
+                size_t num = (size_t) descs[idx].w * descs[idx].h * descs[idx].d;
+                void *texels = pl_alloc(tmp, num * 4 * sizeof(float));
+                pl_cpu_decode(fmt, data, texels, num);
+                descs[idx].data = texels;
+            }
+        }
+    }
+
+    const struct pl_cpu_bindings bind = {
+        .vars = (const void *const *) pass_cpu->var_data,
+        .descs = descs,
+    };
+
+    // Run the vertex shader on all vertices
+    const int nv = mod->num_varyings, vsize = 4 + nv;
+    const uint8_t *vdata = get_buf_data(params->vertex_buf, params->buf_offset,
+                                        params->vertex_data);
+    const void *idata = get_buf_data(params->index_buf, params->index_offset,
+                                     params->index_data);
+    float *verts = pl_calloc(tmp, (size_t) params->vertex_count * vsize, sizeof(float));
+    float *attribs = pl_calloc(tmp, 4 * pp->num_vertex_attribs + 1, sizeof(float));
+    void *vert = pl_zalloc(tmp, PL_MAX(mod->vert_size, 1));
+    mod->vert_create(vert, &bind);
+    for (int i = 0; i < params->vertex_count; i++) {
+        size_t idx = i;
+        if (idata) {
+            idx = params->index_fmt == PL_INDEX_UINT16 ? ((const uint16_t *) idata)[i]
+                                                       : ((const uint32_t *) idata)[i];
+        }
+
+        const uint8_t *vertex = vdata + idx * pp->vertex_stride;
+        for (int a = 0; a < pp->num_vertex_attribs; a++) {
+            const struct pl_vertex_attrib *va = &pp->vertex_attribs[a];
+            pl_cpu_decode_float(va->fmt, vertex + va->offset, &attribs[4 * a], 1);
+        }
+
+        mod->vert_run(vert, attribs, &verts[i * vsize]);
+    }
+    mod->vert_destroy(vert);
+
+    // Set up the triangles in screen space
+    const pl_rect2d vp = params->viewport;
+    const pl_rect2d sc = params->scissors;
+    const pl_rect2d rc = {
+        .x0 = PL_MAX3(sc.x0, vp.x0, 0),
+        .y0 = PL_MAX3(sc.y0, vp.y0, 0),
+        .x1 = PL_MIN(PL_MIN(sc.x1, vp.x1), target->params.w),
+        .y1 = PL_MIN(PL_MIN(sc.y1, vp.y1), target->params.h),
+    };
+
+    int num_tris = 0;
+    if (params->vertex_count >= 3) {
+        num_tris = pp->vertex_type == PL_PRIM_TRIANGLE_LIST ? params->vertex_count / 3
+                                                            : params->vertex_count - 2;
+    }
+
+    struct triangle *tris = pl_calloc_ptr(tmp, num_tris, tris);
+    int n = 0;
+    for (int t = 0; t < num_tris; t++) {
+        struct triangle *tri = &tris[n];
+        const int base = pp->vertex_type == PL_PRIM_TRIANGLE_LIST ? 3 * t : t;
+        for (int i = 0; i < 3; i++) {
+            const float *pos = &verts[(base + i) * vsize];
+            const double w = pos[3] ? pos[3] : 1.0;
+            tri->v[i] = (struct vertex) {
+                .x = vp.x0 + (pos[0] / w + 1.0) * 0.5 * pl_rect_w(vp),
+                .y = vp.y0 + (pos[1] / w + 1.0) * 0.5 * pl_rect_h(vp),
+                .vary = pos + 4,
+            };
+        }
+
+        tri->area = edge(&tri->v[0], &tri->v[1], tri->v[2].x, tri->v[2].y);
+        if (!isfinite(tri->area) || tri->area == 0)
+            continue;
+        if (tri->area < 0) {
+            PL_SWAP(tri->v[1], tri->v[2]);
+            tri->area = -tri->area;
+        }
+
+        double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+        for (int i = 0; i < 3; i++) {
+            x0 = PL_MIN(x0, tri->v[i].x);
+            y0 = PL_MIN(y0, tri->v[i].y);
+            x1 = PL_MAX(x1, tri->v[i].x);
+            y1 = PL_MAX(y1, tri->v[i].y);
+        }
+
+        tri->bbox = (pl_rect2d) {
+            .x0 = PL_CLAMP(floor(x0), rc.x0, rc.x1),
+            .y0 = PL_CLAMP(floor(y0), rc.y0, rc.y1),
+            .x1 = PL_CLAMP(ceil(x1), rc.x0, rc.x1),
+            .y1 = PL_CLAMP(ceil(y1), rc.y0, rc.y1),
+        };
+
+        if (pl_rect_w(tri->bbox) > 0 && pl_rect_h(tri->bbox) > 0)
+            n++;
+    }
+
+    if (n && pl_rect_h(rc) > 0) {
+        struct raster_args args = {
+            .params = params,
+            .mod = mod,
+            .bind = &bind,
+            .tris = tris,
+            .num_tris = n,
+            .num_varyings = nv,
+            .rc = rc,
+            .data = pl_tex_dummy_data(target),
+            .stride = target->params.w * target->params.format->texel_size,
+        };
+
+        pl_parallel_for(NULL, pl_rect_h(rc), 4, raster_rows, &args);
+    }
+
+done:
+    pl_free(tmp);
+}
@@ -0,0 +1,1169 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "abi.h"
+
+// C++ implementation of the GLSL types and built-in functions, prepended to
+// every shader translated by `pl_cpu_translate`. This is compiled together
+// with the shader itself, so it must be entirely self-contained: in
+// particular, it may not include any system headers, which would drag in
+// conflicting declarations of functions like `sin` or `min`.
+//
+// Everything lives in `namespace glsl`. Scalar math is mapped directly to the
+// compiler built-ins, vectors and matrices are plain aggregates of floats
+// (matching the host layout of `pl_var`) with the GLSL operators defined on
+// top of them.
+
+extern "C" const char pl_cpu_runtime[];
+extern "C" const char pl_cpu_runtime[] = PL_CPU_ABI(PL_CPU_ABI_STRING) R"runtime(
+
+namespace glsl {
+
+typedef unsigned int uint;
+typedef decltype(sizeof(0)) size_t;
+
+// Minimal type traits
+template<bool B, class T = void> struct enable_if_ {};
+template<class T> struct enable_if_<true, T> { typedef T type; };
+template<bool B, class T = void> using enable_if = typename enable_if_<B, T>::type;
+
+template<class T> struct identity_ { typedef T type; };
+template<class T> using nd = typename identity_<T>::type; // non-deduced
+
+template<class A, class B> struct same_ { static constexpr bool value = false; };
+template<class A> struct same_<A, A> { static constexpr bool value = true; };
+
+template<class T> struct scalar_ { static constexpr bool value = false; };
+#define PL_SCALAR(T) template<> struct scalar_<T> { static constexpr bool value = true; };
+PL_SCALAR(bool) PL_SCALAR(char) PL_SCALAR(signed char) PL_SCALAR(unsigned char)
+PL_SCALAR(short) PL_SCALAR(unsigned short) PL_SCALAR(int) PL_SCALAR(unsigned)
+PL_SCALAR(long) PL_SCALAR(unsigned long) PL_SCALAR(long long)
+PL_SCALAR(unsigned long long) PL_SCALAR(float) PL_SCALAR(double)
+#undef PL_SCALAR
+
+template<class T> constexpr bool is_scalar = scalar_<T>::value;
+template<class T> constexpr bool is_float = same_<T, float>::value || same_<T, double>::value;
+
+// Result of arithmetic between two scalar types
+template<bool F, class A, class B> struct promote_ { typedef float type; };
+template<class A, class B> struct promote_<false, A, B> { typedef decltype(A() + B()) type; };
+template<class A, class B> using promote = typename promote_<is_float<A> || is_float<B>, A, B>::type;
+
+// Whether GLSL implicitly converts from U to T (int -> uint -> float)
+template<class U, class T> constexpr bool implicit =
+    !same_<U, T>::value && !same_<U, bool>::value &&
+    (is_float<T> || (same_<T, uint>::value && same_<U, int>::value));
+
+template<class T, int N> struct tvec;
+template<int C, int R> struct tmat;
+template<class T, int... I> struct swizzle;
+
+template<class T, int N> struct vec_data;
+template<class T> struct vec_data<T, 2> {
+    union {
+        T v[2];
+        struct { T x, y; };
+        struct { T r, g; };
+        struct { T s, t; };
+    };
+};
+
+template<class T> struct vec_data<T, 3> {
+    union {
+        T v[3];
+        struct { T x, y, z; };
+        struct { T r, g, b; };
+        struct { T s, t, p; };
+    };
+};
+
+template<class T> struct vec_data<T, 4> {
+    union {
+        T v[4];
+        struct { T x, y, z, w; };
+        struct { T r, g, b, a; };
+        struct { T s, t, p, q; };
+    };
+};
+
+#define PL_VEC_BINOP(op)                                                        \
+    tvec &operator op##=(const tvec &o)                                         \
+    {                                                                           \
+        for (int i = 0; i < N; i++)                                             \
+            v[i] op##= o.v[i];                                                  \
+        return *this;                                                           \
+    }                                                                           \
+    tvec &operator op##=(T o)                                                   \
+    {                                                                           \
+        for (int i = 0; i < N; i++)                                             \
+            v[i] op##= o;                                                       \
+        return *this;                                                           \
+    }                                                                           \
+    friend tvec operator op(tvec a, const tvec &b) { return a op##= b; }        \
+    friend tvec operator op(tvec a, T b) { return a op##= b; }                  \
+    friend tvec operator op(T a, const tvec &b)                                 \
+    {                                                                           \
+        tvec r;                                                                 \
+        for (int i = 0; i < N; i++)                                             \
+            r.v[i] = a op b.v[i];                                               \
+        return r;                                                               \
+    }
+
+#define PL_VEC_UNOP(op)                                                         \
+    friend tvec operator op(tvec a)                                             \
+    {                                                                           \
+        for (int i = 0; i < N; i++)                                             \
+            a.v[i] = op a.v[i];                                                 \
+        return a;                                                               \
+    }
+
+template<class T, int N>
+struct tvec : vec_data<T, N> {
+    using vec_data<T, N>::v;
+
+    tvec()
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = T();
+    }
+
+    template<class S, enable_if<is_scalar<S>, int> = 0>
+    explicit tvec(S s)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = T(s);
+    }
+
+    template<class U, int M, enable_if<(M > N) || (M == N && !implicit<U, T>), int> = 0>
+    explicit tvec(const tvec<U, M> &o)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = T(o.v[i]);
+    }
+
+    template<class U, enable_if<implicit<U, T>, int> = 0>
+    tvec(const tvec<U, N> &o)
+    {
+        for (int i = 0; i < N; i++)
+            v[i] = T(o.v[i]);
+    }
+
+    template<int C, int R>
+    explicit tvec(const tmat<C, R> &m)
+    {
+        int i = 0;
+        fill(i, m);
+    }
+
+    template<class A, class B, class... Rest>
+    tvec(const A &a, const B &b, const Rest &...rest)
+    {
+        int i = 0;
+        fill(i, a);
+        fill(i, b);
+        (fill(i, rest), ...);
+    }
+
+    template<class S, enable_if<is_scalar<S>, int> = 0>
+    void fill(int &i, S s)
+    {
+        if (i < N)
+            v[i++] = T(s);
+    }
+
+    template<class U, int M>
+    void fill(int &i, const tvec<U, M> &o)
+    {
+        for (int j = 0; j < M && i < N; j++)
+            v[i++] = T(o.v[j]);
+    }
+
+    template<int C, int R>
+    void fill(int &i, const tmat<C, R> &m)
+    {
+        for (int j = 0; j < C; j++)
+            fill(i, m.c[j]);
+    }
+
+    // Conversion to scalars, e.g. `float(v)`, which uses the first component
+    template<class S, enable_if<is_scalar<S>, int> = 0>
+    explicit operator S() const { return S(v[0]); }
+
+    T &operator[](int i) { return v[i]; }
+    const T &operator[](int i) const { return v[i]; }
+    int length() const { return N; }
+
+    // Swizzles, as r-values and as (assignable) l-values, respectively
+    template<int... I>
+    tvec<T, sizeof...(I)> swz() const { return tvec<T, sizeof...(I)>(v[I]...); }
+
+    template<int... I>
+    swizzle<T, I...> swzr() { return swizzle<T, I...>(v); }
+
+    PL_VEC_BINOP(+)
+    PL_VEC_BINOP(-)
+    PL_VEC_BINOP(*)
+    PL_VEC_BINOP(/)
+    PL_VEC_BINOP(%)
+    PL_VEC_BINOP(&)
+    PL_VEC_BINOP(|)
+    PL_VEC_BINOP(^)
+    PL_VEC_BINOP(<<)
+    PL_VEC_BINOP(>>)
+    PL_VEC_UNOP(-)
+    PL_VEC_UNOP(+)
+    PL_VEC_UNOP(~)
+    PL_VEC_UNOP(!)
+
+    tvec &operator++() { return *this += T(1); }
+    tvec &operator--() { return *this -= T(1); }
+    tvec operator++(int) { tvec r = *this; *this += T(1); return r; }
+    tvec operator--(int) { tvec r = *this; *this -= T(1); return r; }
+
+    friend bool operator==(const tvec &a, const tvec &b)
+    {
+        for (int i = 0; i < N; i++) {
+            if (a.v[i] != b.v[i])
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const tvec &a, const tvec &b) { return !(a == b); }
+};
+
+#undef PL_VEC_BINOP
+#undef PL_VEC_UNOP
+
+template<class T, int... I>
+struct swizzle {
+    typedef tvec<T, sizeof...(I)> vec;
+    T *v;
+
+    explicit swizzle(T *p) : v(p) {}
+    vec get() const { return vec(v[I]...); }
+    operator vec() const { return get(); }
+
+    void set(const vec &x)
+    {
+        int k = 0;
+        ((v[I] = x.v[k++]), ...);
+    }
+
+    swizzle &operator=(const vec &x) { set(x); return *this; }
+    swizzle &operator=(const swizzle &x) { set(x.get()); return *this; }
+    template<class X> swizzle &operator+=(const X &x) { set(get() + x); return *this; }
+    template<class X> swizzle &operator-=(const X &x) { set(get() - x); return *this; }
+    template<class X> swizzle &operator*=(const X &x) { set(get() * x); return *this; }
+    template<class X> swizzle &operator/=(const X &x) { set(get() / x); return *this; }
+};
+
+typedef tvec<float, 2> vec2;
+typedef tvec<float, 3> vec3;
+typedef tvec<float, 4> vec4;
+typedef tvec<int, 2> ivec2;
+typedef tvec<int, 3> ivec3;
+typedef tvec<int, 4> ivec4;
+typedef tvec<uint, 2> uvec2;
+typedef tvec<uint, 3> uvec3;
+typedef tvec<uint, 4> uvec4;
+typedef tvec<bool, 2> bvec2;
+typedef tvec<bool, 3> bvec3;
+typedef tvec<bool, 4> bvec4;
+
+// Column-major matrix with C columns and R rows
+template<int C, int R>
+struct tmat {
+    tvec<float, R> c[C];
+
+    tmat() {}
+
+    template<class S, enable_if<is_scalar<S>, int> = 0>
+    explicit tmat(S s)
+    {
+        for (int i = 0; i < C && i < R; i++)
+            c[i].v[i] = float(s);
+    }
+
+    template<int C2, int R2, enable_if<C2 != C || R2 != R, int> = 0>
+    explicit tmat(const tmat<C2, R2> &m)
+    {
+        for (int i = 0; i < C; i++) {
+            for (int j = 0; j < R; j++)
+                c[i].v[j] = (i < C2 && j < R2) ? m.c[i].v[j] : float(i == j);
+        }
+    }
+
+    template<class U, int M>
+    explicit tmat(const tvec<U, M> &o)
+    {
+        int i = 0;
+        fill(i, o);
+    }
+
+    template<class A, class B, class... Rest>
+    tmat(const A &a, const B &b, const Rest &...rest)
+    {
+        int i = 0;
+        fill(i, a);
+        fill(i, b);
+        (fill(i, rest), ...);
+    }
+
+    template<class S, enable_if<is_scalar<S>, int> = 0>
+    void fill(int &i, S s)
+    {
+        if (i < C * R) {
+            c[i / R].v[i % R] = float(s);
+            i++;
+        }
+    }
+
+    template<class U, int M>
+    void fill(int &i, const tvec<U, M> &o)
+    {
+        for (int j = 0; j < M; j++)
+            fill(i, o.v[j]);
+    }
+
+    tvec<float, R> &operator[](int i) { return c[i]; }
+    const tvec<float, R> &operator[](int i) const { return c[i]; }
+    int length() const { return C; }
+
+    friend tmat operator+(tmat a, const tmat &b) { for (int i = 0; i < C; i++) a.c[i] += b.c[i]; return a; }
+    friend tmat operator-(tmat a, const tmat &b) { for (int i = 0; i < C; i++) a.c[i] -= b.c[i]; return a; }
+    friend tmat operator*(tmat a, float s) { for (int i = 0; i < C; i++) a.c[i] *= s; return a; }
+    friend tmat operator*(float s, tmat a) { for (int i = 0; i < C; i++) a.c[i] *= s; return a; }
+    friend tmat operator/(tmat a, float s) { for (int i = 0; i < C; i++) a.c[i] /= s; return a; }
+    friend tmat operator-(tmat a) { for (int i = 0; i < C; i++) a.c[i] = -a.c[i]; return a; }
+    friend tmat operator+(const tmat &a) { return a; }
+
+    friend tvec<float, R> operator*(const tmat &m, const tvec<float, C> &x)
+    {
+        tvec<float, R> r;
+        for (int i = 0; i < C; i++)
+            r += m.c[i] * x.v[i];
+        return r;
+    }
+
+    friend tvec<float, C> operator*(const tvec<float, R> &x, const tmat &m)
+    {
+        tvec<float, C> r;
+        for (int i = 0; i < C; i++) {
+            for (int j = 0; j < R; j++)
+                r.v[i] += x.v[j] * m.c[i].v[j];
+        }
+        return r;
+    }
+
+    tmat &operator+=(const tmat &b) { return *this = *this + b; }
+    tmat &operator-=(const tmat &b) { return *this = *this - b; }
+    tmat &operator*=(float s) { return *this = *this * s; }
+    tmat &operator/=(float s) { return *this = *this / s; }
+
+    friend bool operator==(const tmat &a, const tmat &b)
+    {
+        for (int i = 0; i < C; i++) {
+            if (a.c[i] != b.c[i])
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const tmat &a, const tmat &b) { return !(a == b); }
+};
+
+template<int C, int R, int K>
+static inline tmat<C, R> operator*(const tmat<K, R> &a, const tmat<C, K> &b)
+{
+    tmat<C, R> r;
+    for (int i = 0; i < C; i++)
+        r.c[i] = a * b.c[i];
+    return r;
+}
+
+template<int C, int R>
+static inline tmat<C, R> &operator*=(tmat<C, R> &a, const tmat<C, C> &b)
+{
+    return a = a * b;
+}
+
+template<int N>
+static inline tvec<float, N> &operator*=(tvec<float, N> &a, const tmat<N, N> &m)
+{
+    return a = a * m;
+}
+
+typedef tmat<2, 2> mat2;
+typedef tmat<3, 3> mat3;
+typedef tmat<4, 4> mat4;
+typedef tmat<2, 2> mat2x2;
+typedef tmat<2, 3> mat2x3;
+typedef tmat<2, 4> mat2x4;
+typedef tmat<3, 2> mat3x2;
+typedef tmat<3, 3> mat3x3;
+typedef tmat<3, 4> mat3x4;
+typedef tmat<4, 2> mat4x2;
+typedef tmat<4, 3> mat4x3;
+typedef tmat<4, 4> mat4x4;
+
+template<class T> struct comps_ { static constexpr int value = 1; };
+template<class T, int N> struct comps_<tvec<T, N>> { static constexpr int value = N; };
+template<int C, int R> struct comps_<tmat<C, R>> { static constexpr int value = C * R; };
+template<class T, int N> struct comps_<T[N]> { static constexpr int value = N * comps_<T>::value; };
+
+// Number of scalar components making up a value of type T
+template<class T> constexpr int comps = comps_<T>::value;
+
+// Component-wise application of a scalar function
+template<class T, int N, class F>
+static inline auto map(const tvec<T, N> &a, F f) -> tvec<decltype(f(a.v[0])), N>
+{
+    tvec<decltype(f(a.v[0])), N> r;
+    for (int i = 0; i < N; i++)
+        r.v[i] = f(a.v[i]);
+    return r;
+}
+
+template<class T, class U, int N, class F>
+static inline auto map(const tvec<T, N> &a, const tvec<U, N> &b, F f)
+    -> tvec<decltype(f(a.v[0], b.v[0])), N>
+{
+    tvec<decltype(f(a.v[0], b.v[0])), N> r;
+    for (int i = 0; i < N; i++)
+        r.v[i] = f(a.v[i], b.v[i]);
+    return r;
+}
+
+template<class T, class U, class V, int N, class F>
+static inline auto map(const tvec<T, N> &a, const tvec<U, N> &b,
+                       const tvec<V, N> &c, F f)
+    -> tvec<decltype(f(a.v[0], b.v[0], c.v[0])), N>
+{
+    tvec<decltype(f(a.v[0], b.v[0], c.v[0])), N> r;
+    for (int i = 0; i < N; i++)
+        r.v[i] = f(a.v[i], b.v[i], c.v[i]);
+    return r;
+}
+
+// Floating point functions of one argument
+#define PL_FUN1(name, expr)                                                     \
+    static inline float name(float x) { return expr; }                          \
+    template<int N>                                                             \
+    static inline tvec<float, N> name(const tvec<float, N> &x)                  \
+    {                                                                           \
+        return map(x, [](float y) { return name(y); });                         \
+    }
+
+PL_FUN1(radians,     x * 0.017453292519943295f)
+PL_FUN1(degrees,     x * 57.29577951308232f)
+PL_FUN1(sin,         __builtin_sinf(x))
+PL_FUN1(cos,         __builtin_cosf(x))
+PL_FUN1(tan,         __builtin_tanf(x))
+PL_FUN1(asin,        __builtin_asinf(x))
+PL_FUN1(acos,        __builtin_acosf(x))
+PL_FUN1(atan,        __builtin_atanf(x))
+PL_FUN1(sinh,        __builtin_sinhf(x))
+PL_FUN1(cosh,        __builtin_coshf(x))
+PL_FUN1(tanh,        __builtin_tanhf(x))
+PL_FUN1(asinh,       __builtin_asinhf(x))
+PL_FUN1(acosh,       __builtin_acoshf(x))
+PL_FUN1(atanh,       __builtin_atanhf(x))
+PL_FUN1(exp,         __builtin_expf(x))
+PL_FUN1(log,         __builtin_logf(x))
+PL_FUN1(exp2,        __builtin_exp2f(x))
+PL_FUN1(log2,        __builtin_log2f(x))
+PL_FUN1(sqrt,        __builtin_sqrtf(x))
+PL_FUN1(inversesqrt, 1.0f / __builtin_sqrtf(x))
+PL_FUN1(floor,       __builtin_floorf(x))
+PL_FUN1(ceil,        __builtin_ceilf(x))
+PL_FUN1(trunc,       __builtin_truncf(x))
+PL_FUN1(round,       __builtin_roundf(x))
+PL_FUN1(roundEven,   __builtin_rintf(x))
+PL_FUN1(fract,       x - __builtin_floorf(x))
+PL_FUN1(dFdx,        0.0f * x)
+PL_FUN1(dFdy,        0.0f * x)
+PL_FUN1(fwidth,      0.0f * x)
+#undef PL_FUN1
+
+// Floating point functions of two arguments
+#define PL_FUN2(name, expr)                                                     \
+    static inline float name(float x, float y) { return expr; }                 \
+    template<int N>                                                             \
+    static inline tvec<float, N> name(const tvec<float, N> &x,                  \
+                                      const tvec<float, N> &y)                  \
+    {                                                                           \
+        return map(x, y, [](float a, float b) { return name(a, b); });          \
+    }
+
+PL_FUN2(pow,  __builtin_powf(x, y))
+PL_FUN2(atan, __builtin_atan2f(x, y))
+PL_FUN2(mod,  x - y * __builtin_floorf(x / y))
+PL_FUN2(step, y < x ? 0.0f : 1.0f)
+#undef PL_FUN2
+
+template<int N>
+static inline tvec<float, N> mod(const tvec<float, N> &x, float y)
+{
+    return mod(x, tvec<float, N>(y));
+}
+
+template<int N>
+static inline tvec<float, N> step(float edge, const tvec<float, N> &x)
+{
+    return step(tvec<float, N>(edge), x);
+}
+
+static inline float smoothstep(float e0, float e1, float x)
+{
+    float t = (x - e0) / (e1 - e0);
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+template<int N>
+static inline tvec<float, N> smoothstep(const tvec<float, N> &e0,
+                                        const tvec<float, N> &e1,
+                                        const tvec<float, N> &x)
+{
+    return map(e0, e1, x, [](float a, float b, float c) { return smoothstep(a, b, c); });
+}
+
+template<int N>
+static inline tvec<float, N> smoothstep(float e0, float e1, const tvec<float, N> &x)
+{
+    return smoothstep(tvec<float, N>(e0), tvec<float, N>(e1), x);
+}
+
+static inline float mix(float x, float y, float a) { return x + (y - x) * a; }
+
+template<class T, enable_if<is_scalar<T>, int> = 0>
+static inline T mix(T x, T y, bool a) { return a ? y : x; }
+
+template<int N>
+static inline tvec<float, N> mix(const tvec<float, N> &x, const tvec<float, N> &y,
+                                 const tvec<float, N> &a)
+{
+    return x + (y - x) * a;
+}
+
+template<int N>
+static inline tvec<float, N> mix(const tvec<float, N> &x, const tvec<float, N> &y,
+                                 float a)
+{
+    return x + (y - x) * a;
+}
+
+template<class T, int N>
+static inline tvec<T, N> mix(const tvec<T, N> &x, const tvec<T, N> &y,
+                             const tvec<bool, N> &a)
+{
+    return map(x, y, a, [](T u, T v, bool b) { return b ? v : u; });
+}
+
+static inline float fma(float a, float b, float c) { return __builtin_fmaf(a, b, c); }
+
+template<int N>
+static inline tvec<float, N> fma(const tvec<float, N> &a, const tvec<float, N> &b,
+                                 const tvec<float, N> &c)
+{
+    return map(a, b, c, [](float x, float y, float z) { return fma(x, y, z); });
+}
+
+// Functions defined for all numeric types
+template<class T, enable_if<is_scalar<T>, int> = 0>
+static inline T abs(T x) { return x < T(0) ? -x : x; }
+
+static inline float abs(float x) { return __builtin_fabsf(x); }
+
+template<class T, enable_if<is_scalar<T>, int> = 0>
+static inline T sign(T x) { return T((T(0) < x) - (x < T(0))); }
+
+template<class A, class B, enable_if<is_scalar<A> && is_scalar<B>, int> = 0>
+static inline promote<A, B> min(A a, B b)
+{
+    typedef promote<A, B> T;
+    return T(b) < T(a) ? T(b) : T(a);
+}
+
+template<class A, class B, enable_if<is_scalar<A> && is_scalar<B>, int> = 0>
+static inline promote<A, B> max(A a, B b)
+{
+    typedef promote<A, B> T;
+    return T(a) < T(b) ? T(b) : T(a);
+}
+
+template<class A, class B, class C, enable_if<is_scalar<A> && is_scalar<B> && is_scalar<C>, int> = 0>
+static inline promote<promote<A, B>, C> clamp(A x, B lo, C hi)
+{
+    return min(max(x, lo), hi);
+}
+
+template<class T, int N>
+static inline tvec<T, N> abs(const tvec<T, N> &x)
+{
+    return map(x, [](T a) { return abs(a); });
+}
+
+template<class T, int N>
+static inline tvec<T, N> sign(const tvec<T, N> &x)
+{
+    return map(x, [](T a) { return sign(a); });
+}
+
+template<class T, int N>
+static inline tvec<T, N> min(const tvec<T, N> &a, const tvec<T, N> &b)
+{
+    return map(a, b, [](T x, T y) { return y < x ? y : x; });
+}
+
+template<class T, int N>
+static inline tvec<T, N> min(const tvec<T, N> &a, nd<T> b)
+{
+    return min(a, tvec<T, N>(b));
+}
+
+template<class T, int N>
+static inline tvec<T, N> max(const tvec<T, N> &a, const tvec<T, N> &b)
+{
+    return map(a, b, [](T x, T y) { return x < y ? y : x; });
+}
+
+template<class T, int N>
+static inline tvec<T, N> max(const tvec<T, N> &a, nd<T> b)
+{
+    return max(a, tvec<T, N>(b));
+}
+
+template<class T, int N>
+static inline tvec<T, N> clamp(const tvec<T, N> &x, const tvec<T, N> &lo,
+                               const tvec<T, N> &hi)
+{
+    return min(max(x, lo), hi);
+}
+
+template<class T, int N>
+static inline tvec<T, N> clamp(const tvec<T, N> &x, nd<T> lo, nd<T> hi)
+{
+    return min(max(x, lo), hi);
+}
+
+// Geometric functions
+static inline float dot(float a, float b) { return a * b; }
+static inline float length(float x) { return abs(x); }
+static inline float distance(float a, float b) { return abs(a - b); }
+static inline float normalize(float x) { return x < 0.0f ? -1.0f : 1.0f; }
+
+template<int N>
+static inline float dot(const tvec<float, N> &a, const tvec<float, N> &b)
+{
+    float r = 0.0f;
+    for (int i = 0; i < N; i++)
+        r += a.v[i] * b.v[i];
+    return r;
+}
+
+template<int N>
+static inline float length(const tvec<float, N> &x) { return sqrt(dot(x, x)); }
+
+template<int N>
+static inline float distance(const tvec<float, N> &a, const tvec<float, N> &b)
+{
+    return length(a - b);
+}
+
+template<int N>
+static inline tvec<float, N> normalize(const tvec<float, N> &x)
+{
+    return x * inversesqrt(dot(x, x));
+}
+
+static inline vec3 cross(const vec3 &a, const vec3 &b)
+{
+    return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+template<class T>
+static inline T reflect(const T &i, const T &n) { return i - 2.0f * dot(n, i) * n; }
+
+// Relational functions
+#define PL_REL(name, op)                                                        \
+    template<class T, int N>                                                    \
+    static inline tvec<bool, N> name(const tvec<T, N> &a, const tvec<T, N> &b)  \
+    {                                                                           \
+        return map(a, b, [](T x, T y) { return x op y; });                      \
+    }
+
+PL_REL(lessThan,         <)
+PL_REL(lessThanEqual,    <=)
+PL_REL(greaterThan,      >)
+PL_REL(greaterThanEqual, >=)
+PL_REL(equal,            ==)
+PL_REL(notEqual,         !=)
+#undef PL_REL
+
+template<int N>
+static inline bool any(const tvec<bool, N> &x)
+{
+    for (int i = 0; i < N; i++) {
+        if (x.v[i])
+            return true;
+    }
+    return false;
+}
+
+template<int N>
+static inline bool all(const tvec<bool, N> &x)
+{
+    for (int i = 0; i < N; i++) {
+        if (!x.v[i])
+            return false;
+    }
+    return true;
+}
+
+// `not` is a reserved word in C++, the translator renames it
+template<int N>
+static inline tvec<bool, N> not_(const tvec<bool, N> &x) { return !x; }
+
+static inline bool isnan(float x) { return __builtin_isnan(x); }
+static inline bool isinf(float x) { return __builtin_isinf(x); }
+
+template<int N>
+static inline tvec<bool, N> isnan(const tvec<float, N> &x)
+{
+    return map(x, [](float y) { return isnan(y); });
+}
+
+template<int N>
+static inline tvec<bool, N> isinf(const tvec<float, N> &x)
+{
+    return map(x, [](float y) { return isinf(y); });
+}
+
+// Bit casts
+template<class T, class U>
+static inline T bitcast(U x)
+{
+    static_assert(sizeof(T) == sizeof(U), "size mismatch");
+    T r;
+    __builtin_memcpy(&r, &x, sizeof(r));
+    return r;
+}
+
+#define PL_CAST(name, T, U)                                                     \
+    static inline T name(U x) { return bitcast<T>(x); }                         \
+    template<int N>                                                             \
+    static inline tvec<T, N> name(const tvec<U, N> &x)                          \
+    {                                                                           \
+        return map(x, [](U y) { return bitcast<T>(y); });                       \
+    }
+
+PL_CAST(floatBitsToInt,  int,   float)
+PL_CAST(floatBitsToUint, uint,  float)
+PL_CAST(intBitsToFloat,  float, int)
+PL_CAST(uintBitsToFloat, float, uint)
+#undef PL_CAST
+
+// Matrix functions
+template<int C, int R>
+static inline tmat<C, R> matrixCompMult(const tmat<C, R> &a, const tmat<C, R> &b)
+{
+    tmat<C, R> r;
+    for (int i = 0; i < C; i++)
+        r.c[i] = a.c[i] * b.c[i];
+    return r;
+}
+
+template<int C, int R>
+static inline tmat<C, R> outerProduct(const tvec<float, R> &a, const tvec<float, C> &b)
+{
+    tmat<C, R> r;
+    for (int i = 0; i < C; i++)
+        r.c[i] = a * b.v[i];
+    return r;
+}
+
+template<int C, int R>
+static inline tmat<R, C> transpose(const tmat<C, R> &m)
+{
+    tmat<R, C> r;
+    for (int i = 0; i < C; i++) {
+        for (int j = 0; j < R; j++)
+            r.c[j].v[i] = m.c[i].v[j];
+    }
+    return r;
+}
+
+static inline float determinant(const mat2 &m)
+{
+    return m.c[0].x * m.c[1].y - m.c[1].x * m.c[0].y;
+}
+
+static inline float determinant(const mat3 &m)
+{
+    return dot(m.c[0], cross(m.c[1], m.c[2]));
+}
+
+static inline float determinant(const mat4 &m)
+{
+    float r = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        mat3 sub;
+        for (int j = 1; j < 4; j++) {
+            for (int k = 0, n = 0; k < 4; k++) {
+                if (k != i)
+                    sub.c[n++].v[j - 1] = m.c[k].v[j];
+            }
+        }
+        r += ((i & 1) ? -1.0f : 1.0f) * m.c[i].v[0] * determinant(sub);
+    }
+    return r;
+}
+
+// Gauss-Jordan elimination with partial pivoting
+template<int N>
+static inline tmat<N, N> inverse(const tmat<N, N> &m)
+{
+    tmat<N, N> a = m, r(1.0f);
+    for (int i = 0; i < N; i++) {
+        int p = i;
+        for (int j = i + 1; j < N; j++) {
+            if (abs(a.c[i].v[j]) > abs(a.c[i].v[p]))
+                p = j;
+        }
+        for (int k = 0; k < N; k++) {
+            float t = a.c[k].v[i]; a.c[k].v[i] = a.c[k].v[p]; a.c[k].v[p] = t;
+            t = r.c[k].v[i]; r.c[k].v[i] = r.c[k].v[p]; r.c[k].v[p] = t;
+        }
+        const float inv = 1.0f / a.c[i].v[i];
+        for (int k = 0; k < N; k++) {
+            a.c[k].v[i] *= inv;
+            r.c[k].v[i] *= inv;
+        }
+        for (int j = 0; j < N; j++) {
+            const float f = a.c[i].v[j];
+            if (j == i || f == 0.0f)
+                continue;
+            for (int k = 0; k < N; k++) {
+                a.c[k].v[j] -= f * a.c[k].v[i];
+                r.c[k].v[j] -= f * r.c[k].v[i];
+            }
+        }
+    }
+    return r;
+}
+
+// Samplers. The texel data is always RGBA, so all lookups return 4 values.
+struct sampler_base {
+    const pl_cpu_tex *t = nullptr;
+};
+
+template<int D, class T, bool RECT>
+struct tsampler : sampler_base {};
+
+typedef tsampler<1, float, false> sampler1D;
+typedef tsampler<2, float, false> sampler2D;
+typedef tsampler<3, float, false> sampler3D;
+typedef tsampler<2, float, true>  sampler2DRect;
+typedef tsampler<2, float, false> samplerExternalOES;
+typedef tsampler<1, int, false>   isampler1D;
+typedef tsampler<2, int, false>   isampler2D;
+typedef tsampler<3, int, false>   isampler3D;
+typedef tsampler<2, int, true>    isampler2DRect;
+typedef tsampler<1, uint, false>  usampler1D;
+typedef tsampler<2, uint, false>  usampler2D;
+typedef tsampler<3, uint, false>  usampler3D;
+typedef tsampler<2, uint, true>   usampler2DRect;
+
+// Clamped float -> int conversion, also mapping NaN to 0
+static inline int tex_floor(float x)
+{
+    if (!(x > -1e8f))
+        return x != x ? 0 : -100000000;
+    return x < 1e8f ? int(__builtin_floorf(x)) : 100000000;
+}
+
+static inline int tex_wrap(int i, int n, int mode)
+{
+    switch (mode) {
+    case 1: // repeat
+        i %= n;
+        return i < 0 ? i + n : i;
+    case 2: { // mirror
+        const int p = 2 * n;
+        i %= p;
+        i = i < 0 ? i + p : i;
+        return i < n ? i : p - 1 - i;
+    }
+    default: // clamp
+        return i < 0 ? 0 : (i >= n ? n - 1 : i);
+    }
+}
+
+template<class T>
+static inline tvec<T, 4> tex_fetch(const pl_cpu_tex *t, int x, int y, int z)
+{
+    const T *p = (const T *) t->data + 4 * ((size_t(z) * t->h + y) * t->w + x);
+    return tvec<T, 4>(p[0], p[1], p[2], p[3]);
+}
+
+// Sample at (u, v, w), given in units of texels
+template<int D, class T>
+static inline tvec<T, 4> tex_sample(const pl_cpu_tex *t, float u, float v, float w)
+{
+    const int m = t->address;
+    if constexpr (is_float<T>) {
+        if (t->linear) {
+            u -= 0.5f;
+            v -= 0.5f;
+            w -= 0.5f;
+            const int x = tex_floor(u), y = tex_floor(v), z = tex_floor(w);
+            const float fx = u - x, fy = v - y, fz = w - z;
+            const int x0 = tex_wrap(x, t->w, m), x1 = tex_wrap(x + 1, t->w, m);
+            const int y0 = D > 1 ? tex_wrap(y, t->h, m) : 0;
+            const int y1 = D > 1 ? tex_wrap(y + 1, t->h, m) : 0;
+            const int z0 = D > 2 ? tex_wrap(z, t->d, m) : 0;
+            const int z1 = D > 2 ? tex_wrap(z + 1, t->d, m) : 0;
+
+            vec4 r = mix(tex_fetch<float>(t, x0, y0, z0), tex_fetch<float>(t, x1, y0, z0), fx);
+            if constexpr (D > 1) {
+                r = mix(r, mix(tex_fetch<float>(t, x0, y1, z0),
+                               tex_fetch<float>(t, x1, y1, z0), fx), fy);
+            }
+            if constexpr (D > 2) {
+                vec4 s = mix(tex_fetch<float>(t, x0, y0, z1), tex_fetch<float>(t, x1, y0, z1), fx);
+                s = mix(s, mix(tex_fetch<float>(t, x0, y1, z1),
+                               tex_fetch<float>(t, x1, y1, z1), fx), fy);
+                r = mix(r, s, fz);
+            }
+            return r;
+        }
+    }
+
+    const int x = tex_wrap(tex_floor(u), t->w, m);
+    const int y = D > 1 ? tex_wrap(tex_floor(v), t->h, m) : 0;
+    const int z = D > 2 ? tex_wrap(tex_floor(w), t->d, m) : 0;
+    return tex_fetch<T>(t, x, y, z);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> texture(const tsampler<1, T, R> &s, float p)
+{
+    return tex_sample<1, T>(s.t, R ? p : p * s.t->w, 0.0f, 0.0f);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> texture(const tsampler<2, T, R> &s, const vec2 &p)
+{
+    const pl_cpu_tex *t = s.t;
+    return R ? tex_sample<2, T>(t, p.x, p.y, 0.0f)
+             : tex_sample<2, T>(t, p.x * t->w, p.y * t->h, 0.0f);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> texture(const tsampler<3, T, R> &s, const vec3 &p)
+{
+    const pl_cpu_tex *t = s.t;
+    return tex_sample<3, T>(t, p.x * t->w, p.y * t->h, p.z * t->d);
+}
+
+// Sample with an offset, given in texels
+template<class T, bool R>
+static inline tvec<T, 4> textureOffset(const tsampler<1, T, R> &s, float p, int off)
+{
+    return tex_sample<1, T>(s.t, (R ? p : p * s.t->w) + off, 0.0f, 0.0f);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> textureOffset(const tsampler<2, T, R> &s, const vec2 &p,
+                                       const ivec2 &off)
+{
+    const pl_cpu_tex *t = s.t;
+    const vec2 pt = R ? p : vec2(p.x * t->w, p.y * t->h);
+    return tex_sample<2, T>(t, pt.x + off.x, pt.y + off.y, 0.0f);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> textureOffset(const tsampler<3, T, R> &s, const vec3 &p,
+                                       const ivec3 &off)
+{
+    const pl_cpu_tex *t = s.t;
+    return tex_sample<3, T>(t, p.x * t->w + off.x, p.y * t->h + off.y,
+                            p.z * t->d + off.z);
+}
+
+// Mipmaps are not supported, so the LOD and bias arguments are ignored
+template<class S, class P>
+static inline auto texture(const S &s, const P &p, float bias) { return texture(s, p); }
+
+template<class S, class P>
+static inline auto textureLod(const S &s, const P &p, float lod) { return texture(s, p); }
+
+template<class S, class P, class O>
+static inline auto textureLodOffset(const S &s, const P &p, float lod, const O &off)
+{
+    return textureOffset(s, p, off);
+}
+
+template<class S, class P>
+static inline auto texture1D(const S &s, const P &p) { return texture(s, p); }
+template<class S, class P>
+static inline auto texture2D(const S &s, const P &p) { return texture(s, p); }
+template<class S, class P>
+static inline auto texture3D(const S &s, const P &p) { return texture(s, p); }
+
+// Arrays of samplers can always be indexed by non-uniform expressions
+static inline int nonuniformEXT(int idx) { return idx; }
+
+static inline int tex_clamp(int x, int n) { return x < 0 ? 0 : (x >= n ? n - 1 : x); }
+
+template<class T, bool R>
+static inline tvec<T, 4> texelFetch(const tsampler<1, T, R> &s, int p, int lod = 0)
+{
+    return tex_fetch<T>(s.t, tex_clamp(p, s.t->w), 0, 0);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> texelFetch(const tsampler<2, T, R> &s, const ivec2 &p, int lod = 0)
+{
+    const pl_cpu_tex *t = s.t;
+    return tex_fetch<T>(t, tex_clamp(p.x, t->w), tex_clamp(p.y, t->h), 0);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> texelFetch(const tsampler<3, T, R> &s, const ivec3 &p, int lod = 0)
+{
+    const pl_cpu_tex *t = s.t;
+    return tex_fetch<T>(t, tex_clamp(p.x, t->w), tex_clamp(p.y, t->h), tex_clamp(p.z, t->d));
+}
+
+template<class T, bool R>
+static inline int textureSize(const tsampler<1, T, R> &s, int lod = 0) { return s.t->w; }
+
+template<class T, bool R>
+static inline ivec2 textureSize(const tsampler<2, T, R> &s, int lod = 0)
+{
+    return ivec2(s.t->w, s.t->h);
+}
+
+template<class T, bool R>
+static inline ivec3 textureSize(const tsampler<3, T, R> &s, int lod = 0)
+{
+    return ivec3(s.t->w, s.t->h, s.t->d);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> textureGatherOffset(const tsampler<2, T, R> &s, const vec2 &p,
+                                             const ivec2 &off, int comp = 0)
+{
+    const pl_cpu_tex *t = s.t;
+    const vec2 pt = R ? p : vec2(p.x * t->w, p.y * t->h);
+    const int x = tex_floor(pt.x - 0.5f) + off.x, y = tex_floor(pt.y - 0.5f) + off.y;
+    const int x0 = tex_wrap(x, t->w, t->address), x1 = tex_wrap(x + 1, t->w, t->address);
+    const int y0 = tex_wrap(y, t->h, t->address), y1 = tex_wrap(y + 1, t->h, t->address);
+    return tvec<T, 4>(tex_fetch<T>(t, x0, y1, 0).v[comp], tex_fetch<T>(t, x1, y1, 0).v[comp],
+                      tex_fetch<T>(t, x1, y0, 0).v[comp], tex_fetch<T>(t, x0, y0, 0).v[comp]);
+}
+
+template<class T, bool R>
+static inline tvec<T, 4> textureGather(const tsampler<2, T, R> &s, const vec2 &p, int comp = 0)
+{
+    return textureGatherOffset(s, p, ivec2(0), comp);
+}
+
+// Built-in variables shared by all shader stages
+struct base {
+    vec4 gl_Position;
+    vec4 gl_FragCoord;
+    vec4 gl_FragColor;
+    bool gl_FrontFacing = true;
+    int gl_VertexID = 0;
+    int gl_InstanceID = 0;
+};
+
+struct discard_t {};
+[[noreturn]] static inline void discard() { throw discard_t(); }
+
+// Helpers for the generated glue code
+template<class T>
+static inline void load(T &dst, const void *src) { __builtin_memcpy((void *) &dst, src, sizeof(T)); }
+
+static inline void get(float &dst, const float *src) { dst = src[0]; }
+static inline void get(int &dst, const float *src) { dst = int(__builtin_roundf(src[0])); }
+static inline void get(uint &dst, const float *src) { dst = uint(__builtin_roundf(src[0])); }
+static inline void put(float *dst, float x) { dst[0] = x; }
+static inline void put(float *dst, int x) { dst[0] = float(x); }
+static inline void put(float *dst, uint x) { dst[0] = float(x); }
+
+template<class T, int N>
+static inline void get(tvec<T, N> &dst, const float *src)
+{
+    for (int i = 0; i < N; i++)
+        get(dst.v[i], src + i);
+}
+
+template<class T, int N>
+static inline void put(float *dst, const tvec<T, N> &x)
+{
+    for (int i = 0; i < N; i++)
+        put(dst + i, x.v[i]);
+}
+
+template<int C, int R>
+static inline void get(tmat<C, R> &dst, const float *src)
+{
+    for (int i = 0; i < C; i++)
+        get(dst.c[i], src + i * R);
+}
+
+template<int C, int R>
+static inline void put(float *dst, const tmat<C, R> &x)
+{
+    for (int i = 0; i < C; i++)
+        put(dst + i * R, x.c[i]);
+}
+
+// Linear interpolation of a varying at pixel `i` of a span
+template<class T>
+static inline void interp(T &dst, const float *v, const float *dx, int i)
+{
+    float tmp[comps<T>];
+    for (int k = 0; k < comps<T>; k++)
+        tmp[k] = v[k] + i * dx[k];
+    get(dst, tmp);
+}
+
+// Writes a fragment shader output as RGBA, filling in missing components
+template<class T>
+static inline void put_color(float *dst, const T &x)
+{
+    static_assert(comps<T> <= 4, "invalid fragment shader output");
+    float tmp[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    put(tmp, x);
+    for (int k = 0; k < 4; k++)
+        dst[k] = tmp[k];
+}
+
+struct place_t {};
+
+} // namespace glsl
+
+inline void *operator new(glsl::size_t, glsl::place_t, void *p) noexcept { return p; }
+inline void operator delete(void *, glsl::place_t, void *) noexcept {}
+
+)runtime";
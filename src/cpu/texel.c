@@ -0,0 +1,206 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "common.h"
+#include "cpu.h"
+
+static inline float half_to_float(uint16_t h)
+{
+    const uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    const uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+    float f;
+    if (exp == 0) {
+        f = ldexpf(mant, -24); // denormal
+    } else if (exp == 0x1F) {
+        f = mant ? NAN : INFINITY;
+    } else {
+        f = ldexpf(mant | 0x400, (int) exp - 25);
+    }
+
+    union { float f; uint32_t u; } u = { .f = f };
+    u.u |= sign;
+    return u.f;
+}
+
+static inline uint16_t float_to_half(float f)
+{
+    union { float f; uint32_t u; } u = { .f = f };
+    const uint16_t sign = (u.u >> 16) & 0x8000;
+    const float a = fabsf(f);
+    if (isnan(a))
+        return sign | 0x7E00;
+    if (a >= 65520.0f)
+        return sign | 0x7C00;
+    if (a < 0x1p-14f)
+        return sign | (uint16_t) lrintf(a * 0x1p24f); // denormal
+
+    int exp;
+    const float mant = frexpf(a, &exp); // [0.5, 1)
+    uint32_t bits = lrintf(mant * 2048.0f); // 11 significant bits
+    if (bits == 2048) {
+        bits = 1024;
+        exp++;
+    }
+    return sign | (uint16_t) (((exp + 14) << 10) + (bits - 1024));
+}
+
+// Reads component `c` of a texel, as a normalized float or raw integer value
+static inline double read_comp(pl_fmt fmt, const uint8_t *src, int c)
+{
+    const int depth = fmt->component_depth[c];
+    const uint8_t *p = src + fmt->sample_order[c] * depth / 8;
+
+#define READ(T) ({ T v_; memcpy(&v_, p, sizeof(v_)); v_; })
+
+    switch (fmt->type) {
+    case PL_FMT_UNORM:
+    case PL_FMT_UINT: {
+        uint64_t x;
+        switch (depth) {
+        case 8:  x = READ(uint8_t); break;
+        case 16: x = READ(uint16_t); break;
+        case 32: x = READ(uint32_t); break;
+        default: x = READ(uint64_t); break;
+        }
+        if (fmt->type == PL_FMT_UINT)
+            return x;
+        return x / (double) (UINT64_MAX >> (64 - depth));
+    }
+    case PL_FMT_SNORM:
+    case PL_FMT_SINT: {
+        int64_t x;
+        switch (depth) {
+        case 8:  x = READ(int8_t); break;
+        case 16: x = READ(int16_t); break;
+        case 32: x = READ(int32_t); break;
+        default: x = READ(int64_t); break;
+        }
+        if (fmt->type == PL_FMT_SINT)
+            return x;
+        return PL_MAX(x / (double) (INT64_MAX >> (64 - depth)), -1.0);
+    }
+    case PL_FMT_FLOAT:
+        switch (depth) {
+        case 16: return half_to_float(READ(uint16_t));
+        case 32: return READ(float);
+        default: return READ(double);
+        }
+    case PL_FMT_UNKNOWN:
+    case PL_FMT_TYPE_COUNT:
+        break;
+    }
+
+#undef READ
+
+    pl_unreachable();
+}
+
+void pl_cpu_decode(pl_fmt fmt, const void *src, void *dst, size_t num)
+{
+    const uint8_t *in = src;
+    const bool is_int = fmt->type == PL_FMT_UINT || fmt->type == PL_FMT_SINT;
+
+    if (fmt->type == PL_FMT_FLOAT && fmt->num_components == 4 &&
+        fmt->texel_size == 4 * sizeof(float) && !fmt->opaque)
+    {
+        memcpy(dst, src, num * 4 * sizeof(float));
+        return;
+    }
+
+    for (size_t i = 0; i < num; i++, in += fmt->texel_size) {
+        double rgba[4] = { 0.0, 0.0, 0.0, 1.0 };
+        for (int c = 0; c < fmt->num_components; c++)
+            rgba[c] = read_comp(fmt, in, c);
+
+        for (int c = 0; c < 4; c++) {
+            if (!is_int) {
+                ((float *) dst)[4 * i + c] = rgba[c];
+            } else if (fmt->type == PL_FMT_UINT) {
+                ((uint32_t *) dst)[4 * i + c] = rgba[c];
+            } else {
+                ((int32_t *) dst)[4 * i + c] = rgba[c];
+            }
+        }
+    }
+}
+
+void pl_cpu_decode_float(pl_fmt fmt, const void *src, float *dst, size_t num)
+{
+    const uint8_t *in = src;
+    for (size_t i = 0; i < num; i++, in += fmt->texel_size) {
+        float *out = &dst[4 * i];
+        out[0] = out[1] = out[2] = 0.0f;
+        out[3] = 1.0f;
+        for (int c = 0; c < fmt->num_components; c++)
+            out[c] = read_comp(fmt, in, c);
+    }
+}
+
+void pl_cpu_encode(pl_fmt fmt, const float *src, void *dst, size_t num)
+{
+    uint8_t *out = dst;
+    for (size_t i = 0; i < num; i++, out += fmt->texel_size, src += 4) {
+        for (int c = 0; c < fmt->num_components; c++) {
+            const int depth = fmt->component_depth[c];
+            uint8_t *p = out + fmt->sample_order[c] * depth / 8;
+            double x = src[c];
+
+            switch (fmt->type) {
+            case PL_FMT_UNORM:
+            case PL_FMT_UINT: {
+                const double max = UINT64_MAX >> (64 - depth);
+                if (fmt->type == PL_FMT_UNORM)
+                    x *= max;
+                x = isnan(x) ? 0.0 : PL_CLAMP(round(x), 0.0, max);
+                switch (depth) {
+                case 8:  *p = x; break;
+                case 16: { uint16_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                case 32: { uint32_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                default: { uint64_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                }
+                break;
+            }
+            case PL_FMT_SNORM:
+            case PL_FMT_SINT: {
+                const double max = INT64_MAX >> (64 - depth);
+                if (fmt->type == PL_FMT_SNORM)
+                    x *= max;
+                x = isnan(x) ? 0.0 : PL_CLAMP(round(x), -max - 1, max);
+                switch (depth) {
+                case 8:  { int8_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                case 16: { int16_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                case 32: { int32_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                default: { int64_t v = x; memcpy(p, &v, sizeof(v)); break; }
+                }
+                break;
+            }
+            case PL_FMT_FLOAT:
+                switch (depth) {
+                case 16: { uint16_t v = float_to_half(x); memcpy(p, &v, sizeof(v)); break; }
+                case 32: { float v = x; memcpy(p, &v, sizeof(v)); break; }
+                default: memcpy(p, &x, sizeof(x)); break;
+                }
+                break;
+            case PL_FMT_UNKNOWN:
+            case PL_FMT_TYPE_COUNT:
+                pl_unreachable();
+            }
+        }
+    }
+}
@@ -0,0 +1,873 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Source-to-source translation of GLSL into C++, on top of the runtime in
+// runtime.cc. GLSL is close enough to C++ that a token-level rewrite gets us
+// most of the way there; the remaining semantic differences are taken care
+// of by the runtime types. The main transformations are:
+//
+// - Each shader stage becomes a struct deriving from `glsl::base`, so that
+//   global variables (uniforms, inputs, outputs) turn into data members and
+//   functions into member functions, which frees us from having to care
+//   about declaration order.
+// - Qualifiers with no C++ equivalent (layout, uniform, precision, ...) are
+//   dropped, `out` and `inout` parameters become references, and global
+//   `in` / `out` variables are recorded for the interface code.
+// - Swizzles become calls to `swz<...>()`, or `swzr<...>()` when assigned
+//   to, float literals get an `f` suffix, and array and struct constructors
+//   become brace initializers.
+// - Function prototypes are dropped, and identifiers which are reserved in
+//   C++ are renamed.
+//
+// Note that this is not a GLSL compiler, and does not attempt to validate
+// its input. It only needs to handle the shaders libplacebo generates (plus
+// typical user shaders); anything else will fail to compile as C++.
+
+#include "common.h"
+#include "log.h"
+#include "cpu.h"
+
+#define MAX_PARENS 256
+
+struct io_var {
+    pl_str type;
+    pl_str name;
+};
+
+struct stage {
+    int version;
+    bool discard;
+    PL_ARRAY(pl_str) defines;
+    PL_ARRAY(pl_str) structs;
+    PL_ARRAY(pl_str) uniforms;
+    PL_ARRAY(struct io_var) ins;
+    PL_ARRAY(struct io_var) outs;
+};
+
+enum io_dir {
+    IO_NONE = 0,
+    IO_IN,
+    IO_OUT,
+};
+
+struct tstate {
+    void *alloc;
+    pl_str *out;
+    struct stage *st;
+    bool frag;
+    pl_str src;
+    size_t pos;
+
+    // Parser state
+    int depth;      // nesting level of {}
+    int parens;     // nesting level of ()
+    bool brace[MAX_PARENS]; // `(` was translated to `{`
+    bool line_start;
+    bool pending_ref;
+    char last_sig;  // last significant character seen
+
+    // State of the current statement at global scope
+    size_t stmt_start;
+    enum io_dir stmt_io;
+    bool stmt_uniform;
+    bool stmt_eq;
+    bool stmt_paren;
+    bool stmt_bracket;
+    int stmt_idents;
+    pl_str stmt_type;
+    pl_str stmt_name;
+};
+
+static inline bool is_alpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_alnum(char c)
+{
+    return is_alpha(c) || is_digit(c);
+}
+
+static inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline char peek(const struct tstate *t, size_t pos)
+{
+    return pos < t->src.len ? t->src.buf[pos] : '\0';
+}
+
+static size_t skip_space(const struct tstate *t, size_t pos)
+{
+    while (is_space(peek(t, pos)) || peek(t, pos) == '\n')
+        pos++;
+    return pos;
+}
+
+static pl_str ident_at(const struct tstate *t, size_t pos)
+{
+    size_t end = pos;
+    if (is_alpha(peek(t, end))) {
+        while (is_alnum(peek(t, end)))
+            end++;
+    }
+    return (pl_str) { t->src.buf + pos, end - pos };
+}
+
+static inline void emit(struct tstate *t, pl_str str)
+{
+    pl_str_append(t->alloc, t->out, str);
+}
+
+static inline void emit0(struct tstate *t, const char *str)
+{
+    emit(t, pl_str0(str));
+}
+
+// Emits one newline for each newline in src[start, end), to keep the line
+// numbers in compiler errors in sync with the GLSL source
+static void emit_newlines(struct tstate *t, size_t start, size_t end)
+{
+    for (size_t i = start; i < end; i++) {
+        if (t->src.buf[i] == '\n')
+            emit0(t, "\n");
+    }
+}
+
+static bool str_in(pl_str str, const char *const list[])
+{
+    for (int i = 0; list[i]; i++) {
+        if (pl_str_equals0(str, list[i]))
+            return true;
+    }
+    return false;
+}
+
+static bool str_in_array(pl_str str, const pl_str *list, int num)
+{
+    for (int i = 0; i < num; i++) {
+        if (pl_str_equals(str, list[i]))
+            return true;
+    }
+    return false;
+}
+
+// Identifiers which are valid in GLSL, but reserved in C++ or by the
+// generated code. These are renamed by appending an underscore.
+static const char *const reserved_names[] = {
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+    "catch", "char", "char8_t", "char16_t", "char32_t", "class", "compl",
+    "concept", "consteval", "constexpr", "constinit", "const_cast",
+    "co_await", "co_return", "co_yield", "decltype", "delete",
+    "dynamic_cast", "explicit", "export", "extern", "final", "friend", "goto",
+    "inline", "long", "mutable", "namespace", "new", "noexcept", "not",
+    "not_eq", "nullptr", "operator", "or", "or_eq", "override", "private",
+    "protected", "public", "register", "reinterpret_cast", "requires",
+    "short", "signed", "sizeof", "static", "static_assert", "static_cast",
+    "template", "this", "thread_local", "throw", "try", "typedef", "typeid",
+    "typename", "union", "unsigned", "using", "virtual", "wchar_t", "xor",
+    "xor_eq", "glsl", "base", "shader",
+    NULL
+};
+
+static pl_str cxx_name(void *alloc, pl_str name)
+{
+    if (!str_in(name, reserved_names))
+        return name;
+
+    pl_str ret = {0};
+    pl_str_append_asprintf_c(alloc, &ret, "%.*s_", PL_STR_FMT(name));
+    return ret;
+}
+
+static void emit_ident(struct tstate *t, pl_str id)
+{
+    emit(t, cxx_name(t->alloc, id));
+}
+
+static bool is_type(const struct tstate *t, pl_str id)
+{
+    static const char *const scalars[] = { "float", "int", "uint", "bool", NULL };
+    if (str_in(id, scalars))
+        return true;
+    if (str_in_array(id, t->st->structs.elem, t->st->structs.num))
+        return true;
+
+    pl_str rest = id;
+    if (!pl_str_eatstart0(&rest, "mat")) {
+        if (rest.len && strchr("iub", rest.buf[0]))
+            rest = pl_str_drop(rest, 1);
+        if (!pl_str_eatstart0(&rest, "vec"))
+            return false;
+    }
+
+    // Remainder must be something like `3` or `2x4`
+    return rest.len && pl_strspn(rest, "234x") == rest.len;
+}
+
+static void stmt_reset(struct tstate *t)
+{
+    t->stmt_start = t->out->len;
+    t->stmt_io = IO_NONE;
+    t->stmt_uniform = false;
+    t->stmt_eq = false;
+    t->stmt_paren = false;
+    t->stmt_bracket = false;
+    t->stmt_idents = 0;
+    t->stmt_type = t->stmt_name = (pl_str) {0};
+}
+
+static inline bool global_scope(const struct tstate *t)
+{
+    return t->depth == 0 && t->parens == 0;
+}
+
+static void end_statement(struct tstate *t)
+{
+    struct stage *st = t->st;
+    if (t->stmt_paren && !t->stmt_eq && t->last_sig == ')') {
+        // Function prototype, drop it (but keep the line count intact)
+        size_t len = t->out->len - t->stmt_start;
+        int newlines = 0;
+        for (size_t i = 0; i < len; i++)
+            newlines += t->out->buf[t->stmt_start + i] == '\n';
+        t->out->len = t->stmt_start;
+        while (newlines--)
+            emit0(t, "\n");
+        stmt_reset(t);
+        return;
+    }
+
+    emit0(t, ";");
+    if (t->stmt_idents >= 2) {
+        const struct io_var var = {
+            .type = pl_strdup(t->alloc, t->stmt_type),
+            .name = pl_strdup(t->alloc, cxx_name(t->alloc, t->stmt_name)),
+        };
+
+        switch (t->stmt_io) {
+        case IO_IN:  PL_ARRAY_APPEND(t->alloc, st->ins, var); break;
+        case IO_OUT: PL_ARRAY_APPEND(t->alloc, st->outs, var); break;
+        case IO_NONE: break;
+        }
+
+        if (t->stmt_uniform)
+            PL_ARRAY_APPEND(t->alloc, st->uniforms, var.name);
+    }
+
+    stmt_reset(t);
+}
+
+static void translate_number(struct tstate *t)
+{
+    size_t start = t->pos, pos = start;
+    bool is_float = false;
+
+    if (peek(t, pos) == '0' && (peek(t, pos + 1) == 'x' || peek(t, pos + 1) == 'X')) {
+        pos += 2;
+        while (is_alnum(peek(t, pos)) && peek(t, pos) != 'u' && peek(t, pos) != 'U')
+            pos++;
+    } else {
+        while (is_digit(peek(t, pos)))
+            pos++;
+        if (peek(t, pos) == '.') {
+            is_float = true;
+            pos++;
+            while (is_digit(peek(t, pos)))
+                pos++;
+        }
+
+        if (peek(t, pos) == 'e' || peek(t, pos) == 'E') {
+            size_t exp = pos + 1;
+            if (peek(t, exp) == '+' || peek(t, exp) == '-')
+                exp++;
+            if (is_digit(peek(t, exp))) {
+                is_float = true;
+                pos = exp;
+                while (is_digit(peek(t, pos)))
+                    pos++;
+            }
+        }
+    }
+
+    emit(t, (pl_str) { t->src.buf + start, pos - start });
+
+    // Normalize the suffix, treating doubles as floats
+    char c = peek(t, pos);
+    if (c == 'f' || c == 'F') {
+        pos++;
+        emit0(t, "f");
+    } else if ((c == 'l' || c == 'L') && (peek(t, pos + 1) == 'f' || peek(t, pos + 1) == 'F')) {
+        pos += 2;
+        emit0(t, "f");
+    } else if (c == 'u' || c == 'U') {
+        pos++;
+        emit0(t, "u");
+    } else if (is_float) {
+        emit0(t, "f");
+    }
+
+    t->pos = pos;
+}
+
+static int swizzle_index(char c, const char *set)
+{
+    for (int i = 0; set[i]; i++) {
+        if (set[i] == c)
+            return i;
+    }
+    return -1;
+}
+
+// Handles `.` followed by a member name
+static void translate_member(struct tstate *t)
+{
+    static const char *const sets[] = { "xyzw", "rgba", "stpq" };
+
+    pl_str id = ident_at(t, t->pos + 1);
+    int set = -1;
+    if (id.len >= 2 && id.len <= 4) {
+        for (int s = 0; s < PL_ARRAY_SIZE(sets) && set < 0; s++) {
+            set = s;
+            for (int i = 0; i < id.len; i++) {
+                if (swizzle_index(id.buf[i], sets[s]) < 0) {
+                    set = -1;
+                    break;
+                }
+            }
+        }
+    }
+
+    t->pos += 1 + id.len;
+    if (set < 0) {
+        emit0(t, ".");
+        emit_ident(t, id);
+        return;
+    }
+
+    // Assignments need a proxy object, everything else can use a copy
+    size_t pos = skip_space(t, t->pos);
+    char c0 = peek(t, pos), c1 = peek(t, pos + 1);
+    bool lvalue = (c0 == '=' && c1 != '=') ||
+                  (strchr("+-*/", c0) && c0 && c1 == '=');
+
+    emit0(t, lvalue ? ".swzr<" : ".swz<");
+    for (int i = 0; i < id.len; i++) {
+        pl_str_append_asprintf_c(t->alloc, t->out, "%s%d", i ? "," : "",
+                                 swizzle_index(id.buf[i], sets[set]));
+    }
+    emit0(t, ">()");
+}
+
+static void push_paren(struct tstate *t, bool brace)
+{
+    if (t->parens < MAX_PARENS)
+        t->brace[t->parens] = brace;
+    t->parens++;
+}
+
+static void translate_ident(struct tstate *t, bool pp)
+{
+    static const char *const dropped[] = {
+        "highp", "mediump", "lowp", "flat", "smooth", "noperspective",
+        "centroid", "invariant", "precise", "restrict", "readonly",
+        "writeonly", "coherent", "volatile",
+        NULL
+    };
+
+    struct stage *st = t->st;
+    pl_str id = ident_at(t, t->pos);
+    t->pos += id.len;
+    t->last_sig = 'a';
+
+    if (pp) {
+        emit_ident(t, id);
+        return;
+    }
+
+    if (pl_str_equals0(id, "layout")) {
+        size_t pos = skip_space(t, t->pos);
+        if (peek(t, pos) == '(') {
+            int level = 0;
+            do {
+                char c = peek(t, pos++);
+                level += c == '(';
+                level -= c == ')';
+            } while (level > 0 && pos < t->src.len);
+            emit_newlines(t, t->pos, pos);
+            t->pos = pos;
+        }
+        return;
+    }
+
+    if (str_in(id, dropped))
+        return;
+
+    if (pl_str_equals0(id, "precision")) {
+        size_t pos = t->pos;
+        while (pos < t->src.len && t->src.buf[pos] != ';')
+            pos++;
+        emit_newlines(t, t->pos, pos);
+        t->pos = PL_MIN(pos + 1, t->src.len);
+        return;
+    }
+
+    if (pl_str_equals0(id, "uniform")) {
+        t->stmt_uniform |= global_scope(t);
+        return;
+    }
+
+    static const char *const io_quals[] = {
+        "in", "out", "inout", "attribute", "varying", NULL
+    };
+
+    if (str_in(id, io_quals)) {
+        if (t->depth == 0 && t->parens > 0) {
+            // Function parameter
+            t->pending_ref |= !pl_str_equals0(id, "in");
+            return;
+        } else if (global_scope(t)) {
+            bool in = pl_str_equals0(id, "in") || pl_str_equals0(id, "attribute") ||
+                      (pl_str_equals0(id, "varying") && t->frag);
+            t->stmt_io = in ? IO_IN : IO_OUT;
+            return;
+        }
+    }
+
+    if (pl_str_equals0(id, "discard")) {
+        st->discard = true;
+        emit0(t, "discard()");
+        return;
+    }
+
+    if (pl_str_equals0(id, "struct")) {
+        emit(t, id);
+        pl_str name = ident_at(t, skip_space(t, t->pos));
+        if (name.len)
+            PL_ARRAY_APPEND(t->alloc, st->structs, pl_strdup(t->alloc, name));
+        return;
+    }
+
+    if (pl_str_equals0(id, "const") && global_scope(t)) {
+        // Make integral constants usable in constant expressions, e.g. as
+        // array sizes, which requires them to be static
+        static const char *const integral[] = { "int", "uint", "bool", NULL };
+        pl_str type = ident_at(t, skip_space(t, t->pos));
+        emit0(t, str_in(type, integral) ? "static constexpr" : "const");
+        return;
+    }
+
+    if (is_type(t, id)) {
+        size_t pos = skip_space(t, t->pos);
+        if (peek(t, pos) == '[') {
+            // Possibly an array constructor, e.g. `float[3](...)`
+            size_t end = pos;
+            while (end < t->src.len && t->src.buf[end] != ']')
+                end++;
+            end = skip_space(t, end + 1);
+            if (peek(t, end) == '(') {
+                emit_newlines(t, t->pos, end);
+                emit0(t, "{");
+                push_paren(t, true);
+                t->pos = end + 1;
+                return;
+            }
+        } else if (peek(t, pos) == '(' &&
+                   str_in_array(id, st->structs.elem, st->structs.num))
+        {
+            // Struct constructor
+            emit_ident(t, id);
+            emit_newlines(t, t->pos, pos);
+            emit0(t, "{");
+            push_paren(t, true);
+            t->pos = pos + 1;
+            return;
+        }
+    }
+
+    emit_ident(t, id);
+    if (t->pending_ref) {
+        // This is the type of an `out` or `inout` parameter
+        emit0(t, " &");
+        t->pending_ref = false;
+    }
+
+    if (global_scope(t) && !t->stmt_eq && !t->stmt_bracket) {
+        if (!t->stmt_idents++)
+            t->stmt_type = id;
+        t->stmt_name = id;
+    }
+}
+
+static void translate_range(struct tstate *t, size_t end, bool pp);
+
+static void translate_directive(struct tstate *t)
+{
+    struct stage *st = t->st;
+
+    // Find the end of the directive, taking line continuations into account
+    size_t end = t->pos;
+    while (end < t->src.len && t->src.buf[end] != '\n')
+        end += t->src.buf[end] == '\\' ? 2 : 1;
+    end = PL_MIN(end, t->src.len);
+
+    size_t pos = t->pos + 1;
+    while (is_space(peek(t, pos)))
+        pos++;
+    pl_str name = ident_at(t, pos);
+    pos += name.len;
+
+    if (pl_str_equals0(name, "version")) {
+        pl_str rest = { t->src.buf + pos, end - pos };
+        pl_str_parse_int(pl_str_split_chars(pl_str_strip(rest), " \t", NULL),
+                         &st->version);
+
+        int line = 1;
+        for (size_t i = 0; i < t->pos; i++)
+            line += t->src.buf[i] == '\n';
+        pl_str_append_asprintf_c(t->alloc, t->out, "#undef __VERSION__\n"
+                                 "#define __VERSION__ %d\n#line %d",
+                                 st->version, line + 1);
+        t->pos = end;
+        return;
+    }
+
+    if (pl_str_equals0(name, "extension") || pl_str_equals0(name, "pragma")) {
+        emit_newlines(t, t->pos, end);
+        t->pos = end;
+        return;
+    }
+
+    if (pl_str_equals0(name, "define")) {
+        while (is_space(peek(t, pos)))
+            pos++;
+        pl_str macro = ident_at(t, pos);
+        if (macro.len)
+            PL_ARRAY_APPEND(t->alloc, st->defines, pl_strdup(t->alloc, macro));
+    }
+
+    translate_range(t, end, true);
+}
+
+// Translates src[t->pos, end). In preprocessor mode (`pp`), only the
+// token-level transformations are performed.
+static void translate_range(struct tstate *t, size_t end, bool pp)
+{
+    while (t->pos < end) {
+        const char c = t->src.buf[t->pos], next = peek(t, t->pos + 1);
+
+        if (c == '\n') {
+            emit0(t, "\n");
+            t->pos++;
+            t->line_start = true;
+            continue;
+        }
+
+        if (is_space(c)) {
+            emit(t, (pl_str) { t->src.buf + t->pos, 1 });
+            t->pos++;
+            continue;
+        }
+
+        if (!pp && t->line_start && c == '#') {
+            translate_directive(t);
+            continue;
+        }
+
+        t->line_start = false;
+
+        // Copy comments, line continuations and strings verbatim
+        size_t copy = 0;
+        if (c == '/' && next == '/') {
+            while (t->pos + copy < end && t->src.buf[t->pos + copy] != '\n')
+                copy++;
+        } else if (c == '/' && next == '*') {
+            pl_str rest = { t->src.buf + t->pos, end - t->pos };
+            int idx = pl_str_find(pl_str_drop(rest, 2), pl_str0("*/"));
+            copy = idx >= 0 ? idx + 4 : rest.len;
+        } else if (c == '\\' && next == '\n') {
+            copy = 2;
+        } else if (pp && c == '"') {
+            copy = 1;
+            while (t->pos + copy < end && t->src.buf[t->pos + copy++] != '"')
+                ;
+        }
+
+        if (copy) {
+            emit(t, (pl_str) { t->src.buf + t->pos, copy });
+            t->pos += copy;
+            continue;
+        }
+
+        if (is_digit(c) || (c == '.' && is_digit(next))) {
+            translate_number(t);
+            t->last_sig = '0';
+            continue;
+        }
+
+        if (is_alpha(c)) {
+            translate_ident(t, pp);
+            continue;
+        }
+
+        if (c == '.') {
+            translate_member(t);
+            t->last_sig = 'a';
+            continue;
+        }
+
+        t->pos++;
+        if (pp) {
+            emit(t, (pl_str) { t->src.buf + t->pos - 1, 1 });
+            continue;
+        }
+
+        switch (c) {
+        case '(':
+            if (global_scope(t) && !t->stmt_eq)
+                t->stmt_paren = true;
+            push_paren(t, false);
+            emit0(t, "(");
+            break;
+        case ')':
+            t->parens = PL_MAX(t->parens - 1, 0);
+            bool brace = t->parens < MAX_PARENS && t->brace[t->parens];
+            emit0(t, brace ? "}" : ")");
+            break;
+        case '{':
+            t->depth++;
+            emit0(t, "{");
+            break;
+        case '}':
+            t->depth = PL_MAX(t->depth - 1, 0);
+            emit0(t, "}");
+            if (global_scope(t))
+                stmt_reset(t);
+            break;
+        case '[':
+            t->stmt_bracket |= global_scope(t);
+            emit0(t, "[");
+            break;
+        case '=':
+            t->stmt_eq |= global_scope(t);
+            emit0(t, "=");
+            break;
+        case ';':
+            if (global_scope(t)) {
+                end_statement(t);
+                break;
+            }
+            emit0(t, ";");
+            break;
+        default:
+            emit(t, (pl_str) { t->src.buf + t->pos - 1, 1 });
+            break;
+        }
+
+        t->last_sig = c;
+    }
+}
+
+static void translate_stage(void *alloc, pl_str *out, struct stage *st,
+                            const char *ns, const char *glsl, bool frag)
+{
+    pl_str_append_asprintf_c(alloc, out,
+        "namespace %s {\n"
+        "using namespace glsl;\n"
+        "struct shader : base {\n"
+        "#line 1 \"%s\"\n",
+        ns, frag ? "fragment" : "vertex");
+
+    struct tstate t = {
+        .alloc = alloc,
+        .out = out,
+        .st = st,
+        .frag = frag,
+        .src = pl_str0(glsl),
+        .line_start = true,
+    };
+
+    stmt_reset(&t);
+    translate_range(&t, t.src.len, false);
+
+    pl_str_append_asprintf_c(alloc, out, "\n};\n} // namespace %s\n", ns);
+    for (int i = 0; i < st->defines.num; i++)
+        pl_str_append_asprintf_c(alloc, out, "#undef %.*s\n", PL_STR_FMT(st->defines.elem[i]));
+}
+
+static const struct io_var *find_var(const struct io_var *vars, int num, pl_str name)
+{
+    for (int i = 0; i < num; i++) {
+        if (pl_str_equals(vars[i].name, name))
+            return &vars[i];
+    }
+    return NULL;
+}
+
+#define ADD(...) pl_str_append_asprintf_c(alloc, out, __VA_ARGS__)
+
+// Binds all uniforms and samplers declared by a stage
+static void add_bindings(void *alloc, pl_str *out, const struct stage *st,
+                         const struct pl_pass_params *params)
+{
+    for (int i = 0; i < params->num_variables; i++) {
+        pl_str name = cxx_name(alloc, pl_str0(params->variables[i].name));
+        if (str_in_array(name, st->uniforms.elem, st->uniforms.num))
+            ADD("    glsl::load(s->%.*s, bind->vars[%d]);\n", PL_STR_FMT(name), i);
+    }
+
+    // Array elements are laid out consecutively in `bind->descs`
+    for (int i = 0, idx = 0; i < params->num_descriptors; i++) {
+        const struct pl_desc *desc = &params->descriptors[i];
+        pl_str name = cxx_name(alloc, pl_str0(desc->name));
+        if (str_in_array(name, st->uniforms.elem, st->uniforms.num)) {
+            if (desc->count) {
+                for (int j = 0; j < desc->count; j++) {
+                    ADD("    s->%.*s[%d].t = &bind->descs[%d];\n",
+                        PL_STR_FMT(name), j, idx + j);
+                }
+            } else {
+                ADD("    s->%.*s.t = &bind->descs[%d];\n", PL_STR_FMT(name), idx);
+            }
+        }
+        idx += pl_desc_elems(desc);
+    }
+}
+
+static void add_glue(void *alloc, pl_str *out, const struct stage *vert,
+                     const struct stage *frag, const struct pl_pass_params *params)
+{
+    ADD("#line 1 \"interface\"\n"
+        "namespace pl_glue {\n"
+        "using glsl::comps;\n"
+        "constexpr int num_varyings = 0");
+    for (int i = 0; i < vert->outs.num; i++) {
+        ADD(" + comps<decltype(pl_vert::shader::%.*s)>",
+            PL_STR_FMT(vert->outs.elem[i].name));
+    }
+    ADD(";\n");
+
+    // Offsets of each varying, in the order of the vertex shader outputs
+    for (int i = 0; i < vert->outs.num; i++) {
+        if (i == 0) {
+            ADD("constexpr int vary_0 = 0;\n");
+            continue;
+        }
+        ADD("constexpr int vary_%d = vary_%d + comps<decltype(pl_vert::shader::%.*s)>;\n",
+            i, i - 1, PL_STR_FMT(vert->outs.elem[i - 1].name));
+    }
+
+    ADD("\n"
+        "static void vert_create(void *mem, const pl_cpu_bindings *bind)\n"
+        "{\n"
+        "    pl_vert::shader *s = new (glsl::place_t(), mem) pl_vert::shader();\n");
+    add_bindings(alloc, out, vert, params);
+    ADD("}\n"
+        "\n"
+        "static void vert_run(void *p, const float *attribs, float *out)\n"
+        "{\n"
+        "    pl_vert::shader *s = (pl_vert::shader *) p;\n");
+    for (int i = 0; i < params->num_vertex_attribs; i++) {
+        pl_str name = cxx_name(alloc, pl_str0(params->vertex_attribs[i].name));
+        if (find_var(vert->ins.elem, vert->ins.num, name))
+            ADD("    glsl::get(s->%.*s, attribs + %d);\n", PL_STR_FMT(name), 4 * i);
+    }
+    ADD("    s->main();\n"
+        "    glsl::put(out, s->gl_Position);\n");
+    for (int i = 0; i < vert->outs.num; i++) {
+        ADD("    glsl::put(out + 4 + vary_%d, s->%.*s);\n", i,
+            PL_STR_FMT(vert->outs.elem[i].name));
+    }
+    ADD("}\n"
+        "\n"
+        "static void frag_create(void *mem, const pl_cpu_bindings *bind)\n"
+        "{\n"
+        "    pl_frag::shader *s = new (glsl::place_t(), mem) pl_frag::shader();\n");
+    add_bindings(alloc, out, frag, params);
+    ADD("}\n"
+        "\n"
+        "static void frag_run(void *p, const pl_cpu_span *span)\n"
+        "{\n"
+        "    pl_frag::shader *s = (pl_frag::shader *) p;\n"
+        "    for (int x = span->x0, i = 0; x < span->x1; x++, i++) {\n");
+    for (int i = 0; i < frag->ins.num; i++) {
+        pl_str name = frag->ins.elem[i].name;
+        for (int j = 0; j < vert->outs.num; j++) {
+            if (!pl_str_equals(name, vert->outs.elem[j].name))
+                continue;
+            ADD("        glsl::interp(s->%.*s, span->vary + vary_%d, "
+                "span->vary_dx + vary_%d, i);\n", PL_STR_FMT(name), j, j);
+            break;
+        }
+    }
+    ADD("        s->gl_FragCoord = glsl::vec4(x + 0.5f, span->y + 0.5f, 0.0f, 1.0f);\n");
+    if (frag->discard) {
+        ADD("        try {\n"
+            "            s->main();\n"
+            "        } catch (const glsl::discard_t &) {\n"
+            "            span->mask[i] = 0;\n"
+            "            continue;\n"
+            "        }\n");
+    } else {
+        ADD("        s->main();\n");
+    }
+    ADD("        span->mask[i] = 1;\n"
+        "        glsl::put_color(span->out + 4 * i, s->%.*s);\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "static void vert_destroy(void *p) { ((pl_vert::shader *) p)->~shader(); }\n"
+        "static void frag_destroy(void *p) { ((pl_frag::shader *) p)->~shader(); }\n"
+        "\n"
+        "} // namespace pl_glue\n"
+        "\n"
+        "extern \"C\" __attribute__((visibility(\"default\"))) const pl_cpu_module pl_cpu_entry;\n"
+        "extern \"C\" const pl_cpu_module pl_cpu_entry = {\n"
+        "    PL_CPU_ABI_VERSION,\n"
+        "    pl_glue::num_varyings,\n"
+        "    sizeof(pl_vert::shader),\n"
+        "    sizeof(pl_frag::shader),\n"
+        "    pl_glue::vert_create,\n"
+        "    pl_glue::vert_run,\n"
+        "    pl_glue::vert_destroy,\n"
+        "    pl_glue::frag_create,\n"
+        "    pl_glue::frag_run,\n"
+        "    pl_glue::frag_destroy,\n"
+        "};\n",
+        PL_STR_FMT(frag->outs.num ? frag->outs.elem[0].name : pl_str0("gl_FragColor")));
+}
+
+#undef ADD
+
+pl_str pl_cpu_translate(void *alloc, const struct pl_pass_params *params)
+{
+    pl_assert(params->type == PL_PASS_RASTER);
+    struct stage vert = {0}, frag = {0};
+    pl_str out = {0};
+
+    pl_str_append(alloc, &out, pl_str0(pl_cpu_runtime));
+    translate_stage(alloc, &out, &vert, "pl_vert", params->vertex_shader, false);
+    translate_stage(alloc, &out, &frag, "pl_frag", params->glsl_shader, true);
+    add_glue(alloc, &out, &vert, &frag, params);
+    return out;
+}
@@ -23,10 +23,13 @@
 #include "pl_thread.h"
 
 // Maximum number of passes to keep around at once. If full, passes older than
-// MIN_AGE are evicted to make room. (Failing that, the passes array doubles)
+// MIN_AGE are evicted to make room. (Failing that, the limit doubles)
 #define MAX_PASSES 100
 #define MIN_AGE 10
 
+// Initial number of hash buckets for the pass cache, must be a power of two
+#define MIN_PASS_BUCKETS 64
+
 enum {
     TMP_PRELUDE,   // GLSL version, global definitions, etc.
     TMP_MAIN,      // main GLSL shader body
@@ -43,12 +46,31 @@ struct pl_dispatch_t {
     uint8_t current_index;
     bool dynamic_constants;
     int max_passes;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+
+    // background pass compilation, see `pl_dispatch_mark_async`
+    bool async;
+    bool exit;
+    bool has_worker;
+    pl_thread worker;
+    pl_cond wakeup;
+    pl_cond compiled;
+    PL_ARRAY(struct pass *) compile_queue;
+    int num_pending; // passes queued or undergoing compilation
+    bool pending;    // dispatches were discarded since enabling `async`
 
     void (*info_callback)(void *, const struct pl_dispatch_info *);
     void *info_priv;
 
     PL_ARRAY(pl_shader) shaders;                // to avoid re-allocations
-    PL_ARRAY(struct pass *) passes;             // compiled passes
+
+    // compiled passes, indexed by signature and ordered by last use
+    struct pass **buckets;  // hash table, `num_buckets` is a power of two
+    int num_buckets;
+    int num_passes;
+    struct pass *oldest;
+    struct pass *newest;
 
     // temporary buffers to help avoid re_allocations during pass creation
     PL_ARRAY(const struct pl_buffer_var *) buf_tmp;
@@ -76,6 +98,15 @@ struct pass {
     pl_pass pass;
     int last_index;
 
+    struct pass *hnext;         // next pass in the same hash bucket
+    struct pass *prev, *next;   // age-ordered list, oldest first
+
+    // Set while this pass is queued for (or undergoing) background
+    // compilation, in which case `compile_params` holds a private copy of
+    // the pass parameters
+    bool compiling;
+    struct pl_pass_params *compile_params;
+
     // contains cached data and update metadata, same order as pl_shader
     struct pass_var *vars;
     int num_var_locs;
@@ -110,13 +141,167 @@ static void pass_destroy(pl_dispatch dp, struct pass *pass)
     pl_free(pass);
 }
 
+static inline struct pass **pass_bucket(pl_dispatch dp, uint64_t signature)
+{
+    return &dp->buckets[(signature * GOLDEN_RATIO_64 >> 32) & (dp->num_buckets - 1)];
+}
+
+static struct pass *find_pass(pl_dispatch dp, uint64_t signature)
+{
+    struct pass *pass = *pass_bucket(dp, signature);
+    while (pass && pass->signature != signature)
+        pass = pass->hnext;
+    return pass;
+}
+
+static void list_remove(pl_dispatch dp, struct pass *pass)
+{
+    if (pass->prev) {
+        pass->prev->next = pass->next;
+    } else {
+        dp->oldest = pass->next;
+    }
+    if (pass->next) {
+        pass->next->prev = pass->prev;
+    } else {
+        dp->newest = pass->prev;
+    }
+    pass->prev = pass->next = NULL;
+}
+
+static void list_append(pl_dispatch dp, struct pass *pass)
+{
+    pass->prev = dp->newest;
+    pass->next = NULL;
+    if (dp->newest) {
+        dp->newest->next = pass;
+    } else {
+        dp->oldest = pass;
+    }
+    dp->newest = pass;
+}
+
+static void grow_buckets(pl_dispatch dp)
+{
+    struct pass **old = dp->buckets;
+    const int num_old = dp->num_buckets;
+    if (num_old > INT_MAX / 2)
+        return;
+
+    dp->num_buckets = num_old * 2;
+    dp->buckets = pl_calloc_ptr(dp, dp->num_buckets, dp->buckets);
+    for (int i = 0; i < num_old; i++) {
+        struct pass *pass = old[i];
+        while (pass) {
+            struct pass *next = pass->hnext;
+            struct pass **head = pass_bucket(dp, pass->signature);
+            pass->hnext = *head;
+            *head = pass;
+            pass = next;
+        }
+    }
+
+    pl_free(old);
+}
+
+static void insert_pass(pl_dispatch dp, struct pass *pass)
+{
+    if (dp->num_passes >= dp->num_buckets)
+        grow_buckets(dp);
+
+    struct pass **head = pass_bucket(dp, pass->signature);
+    pass->hnext = *head;
+    *head = pass;
+    list_append(dp, pass);
+    dp->num_passes++;
+}
+
+static void remove_pass(pl_dispatch dp, struct pass *pass)
+{
+    struct pass **link = pass_bucket(dp, pass->signature);
+    while (*link != pass)
+        link = &(*link)->hnext;
+    *link = pass->hnext;
+    list_remove(dp, pass);
+    dp->num_passes--;
+}
+
+static PL_THREAD_VOID compile_thread(void *arg)
+{
+    pl_dispatch dp = arg;
+    pl_mutex_lock(&dp->lock);
+    while (!dp->exit) {
+        if (!dp->compile_queue.num) {
+            pl_cond_wait(&dp->wakeup, &dp->lock);
+            continue;
+        }
+
+        struct pass *pass = dp->compile_queue.elem[0];
+        PL_ARRAY_REMOVE_AT(dp->compile_queue, 0);
+
+        // Passes are never evicted while `compiling` is set, so it's safe to
+        // release the lock here
+        pl_mutex_unlock(&dp->lock);
+        pl_pass res = pl_pass_create(dp->gpu, pass->compile_params);
+        pl_mutex_lock(&dp->lock);
+
+        if (!res)
+            PL_ERR(dp, "Failed creating render pass for dispatch");
+        pass->pass = pass->run_params.pass = res;
+        pass->compiling = false;
+        pl_free(pass->compile_params);
+        pass->compile_params = NULL;
+        dp->num_pending--;
+        pl_cond_broadcast(&dp->compiled);
+    }
+
+    pl_mutex_unlock(&dp->lock);
+    PL_THREAD_RETURN();
+}
+
+// Handles passes which are still being compiled in the background. With
+// `async` enabled, this and all further dispatches are discarded (see
+// `pl_dispatch_mark_async`), otherwise this blocks until the pass is ready.
+// Must be called with the lock held.
+static bool discard_pass(pl_dispatch dp, struct pass *pass)
+{
+    if (!dp->async) {
+        while (pass->compiling)
+            pl_cond_wait(&dp->compiled, &dp->lock);
+        return false;
+    }
+
+    dp->pending |= pass->compiling;
+    return dp->pending;
+}
+
+static bool start_worker(pl_dispatch dp)
+{
+    if (dp->has_worker)
+        return true;
+
+    if (pl_thread_create(&dp->worker, compile_thread, dp) != 0) {
+        PL_WARN(dp, "Failed creating pass compilation thread, falling back "
+                "to synchronous compilation");
+        dp->async = false;
+        return false;
+    }
+
+    dp->has_worker = true;
+    return true;
+}
+
 pl_dispatch pl_dispatch_create(pl_log log, pl_gpu gpu)
 {
     struct pl_dispatch_t *dp = pl_zalloc_ptr(NULL, dp);
     pl_mutex_init(&dp->lock);
+    pl_cond_init(&dp->wakeup);
+    pl_cond_init(&dp->compiled);
     dp->log = log;
     dp->gpu = gpu;
     dp->max_passes = MAX_PASSES;
+    dp->num_buckets = MIN_PASS_BUCKETS;
+    dp->buckets = pl_calloc_ptr(dp, dp->num_buckets, dp->buckets);
     for (int i = 0; i < PL_ARRAY_SIZE(dp->tmp); i++)
         dp->tmp[i] = pl_str_builder_alloc(dp);
 
@@ -129,11 +314,24 @@ void pl_dispatch_destroy(pl_dispatch *ptr)
     if (!dp)
         return;
 
-    for (int i = 0; i < dp->passes.num; i++)
-        pass_destroy(dp, dp->passes.elem[i]);
+    if (dp->has_worker) {
+        pl_mutex_lock(&dp->lock);
+        dp->exit = true;
+        pl_cond_broadcast(&dp->wakeup);
+        pl_mutex_unlock(&dp->lock);
+        pl_thread_join(dp->worker);
+    }
+
+    while (dp->oldest) {
+        struct pass *pass = dp->oldest;
+        dp->oldest = pass->next;
+        pass_destroy(dp, pass);
+    }
     for (int i = 0; i < dp->shaders.num; i++)
         pl_shader_free(&dp->shaders.elem[i]);
 
+    pl_cond_destroy(&dp->wakeup);
+    pl_cond_destroy(&dp->compiled);
     pl_mutex_destroy(&dp->lock);
     pl_free(dp);
     *ptr = NULL;
@@ -167,6 +365,38 @@ void pl_dispatch_mark_dynamic(pl_dispatch dp, bool dynamic)
     dp->dynamic_constants = dynamic;
 }
 
+void pl_dispatch_mark_async(pl_dispatch dp, bool async)
+{
+    pl_mutex_lock(&dp->lock);
+    dp->async = async && dp->gpu->limits.thread_safe;
+    dp->pending = false;
+    pl_mutex_unlock(&dp->lock);
+}
+
+int pl_dispatch_num_pending(pl_dispatch dp)
+{
+    pl_mutex_lock(&dp->lock);
+    int num = dp->num_pending;
+    pl_mutex_unlock(&dp->lock);
+    return num;
+}
+
+int pl_dispatch_num_passes(pl_dispatch dp)
+{
+    pl_mutex_lock(&dp->lock);
+    int num = dp->num_passes;
+    pl_mutex_unlock(&dp->lock);
+    return num;
+}
+
+bool pl_dispatch_pending(pl_dispatch dp)
+{
+    pl_mutex_lock(&dp->lock);
+    bool pending = dp->pending;
+    pl_mutex_unlock(&dp->lock);
+    return pending;
+}
+
 void pl_dispatch_callback(pl_dispatch dp, void *priv,
                           void (*cb)(void *priv, const struct pl_dispatch_info *))
 {
@@ -284,6 +514,7 @@ static void add_buffer_vars(pl_dispatch dp, void *tmp, pl_str_builder body,
 struct generate_params {
     void *tmp;
     pl_shader sh;
+    pl_str_builder body;
     struct pass *pass;
     struct pl_pass_params *pass_params;
     ident_t out_mat;
@@ -301,7 +532,7 @@ static void generate_shaders(pl_dispatch dp,
     void *tmp = params->tmp;
     struct pass *pass = params->pass;
     struct pl_pass_params *pass_params = params->pass_params;
-    pl_str_builder shader_body = sh_finalize_internal(sh);
+    pl_str_builder shader_body = params->body;
 
     pl_str_builder pre = dp->tmp[TMP_PRELUDE];
     ADD(pre, "#version %d%s\n", gpu->glsl.version,
@@ -323,7 +554,7 @@ static void generate_shaders(pl_dispatch dp,
 
     // Enable all extensions needed for different types of input
     bool has_ssbo = false, has_ubo = false, has_img = false, has_texel = false,
-         has_ext = false, has_nofmt = false, has_gather = false;
+         has_ext = false, has_nofmt = false, has_gather = false, has_array = false;
     for (int i = 0; i < sh->descs.num; i++) {
         switch (sh->descs.elem[i].desc.type) {
         case PL_DESC_BUF_UNIFORM: has_ubo = true; break;
@@ -342,8 +573,10 @@ static void generate_shaders(pl_dispatch dp,
             break;
         }
         case PL_DESC_SAMPLED_TEX: {
-            pl_tex tex = sh->descs.elem[i].binding.object;
+            const struct pl_shader_desc *sd = &sh->descs.elem[i];
+            pl_tex tex = pl_desc_tex(&sd->desc, &sd->binding, 0);
             has_gather |= tex->params.format->gatherable;
+            has_array |= sd->desc.count;
             switch (tex->sampler_type) {
             case PL_SAMPLER_NORMAL: break;
             case PL_SAMPLER_RECT: break;
@@ -378,6 +611,8 @@ static void generate_shaders(pl_dispatch dp,
         ADD(pre, "#extension GL_EXT_shader_image_load_formatted : enable\n");
     if (has_gather)
         ADD(pre, "#extension GL_ARB_texture_gather : enable\n");
+    if (has_array && gpu->glsl.nonuniform_indexing)
+        ADD(pre, "#extension GL_EXT_nonuniform_qualifier : enable\n");
 
     if (gpu->glsl.gles) {
         // Use 32-bit precision for floats if possible
@@ -403,7 +638,8 @@ static void generate_shaders(pl_dispatch dp,
     for (int i = 0; i < sh->descs.num; i++) {
         if (pass_params->descriptors[i].type != PL_DESC_SAMPLED_TEX)
             continue;
-        pl_tex tex = sh->descs.elem[i].binding.object;
+        const struct pl_shader_desc *sd = &sh->descs.elem[i];
+        pl_tex tex = pl_desc_tex(&sd->desc, &sd->binding, 0);
         if (tex->sampler_type != PL_SAMPLER_NORMAL) {
             ADD(pre, "#define textureLod(t, p, b) texture(t, p) \n"
                      "#define textureLodOffset(t, p, b, o)    \\\n"
@@ -469,7 +705,7 @@ static void generate_shaders(pl_dispatch dp,
                 [PL_SAMPLER_EXTERNAL][2] = "samplerExternalOES",
             };
 
-            pl_tex tex = sd->binding.object;
+            pl_tex tex = pl_desc_tex(desc, &sd->binding, 0);
             int dims = pl_tex_params_dimension(tex->params);
             const char *type = types[tex->sampler_type][dims];
             char prefix = sampler_prefixes[tex->params.format->type];
@@ -479,13 +715,16 @@ static void generate_shaders(pl_dispatch dp,
             // Vulkan requires explicit bindings; GL always sets the
             // bindings manually to avoid relying on the user doing so
             if (gpu->glsl.vulkan) {
-                ADD(pre, "layout(binding=%d) uniform %c%s "$";\n",
+                ADD(pre, "layout(binding=%d) uniform %c%s "$"",
                     desc->binding, prefix, type, id);
             } else if (gpu->glsl.gles && prefix != ' ') {
-                ADD(pre, "uniform highp %c%s "$";\n", prefix, type, id);
+                ADD(pre, "uniform highp %c%s "$"", prefix, type, id);
             } else {
-                ADD(pre, "uniform %c%s "$";\n", prefix, type, id);
+                ADD(pre, "uniform %c%s "$"", prefix, type, id);
             }
+            if (desc->count)
+                ADD(pre, "[%d]", desc->count);
+            ADD_CONST(pre, ";\n");
             break;
         }
 
@@ -649,7 +888,6 @@ static void generate_shaders(pl_dispatch dp,
 
         ADD(vert_body, "}");
         ADD_CAT(vert_head, vert_body);
-        pl_hash_merge(&pass->signature, pl_str_builder_hash(vert_head));
         *out_vert_builder = vert_head;
 
         if (has_loc) {
@@ -687,39 +925,148 @@ static void generate_shaders(pl_dispatch dp,
     }
 
     ADD(glsl, "}");
-
-    pl_hash_merge(&pass->signature, pl_str_builder_hash(glsl));
     *out_glsl_builder = glsl;
 }
 
 #undef ADD
 #undef ADD_CAT
 
-#define pass_age(pass) (dp->current_index - (pass)->last_index)
+static inline void hash_var(uint64_t *sig, const struct pl_var *var)
+{
+    pl_hash_merge(sig, (uintptr_t) var->name); // packed ident_t
+    pl_hash_merge(sig, (uint64_t) var->type);
+    pl_hash_merge(sig, (uint64_t) var->dim_v);
+    pl_hash_merge(sig, (uint64_t) var->dim_m);
+    pl_hash_merge(sig, (uint64_t) var->dim_a);
+}
 
-static int cmp_pass_age(const void *ptra, const void *ptrb)
+static inline void hash_layout(uint64_t *sig, struct pl_var_layout layout)
 {
-    const struct pass *a = *(const struct pass **) ptra;
-    const struct pass *b = *(const struct pass **) ptrb;
-    return b->last_index - a->last_index;
+    pl_hash_merge(sig, layout.offset);
+    pl_hash_merge(sig, layout.stride);
+    pl_hash_merge(sig, layout.size);
 }
 
-static void garbage_collect_passes(pl_dispatch dp)
+static inline void hash_fmt(uint64_t *sig, pl_fmt fmt)
 {
-    if (dp->passes.num <= dp->max_passes)
-        return;
+    // Only the properties which affect the generated GLSL
+    pl_hash_merge(sig, (uint64_t) fmt->type);
+    pl_hash_merge(sig, (uint64_t) fmt->gatherable);
+    pl_hash_merge(sig, fmt->glsl_format ? pl_str0_hash(fmt->glsl_format) : 0);
+}
+
+// Computes the pass signature directly from the structure of the shader and
+// the placement decisions made by `finalize_pass`, without generating any
+// GLSL. This must cover everything `generate_shaders` depends on.
+static void hash_pass_structure(const struct generate_params *params)
+{
+    pl_shader sh = params->sh;
+    const struct pass *pass = params->pass;
+    const struct pl_pass_params *pass_params = params->pass_params;
+    uint64_t *sig = &params->pass->signature;
+
+    pl_hash_merge(sig, pl_str_builder_hash(params->body));
+    pl_hash_merge(sig, (uint64_t) pass_params->type);
+    pl_hash_merge(sig, (uint64_t) sh->name);
+    pl_hash_merge(sig, (uint64_t) sh->output);
+    pl_hash_merge(sig, pass_params->push_constants_size);
+
+    for (int i = 0; i < sh->vars.num; i++) {
+        hash_var(sig, &sh->vars.elem[i].var);
+        pl_hash_merge(sig, (uint64_t) pass->vars[i].type);
+        hash_layout(sig, pass->vars[i].layout);
+    }
+
+    for (int i = 0; i < sh->consts.num; i++) {
+        const struct pl_shader_const *sc = &sh->consts.elem[i];
+        pl_hash_merge(sig, (uint64_t) sc->type);
+        pl_hash_merge(sig, (uintptr_t) sc->name);
+        pl_hash_merge(sig, pass_params->constants[i].id);
+    }
+
+    for (int i = 0; i < sh->descs.num; i++) {
+        const struct pl_shader_desc *sd = &sh->descs.elem[i];
+        const struct pl_desc *desc = &pass_params->descriptors[i];
+        pl_hash_merge(sig, (uintptr_t) desc->name);
+        pl_hash_merge(sig, (uint64_t) desc->type);
+        pl_hash_merge(sig, (uint64_t) desc->binding);
+        pl_hash_merge(sig, (uint64_t) desc->access);
+        pl_hash_merge(sig, (uint64_t) desc->count);
+        pl_hash_merge(sig, (uint64_t) sd->memory);
+
+        switch (desc->type) {
+        case PL_DESC_SAMPLED_TEX:
+        case PL_DESC_STORAGE_IMG: {
+            // All elements of an array share these properties
+            pl_tex tex = pl_desc_tex(desc, &sd->binding, 0);
+            pl_hash_merge(sig, (uint64_t) tex->sampler_type);
+            pl_hash_merge(sig, pl_tex_params_dimension(tex->params));
+            hash_fmt(sig, tex->params.format);
+            break;
+        }
+        case PL_DESC_BUF_TEXEL_UNIFORM:
+        case PL_DESC_BUF_TEXEL_STORAGE: {
+            pl_buf buf = sd->binding.object;
+            hash_fmt(sig, buf->params.format);
+            break;
+        }
+        case PL_DESC_BUF_UNIFORM:
+        case PL_DESC_BUF_STORAGE:
+            for (int j = 0; j < sd->num_buffer_vars; j++) {
+                hash_var(sig, &sd->buffer_vars[j].var);
+                hash_layout(sig, sd->buffer_vars[j].layout);
+            }
+            break;
+        case PL_DESC_INVALID:
+        case PL_DESC_TYPE_COUNT:
+            pl_unreachable();
+        }
+    }
 
-    // Garbage collect oldest passes, starting at the middle
-    qsort(dp->passes.elem, dp->passes.num, sizeof(struct pass *), cmp_pass_age);
-    int idx = dp->passes.num / 2;
-    while (idx < dp->passes.num && pass_age(dp->passes.elem[idx]) < MIN_AGE)
-        idx++;
+    switch (pass_params->type) {
+    case PL_PASS_RASTER:
+        pl_hash_merge(sig, (uint64_t) params->vert_idx);
+        pl_hash_merge(sig, (uint64_t) params->out_mat);
+        pl_hash_merge(sig, (uint64_t) params->out_off);
+        for (int i = 0; i < sh->vas.num; i++) {
+            const struct pl_vertex_attrib *va = &pass_params->vertex_attribs[i];
+            pl_hash_merge(sig, (uintptr_t) sh->vas.elem[i].attr.name);
+            pl_hash_merge(sig, (uintptr_t) va->name);
+            pl_hash_merge(sig, pl_str0_hash(va->fmt->name));
+            pl_hash_merge(sig, (uint64_t) va->location);
+            pl_hash_merge(sig, va->offset);
+        }
+        break;
+    case PL_PASS_COMPUTE:
+        pl_hash_merge(sig, (uint64_t) sh->group_size[0]);
+        pl_hash_merge(sig, (uint64_t) sh->group_size[1]);
+        break;
+    case PL_PASS_INVALID:
+    case PL_PASS_TYPE_COUNT:
+        pl_unreachable();
+    }
+}
 
-    for (int i = idx; i < dp->passes.num; i++)
-        pass_destroy(dp, dp->passes.elem[i]);
+#define pass_age(pass) ((uint8_t) (dp->current_index - (pass)->last_index))
 
-    int num_evicted = dp->passes.num - idx;
-    dp->passes.num = idx;
+static void garbage_collect_passes(pl_dispatch dp)
+{
+    if (dp->num_passes <= dp->max_passes)
+        return;
+
+    // Garbage collect the oldest half of the passes, stopping early at the
+    // first pass which is still too young to evict. Since the list is ordered
+    // by last use, this only ever touches the passes that get evicted.
+    const int num_keep = dp->num_passes / 2;
+    int num_evicted = 0;
+    while (dp->num_passes > num_keep && pass_age(dp->oldest) >= MIN_AGE &&
+           !dp->oldest->compiling)
+    {
+        struct pass *pass = dp->oldest;
+        remove_pass(dp, pass);
+        pass_destroy(dp, pass);
+        num_evicted++;
+    }
 
     if (num_evicted) {
         PL_DEBUG(dp, "Evicted %d passes from dispatch cache, consider "
@@ -826,6 +1173,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
 
     // Place all of the compile-time constants
     uint8_t *constant_data = NULL;
+    size_t constant_size = 0;
     if (sh->consts.num) {
         params.num_constants = sh->consts.num;
         params.constants = pl_alloc(tmp, sh->consts.num * sizeof(struct pl_constant));
@@ -843,6 +1191,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
         }
 
         // Write values into the constants buffer
+        constant_size = total_size;
         params.constant_data = constant_data = pl_alloc(pass, total_size);
         for (int i = 0; i < sh->consts.num; i++) {
             const struct pl_shader_const *sc = &sh->consts.elem[i];
@@ -882,28 +1231,32 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     for (int i = 0; i < num_descs; i++) {
         struct pl_desc *desc = &params.descriptors[i];
         *desc = sh->descs.elem[i].desc;
-        desc->binding = binding[pl_desc_namespace(dp->gpu, desc->type)]++;
+        desc->binding = binding[pl_desc_namespace(dp->gpu, desc->type)];
+        binding[pl_desc_namespace(dp->gpu, desc->type)] += pl_desc_elems(desc);
     }
 
     // Finalize the shader and look it up in the pass cache
-    pl_str_builder vert_builder = NULL, glsl_builder = NULL;
-    generate_shaders(dp, &gen_params, &vert_builder, &glsl_builder);
-    for (int i = 0; i < dp->passes.num; i++) {
-        struct pass *p = dp->passes.elem[i];
-        if (p->signature != pass->signature)
-            continue;
-
+    gen_params.body = sh_finalize_internal(sh);
+    hash_pass_structure(&gen_params);
+    struct pass *p = find_pass(dp, pass->signature);
+    if (p) {
         // Found existing shader, re-use directly
         if (p->ubo)
             sh->descs.elem[p->ubo_index].binding.object = p->ubo;
         pl_free(p->run_params.constant_data);
         p->run_params.constant_data = pl_steal(p, constant_data);
         p->last_index = dp->current_index;
+        list_remove(dp, p);
+        list_append(dp, p);
+        dp->cache_hits++;
         pl_free(pass);
         return p;
     }
 
-    // Need to compile new shader, execute templates now
+    // Need to compile new shader, generate and execute templates now
+    dp->cache_misses++;
+    pl_str_builder vert_builder = NULL, glsl_builder = NULL;
+    generate_shaders(dp, &gen_params, &vert_builder, &glsl_builder);
     if (vert_builder) {
         pl_str vert = pl_str_builder_exec(vert_builder);
         params.vertex_shader = (char *) vert.buf;
@@ -923,10 +1276,20 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
         FIX_IDENT(params.vertex_attribs[i].name);
 #undef FIX_IDENT
 
-    pass->pass = pl_pass_create(dp->gpu, &params);
-    if (!pass->pass) {
-        PL_ERR(dp, "Failed creating render pass for dispatch");
-        // Add it anyway
+    if (dp->async && start_worker(dp)) {
+        // Hand off a private copy of the parameters to the compile thread,
+        // since `params` references temporary memory
+        struct pl_pass_params *cparams = pl_alloc_ptr(pass, cparams);
+        *cparams = pl_pass_params_copy(cparams, &params);
+        cparams->constant_data = pl_memdup(cparams, constant_data, constant_size);
+        pass->compile_params = cparams;
+        pass->compiling = true;
+    } else {
+        pass->pass = pl_pass_create(dp->gpu, &params);
+        if (!pass->pass) {
+            PL_ERR(dp, "Failed creating render pass for dispatch");
+            // Add it anyway
+        }
     }
 
     struct pl_pass_run_params *rparams = &pass->run_params;
@@ -936,7 +1299,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     rparams->desc_bindings = pl_calloc_ptr(pass, params.num_descriptors,
                                            rparams->desc_bindings);
 
-    if (ubo_size && pass->pass) {
+    if (ubo_size && (pass->pass || pass->compiling)) {
         // Create the UBO
         pass->ubo = pl_buf_create(dp->gpu, pl_buf_params(
             .size = ubo_size,
@@ -961,7 +1324,15 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
 
     pass->timer = pl_timer_create(dp->gpu);
 
-    PL_ARRAY_APPEND(dp, dp->passes, pass);
+    // Only queue the pass for compilation once nothing can fail anymore, since
+    // the error path frees it
+    if (pass->compiling) {
+        PL_ARRAY_APPEND(dp, dp->compile_queue, pass);
+        pl_cond_signal(&dp->wakeup);
+        dp->num_pending++;
+    }
+
+    insert_pass(dp, pass);
     return pass;
 
 error:
@@ -1176,6 +1547,8 @@ static void run_pass(pl_dispatch dp, pl_shader sh, struct pass *pass)
     info.last = pass->ts_last;
     info.peak = pass->ts_peak;
     info.average = pass->ts_sum / PL_MAX(info.num_samples, 1);
+    info.cache_hits = dp->cache_hits;
+    info.cache_misses = dp->cache_misses;
     dp->info_callback(dp->info_priv, &info);
 }
 
@@ -1282,6 +1655,11 @@ bool pl_dispatch_finish(pl_dispatch dp, const struct pl_dispatch_params *params)
     struct pass *pass = finalize_pass(dp, sh, params->target, vert_idx,
                                       params->blend_params, load, NULL, proj);
 
+    if (pass && discard_pass(dp, pass)) {
+        ret = true;
+        goto error;
+    }
+
     // Silently return on failed passes
     if (!pass || !pass->pass)
         goto error;
@@ -1391,6 +1769,11 @@ bool pl_dispatch_compute(pl_dispatch dp, const struct pl_dispatch_compute_params
 
     struct pass *pass = finalize_pass(dp, sh, NULL, -1, NULL, false, NULL, NULL);
 
+    if (pass && discard_pass(dp, pass)) {
+        ret = true;
+        goto error;
+    }
+
     // Silently return on failed passes
     if (!pass || !pass->pass)
         goto error;
@@ -1528,6 +1911,11 @@ bool pl_dispatch_vertex(pl_dispatch dp, const struct pl_dispatch_vertex_params *
     struct pass *pass = finalize_pass(dp, sh, params->target, pos_idx,
                                       params->blend_params, true, params, &proj);
 
+    if (pass && discard_pass(dp, pass)) {
+        ret = true;
+        goto error;
+    }
+
     // Silently return on failed passes
     if (!pass || !pass->pass)
         goto error;
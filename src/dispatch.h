@@ -29,3 +29,24 @@ pl_shader pl_dispatch_begin_ex(pl_dispatch dp, bool unique);
 //
 // This is a private API because it's sort of clunky/stateful.
 void pl_dispatch_mark_dynamic(pl_dispatch dp, bool dynamic);
+
+// Enables compiling new passes on a background thread. Once a dispatch runs
+// into a pass which is still being compiled, that dispatch and all further
+// dispatches are discarded without being executed, until this is called
+// again. Discarded dispatches still queue their passes for compilation, and
+// are reported as successful, so `pl_dispatch_pending` must be used to tell
+// whether the results are valid. Without `async`, dispatches requiring a pass
+// which is still being compiled block until it's ready instead. Ignored
+// unless `pl_gpu_limits.thread_safe` is set.
+void pl_dispatch_mark_async(pl_dispatch dp, bool async);
+
+// Returns the number of passes currently queued for (or undergoing) background
+// compilation.
+int pl_dispatch_num_pending(pl_dispatch dp);
+
+// Returns the number of distinct passes currently held by the pass cache.
+int pl_dispatch_num_passes(pl_dispatch dp);
+
+// Returns whether any dispatch was discarded since the last call to
+// `pl_dispatch_mark_async`.
+bool pl_dispatch_pending(pl_dispatch dp);
@@ -16,23 +16,40 @@
  */
 
 #include <limits.h>
+#include <math.h>
 #include <string.h>
 
 #include "gpu.h"
 
+#ifdef PL_HAVE_CPU_EXEC
+#include "cpu/cpu.h"
+#endif
+
 #include <libplacebo/dummy.h>
 
 const struct pl_gpu_dummy_params pl_gpu_dummy_default_params = { PL_GPU_DUMMY_DEFAULTS };
 static const struct pl_gpu_fns pl_fns_dummy;
+#ifdef PL_HAVE_CPU_EXEC
+static void dumb_tex_clear_ex(pl_gpu, pl_tex, const union pl_clear_color);
+static void dumb_tex_blit(pl_gpu, const struct pl_tex_blit_params *);
+#endif
 
 struct priv {
     struct pl_gpu_fns impl;
     struct pl_gpu_dummy_params params;
+    const char *compiler;
 };
 
 pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
 {
     params = PL_DEF(params, &pl_gpu_dummy_default_params);
+#ifndef PL_HAVE_CPU_EXEC
+    if (params->execute) {
+        pl_err(log, "Executing shaders on dummy GPUs requires libplacebo to be "
+               "built with -Dcpu-exec=enabled!");
+        return NULL;
+    }
+#endif
 
     struct pl_gpu_t *gpu = pl_zalloc_obj(NULL, gpu, struct priv);
     gpu->log = log;
@@ -48,6 +65,26 @@ pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
     gpu->limits.align_tex_xfer_offset = 1;
     gpu->limits.align_vertex_stride = 1;
 
+    if (params->execute) {
+        // The CPU backend only implements raster passes, with variables and
+        // sampled textures as the only inputs
+        gpu->glsl.compute = false;
+        gpu->glsl.subgroup_size = 0;
+        gpu->limits.max_ubo_size = 0;
+        gpu->limits.max_ssbo_size = 0;
+        gpu->limits.max_buffer_texels = 0;
+        gpu->limits.max_pushc_size = 0;
+        gpu->limits.max_constants = 0;
+
+#ifdef PL_HAVE_CPU_EXEC
+        p->impl.tex_clear_ex = dumb_tex_clear_ex;
+        p->impl.tex_blit = dumb_tex_blit;
+#endif
+
+        p->compiler = pl_strdup0(gpu, pl_str0(PL_DEF(params->compiler, "c++")));
+        p->params.compiler = p->compiler;
+    }
+
     // Set up the dummy formats, add one for each possible format type that we
     // can represent on the host
     PL_ARRAY(pl_fmt) formats = {0};
@@ -99,6 +136,8 @@ pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
 
                 if (gpu->glsl.compute)
                     fmt->caps |= PL_FMT_CAP_STORABLE;
+                if (params->execute)
+                    fmt->caps |= PL_FMT_CAP_BLITTABLE;
                 if (gpu->limits.max_buffer_texels && gpu->limits.max_ubo_size)
                     fmt->caps |= PL_FMT_CAP_TEXEL_UNIFORM;
                 if (gpu->limits.max_buffer_texels && gpu->limits.max_ssbo_size)
@@ -315,6 +354,106 @@ static bool dumb_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *p
     return true;
 }
 
+#ifdef PL_HAVE_CPU_EXEC
+
+static void dumb_tex_clear_ex(pl_gpu gpu, pl_tex tex, const union pl_clear_color color)
+{
+    struct tex_priv *p = PL_PRIV(tex);
+    pl_fmt fmt = tex->params.format;
+
+    float rgba[4];
+    for (int i = 0; i < 4; i++) {
+        switch (fmt->type) {
+        case PL_FMT_UINT: rgba[i] = color.u[i]; break;
+        case PL_FMT_SINT: rgba[i] = color.i[i]; break;
+        default:          rgba[i] = color.f[i]; break;
+        }
+    }
+
+    uint8_t texel[64];
+    pl_assert(fmt->texel_size <= sizeof(texel));
+    pl_cpu_encode(fmt, rgba, texel, 1);
+
+    uint8_t *data = p->data;
+    size_t num = tex_size(gpu, tex) / fmt->texel_size;
+    for (size_t i = 0; i < num; i++, data += fmt->texel_size)
+        memcpy(data, texel, fmt->texel_size);
+}
+
+// Maps `x` from the range [a0, a1] to the range [b0, b1]
+static inline float remap(float x, int a0, int a1, int b0, int b1)
+{
+    return b0 + (x - a0) * (b1 - b0) / (a1 - a0);
+}
+
+static void dumb_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
+{
+    pl_tex src = params->src, dst = params->dst;
+    pl_fmt src_fmt = src->params.format, dst_fmt = dst->params.format;
+    const uint8_t *src_data = pl_tex_dummy_data(src);
+    uint8_t *dst_data = pl_tex_dummy_data(dst);
+    const int sw = src->params.w, sh = PL_DEF(src->params.h, 1);
+    const int dw = dst->params.w, dh = PL_DEF(dst->params.h, 1);
+    const bool linear = params->sample_mode == PL_TEX_SAMPLE_LINEAR;
+
+    pl_rect3d src_rc = params->src_rc, dst_rc = params->dst_rc;
+    if (!src->params.h) {
+        src_rc.y0 = dst_rc.y0 = 0;
+        src_rc.y1 = dst_rc.y1 = 1;
+    }
+    if (!src->params.d) {
+        src_rc.z0 = dst_rc.z0 = 0;
+        src_rc.z1 = dst_rc.z1 = 1;
+    }
+
+    pl_rect3d rc = dst_rc;
+    pl_rect3d_normalize(&rc);
+
+    #define TEXEL(data, fmt, w, h, x, y, z) \
+        ((data) + ((((size_t) (z) * (h) + (y)) * (w) + (x)) * (fmt)->texel_size))
+
+    for (int z = rc.z0; z < rc.z1; z++) {
+        const int sz = PL_CLAMP((int) floorf(remap(z + 0.5f, dst_rc.z0, dst_rc.z1,
+                                                   src_rc.z0, src_rc.z1)),
+                                0, PL_DEF(src->params.d, 1) - 1);
+        for (int y = rc.y0; y < rc.y1; y++) {
+            const float v = remap(y + 0.5f, dst_rc.y0, dst_rc.y1, src_rc.y0, src_rc.y1);
+            for (int x = rc.x0; x < rc.x1; x++) {
+                const float u = remap(x + 0.5f, dst_rc.x0, dst_rc.x1, src_rc.x0, src_rc.x1);
+                float color[4];
+                if (linear) {
+                    // Bilinear filtering, clamped to the edges of the texture
+                    const float fu = u - 0.5f, fv = v - 0.5f;
+                    const int x0 = floorf(fu), y0 = floorf(fv);
+                    const float wx = fu - x0, wy = fv - y0;
+                    float texels[4][4];
+                    for (int i = 0; i < 4; i++) {
+                        const int tx = PL_CLAMP(x0 + (i & 1), 0, sw - 1);
+                        const int ty = PL_CLAMP(y0 + (i >> 1), 0, sh - 1);
+                        pl_cpu_decode_float(src_fmt, TEXEL(src_data, src_fmt, sw, sh, tx, ty, sz),
+                                            texels[i], 1);
+                    }
+                    for (int c = 0; c < 4; c++) {
+                        color[c] = PL_MIX(PL_MIX(texels[0][c], texels[1][c], wx),
+                                          PL_MIX(texels[2][c], texels[3][c], wx), wy);
+                    }
+                } else {
+                    const int tx = PL_CLAMP((int) floorf(u), 0, sw - 1);
+                    const int ty = PL_CLAMP((int) floorf(v), 0, sh - 1);
+                    pl_cpu_decode_float(src_fmt, TEXEL(src_data, src_fmt, sw, sh, tx, ty, sz),
+                                        color, 1);
+                }
+
+                pl_cpu_encode(dst_fmt, color, TEXEL(dst_data, dst_fmt, dw, dh, x, y, z), 1);
+            }
+        }
+    }
+
+    #undef TEXEL
+}
+
+#endif // PL_HAVE_CPU_EXEC
+
 static int dumb_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
 {
     return 0; // safest behavior: never alias bindings
@@ -322,10 +461,34 @@ static int dumb_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
 
 static pl_pass dumb_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
 {
+#ifdef PL_HAVE_CPU_EXEC
+    struct priv *p = PL_PRIV(gpu);
+    if (p->params.execute)
+        return pl_cpu_pass_create(gpu, params, p->compiler);
+#endif
+
     PL_ERR(gpu, "Creating render passes is not supported for dummy GPUs");
     return NULL;
 }
 
+static void dumb_pass_destroy(pl_gpu gpu, pl_pass pass)
+{
+#ifdef PL_HAVE_CPU_EXEC
+    pl_cpu_pass_destroy(gpu, pass);
+#else
+    pl_unreachable();
+#endif
+}
+
+static void dumb_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
+{
+#ifdef PL_HAVE_CPU_EXEC
+    pl_cpu_pass_run(gpu, params);
+#else
+    pl_unreachable();
+#endif
+}
+
 static void dumb_gpu_finish(pl_gpu gpu)
 {
     // no-op
@@ -344,5 +507,7 @@ static const struct pl_gpu_fns pl_fns_dummy = {
     .tex_download = dumb_tex_download,
     .desc_namespace = dumb_desc_namespace,
     .pass_create = dumb_pass_create,
+    .pass_destroy = dumb_pass_destroy,
+    .pass_run = dumb_pass_run,
     .gpu_finish = dumb_gpu_finish,
 };
@@ -39,6 +39,8 @@
 #include "common.h"
 #include "filters.h"
 #include "log.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
 
 #ifdef PL_HAVE_WIN32
 #define j1 _j1
@@ -172,6 +174,31 @@ static void compute_row(struct pl_filter_t *f, double offset, float *out)
         out[i] /= wsum;
 }
 
+struct generate_args {
+    struct pl_filter_t *f;
+    float *weights;
+};
+
+static void generate_polar(void *priv, int start, int end)
+{
+    const struct generate_args *args = priv;
+    const struct pl_filter_t *f = args->f;
+    for (int i = start; i < end; i++) {
+        double x = f->radius * i / (f->params.lut_entries - 1);
+        args->weights[i] = pl_filter_sample(&f->params.config, x);
+    }
+}
+
+static void generate_rows(void *priv, int start, int end)
+{
+    const struct generate_args *args = priv;
+    struct pl_filter_t *f = args->f;
+    for (int i = start; i < end; i++) {
+        compute_row(f, i / (double)(f->params.lut_entries - 1),
+                    args->weights + f->row_stride * i);
+    }
+}
+
 // Needed for backwards compatibility with v1 configuration API
 static struct pl_filter_function *dupfilter(void *alloc,
                                             const struct pl_filter_function *f)
@@ -179,6 +206,102 @@ static struct pl_filter_function *dupfilter(void *alloc,
     return f ? pl_memdup(alloc, (void *)f, sizeof(*f)) : NULL;
 }
 
+// Process-wide cache of recently generated filters. The same configurations
+// tend to recur (e.g. when switching back and forth between scaling ratios,
+// or across multiple renderers), and large LUTs are expensive to compute.
+#define FILTER_CACHE_SIZE 16
+
+static pl_static_mutex filter_cache_lock = PL_STATIC_MUTEX_INITIALIZER;
+static pl_filter filter_cache[FILTER_CACHE_SIZE]; // most recently used first
+
+static bool function_eq(const struct pl_filter_function *a, const float a_params[],
+                        const struct pl_filter_function *b, const float b_params[])
+{
+    if (!a || !b)
+        return a == b;
+    if (a->weight != b->weight || a->radius != b->radius || a->resizable != b->resizable)
+        return false;
+
+    // Compare the effective parameters, as used by `pl_filter_sample`
+    for (int i = 0; i < PL_FILTER_MAX_PARAMS; i++) {
+        float pa = a->tunable[i] ? a_params[i] : a->params[i];
+        float pb = b->tunable[i] ? b_params[i] : b->params[i];
+        if (pa != pb)
+            return false;
+    }
+
+    return true;
+}
+
+// Whether two sets of params produce identical filters
+static bool filter_params_eq(const struct pl_filter_params *a,
+                             const struct pl_filter_params *b)
+{
+    const struct pl_filter_config *ca = &a->config, *cb = &b->config;
+    return function_eq(ca->kernel, ca->params, cb->kernel, cb->params) &&
+           function_eq(ca->window, ca->wparams, cb->window, cb->wparams) &&
+           ca->radius           == cb->radius &&
+           ca->clamp            == cb->clamp &&
+           ca->blur             == cb->blur &&
+           ca->taper            == cb->taper &&
+           ca->polar            == cb->polar &&
+           a->lut_entries       == b->lut_entries &&
+           a->cutoff            == b->cutoff &&
+           a->max_row_size      == b->max_row_size &&
+           a->row_stride_align  == b->row_stride_align;
+}
+
+static size_t filter_weights_size(pl_filter f)
+{
+    const int stride = f->params.config.polar ? 1 : f->row_stride;
+    return f->params.lut_entries * stride * sizeof(float);
+}
+
+// Copies a matching filter out of the cache into `f`, if possible
+static bool filter_cache_get(struct pl_filter_t *f)
+{
+    bool found = false;
+    pl_static_mutex_lock(&filter_cache_lock);
+    for (int i = 0; i < FILTER_CACHE_SIZE && filter_cache[i]; i++) {
+        pl_filter cached = filter_cache[i];
+        if (!filter_params_eq(&cached->params, &f->params))
+            continue;
+
+        f->radius = cached->radius;
+        f->radius_zero = cached->radius_zero;
+        f->radius_cutoff = f->radius; // backwards compatibility
+        f->row_size = cached->row_size;
+        f->row_stride = cached->row_stride;
+        f->insufficient = cached->insufficient;
+        f->weights = pl_memdup(f, cached->weights, filter_weights_size(cached));
+
+        // Move to the front
+        memmove(&filter_cache[1], &filter_cache[0], i * sizeof(pl_filter));
+        filter_cache[0] = cached;
+        found = true;
+        break;
+    }
+    pl_static_mutex_unlock(&filter_cache_lock);
+    return found;
+}
+
+static void filter_cache_put(pl_filter f)
+{
+    struct pl_filter_t *copy = pl_memdup(NULL, f, sizeof(*f));
+    copy->params.config.kernel = dupfilter(copy, f->params.config.kernel);
+    copy->params.config.window = dupfilter(copy, f->params.config.window);
+    copy->weights = pl_memdup(copy, f->weights, filter_weights_size(f));
+
+    pl_static_mutex_lock(&filter_cache_lock);
+    pl_filter evict = filter_cache[FILTER_CACHE_SIZE - 1];
+    memmove(&filter_cache[1], &filter_cache[0],
+            (FILTER_CACHE_SIZE - 1) * sizeof(pl_filter));
+    filter_cache[0] = copy;
+    pl_static_mutex_unlock(&filter_cache_lock);
+
+    pl_free((void *) evict);
+}
+
 pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
 {
     pl_assert(params);
@@ -203,6 +326,8 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
     f->params = *params;
     f->params.config.kernel = dupfilter(f, params->config.kernel);
     f->params.config.window = dupfilter(f, params->config.window);
+    if (filter_cache_get(f))
+        return f;
 
     // Compute main lobe and total filter size
     filter_cutoffs(&params->config, params->cutoff, &f->radius, &f->radius_zero);
@@ -212,10 +337,8 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
     if (params->config.polar) {
         // Compute a 1D array indexed by radius
         weights = pl_alloc(f, params->lut_entries * sizeof(float));
-        for (int i = 0; i < params->lut_entries; i++) {
-            double x = f->radius * i / (params->lut_entries - 1);
-            weights[i] = pl_filter_sample(&params->config, x);
-        }
+        pl_parallel_for(NULL, params->lut_entries, 64, generate_polar,
+                        &(struct generate_args) { f, weights });
     } else {
         // Pick the most appropriate row size
         f->row_size = ceilf(f->radius) * 2;
@@ -230,13 +353,12 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
 
         // Compute a 2D array indexed by the subpixel position
         weights = pl_calloc(f, params->lut_entries * f->row_stride, sizeof(float));
-        for (int i = 0; i < params->lut_entries; i++) {
-            compute_row(f, i / (double)(params->lut_entries - 1),
-                        weights + f->row_stride * i);
-        }
+        pl_parallel_for(NULL, params->lut_entries, 16, generate_rows,
+                        &(struct generate_args) { f, weights });
     }
 
     f->weights = weights;
+    filter_cache_put(f);
     return f;
 }
 
@@ -18,9 +18,9 @@
 #include <math.h>
 
 #include "common.h"
+#include "gamut_mapping.h"
 #include "pl_thread.h"
-
-#include <libplacebo/gamut_mapping.h>
+#include "pl_thread_pool.h"
 
 #define fclampf(x, lo, hi) fminf(fmaxf(x, lo), hi)
 static void fix_constants(struct pl_gamut_map_constants *c)
@@ -374,34 +374,188 @@ static inline bool ingamut(struct IPT c, struct gamut gamut)
            rgb.B >= gamut.min_rgb && rgb.B <= gamut.max_rgb;
 }
 
+static inline struct pl_gamut_bounds gamut_bounds(struct gamut gamut)
+{
+    return (struct pl_gamut_bounds) {
+        .lms2rgb  = gamut.lms2rgb,
+        .min_luma = gamut.min_luma,
+        .max_luma = gamut.max_luma,
+        .min_rgb  = gamut.min_rgb,
+        .max_rgb  = gamut.max_rgb,
+    };
+}
+
+// Scalar reference kernels, wrapping the functions above
+
+static bool scalar_supported(void)
+{
+    return true;
+}
+
+static void scalar_ipt2rgb(float *I, float *P, float *T, int num,
+                           const pl_matrix3x3 *lms2rgb)
+{
+    const struct gamut gamut = { .lms2rgb = *lms2rgb };
+    for (int i = 0; i < num; i++) {
+        struct RGB rgb = ipt2rgb((struct IPT) { I[i], P[i], T[i] }, gamut);
+        I[i] = rgb.R;
+        P[i] = rgb.G;
+        T[i] = rgb.B;
+    }
+}
+
+static void scalar_rgb2ipt(float *R, float *G, float *B, int num,
+                           const pl_matrix3x3 *rgb2lms)
+{
+    const struct gamut gamut = { .rgb2lms = *rgb2lms };
+    for (int i = 0; i < num; i++) {
+        struct IPT ipt = rgb2ipt((struct RGB) { R[i], G[i], B[i] }, gamut);
+        R[i] = ipt.I;
+        G[i] = ipt.P;
+        B[i] = ipt.T;
+    }
+}
+
+static void scalar_pq_eotf(float *x, int num)
+{
+    for (int i = 0; i < num; i++)
+        x[i] = pq_eotf(x[i]);
+}
+
+static void scalar_pq_oetf(float *x, int num)
+{
+    for (int i = 0; i < num; i++)
+        x[i] = pq_oetf(x[i]);
+}
+
+static void scalar_ingamut(uint8_t *out, const float *I, const float *P,
+                           const float *T, int num,
+                           const struct pl_gamut_bounds *bounds)
+{
+    const struct gamut gamut = {
+        .lms2rgb  = bounds->lms2rgb,
+        .min_luma = bounds->min_luma,
+        .max_luma = bounds->max_luma,
+        .min_rgb  = bounds->min_rgb,
+        .max_rgb  = bounds->max_rgb,
+    };
+
+    for (int i = 0; i < num; i++)
+        out[i] = ingamut((struct IPT) { I[i], P[i], T[i] }, gamut);
+}
+
+static const struct pl_gamut_kernels kernels_scalar = {
+    .name       = "scalar",
+    .supported  = scalar_supported,
+    .ipt2rgb    = scalar_ipt2rgb,
+    .rgb2ipt    = scalar_rgb2ipt,
+    .pq_eotf    = scalar_pq_eotf,
+    .pq_oetf    = scalar_pq_oetf,
+    .ingamut    = scalar_ingamut,
+};
+
+#ifdef __GNUC__
+
+// Vectorized kernels, written using generic vector extensions. These compile
+// down to SSE2 or NEON instructions on the respective baseline targets, and
+// are additionally instantiated for AVX2 on x86 (selected at runtime).
+#if defined(__x86_64__) || defined(__i386__)
+
+# define KERNEL_NAME        sse2
+# define KERNEL_VLEN        4
+# define KERNEL_TARGET
+# define KERNEL_SUPPORTED   scalar_supported
+# include "gamut_mapping_tmpl.h"
+
+static bool avx2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+# define KERNEL_NAME        avx2
+# define KERNEL_VLEN        8
+# define KERNEL_TARGET      __attribute__((target("avx2,fma")))
+# define KERNEL_SUPPORTED   avx2_supported
+# include "gamut_mapping_tmpl.h"
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+# define KERNEL_NAME        neon
+# define KERNEL_VLEN        4
+# define KERNEL_TARGET
+# define KERNEL_SUPPORTED   scalar_supported
+# include "gamut_mapping_tmpl.h"
+
+#else
+
+# define KERNEL_NAME        vector
+# define KERNEL_VLEN        4
+# define KERNEL_TARGET
+# define KERNEL_SUPPORTED   scalar_supported
+# include "gamut_mapping_tmpl.h"
+
+#endif
+#endif // __GNUC__
+
+const struct pl_gamut_kernels * const pl_gamut_kernels[] = {
+    &kernels_scalar,
+#ifdef __GNUC__
+# if defined(__x86_64__) || defined(__i386__)
+    &kernels_sse2,
+    &kernels_avx2,
+# elif defined(__aarch64__) || defined(__ARM_NEON)
+    &kernels_neon,
+# else
+    &kernels_vector,
+# endif
+#endif
+    NULL
+};
+
+const struct pl_gamut_kernels *pl_gamut_kernels_get(void)
+{
+    static pl_static_mutex lock = PL_STATIC_MUTEX_INITIALIZER;
+    static const struct pl_gamut_kernels *best;
+
+    pl_static_mutex_lock(&lock);
+    if (!best) {
+        for (int i = 0; pl_gamut_kernels[i]; i++) {
+            if (pl_gamut_kernels[i]->supported())
+                best = pl_gamut_kernels[i];
+        }
+    }
+    const struct pl_gamut_kernels *kernels = best;
+    pl_static_mutex_unlock(&lock);
+    return kernels;
+}
+
 struct generate_args {
     const struct pl_gamut_map_params *params;
     float *out;
-    int start;
-    int count;
 };
 
-static PL_THREAD_VOID generate(void *priv)
+static void generate(void *priv, int start, int end)
 {
     const struct generate_args *args = priv;
     const struct pl_gamut_map_params *params = args->params;
-
-    float *in = args->out;
-    const int end = args->start + args->count;
-    for (int h = args->start; h < end; h++) {
+    const size_t slice_size = params->lut_size_C * params->lut_size_I *
+                              params->lut_stride;
+
+    float *out = args->out + start * slice_size;
+    float *in = out;
+    for (int h = start; h < end; h++) {
+        const float hx = (float) h / (params->lut_size_h - 1);
+        const float hue = PL_MIX(-M_PI, M_PI, hx);
+        const float cos_h = cosf(hue), sin_h = sinf(hue);
         for (int C = 0; C < params->lut_size_C; C++) {
+            const float Cx = (float) C / (params->lut_size_C - 1);
+            const float chroma = PL_MIX(0.0f, 0.5f, Cx);
             for (int I = 0; I < params->lut_size_I; I++) {
                 float Ix = (float) I / (params->lut_size_I - 1);
-                float Cx = (float) C / (params->lut_size_C - 1);
-                float hx = (float) h / (params->lut_size_h - 1);
-                struct IPT ipt = ich2ipt((struct ICh) {
-                    .I = PL_MIX(params->min_luma, params->max_luma, Ix),
-                    .C = PL_MIX(0.0f, 0.5f, Cx),
-                    .h = PL_MIX(-M_PI, M_PI, hx),
-                });
-                in[0] = ipt.I;
-                in[1] = ipt.P;
-                in[2] = ipt.T;
+                in[0] = PL_MIX(params->min_luma, params->max_luma, Ix);
+                in[1] = chroma * cos_h;
+                in[2] = chroma * sin_h;
                 in += params->lut_stride;
             }
         }
@@ -409,42 +563,14 @@ static PL_THREAD_VOID generate(void *priv)
 
     struct pl_gamut_map_params fixed = *params;
     fix_constants(&fixed.constants);
-    fixed.lut_size_h = args->count;
-    FUN(params).map(args->out, &fixed);
-    PL_THREAD_RETURN();
+    fixed.lut_size_h = end - start;
+    FUN(params).map(out, &fixed);
 }
 
 void pl_gamut_map_generate(float *out, const struct pl_gamut_map_params *params)
 {
-    enum { MAX_WORKERS = 32 };
-    struct generate_args args[MAX_WORKERS];
-
-    const int num_per_worker = PL_DIV_UP(params->lut_size_h, MAX_WORKERS);
-    const int num_workers = PL_DIV_UP(params->lut_size_h, num_per_worker);
-    for (int i = 0; i < num_workers; i++) {
-        const int start = i * num_per_worker;
-        const int count = PL_MIN(num_per_worker, params->lut_size_h - start);
-        args[i] = (struct generate_args) {
-            .params = params,
-            .out    = out,
-            .start  = start,
-            .count  = count,
-        };
-        out += count * params->lut_size_C * params->lut_size_I * params->lut_stride;
-    }
-
-    pl_thread workers[MAX_WORKERS] = {0};
-    for (int i = 0; i < num_workers; i++) {
-        if (pl_thread_create(&workers[i], generate, &args[i]) != 0)
-            generate(&args[i]); // fallback
-    }
-
-    for (int i = 0; i < num_workers; i++) {
-        if (!workers[i])
-            continue;
-        if (pl_thread_join(workers[i]) != 0)
-            generate(&args[i]); // fallback
-    }
+    struct generate_args args = { params, out };
+    pl_parallel_for(NULL, params->lut_size_h, 1, generate, &args);
 }
 
 void pl_gamut_map_sample(float x[3], const struct pl_gamut_map_params *params)
@@ -465,6 +591,48 @@ void pl_gamut_map_sample(float x[3], const struct pl_gamut_map_params *params)
          _i < _end && ( C = *_i, 1 );                                           \
          *_i = C, _i = (struct IPT *) ((float *) _i + params->lut_stride))
 
+// Batched processing of the LUT, in blocks of up to BLOCK_SIZE colors stored
+// in structure-of-arrays form, for use with `struct pl_gamut_kernels`
+#define BLOCK_SIZE 64
+
+struct block {
+    float I[BLOCK_SIZE], P[BLOCK_SIZE], T[BLOCK_SIZE];
+    uint8_t ok[BLOCK_SIZE];
+    float *pos, *end;
+    int stride;
+    int num;
+};
+
+static inline bool block_load(struct block *b)
+{
+    b->num = 0;
+    for (const float *in = b->pos; in < b->end && b->num < BLOCK_SIZE; in += b->stride) {
+        b->I[b->num] = in[0];
+        b->P[b->num] = in[1];
+        b->T[b->num] = in[2];
+        b->num++;
+    }
+    return b->num > 0;
+}
+
+static inline void block_store(struct block *b)
+{
+    for (int i = 0; i < b->num; i++, b->pos += b->stride) {
+        b->pos[0] = b->I[i];
+        b->pos[1] = b->P[i];
+        b->pos[2] = b->T[i];
+    }
+}
+
+#define FOREACH_BLOCK(lut, b)                                                   \
+    for (struct block b = {                                                     \
+            .pos = lut,                                                         \
+            .end = lut + LUT_SIZE(params),                                      \
+            .stride = params->lut_stride,                                       \
+         };                                                                     \
+         block_load(&b);                                                        \
+         block_store(&b))
+
 // Something like PL_MIX(base, c, x) but follows an exponential curve, note
 // that this can be used to extend 'c' outwards for x > 1
 static inline struct ICh mix_exp(struct ICh c, float x, float gamma, float base)
@@ -579,6 +747,24 @@ clip_gamma(struct IPT ipt, float gamma, struct gamut gamut)
     return ich2ipt(mix_exp(ich, x, gamma, peak.I));
 }
 
+// Batched version of `clip_gamma`, only falling back to the (slow) scalar
+// path for colors which are not already inside the gamut
+static void block_clip_gamma(struct block *b, float gamma, struct gamut gamut,
+                             const struct pl_gamut_kernels *k)
+{
+    const struct pl_gamut_bounds bounds = gamut_bounds(gamut);
+    k->ingamut(b->ok, b->I, b->P, b->T, b->num, &bounds);
+    for (int i = 0; i < b->num; i++) {
+        if (b->ok[i] && b->I[i] > gamut.min_luma)
+            continue;
+        struct IPT ipt = { b->I[i], b->P[i], b->T[i] };
+        ipt = clip_gamma(ipt, gamma, gamut);
+        b->I[i] = ipt.I;
+        b->P[i] = ipt.P;
+        b->T[i] = ipt.T;
+    }
+}
+
 static float softclip(float value, float source, float target,
                       const struct pl_gamut_map_constants *c)
 {
@@ -716,30 +902,41 @@ done:
 static void perceptual(float *lut, const struct pl_gamut_map_params *params)
 {
     const struct pl_gamut_map_constants *c = &params->constants;
+    const struct pl_gamut_kernels *kern = pl_gamut_kernels_get();
     struct cache cache;
     struct gamut dst, src;
     get_gamuts(&dst, &src, &cache, params);
 
-    FOREACH_LUT(lut, ipt) {
-        struct ICh ich = ipt2ich(ipt);
-        struct ICh src_peak = saturate(ich.h, src);
-        struct ICh dst_peak = saturate(ich.h, dst);
-        struct IPT mapped = rgb2ipt(ipt2rgb(ipt, src), dst);
-
-        // Protect in gamut region
-        const float maxC = fmaxf(src_peak.C, dst_peak.C);
-        float k = pl_smoothstep(c->perceptual_deadzone, 1.0f, ich.C / maxC);
-        k *= c->perceptual_strength;
-        ipt.I = PL_MIX(ipt.I, mapped.I, k);
-        ipt.P = PL_MIX(ipt.P, mapped.P, k);
-        ipt.T = PL_MIX(ipt.T, mapped.T, k);
-
-        struct RGB rgb = ipt2rgb(ipt, dst);
-        const float maxRGB = fmaxf(rgb.R, fmaxf(rgb.G, rgb.B));
-        rgb.R = fmaxf(softclip(rgb.R, maxRGB, dst.max_rgb, c), dst.min_rgb);
-        rgb.G = fmaxf(softclip(rgb.G, maxRGB, dst.max_rgb, c), dst.min_rgb);
-        rgb.B = fmaxf(softclip(rgb.B, maxRGB, dst.max_rgb, c), dst.min_rgb);
-        ipt = rgb2ipt(rgb, dst);
+    FOREACH_BLOCK(lut, b) {
+        struct block mapped;
+        memcpy(mapped.I, b.I, b.num * sizeof(float));
+        memcpy(mapped.P, b.P, b.num * sizeof(float));
+        memcpy(mapped.T, b.T, b.num * sizeof(float));
+        kern->ipt2rgb(mapped.I, mapped.P, mapped.T, b.num, &src.lms2rgb);
+        kern->rgb2ipt(mapped.I, mapped.P, mapped.T, b.num, &dst.rgb2lms);
+
+        for (int i = 0; i < b.num; i++) {
+            struct ICh ich = ipt2ich((struct IPT) { b.I[i], b.P[i], b.T[i] });
+            struct ICh src_peak = saturate(ich.h, src);
+            struct ICh dst_peak = saturate(ich.h, dst);
+
+            // Protect in gamut region
+            const float maxC = fmaxf(src_peak.C, dst_peak.C);
+            float k = pl_smoothstep(c->perceptual_deadzone, 1.0f, ich.C / maxC);
+            k *= c->perceptual_strength;
+            b.I[i] = PL_MIX(b.I[i], mapped.I[i], k);
+            b.P[i] = PL_MIX(b.P[i], mapped.P[i], k);
+            b.T[i] = PL_MIX(b.T[i], mapped.T[i], k);
+        }
+
+        kern->ipt2rgb(b.I, b.P, b.T, b.num, &dst.lms2rgb);
+        for (int i = 0; i < b.num; i++) {
+            const float maxRGB = fmaxf(b.I[i], fmaxf(b.P[i], b.T[i]));
+            b.I[i] = fmaxf(softclip(b.I[i], maxRGB, dst.max_rgb, c), dst.min_rgb);
+            b.P[i] = fmaxf(softclip(b.P[i], maxRGB, dst.max_rgb, c), dst.min_rgb);
+            b.T[i] = fmaxf(softclip(b.T[i], maxRGB, dst.max_rgb, c), dst.min_rgb);
+        }
+        kern->rgb2ipt(b.I, b.P, b.T, b.num, &dst.rgb2lms);
     }
 }
 
@@ -825,8 +1022,8 @@ static void relative(float *lut, const struct pl_gamut_map_params *params)
     struct gamut dst;
     get_gamuts(&dst, NULL, &cache, params);
 
-    FOREACH_LUT(lut, ipt)
-        ipt = clip_gamma(ipt, c->colorimetric_gamma, dst);
+    FOREACH_BLOCK(lut, b)
+        block_clip_gamma(&b, c->colorimetric_gamma, dst, pl_gamut_kernels_get());
 }
 
 const struct pl_gamut_map_function pl_gamut_map_relative = {
@@ -841,8 +1038,8 @@ static void desaturate(float *lut, const struct pl_gamut_map_params *params)
     struct gamut dst;
     get_gamuts(&dst, NULL, &cache, params);
 
-    FOREACH_LUT(lut, ipt)
-        ipt = clip_gamma(ipt, 0.0f, dst);
+    FOREACH_BLOCK(lut, b)
+        block_clip_gamma(&b, 0.0f, dst, pl_gamut_kernels_get());
 }
 
 const struct pl_gamut_map_function pl_gamut_map_desaturate = {
@@ -856,9 +1053,12 @@ static void saturation(float *lut, const struct pl_gamut_map_params *params)
     struct cache cache;
     struct gamut dst, src;
     get_gamuts(&dst, &src, &cache, params);
+    const struct pl_gamut_kernels *k = pl_gamut_kernels_get();
 
-    FOREACH_LUT(lut, ipt)
-        ipt = rgb2ipt(ipt2rgb(ipt, src), dst);
+    FOREACH_BLOCK(lut, b) {
+        k->ipt2rgb(b.I, b.P, b.T, b.num, &src.lms2rgb);
+        k->rgb2ipt(b.I, b.P, b.T, b.num, &dst.rgb2lms);
+    }
 }
 
 const struct pl_gamut_map_function pl_gamut_map_saturation = {
@@ -876,12 +1076,19 @@ static void absolute(float *lut, const struct pl_gamut_map_params *params)
     get_gamuts(&dst, NULL, &cache, params);
     pl_matrix3x3 m = pl_get_adaptation_matrix(params->output_gamut.white,
                                               params->input_gamut.white);
-
-    FOREACH_LUT(lut, ipt) {
-        struct RGB rgb = ipt2rgb(ipt, dst);
-        pl_matrix3x3_apply(&m, (float *) &rgb);
-        ipt = rgb2ipt(rgb, dst);
-        ipt = clip_gamma(ipt, c->colorimetric_gamma, dst);
+    const struct pl_gamut_kernels *k = pl_gamut_kernels_get();
+
+    FOREACH_BLOCK(lut, b) {
+        k->ipt2rgb(b.I, b.P, b.T, b.num, &dst.lms2rgb);
+        for (int i = 0; i < b.num; i++) {
+            float rgb[3] = { b.I[i], b.P[i], b.T[i] };
+            pl_matrix3x3_apply(&m, rgb);
+            b.I[i] = rgb[0];
+            b.P[i] = rgb[1];
+            b.T[i] = rgb[2];
+        }
+        k->rgb2ipt(b.I, b.P, b.T, b.num, &dst.rgb2lms);
+        block_clip_gamma(&b, c->colorimetric_gamma, dst, k);
     }
 }
 
@@ -896,12 +1103,17 @@ static void highlight(float *lut, const struct pl_gamut_map_params *params)
     struct cache cache;
     struct gamut dst;
     get_gamuts(&dst, NULL, &cache, params);
-
-    FOREACH_LUT(lut, ipt) {
-        if (!ingamut(ipt, dst)) {
-            ipt.I = fminf(ipt.I + 0.1f, 1.0f);
-            ipt.P = fclampf(-1.2f * ipt.P, -0.5f, 0.5f);
-            ipt.T = fclampf(-1.2f * ipt.T, -0.5f, 0.5f);
+    const struct pl_gamut_bounds bounds = gamut_bounds(dst);
+    const struct pl_gamut_kernels *k = pl_gamut_kernels_get();
+
+    FOREACH_BLOCK(lut, b) {
+        k->ingamut(b.ok, b.I, b.P, b.T, b.num, &bounds);
+        for (int i = 0; i < b.num; i++) {
+            if (!b.ok[i]) {
+                b.I[i] = fminf(b.I[i] + 0.1f, 1.0f);
+                b.P[i] = fclampf(-1.2f * b.P[i], -0.5f, 0.5f);
+                b.T[i] = fclampf(-1.2f * b.T[i], -0.5f, 0.5f);
+            }
         }
     }
 }
@@ -954,13 +1166,16 @@ static void darken(float *lut, const struct pl_gamut_map_params *params)
         gain = fminf(gain, 1.0 / maxRGB);
     }
 
-    FOREACH_LUT(lut, ipt) {
-        struct RGB rgb = ipt2rgb(ipt, dst);
-        rgb.R *= gain;
-        rgb.G *= gain;
-        rgb.B *= gain;
-        ipt = rgb2ipt(rgb, dst);
-        ipt = clip_gamma(ipt, c->colorimetric_gamma, dst);
+    const struct pl_gamut_kernels *k = pl_gamut_kernels_get();
+    FOREACH_BLOCK(lut, b) {
+        k->ipt2rgb(b.I, b.P, b.T, b.num, &dst.lms2rgb);
+        for (int i = 0; i < b.num; i++) {
+            b.I[i] *= gain;
+            b.P[i] *= gain;
+            b.T[i] *= gain;
+        }
+        k->rgb2ipt(b.I, b.P, b.T, b.num, &dst.rgb2lms);
+        block_clip_gamma(&b, c->colorimetric_gamma, dst, k);
     }
 }
 
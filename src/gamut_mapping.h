@@ -0,0 +1,62 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <libplacebo/gamut_mapping.h>
+
+// Describes the bounds of a gamut, in the (PQ-encoded) IPT and linear RGB
+// (normalized to 10k nits) domains.
+struct pl_gamut_bounds {
+    pl_matrix3x3 lms2rgb;
+    float min_luma, max_luma;   // pq
+    float min_rgb,  max_rgb;    // 10k normalized
+};
+
+// Batched versions of the color conversions used by the gamut mapping
+// functions. All kernels operate in-place on `num` colors stored in
+// structure-of-arrays form, i.e. one array per component.
+struct pl_gamut_kernels {
+    const char *name;
+
+    // Returns whether these kernels can be used on the running CPU.
+    bool (*supported)(void);
+
+    // Convert from IPT to linear RGB, and vice versa. The matrices are the
+    // ones returned by `pl_ipt_lms2rgb` and `pl_ipt_rgb2lms`, respectively.
+    void (*ipt2rgb)(float *I, float *P, float *T, int num, const pl_matrix3x3 *lms2rgb);
+    void (*rgb2ipt)(float *R, float *G, float *B, int num, const pl_matrix3x3 *rgb2lms);
+
+    // PQ EOTF and its inverse, in the 10k-normalized linear light domain.
+    void (*pq_eotf)(float *x, int num);
+    void (*pq_oetf)(float *x, int num);
+
+    // Tests whether IPT colors are contained in `gamut`. `out` is set to 1
+    // for colors inside the gamut, and 0 otherwise.
+    void (*ingamut)(uint8_t *out, const float *I, const float *P, const float *T,
+                    int num, const struct pl_gamut_bounds *gamut);
+};
+
+// All kernels compiled into this binary, sorted from slowest to fastest and
+// terminated by NULL. The first entry is the scalar reference implementation,
+// which is always supported.
+extern const struct pl_gamut_kernels * const pl_gamut_kernels[];
+
+// Returns the fastest set of kernels supported by the running CPU.
+const struct pl_gamut_kernels *pl_gamut_kernels_get(void);
@@ -0,0 +1,342 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Template for the vectorized gamut mapping kernels, included multiple times
+// by gamut_mapping.c. The including file must define:
+//
+//   KERNEL_NAME:       identifier for this instance, e.g. `sse2`
+//   KERNEL_VLEN:       number of floats per vector
+//   KERNEL_TARGET:     function attributes selecting the target ISA
+//   KERNEL_SUPPORTED:  function returning whether the target ISA is available
+//
+// Note: `pow` is approximated using `exp2` and `log2` polynomials, which are
+// accurate to within a few ULP, i.e. on par with `powf` in practice.
+
+#define KCAT_(a, b) a##_##b
+#define KCAT(a, b) KCAT_(a, b)
+
+#define VLEN        KERNEL_VLEN
+#define VINLINE     static inline __attribute__((always_inline)) KERNEL_TARGET
+#define vf          KCAT(KERNEL_NAME, vf)
+#define vi          KCAT(KERNEL_NAME, vi)
+#define vload       KCAT(KERNEL_NAME, vload)
+#define vstore      KCAT(KERNEL_NAME, vstore)
+#define vset        KCAT(KERNEL_NAME, vset)
+#define vsel        KCAT(KERNEL_NAME, vsel)
+#define vmin        KCAT(KERNEL_NAME, vmin)
+#define vmax        KCAT(KERNEL_NAME, vmax)
+#define vlog2       KCAT(KERNEL_NAME, vlog2)
+#define vexp2       KCAT(KERNEL_NAME, vexp2)
+#define vpow        KCAT(KERNEL_NAME, vpow)
+#define vpq_eotf    KCAT(KERNEL_NAME, vpq_eotf)
+#define vpq_oetf    KCAT(KERNEL_NAME, vpq_oetf)
+
+#define VMAT(mat, i, x, y, z) \
+    ((mat).m[i][0] * (x) + (mat).m[i][1] * (y) + (mat).m[i][2] * (z))
+
+typedef float   vf __attribute__((vector_size(VLEN * sizeof(float))));
+typedef int32_t vi __attribute__((vector_size(VLEN * sizeof(int32_t))));
+
+VINLINE vf vload(const float *p)
+{
+    vf v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+VINLINE void vstore(float *p, vf v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+VINLINE vf vset(float x)
+{
+    return (vf) {0} + x;
+}
+
+VINLINE vf vsel(vi mask, vf a, vf b)
+{
+    return (vf) (((vi) a & mask) | ((vi) b & ~mask));
+}
+
+VINLINE vf vmin(vf a, vf b)
+{
+    return vsel(a < b, a, b);
+}
+
+VINLINE vf vmax(vf a, vf b)
+{
+    return vsel(a > b, a, b);
+}
+
+// log2(x), for x > 0
+VINLINE vf vlog2(vf x)
+{
+    const vi bits = (vi) x;
+    vi e = ((bits >> 23) & 0xFF) - 127;
+    vf m = (vf) ((bits & 0x007FFFFF) | 0x3F800000); // [1, 2)
+
+    // Renormalize the mantissa to [sqrt(0.5), sqrt(2)) for better accuracy
+    const vi big = m > (float) M_SQRT2;
+    m = vsel(big, m * 0.5f, m);
+    e -= big;
+
+    // ln(m) = 2 atanh(t), with t = (m - 1) / (m + 1), |t| < 0.172
+    const vf t = (m - 1.0f) / (m + 1.0f);
+    const vf t2 = t * t;
+    vf p = vset(1.0f / 9);
+    p = p * t2 + 1.0f / 7;
+    p = p * t2 + 1.0f / 5;
+    p = p * t2 + 1.0f / 3;
+    p = p * t2 + 1.0f;
+    return __builtin_convertvector(e, vf) + (float) (2.0 * M_LOG2E) * t * p;
+}
+
+// 2^x, for finite x
+VINLINE vf vexp2(vf x)
+{
+    x = vmin(vmax(x, vset(-126.0f)), vset(126.0f));
+
+    // Split into integer part n and fractional part f in [-0.5, 0.5]
+    const vf xr = x + 0.5f;
+    vi n = __builtin_convertvector(xr, vi); // rounds towards zero
+    n += __builtin_convertvector(n, vf) > xr; // floor
+    const vf f = x - __builtin_convertvector(n, vf);
+
+    // Taylor series of exp(f * ln(2)), error < 1e-8
+    vf p = vset(1.52527338040598e-05f);
+    p = p * f + 0.000154035303933816f;
+    p = p * f + 0.00133335581464284f;
+    p = p * f + 0.00961812910762848f;
+    p = p * f + 0.0555041086648216f;
+    p = p * f + 0.240226506959101f;
+    p = p * f + 0.693147180559945f;
+    p = p * f + 1.0f;
+    return p * (vf) ((n + 127) << 23);
+}
+
+// x^y, for x >= 0
+VINLINE vf vpow(vf x, float y)
+{
+    return vsel(x > 0.0f, vexp2(vlog2(x) * y), vset(0.0f));
+}
+
+VINLINE vf vpq_eotf(vf x)
+{
+    const vf idxf = vmin(vmax(x, vset(0.0f)), vset(1.0f)) * (PQ_LUT_SIZE - 1);
+    const vi ipart = __builtin_convertvector(idxf, vi);
+    const vf fpart = idxf - __builtin_convertvector(ipart, vf);
+    vf lo = {0}, hi = {0};
+    for (int i = 0; i < VLEN; i++) {
+        lo[i] = pq_eotf_lut[ipart[i]];
+        hi[i] = pq_eotf_lut[ipart[i] + 1];
+    }
+    return PL_MIX(lo, hi, fpart);
+}
+
+VINLINE vf vpq_oetf(vf x)
+{
+    x = vpow(x, PQ_M1);
+    x = (PQ_C1 + PQ_C2 * x) / (1.0f + PQ_C3 * x);
+    return vpow(x, PQ_M2);
+}
+
+// Each kernel processes one vector worth of colors at a time. Partial vectors
+// at the end of the input are padded out and go through the same code path,
+// rather than the scalar reference kernels, so that the result for any given
+// color does not depend on how the input happens to be split into batches.
+#define vload_tail  KCAT(KERNEL_NAME, vload_tail)
+#define vstore_tail KCAT(KERNEL_NAME, vstore_tail)
+
+VINLINE vf vload_tail(const float *p, int num)
+{
+    float buf[VLEN] = {0};
+    memcpy(buf, p, num * sizeof(float));
+    return vload(buf);
+}
+
+VINLINE void vstore_tail(float *p, vf v, int num)
+{
+    float buf[VLEN];
+    vstore(buf, v);
+    memcpy(p, buf, num * sizeof(float));
+}
+
+#define ipt2rgb_vec KCAT(KERNEL_NAME, ipt2rgb_vec)
+VINLINE void ipt2rgb_vec(vf vI, vf vP, vf vT, const pl_matrix3x3 *lms2rgb,
+                         vf *R, vf *G, vf *B)
+{
+    const vf L = vpq_eotf(vI + 0.0975689f * vP + 0.205226f * vT);
+    const vf M = vpq_eotf(vI - 0.1138760f * vP + 0.133217f * vT);
+    const vf S = vpq_eotf(vI + 0.0326151f * vP - 0.676887f * vT);
+    *R = VMAT(*lms2rgb, 0, L, M, S);
+    *G = VMAT(*lms2rgb, 1, L, M, S);
+    *B = VMAT(*lms2rgb, 2, L, M, S);
+}
+
+#define rgb2ipt_vec KCAT(KERNEL_NAME, rgb2ipt_vec)
+VINLINE void rgb2ipt_vec(vf vR, vf vG, vf vB, const pl_matrix3x3 *rgb2lms,
+                         vf *I, vf *P, vf *T)
+{
+    const vf Lp = vpq_oetf(VMAT(*rgb2lms, 0, vR, vG, vB));
+    const vf Mp = vpq_oetf(VMAT(*rgb2lms, 1, vR, vG, vB));
+    const vf Sp = vpq_oetf(VMAT(*rgb2lms, 2, vR, vG, vB));
+    *I = 0.4000f * Lp + 0.4000f * Mp + 0.2000f * Sp;
+    *P = 4.4550f * Lp - 4.8510f * Mp + 0.3960f * Sp;
+    *T = 0.8056f * Lp + 0.3572f * Mp - 1.1628f * Sp;
+}
+
+#define ingamut_vec KCAT(KERNEL_NAME, ingamut_vec)
+VINLINE vi ingamut_vec(vf vI, vf vP, vf vT, const struct pl_gamut_bounds *gamut)
+{
+    const vf Lp = vI + 0.0975689f * vP + 0.205226f * vT;
+    const vf Mp = vI - 0.1138760f * vP + 0.133217f * vT;
+    const vf Sp = vI + 0.0326151f * vP - 0.676887f * vT;
+    vi ok = (Lp >= gamut->min_luma) & (Lp <= gamut->max_luma) &
+            (Mp >= gamut->min_luma) & (Mp <= gamut->max_luma) &
+            (Sp >= gamut->min_luma) & (Sp <= gamut->max_luma);
+
+    const vf L = vpq_eotf(Lp), M = vpq_eotf(Mp), S = vpq_eotf(Sp);
+    const vf R = VMAT(gamut->lms2rgb, 0, L, M, S);
+    const vf G = VMAT(gamut->lms2rgb, 1, L, M, S);
+    const vf B = VMAT(gamut->lms2rgb, 2, L, M, S);
+    ok &= (R >= gamut->min_rgb) & (R <= gamut->max_rgb) &
+          (G >= gamut->min_rgb) & (G <= gamut->max_rgb) &
+          (B >= gamut->min_rgb) & (B <= gamut->max_rgb);
+    return ok;
+}
+
+KERNEL_TARGET
+static void KCAT(KERNEL_NAME, ipt2rgb)(float *I, float *P, float *T, int num,
+                                       const pl_matrix3x3 *lms2rgb)
+{
+    int i = 0;
+    vf R, G, B;
+    for (; i + VLEN <= num; i += VLEN) {
+        ipt2rgb_vec(vload(&I[i]), vload(&P[i]), vload(&T[i]), lms2rgb, &R, &G, &B);
+        vstore(&I[i], R);
+        vstore(&P[i], G);
+        vstore(&T[i], B);
+    }
+
+    if (i < num) {
+        const int n = num - i;
+        ipt2rgb_vec(vload_tail(&I[i], n), vload_tail(&P[i], n),
+                    vload_tail(&T[i], n), lms2rgb, &R, &G, &B);
+        vstore_tail(&I[i], R, n);
+        vstore_tail(&P[i], G, n);
+        vstore_tail(&T[i], B, n);
+    }
+}
+
+KERNEL_TARGET
+static void KCAT(KERNEL_NAME, rgb2ipt)(float *R, float *G, float *B, int num,
+                                       const pl_matrix3x3 *rgb2lms)
+{
+    int i = 0;
+    vf I, P, T;
+    for (; i + VLEN <= num; i += VLEN) {
+        rgb2ipt_vec(vload(&R[i]), vload(&G[i]), vload(&B[i]), rgb2lms, &I, &P, &T);
+        vstore(&R[i], I);
+        vstore(&G[i], P);
+        vstore(&B[i], T);
+    }
+
+    if (i < num) {
+        const int n = num - i;
+        rgb2ipt_vec(vload_tail(&R[i], n), vload_tail(&G[i], n),
+                    vload_tail(&B[i], n), rgb2lms, &I, &P, &T);
+        vstore_tail(&R[i], I, n);
+        vstore_tail(&G[i], P, n);
+        vstore_tail(&B[i], T, n);
+    }
+}
+
+KERNEL_TARGET
+static void KCAT(KERNEL_NAME, pq_eotf)(float *x, int num)
+{
+    int i = 0;
+    for (; i + VLEN <= num; i += VLEN)
+        vstore(&x[i], vpq_eotf(vload(&x[i])));
+    if (i < num)
+        vstore_tail(&x[i], vpq_eotf(vload_tail(&x[i], num - i)), num - i);
+}
+
+KERNEL_TARGET
+static void KCAT(KERNEL_NAME, pq_oetf)(float *x, int num)
+{
+    int i = 0;
+    for (; i + VLEN <= num; i += VLEN)
+        vstore(&x[i], vpq_oetf(vload(&x[i])));
+    if (i < num)
+        vstore_tail(&x[i], vpq_oetf(vload_tail(&x[i], num - i)), num - i);
+}
+
+KERNEL_TARGET
+static void KCAT(KERNEL_NAME, ingamut)(uint8_t *out, const float *I,
+                                       const float *P, const float *T, int num,
+                                       const struct pl_gamut_bounds *gamut)
+{
+    for (int i = 0; i < num; i += VLEN) {
+        const int n = PL_MIN(num - i, VLEN);
+        const vi ok = n == VLEN
+            ? ingamut_vec(vload(&I[i]), vload(&P[i]), vload(&T[i]), gamut)
+            : ingamut_vec(vload_tail(&I[i], n), vload_tail(&P[i], n),
+                          vload_tail(&T[i], n), gamut);
+        for (int j = 0; j < n; j++)
+            out[i + j] = !!ok[j];
+    }
+}
+
+static const struct pl_gamut_kernels KCAT(kernels, KERNEL_NAME) = {
+    .name       = PL_TOSTRING(KERNEL_NAME),
+    .supported  = KERNEL_SUPPORTED,
+    .ipt2rgb    = KCAT(KERNEL_NAME, ipt2rgb),
+    .rgb2ipt    = KCAT(KERNEL_NAME, rgb2ipt),
+    .pq_eotf    = KCAT(KERNEL_NAME, pq_eotf),
+    .pq_oetf    = KCAT(KERNEL_NAME, pq_oetf),
+    .ingamut    = KCAT(KERNEL_NAME, ingamut),
+};
+
+#undef KCAT_
+#undef KCAT
+#undef VLEN
+#undef VINLINE
+#undef vf
+#undef vi
+#undef vload
+#undef vstore
+#undef vload_tail
+#undef vstore_tail
+#undef ipt2rgb_vec
+#undef rgb2ipt_vec
+#undef ingamut_vec
+#undef vset
+#undef vsel
+#undef vmin
+#undef vmax
+#undef vlog2
+#undef vexp2
+#undef vpow
+#undef vpq_eotf
+#undef vpq_oetf
+#undef VMAT
+
+#undef KERNEL_NAME
+#undef KERNEL_VLEN
+#undef KERNEL_TARGET
+#undef KERNEL_SUPPORTED
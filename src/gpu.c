@@ -27,6 +27,7 @@ void pl_gpu_destroy(pl_gpu gpu)
 
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
     pl_dispatch_destroy(&impl->dp);
+    pl_buf_pool_destroy(gpu, &impl->buf_pool);
     impl->destroy(gpu);
 }
 
@@ -1060,12 +1061,15 @@ pl_pass pl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     for (int i = 0; i < params->num_descriptors; i++) {
         struct pl_desc desc = params->descriptors[i];
         require(desc.name);
+        require(desc.count >= 0 && (uint32_t) desc.count <= gpu->limits.max_tex_array);
+        require(!desc.count || desc.type == PL_DESC_SAMPLED_TEX);
 
         // enforce disjoint descriptor bindings for each namespace
         int namespace = pl_desc_namespace(gpu, desc.type);
         for (int j = i+1; j < params->num_descriptors; j++) {
             struct pl_desc other = params->descriptors[j];
-            require(desc.binding != other.binding ||
+            require(desc.binding + pl_desc_elems(&desc) <= other.binding ||
+                    other.binding + pl_desc_elems(&other) <= desc.binding ||
                     namespace != pl_desc_namespace(gpu, other.type));
         }
     }
@@ -1111,10 +1115,18 @@ void pl_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
         require(db.object);
         switch (desc.type) {
         case PL_DESC_SAMPLED_TEX: {
-            pl_tex tex = db.object;
-            pl_fmt fmt = tex->params.format;
-            require(tex->params.sampleable);
-            require(db.sample_mode != PL_TEX_SAMPLE_LINEAR || (fmt->caps & PL_FMT_CAP_LINEAR));
+            pl_tex first = pl_desc_tex(&desc, &db, 0);
+            for (int j = 0; j < pl_desc_elems(&desc); j++) {
+                pl_tex tex = pl_desc_tex(&desc, &db, j);
+                require(tex);
+                pl_fmt fmt = tex->params.format;
+                require(tex->params.sampleable);
+                require(db.sample_mode != PL_TEX_SAMPLE_LINEAR || (fmt->caps & PL_FMT_CAP_LINEAR));
+                require(tex->sampler_type == first->sampler_type);
+                require(fmt->type == first->params.format->type);
+                require(pl_tex_params_dimension(tex->params) ==
+                        pl_tex_params_dimension(first->params));
+            }
             break;
         }
         case PL_DESC_STORAGE_IMG: {
@@ -44,6 +44,9 @@ struct pl_gpu_fns {
     // Internal cache, or NULL. Set by the user (via pl_gpu_set_cache).
     _Atomic(pl_cache) cache;
 
+    // Pool of recycled staging buffers, see `pl_buf_pool_get`.
+    struct pl_buf_pool *buf_pool;
+
     // Destructors: These also free the corresponding objects, but they
     // must not be called on NULL. (The NULL checks are done by the pl_*_destroy
     // wrappers)
@@ -77,6 +80,11 @@ struct pl_gpu_fns {
     GPU_PFN(gpu_flush); // optional
     GPU_PFN(gpu_finish);
     GPU_PFN(gpu_is_failed); // optional
+
+    // Like `buf_poll` with a zero timeout, but must not submit any pending
+    // commands. Used to check recycled buffers. (Optional: falls back to
+    // `buf_poll` if NULL)
+    bool (*buf_busy)(pl_gpu, pl_buf);
 };
 #undef GPU_PFN
 
@@ -129,6 +137,18 @@ int pl_tex_transfer_slices(pl_gpu gpu, pl_fmt texel_fmt,
                            const struct pl_tex_transfer_params *params,
                            struct pl_tex_transfer_params **out_slices);
 
+// Internal pool of staging buffers, owned by the `pl_gpu`.
+struct pl_buf_pool *pl_buf_pool_create(pl_gpu gpu);
+void pl_buf_pool_destroy(pl_gpu gpu, struct pl_buf_pool **pool);
+
+// Get a temporary buffer of at least `params->size` bytes, possibly recycled
+// from a previous call. Buffers with `initial_data`, a texel `format`, or
+// import/export handles are never pooled. The buffer should be released with
+// `pl_buf_pool_put` instead of `pl_buf_destroy`, which returns it to the pool
+// for reuse once the GPU is done with it.
+pl_buf pl_buf_pool_get(pl_gpu gpu, const struct pl_buf_params *params);
+void pl_buf_pool_put(pl_gpu gpu, pl_buf *buf);
+
 // Helper that wraps pl_tex_upload/download using texture upload buffers to
 // ensure that params->buf is always set.
 bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params);
@@ -173,6 +193,18 @@ void pl_pass_run_vbo(pl_gpu gpu, const struct pl_pass_run_params *params);
 // copied, but cleared explicitly.
 struct pl_pass_params pl_pass_params_copy(void *alloc, const struct pl_pass_params *params);
 
+// Helpers for descriptors which may be arrays (see `pl_desc.count`)
+static inline int pl_desc_elems(const struct pl_desc *desc)
+{
+    return PL_MAX(desc->count, 1);
+}
+
+static inline pl_tex pl_desc_tex(const struct pl_desc *desc,
+                                 const struct pl_desc_binding *db, int idx)
+{
+    return desc->count ? ((const pl_tex *) db->object)[idx] : db->object;
+}
+
 // Helper to compute the size of an index buffer
 static inline size_t pl_index_buf_size(const struct pl_pass_run_params *params)
 {
@@ -0,0 +1,211 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "gpu.h"
+#include "pl_thread.h"
+
+// Upper bound on the number of buffers kept around for reuse. Beyond this,
+// the least recently returned buffers are released first.
+#define MAX_POOLED_BUFS 16
+
+// Smallest size class, to avoid keeping around lots of tiny buffers
+#define MIN_POOLED_SIZE (64 << 10) // 64 KiB
+
+struct pl_buf_pool {
+    pl_mutex lock;
+    PL_ARRAY(pl_buf) bufs; // oldest first
+    struct pl_buf_pool_stats stats;
+};
+
+struct pl_buf_pool *pl_buf_pool_create(pl_gpu gpu)
+{
+    struct pl_buf_pool *pool = pl_zalloc_ptr(NULL, pool);
+    pl_mutex_init(&pool->lock);
+    return pool;
+}
+
+void pl_buf_pool_destroy(pl_gpu gpu, struct pl_buf_pool **ppool)
+{
+    struct pl_buf_pool *pool = *ppool;
+    if (!pool)
+        return;
+
+    for (int i = 0; i < pool->bufs.num; i++)
+        pl_buf_destroy(gpu, &pool->bufs.elem[i]);
+    pl_mutex_destroy(&pool->lock);
+    pl_free_ptr(ppool);
+}
+
+static inline struct pl_buf_pool *get_pool(pl_gpu gpu)
+{
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    return impl->buf_pool;
+}
+
+// Only plain buffers without any extra state attached are eligible
+static bool poolable(const struct pl_buf_params *params)
+{
+    return !params->format && !params->uniform && !params->drawable &&
+           !params->export_handle && !params->import_handle &&
+           !params->initial_data && !params->user_data;
+}
+
+static bool params_compatible(const struct pl_buf_params *a,
+                              const struct pl_buf_params *b)
+{
+    return a->size == b->size &&
+           a->host_writable == b->host_writable &&
+           a->host_readable == b->host_readable &&
+           a->host_mapped == b->host_mapped &&
+           a->storable == b->storable &&
+           a->memory_type == b->memory_type;
+}
+
+// Round sizes up to the next power of two, so buffers of similar sizes (e.g.
+// planes of slightly different resolutions) can share the same pool entries
+static size_t size_class(pl_gpu gpu, const struct pl_buf_params *params)
+{
+    size_t size = PL_MAX(params->size, MIN_POOLED_SIZE);
+    size = PL_ALIGN_POT(size);
+
+    size_t max_size = gpu->limits.max_buf_size;
+    if (params->host_mapped)
+        max_size = PL_MIN(max_size, gpu->limits.max_mapped_size);
+    if (params->storable)
+        max_size = PL_MIN(max_size, gpu->limits.max_ssbo_size);
+    return PL_MAX(PL_MIN(size, max_size), params->size);
+}
+
+static pl_buf pool_remove(struct pl_buf_pool *pool, int idx)
+{
+    pl_buf buf = pool->bufs.elem[idx];
+    PL_ARRAY_REMOVE_AT(pool->bufs, idx);
+    pool->stats.pooled_bytes -= buf->params.size;
+    pool->stats.num_pooled--;
+    return buf;
+}
+
+static void pool_insert(struct pl_buf_pool *pool, int idx, pl_buf buf)
+{
+    PL_ARRAY_INSERT_AT(pool, pool->bufs, idx, buf);
+    pool->stats.pooled_bytes += buf->params.size;
+    pool->stats.num_pooled++;
+}
+
+static bool buf_busy(pl_gpu gpu, pl_buf buf)
+{
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    return impl->buf_busy ? impl->buf_busy(gpu, buf) : pl_buf_poll(gpu, buf, 0);
+}
+
+pl_buf pl_buf_pool_get(pl_gpu gpu, const struct pl_buf_params *params)
+{
+    struct pl_buf_pool *pool = get_pool(gpu);
+    if (!pool || !poolable(params))
+        return pl_buf_create(gpu, params);
+
+    struct pl_buf_params fixed = *params;
+    fixed.size = size_class(gpu, params);
+    fixed.debug_tag = PL_DEF(params->debug_tag, PL_DEBUG_TAG);
+
+    // Checking whether a buffer is still in use can run completion callbacks,
+    // which may in turn return buffers to the pool, so take the candidates
+    // out of the pool and check them without holding the lock
+    pl_buf candidates[MAX_POOLED_BUFS];
+    int num_candidates = 0;
+    pl_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->bufs.num; i++) {
+        if (params_compatible(&pool->bufs.elem[i]->params, &fixed))
+            candidates[num_candidates++] = pool_remove(pool, i--);
+    }
+    pl_mutex_unlock(&pool->lock);
+
+    pl_buf buf = NULL;
+    for (int i = 0; i < num_candidates; i++) {
+        if (!buf_busy(gpu, candidates[i])) {
+            buf = candidates[i];
+            candidates[i] = NULL;
+            break;
+        }
+    }
+
+    // Put back the remaining candidates in front, since they're older than
+    // anything returned to the pool in the meantime
+    pl_buf evict[MAX_POOLED_BUFS];
+    int num_evict = 0;
+    pl_mutex_lock(&pool->lock);
+    for (int i = num_candidates - 1; i >= 0; i--) {
+        if (candidates[i])
+            pool_insert(pool, 0, candidates[i]);
+    }
+    while (pool->bufs.num > MAX_POOLED_BUFS)
+        evict[num_evict++] = pool_remove(pool, 0);
+    if (buf) {
+        pool->stats.hits++;
+        pool->stats.bytes_recycled += buf->params.size;
+    } else {
+        pool->stats.misses++;
+    }
+    pl_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < num_evict; i++)
+        pl_buf_destroy(gpu, &evict[i]);
+    if (buf)
+        return buf;
+
+    buf = pl_buf_create(gpu, &fixed);
+    if (!buf && fixed.size > params->size) {
+        // Retry without rounding up, in case we ran into some limit
+        fixed.size = params->size;
+        buf = pl_buf_create(gpu, &fixed);
+    }
+
+    return buf;
+}
+
+void pl_buf_pool_put(pl_gpu gpu, pl_buf *pbuf)
+{
+    pl_buf buf = *pbuf;
+    struct pl_buf_pool *pool = get_pool(gpu);
+    if (!buf || !pool || !poolable(&buf->params)) {
+        pl_buf_destroy(gpu, pbuf);
+        return;
+    }
+
+    pl_buf evict = NULL;
+    pl_mutex_lock(&pool->lock);
+    if (pool->bufs.num == MAX_POOLED_BUFS)
+        evict = pool_remove(pool, 0);
+    pool_insert(pool, pool->bufs.num, buf);
+    pl_mutex_unlock(&pool->lock);
+
+    pl_buf_destroy(gpu, &evict);
+    *pbuf = NULL;
+}
+
+struct pl_buf_pool_stats pl_buf_pool_stats(pl_gpu gpu)
+{
+    struct pl_buf_pool *pool = get_pool(gpu);
+    if (!pool)
+        return (struct pl_buf_pool_stats) {0};
+
+    pl_mutex_lock(&pool->lock);
+    struct pl_buf_pool_stats stats = pool->stats;
+    pl_mutex_unlock(&pool->lock);
+    return stats;
+}
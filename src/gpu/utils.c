@@ -204,6 +204,7 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
     LOG(PRIu32, subgroup_size);
     LOG(PRIi16, min_gather_offset);
     LOG(PRIi16, max_gather_offset);
+    LOG("d", nonuniform_indexing);
 #undef LOG_STRUCT
 
 #define LOG_STRUCT limits
@@ -233,6 +234,7 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
     LOG("zu", max_constants);
     LOG("zu", max_pushc_size);
     LOG("zu", align_vertex_stride);
+    LOG(PRIu32, max_tex_array);
     if (gpu->glsl.compute) {
         LOG(PRIu32, max_dispatch[0]);
         LOG(PRIu32, max_dispatch[1]);
@@ -269,6 +271,7 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
     atomic_init(&impl->cache, NULL);
     impl->dp = pl_dispatch_create(gpu->log, gpu);
+    impl->buf_pool = pl_buf_pool_create(gpu);
     return gpu;
 }
 
@@ -562,7 +565,7 @@ bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     if (!fixed.buf) {
         bufparams.import_handle = 0;
         bufparams.host_writable = true;
-        fixed.buf = pl_buf_create(gpu, &bufparams);
+        fixed.buf = pl_buf_pool_get(gpu, &bufparams);
         if (!fixed.buf)
             return false;
         pl_buf_write(gpu, fixed.buf, 0, params->ptr, bufparams.size);
@@ -572,7 +575,7 @@ bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     }
 
     bool ok = pl_tex_upload(gpu, &fixed);
-    pl_buf_destroy(gpu, &fixed.buf);
+    pl_buf_pool_put(gpu, &fixed.buf);
     return ok;
 }
 
@@ -580,6 +583,7 @@ struct pbo_cb_ctx {
     pl_gpu gpu;
     pl_buf buf;
     void *ptr;
+    size_t size;
     void (*callback)(void *priv);
     void *priv;
 };
@@ -587,8 +591,8 @@ struct pbo_cb_ctx {
 static void pbo_download_cb(void *priv)
 {
     struct pbo_cb_ctx *p = priv;
-    pl_buf_read(p->gpu, p->buf, 0, p->ptr, p->buf->params.size);
-    pl_buf_destroy(p->gpu, &p->buf);
+    pl_buf_read(p->gpu, p->buf, 0, p->ptr, p->size);
+    pl_buf_pool_put(p->gpu, &p->buf);
 
     // Run the original callback
     p->callback(p->priv);
@@ -631,7 +635,7 @@ bool pl_tex_download_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params
         // Fallback when host pointer import is not supported
         bufparams.import_handle = 0;
         bufparams.host_readable = true;
-        buf = pl_buf_create(gpu, &bufparams);
+        buf = pl_buf_pool_get(gpu, &bufparams);
     }
 
     if (!buf)
@@ -648,13 +652,14 @@ bool pl_tex_download_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params
             .gpu = gpu,
             .buf = buf,
             .ptr = params->ptr,
+            .size = bufparams.size,
             .callback = params->callback,
             .priv = params->priv,
         });
     }
 
     if (!pl_tex_download(gpu, &newparams)) {
-        pl_buf_destroy(gpu, &buf);
+        pl_buf_pool_put(gpu, &buf);
         return false;
     }
 
@@ -673,7 +678,7 @@ bool pl_tex_download_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params
     } else if (!params->callback) {
         // Synchronous read back to the host pointer
         ok = pl_buf_read(gpu, buf, 0, params->ptr, bufparams.size);
-        pl_buf_destroy(gpu, &buf);
+        pl_buf_pool_put(gpu, &buf);
     } else {
         // Nothing left to do here, the rest will be done by pbo_download_cb
         ok = true;
@@ -56,6 +56,18 @@ struct pl_cache_params {
     size_t max_object_size;
     size_t max_total_size;
 
+    // Number of independently locked partitions to split the cache into.
+    // Objects are assigned to a shard based on their key, and operations on
+    // objects in different shards never contend with each other. This is
+    // useful when a single `pl_cache` is shared by many threads, e.g. many
+    // `pl_renderer` instances attached to the same `pl_gpu`. Rounded up to
+    // the nearest power of two. If 0, defaults to 1 (no sharding).
+    //
+    // Note: Size limits are enforced per shard, with each shard receiving an
+    // equal fraction of `max_total_size`. `max_object_size` is clamped to this
+    // fraction as well.
+    int num_shards;
+
     // Optional external callback to call after a cached object is modified
     // (including deletion and (re-)insertion). Note that this is not called on
     // objects which are merely pruned from the cache due to `max_total_size`,
@@ -106,6 +118,11 @@ PL_API void pl_cache_reset(pl_cache cache);
 PL_API int pl_cache_objects(pl_cache cache);
 PL_API size_t pl_cache_size(pl_cache cache);
 
+// Return the number of times an operation on `cache` had to wait for another
+// thread to release the lock. This counter only ever increases, and can be
+// used to tune `pl_cache_params.num_shards`.
+PL_API uint64_t pl_cache_contention(pl_cache cache);
+
 // --- Cache saving and loading APIs
 
 // Serialize the internal state of a `pl_cache` into an abstract cache
@@ -153,6 +170,107 @@ static inline bool pl_read_file_cb(void *priv, size_t size, void *ptr)
     return fread(ptr, 1, size, (FILE *) priv) == size;
 }
 
+// --- Memory-mapped cache files
+//
+// Alternative serialization format which stores all objects at aligned
+// offsets behind an up-front index. Files in this format can be loaded by
+// mapping them into memory and indexing the objects in-place, so loading
+// costs time proportional to the number of objects (rather than their total
+// size), and objects which are never used are never read from disk. Objects
+// are verified against their checksum lazily, when first retrieved.
+//
+// Note: Objects loaded this way are never modified in-place. Retrieving them
+// with `pl_cache_get` returns a copy, so they remain valid independently of
+// the underlying memory. Replacing them (e.g. via `pl_cache_set`) likewise
+// inserts a separate copy.
+
+// Serialize the internal state of a `pl_cache` in the memory-mapped format.
+// Returns the number of objects saved.
+PL_API int pl_cache_save_mapped_ex(pl_cache cache,
+                                   void (*write)(void *priv, size_t size, const void *ptr),
+                                   void *priv);
+
+// Index the result of a previous `pl_cache_save_mapped_ex` (or
+// `pl_cache_save_mapped_file`) call in-place. Does not copy `data`, which
+// must remain valid and unmodified until `cache` is reset or destroyed.
+// Returns the number of objects loaded, or a negative number on serious error.
+//
+// Note: For convenience, this also accepts data written by `pl_cache_save`,
+// in which case it behaves like (and copies like) `pl_cache_load`.
+PL_API int pl_cache_load_mapped(pl_cache cache, const uint8_t *data, size_t size);
+
+// Map the file at `path` into memory and index it with `pl_cache_load_mapped`.
+// The mapping is owned by `cache`, and is kept alive until `pl_cache_reset` or
+// `pl_cache_destroy`.
+// Returns the number of objects loaded, or a negative number on error
+// (including if memory mapping is not supported on this platform).
+PL_API int pl_cache_load_mapped_file(pl_cache cache, const char *path);
+
+#define pl_cache_save_mapped_file(c, file) pl_cache_save_mapped_ex(c, pl_write_file_cb, file)
+
+// --- Journaled on-disk cache backend
+//
+// Built-in implementation of the `pl_cache_params.get/set` callbacks, which
+// persists objects to an append-only journal file as soon as they are
+// inserted or deleted, and lazily loads objects from it on cache misses. This
+// avoids having to re-save the entire cache (e.g. on exit) to persist new
+// objects. Stale records are periodically compacted away by a background
+// thread. Usage:
+//
+//   pl_cache_journal journal = pl_cache_journal_create(pl_cache_journal_params(
+//       .path = "/path/to/journal",
+//   ));
+//
+//   pl_cache cache = pl_cache_create(pl_cache_params(
+//       .get  = pl_cache_journal_get,
+//       .set  = pl_cache_journal_set,
+//       .priv = journal,
+//   ));
+//
+// Thread-safety: Safe
+typedef struct pl_cache_journal_t *pl_cache_journal;
+
+struct pl_cache_journal_params {
+    // Optional `pl_log` for logging journal-related events.
+    pl_log log;
+
+    // Path to the journal file. Will be created if it does not exist.
+    // (Required)
+    const char *path;
+
+    // Compact the journal in the background once it contains at least this
+    // many bytes of stale (overwritten or deleted) records, and these make
+    // up the majority of the journal. If 0, the journal is never compacted
+    // automatically.
+    size_t compact_threshold;
+};
+
+#define PL_CACHE_JOURNAL_DEFAULTS   \
+    .compact_threshold = 16 << 20,
+
+#define pl_cache_journal_params(...) (&(struct pl_cache_journal_params) { PL_CACHE_JOURNAL_DEFAULTS __VA_ARGS__ })
+PL_API extern const struct pl_cache_journal_params pl_cache_journal_default_params;
+
+// Open (or create) a cache journal. Returns NULL on failure, e.g. if the file
+// could not be created, or exists but is not a cache journal.
+PL_API pl_cache_journal pl_cache_journal_create(const struct pl_cache_journal_params *params);
+
+// Destroy the journal. Any `pl_cache` using it must be destroyed first.
+PL_API void pl_cache_journal_destroy(pl_cache_journal *journal);
+
+// Callbacks suitable for use as `pl_cache_params.set/get`, with `priv`
+// set to a `pl_cache_journal`. Re-inserting an unmodified object does not
+// append a new record.
+PL_API void pl_cache_journal_set(void *journal, pl_cache_obj obj);
+PL_API pl_cache_obj pl_cache_journal_get(void *journal, uint64_t key);
+
+// Synchronously compact the journal, dropping all stale records. Returns
+// whether successful.
+PL_API bool pl_cache_journal_compact(pl_cache_journal journal);
+
+// Returns the current size of the journal file, in bytes.
+PL_API size_t pl_cache_journal_size(pl_cache_journal journal);
+
 // --- Object modification API. Mostly intended for internal use.
 
 // Insert a new cached object into a `pl_cache`. Returns whether successful.
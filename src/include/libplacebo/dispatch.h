@@ -62,6 +62,12 @@ struct pl_dispatch_info {
     uint64_t last;
     uint64_t peak;
     uint64_t average;
+
+    // Running totals of how often the `pl_dispatch` pass cache was hit (the
+    // shader matched an existing pass, skipping GLSL generation entirely) or
+    // missed (new GLSL was generated and a new pass compiled), respectively.
+    uint64_t cache_hits;
+    uint64_t cache_misses;
 };
 
 // Helper function to make a copy of `pl_dispatch_info`, while overriding
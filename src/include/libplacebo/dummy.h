@@ -24,14 +24,18 @@ PL_API_BEGIN
 
 // The functions in this file allow creating and manipulating "dummy" contexts.
 // A dummy context isn't actually mapped by the GPU, all data exists purely on
-// the CPU. It also isn't capable of compiling or executing any shaders, any
-// attempts to do so will simply fail.
+// the CPU. By default, it also isn't capable of compiling or executing any
+// shaders, any attempts to do so will simply fail.
 //
 // The main use case for this dummy context is for users who want to generate
 // advanced shaders that depend on specific GLSL features or support for
 // certain types of GPU resources (e.g. LUTs). This dummy context allows such
 // shaders to be generated, with all of the referenced shader objects and
 // textures simply containing their data in a host-accessible way.
+//
+// Optionally, a dummy context can also execute shaders on the CPU (see
+// `pl_gpu_dummy_params.execute`), which allows using e.g. `pl_renderer` on
+// machines without any GPU at all.
 
 struct pl_gpu_dummy_params {
     // These GPU parameters correspond to their equivalents in `pl_gpu`, and
@@ -45,6 +49,28 @@ struct pl_gpu_dummy_params {
     // `glGet` queries etc.
     struct pl_glsl_version glsl;
     struct pl_gpu_limits limits;
+
+    // If true, raster passes can be created and run. This works by
+    // translating the GLSL shaders to C++, compiling them into a shared
+    // library by running the host's C++ compiler as a separate process, and
+    // rasterizing on the CPU using multiple threads. Expect this to be orders
+    // of magnitude slower than a real GPU, and compiling each new shader to
+    // take a second or so. Compiled shaders are shared within the process,
+    // but never stored in the `pl_cache`, so they are recompiled by every
+    // process.
+    //
+    // Setting this overrides `glsl.compute`, as well as all limits related to
+    // buffer descriptors and push constants, since these are not supported.
+    // Requires the `cpu-exec` component (see `PL_HAVE_CPU_EXEC`), which is
+    // disabled by default and must be explicitly enabled at build time
+    // (`-Dcpu-exec=enabled`, POSIX systems with `dlopen` only). Creating the
+    // GPU fails otherwise.
+    bool execute;
+
+    // Command line used to invoke the C++ compiler, when `execute` is true.
+    // The first word is looked up in `PATH`. Extra flags can be appended
+    // here, e.g. "c++ -march=native" for faster shaders. Defaults to "c++".
+    const char *compiler;
 };
 
 #define PL_GPU_DUMMY_DEFAULTS                                           \
@@ -83,6 +109,7 @@ struct pl_gpu_dummy_params {
         .max_constants      = SIZE_MAX,                                 \
         .max_pushc_size     = SIZE_MAX,                                 \
         .max_dispatch       = { UINT32_MAX, UINT32_MAX, UINT32_MAX },   \
+        .max_tex_array      = UINT32_MAX,                               \
         .fragment_queues    = 0,                                        \
         .compute_queues     = 0,                                        \
     },
@@ -85,6 +85,11 @@ struct pl_glsl_version {
     // Miscellaneous shader limits
     int16_t min_gather_offset;  // minimum `textureGatherOffset` offset
     int16_t max_gather_offset;  // maximum `textureGatherOffset` offset
+
+    // If true, arrays of sampled textures may be indexed by non-uniform
+    // expressions, using `nonuniformEXT` (GL_EXT_nonuniform_qualifier).
+    // Otherwise, they may only be indexed by constant expressions.
+    bool nonuniform_indexing;
 };
 
 // Backwards compatibility alias
@@ -132,6 +137,7 @@ struct pl_gpu_limits {
     size_t max_pushc_size;      // maximum `push_constants_size`
     size_t align_vertex_stride; // alignment of `pl_pass_params.vertex_stride`
     uint32_t max_dispatch[3];   // maximum dispatch size per dimension
+    uint32_t max_tex_array;     // maximum `pl_desc.count` for sampled textures
 
     // Note: At least one of `max_variable_comps` or `max_ubo_size` is
     // guaranteed to be nonzero.
@@ -651,6 +657,20 @@ PL_API bool pl_buf_export(pl_gpu gpu, pl_buf buf);
 // by another thread.
 PL_API bool pl_buf_poll(pl_gpu gpu, pl_buf buf, uint64_t timeout);
 
+// Statistics about the internal pool of staging buffers, which libplacebo
+// uses for transfers that require temporary buffers (e.g. `pl_upload_plane`
+// with byte-swapped data, or emulated host pointer transfers). Buffers are
+// returned to the pool after use, and recycled once the GPU is done with them.
+struct pl_buf_pool_stats {
+    uint64_t hits;              // requests served by a recycled buffer
+    uint64_t misses;            // requests which required a new buffer
+    uint64_t bytes_recycled;    // total size of all recycled buffers
+    size_t pooled_bytes;        // total size of the buffers currently pooled
+    int num_pooled;             // number of buffers currently pooled
+};
+
+PL_API struct pl_buf_pool_stats pl_buf_pool_stats(pl_gpu gpu);
+
 enum pl_tex_sample_mode {
     PL_TEX_SAMPLE_NEAREST,  // nearest neighbour sampling
     PL_TEX_SAMPLE_LINEAR,   // linear filtering, requires PL_FMT_CAP_LINEAR
@@ -1135,6 +1155,19 @@ struct pl_desc {
     // the other descriptor types (uniform buffers and sampled textures are
     // always read-only).
     enum pl_desc_access access;
+
+    // For PL_DESC_SAMPLED_TEX, this can be used to declare an array of
+    // `count` textures, rather than a single texture. The array occupies the
+    // `count` consecutive bindings starting at `binding`, and `count` must not
+    // exceed `pl_gpu_limits.max_tex_array`. The `pl_desc_binding.object` then
+    // points to an array of `count` pl_tex, which must all share the same
+    // dimension, sampler type and format type. The same texture may be bound
+    // to several elements. If left as 0, the descriptor is not an array.
+    //
+    // Note: Unless `pl_glsl_version.nonuniform_indexing` is supported, these
+    // arrays may only be indexed by constant expressions. Non-uniform indices
+    // can still be emulated by branching on the index.
+    int count;
 };
 
 // Framebuffer blending mode (for raster passes)
@@ -1261,6 +1294,7 @@ PL_API void pl_pass_destroy(pl_gpu gpu, pl_pass *pass);
 
 struct pl_desc_binding {
     const void *object; // pl_* object with type corresponding to pl_desc_type
+                        // (or an array of them, see `pl_desc.count`)
 
     // For PL_DESC_SAMPLED_TEX, this can be used to configure the sampler.
     enum pl_tex_address_mode address_mode;
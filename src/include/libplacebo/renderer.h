@@ -79,6 +79,49 @@ PL_API struct pl_render_errors pl_renderer_get_errors(pl_renderer rr);
 PL_API void pl_renderer_reset_errors(pl_renderer rr,
                                      const struct pl_render_errors *errors);
 
+// Statistics about the pool of intermediate textures (FBOs) kept by the
+// renderer. Textures are reused across frames, and released after being
+// unused for a number of frames.
+//
+// Note: Textures holding the input of the main and output scalers are
+// rounded up to coarser size classes, and only the region actually needed is
+// rendered to and sampled from (see `pl_sample_src.bounds`). Small changes to
+// the crop or output size (e.g. animated zooming) therefore don't require
+// reallocating these textures. Other intermediate textures, including all
+// textures exposed to hooks, are still allocated at the exact size required.
+struct pl_renderer_fbo_stats {
+    uint64_t hits;      // requests served by an existing texture as-is
+    uint64_t misses;    // requests which required (re)allocating a texture
+    int num_fbos;       // number of textures currently in the pool
+    size_t vram_bytes;  // approximate memory footprint of these textures
+
+    // Intermediate textures whose contents are no longer needed are reused
+    // for later steps of the same rendering pass. These fields give the
+    // memory footprint of the textures used by the most recent rendering
+    // pass, and the footprint it would have had without such reuse.
+    size_t frame_bytes;
+    size_t unaliased_bytes;
+};
+
+PL_API struct pl_renderer_fbo_stats pl_renderer_get_fbo_stats(pl_renderer rr);
+
+// Statistics about overlay rendering. Consecutive overlays that only differ in
+// their texture and transform are copied into a shared atlas texture (one per
+// texture format) and drawn together using a single draw call. This requires
+// the overlay textures to be created with `blit_src`. Each distinct texture is
+// only copied once per batch. Atlases are released by
+// `pl_renderer_flush_cache`.
+struct pl_renderer_overlay_stats {
+    uint64_t overlays;      // number of overlays drawn
+    uint64_t draws;         // number of draw calls issued for them
+    uint64_t draws_saved;   // draw calls avoided by batching
+    uint64_t atlas_blits;   // number of textures copied into an atlas
+    int num_atlases;        // number of atlas textures currently allocated
+    size_t atlas_bytes;     // approximate memory footprint of these textures
+};
+
+PL_API struct pl_renderer_overlay_stats pl_renderer_get_overlay_stats(pl_renderer rr);
+
 enum pl_lut_type {
     PL_LUT_UNKNOWN = 0,
     PL_LUT_NATIVE,      // applied to raw image contents (after fixing bit depth)
@@ -114,6 +157,11 @@ struct pl_render_info {
     // For PL_RENDER_STAGE_BLEND, this specifies the number of frames
     // being blended (since that results in a different shader).
     int count;
+
+    // Set if this pass belongs to a frame that was rendered with a reduced
+    // set of features, because some shaders required by the full set of
+    // parameters were still being compiled. See `async_compile`.
+    bool degraded;
 };
 
 // Represents the options used for rendering. These affect the quality of
@@ -335,6 +383,21 @@ struct pl_render_params {
     // user, but it should be set to false once those values are "dialed in".
     bool dynamic_constants;
 
+    // If true, new shaders are compiled on a background thread instead of
+    // stalling rendering. If a frame turns out to require shaders which are
+    // still being compiled, the remaining passes of that frame are discarded
+    // and the frame is instead rendered again using a cheaper fallback
+    // configuration (built-in scaling, no debanding, sigmoidization, peak
+    // detection, frame mixing or error diffusion), which is also used for
+    // all further frames until compilation finishes. The shaders for this
+    // fallback configuration are compiled synchronously, so every frame is
+    // always rendered completely, and `pl_render_info.degraded` is set for
+    // all passes of such frames. Note that passes executed before the
+    // discarded ones are still reported to `info_callback`, and that hooks
+    // may be invoked again for the same frame. Requires
+    // `pl_gpu_limits.thread_safe`, otherwise this is ignored.
+    bool async_compile;
+
     // This callback is invoked for every pass successfully executed in the
     // process of rendering a frame. Optional.
     //
@@ -244,6 +244,12 @@ struct pl_color_map_params {
     // default size.
     bool lut3d_tricubic;
 
+    // If true, changes to the gamut mapping parameters (e.g. due to dynamic
+    // HDR metadata) first regenerate the 3DLUT at half resolution per axis,
+    // which is roughly 8x as fast. It is refined to full resolution once the
+    // parameters have remained unchanged for a few frames.
+    bool lut3d_progressive;
+
     // If true, allows the gamut mapping function to expand the gamut, in
     // cases where the target gamut exceeds that of the source. If false,
     // the source gamut will never be enlarged, even when using a gamut
@@ -282,6 +288,19 @@ struct pl_color_map_params {
     // or decreasing this will affect the visual appearance substantially.
     float contrast_smoothness;
 
+    // If true, the tone mapping LUT and gamut mapping 3DLUT are regenerated
+    // on a background thread when the source metadata changes. The previous
+    // LUTs remain in use (for at most a few frames) until the new ones are
+    // ready, avoiding stalls during dynamic scene changes.
+    bool async_luts;
+
+    // If true, the gamut mapping 3DLUT is generated directly on the GPU (via
+    // compute shaders where available), instead of being computed on the CPU
+    // and uploaded. This is only supported for some gamut mapping functions
+    // (currently all except softclip, darken and linear), and otherwise falls
+    // back to the CPU. Takes precedence over `async_luts` for this LUT.
+    bool gpu_luts;
+
     // --- Debugging options
 
     // Force the use of a full tone-mapping LUT even for functions that have
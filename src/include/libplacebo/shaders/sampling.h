@@ -59,6 +59,15 @@ struct pl_sample_src {
 
     // Note: `component_mask` and `components` are mutually exclusive, the
     // former is preferred if both are specified.
+
+    // Region of `tex` containing valid data (optional). If set, all texture
+    // accesses are restricted to this region, emulating
+    // `PL_TEX_ADDRESS_CLAMP` at its edges (regardless of `address_mode`),
+    // and `rect` defaults to this region instead of the entire texture.
+    // Useful for sampling images stored inside a larger texture, without
+    // the contents of the rest of the texture bleeding into the result.
+    // Ignored when sampling from a shader argument. (Since API v358)
+    pl_rect2d bounds;
 };
 
 #define pl_sample_src(...) (&(struct pl_sample_src) { __VA_ARGS__ })
@@ -83,17 +83,26 @@ struct pl_source_frame {
     //
     // Note: If `map` fails, it will not be retried, nor will `discard` be run.
     // The user should clean up state in this case.
+    //
+    // Note: If `pl_queue_params.map_threads` is used, this may be called from
+    // background threads, concurrently for different frames.
     bool (*map)(pl_gpu gpu, pl_tex *tex, const struct pl_source_frame *src,
                 struct pl_frame *out_frame);
 
     // If present, this will be called on frames that are done being used by
     // `pl_queue`. This may be useful to e.g. unmap textures backed by external
     // APIs such as hardware decoders. (Optional)
+    //
+    // Note: If `pl_queue_params.map_threads` is used, this may be called from
+    // background threads, for frames which were evicted while being mapped.
     void (*unmap)(pl_gpu gpu, struct pl_frame *frame, const struct pl_source_frame *src);
 
     // This function will be called for frames that are deemed unnecessary
     // (e.g. never became visible) and should instead be cleanly freed.
     // (Optional)
+    //
+    // Note: If `pl_queue_params.map_threads` is used, this may be called from
+    // background threads, like `unmap`.
     void (*discard)(const struct pl_source_frame *src);
 };
 
@@ -120,6 +129,10 @@ PL_API void pl_queue_reset(pl_queue queue);
 //
 // When no more frames are available, call this function with `frame == NULL`
 // to indicate EOF and begin draining the frame queue.
+//
+// This may be called from any number of threads concurrently. Frames are
+// handed over without contending with `pl_queue_update` on the rendering
+// thread, unless that thread is currently blocked waiting for new frames.
 PL_API void pl_queue_push(pl_queue queue, const struct pl_source_frame *frame);
 
 // Variant of `pl_queue_push` that blocks while the queue is judged
@@ -179,6 +192,20 @@ struct pl_queue_params {
     enum pl_queue_status (*get_frame)(struct pl_source_frame *out_frame,
                                       const struct pl_queue_params *params);
     void *priv;
+
+    // If nonzero, upcoming frames are mapped ahead of time by up to this many
+    // background threads, hiding the latency of e.g. uploading frames behind
+    // the rendering of earlier frames. Frames which are not ready yet by the
+    // time they're needed are still mapped by `pl_queue_update` itself.
+    //
+    // Note: This is ignored (with a warning) unless the GPU is thread-safe,
+    // see `pl_gpu_limits.thread_safe`. Threads are spawned on demand, and
+    // kept around until the queue is destroyed.
+    int map_threads;
+
+    // Number of frames after the current frame to map in the background, if
+    // `map_threads` is set. Defaults to 4 if left as 0.
+    int map_ahead;
 };
 
 #define pl_queue_params(...) (&(struct pl_queue_params) { __VA_ARGS__ })
@@ -225,6 +252,32 @@ PL_API int pl_queue_num_frames(pl_queue queue);
 // it is done being used by the user.
 PL_API bool pl_queue_peek(pl_queue queue, int idx, struct pl_source_frame *out);
 
+// Statistics about the frames passing through a pl_queue, accumulated since
+// its creation or the last `pl_queue_reset`.
+struct pl_queue_stats {
+    // Frames handed over by `pl_queue_push` without taking any lock, versus
+    // frames which had to take the queue's lock. The latter happens for
+    // `pl_queue_push_block`, for frames pulled via `pl_queue_params.get_frame`,
+    // and whenever too many frames are pushed without being consumed.
+    uint64_t pushed_async;
+    uint64_t pushed_locked;
+
+    // Number of distinct frames returned by `pl_queue_update` so far, and the
+    // time (in seconds) from each frame being pushed to it first being
+    // returned as part of a frame mix.
+    uint64_t rendered;
+    double latency_avg;
+    double latency_max;
+    double latency_last;
+
+    // Number of frames mapped ahead of time by `map_threads`, versus frames
+    // that had to be mapped by `pl_queue_update` itself.
+    uint64_t mapped_async;
+    uint64_t mapped_sync;
+};
+
+PL_API struct pl_queue_stats pl_queue_get_stats(pl_queue queue);
+
 PL_API_END
 
 #endif // LIBPLACEBO_FRAME_QUEUE_H
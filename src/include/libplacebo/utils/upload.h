@@ -133,6 +133,12 @@ PL_API pl_fmt pl_plane_find_fmt(pl_gpu gpu, int out_map[4], const struct pl_plan
 // and maximize compatibility with the other `pl_renderer` requirements
 // (blittable, linear filterable, etc.).
 //
+// If `pl_plane_find_fmt` fails, the data is instead converted on the CPU into
+// the closest format with one plain word per component, rescaling normalized
+// values to the new bit depth. This requires the data to be host-accessible,
+// i.e. given as `pixels` or in a `host_mapped` buffer. In this case,
+// `callback` is invoked as soon as the conversion is done.
+//
 // Note: `out_plane->shift_x/y` and `out_plane->flipped` are left
 // uninitialized, and should be set explicitly by the user.
 PL_API bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
@@ -293,6 +293,54 @@ PL_API void pl_vulkan_destroy(pl_vulkan *vk);
 // the underlying `pl_vulkan`. Returns NULL for any other type of `gpu`.
 PL_API pl_vulkan pl_vulkan_get(pl_gpu gpu);
 
+// Statistics about the internal resource management of a `pl_vulkan`.
+struct pl_vulkan_stats {
+    // Descriptor sets are allocated per pass, and additional pools of
+    // descriptor sets are allocated whenever all existing ones are still in
+    // use by in-flight commands (e.g. when running the same pass many times
+    // per frame). This counts the number of times this happened, as well as
+    // the number of descriptor sets currently allocated across all passes.
+    uint64_t descriptor_pool_grows;
+    int descriptor_sets;
+
+    // Descriptor sets retain their contents between uses, so bindings which
+    // still refer to the same object as the last time a set was used don't
+    // need to be written again. These count the number of descriptors
+    // written and skipped, respectively. (Does not apply to push descriptors)
+    uint64_t descriptor_writes;
+    uint64_t descriptor_writes_skipped;
+
+    // Recorded command buffers are queued up and submitted in batches, using
+    // one `vkQueueSubmit2` call per run of commands targeting the same queue.
+    // These count the total number of submit calls, and the number of command
+    // buffers submitted by them.
+    uint64_t submits;
+    uint64_t submitted_cmds;
+
+    // Same as above, but restricted to the most recently completed frame,
+    // i.e. between the last two calls to `pl_gpu_flush` or
+    // `pl_swapchain_submit_frame`.
+    int frame_submits;
+    int frame_cmds;
+
+    // Total size of the memory slabs currently allocated to serve textures
+    // and buffers, and the number of bytes actually in use by them. (Does not
+    // include objects large enough to get dedicated allocations)
+    size_t memory_allocated;
+    size_t memory_used;
+
+    // Small objects share slabs using a buddy allocator. Slabs which become
+    // sparsely used (e.g. after resizing textures) are drained, i.e. new
+    // allocations are steered away from them, so they can be released as
+    // soon as their remaining objects are destroyed. These count the number
+    // of slabs currently being drained, and the total number of bytes
+    // released this way.
+    int memory_slabs_draining;
+    uint64_t memory_reclaimed;
+};
+
+PL_API struct pl_vulkan_stats pl_vulkan_get_stats(pl_vulkan vk);
+
 struct pl_vulkan_device_params {
     // The instance to use. Required!
     //
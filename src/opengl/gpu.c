@@ -197,6 +197,7 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl pl_gl, const struct pl_opengl_para
     if (p->gl_ver >= 21)
         limits->max_tex_1d_dim = limits->max_tex_2d_dim;
     limits->buf_transfer = true;
+    get(GL_MAX_TEXTURE_IMAGE_UNITS, &limits->max_tex_array);
 
     if (p->gl_ver || p->gles_ver >= 30) {
         get(GL_MAX_FRAGMENT_UNIFORM_COMPONENTS, &limits->max_variable_comps);
@@ -295,7 +295,16 @@ pl_pass gl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
             // update the texture/image unit bindings after creating the shader
             // program, since specifying it directly requires GLSL 4.20+
             GLint loc = gl->GetUniformLocation(pass_gl->program, desc->name);
-            gl->Uniform1i(loc, desc->binding);
+            if (desc->count) {
+                // Arrays of samplers use one texture unit per element
+                GLint *units = pl_calloc_ptr(NULL, desc->count, units);
+                for (int j = 0; j < desc->count; j++)
+                    units[j] = desc->binding + j;
+                gl->Uniform1iv(loc, desc->count, units);
+                pl_free(units);
+            } else {
+                gl->Uniform1i(loc, desc->binding);
+            }
             break;
         }
         case PL_DESC_BUF_UNIFORM: {
@@ -447,19 +456,21 @@ static void update_desc(pl_gpu gpu, pl_pass pass, int index,
 
     switch (desc->type) {
     case PL_DESC_SAMPLED_TEX: {
-        pl_tex tex = db->object;
-        struct pl_tex_gl *tex_gl = PL_PRIV(tex);
-        gl->ActiveTexture(GL_TEXTURE0 + desc->binding);
-        gl->BindTexture(tex_gl->target, tex_gl->texture);
-
-        GLint filter = filters[db->sample_mode];
-        GLint wrap = wraps[db->address_mode];
-        gl->TexParameteri(tex_gl->target, GL_TEXTURE_MIN_FILTER, filter);
-        gl->TexParameteri(tex_gl->target, GL_TEXTURE_MAG_FILTER, filter);
-        switch (pl_tex_params_dimension(tex->params)) {
-        case 3: gl->TexParameteri(tex_gl->target, GL_TEXTURE_WRAP_R, wrap); // fall through
-        case 2: gl->TexParameteri(tex_gl->target, GL_TEXTURE_WRAP_T, wrap); // fall through
-        case 1: gl->TexParameteri(tex_gl->target, GL_TEXTURE_WRAP_S, wrap); break;
+        for (int i = 0; i < pl_desc_elems(desc); i++) {
+            pl_tex tex = pl_desc_tex(desc, db, i);
+            struct pl_tex_gl *tex_gl = PL_PRIV(tex);
+            gl->ActiveTexture(GL_TEXTURE0 + desc->binding + i);
+            gl->BindTexture(tex_gl->target, tex_gl->texture);
+
+            GLint filter = filters[db->sample_mode];
+            GLint wrap = wraps[db->address_mode];
+            gl->TexParameteri(tex_gl->target, GL_TEXTURE_MIN_FILTER, filter);
+            gl->TexParameteri(tex_gl->target, GL_TEXTURE_MAG_FILTER, filter);
+            switch (pl_tex_params_dimension(tex->params)) {
+            case 3: gl->TexParameteri(tex_gl->target, GL_TEXTURE_WRAP_R, wrap); // fall through
+            case 2: gl->TexParameteri(tex_gl->target, GL_TEXTURE_WRAP_T, wrap); // fall through
+            case 1: gl->TexParameteri(tex_gl->target, GL_TEXTURE_WRAP_S, wrap); break;
+            }
         }
         return;
     }
@@ -504,10 +515,11 @@ static void unbind_desc(pl_gpu gpu, pl_pass pass, int index,
 
     switch (desc->type) {
     case PL_DESC_SAMPLED_TEX: {
-        pl_tex tex = db->object;
-        struct pl_tex_gl *tex_gl = PL_PRIV(tex);
-        gl->ActiveTexture(GL_TEXTURE0 + desc->binding);
-        gl->BindTexture(tex_gl->target, 0);
+        for (int i = 0; i < pl_desc_elems(desc); i++) {
+            struct pl_tex_gl *tex_gl = PL_PRIV(pl_desc_tex(desc, db, i));
+            gl->ActiveTexture(GL_TEXTURE0 + desc->binding + i);
+            gl->BindTexture(tex_gl->target, 0);
+        }
         return;
     }
     case PL_DESC_STORAGE_IMG: {
@@ -979,6 +979,7 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_INT("lut3d_size_C", "Gamut 3DLUT size C", color_map_params.lut3d_size[1], .max = 1024),
     OPT_INT("lut3d_size_h", "Gamut 3DLUT size h", color_map_params.lut3d_size[2], .max = 1024),
     OPT_BOOL("lut3d_tricubic", "Gamut 3DLUT tricubic interpolation", color_map_params.lut3d_tricubic),
+    OPT_BOOL("lut3d_progressive", "Progressive gamut 3DLUT updates", color_map_params.lut3d_progressive),
     OPT_BOOL("gamut_expansion", "Gamut expansion", color_map_params.gamut_expansion),
     OPT_NAMED("tone_mapping", "Tone mapping function", color_map_params.tone_mapping_function,
               pl_tone_map_functions),
@@ -1003,6 +1004,8 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_INT("tone_lut_size", "Tone mapping LUT size", color_map_params.lut_size, .max = 4096),
     OPT_FLOAT("contrast_recovery", "HDR contrast recovery strength", color_map_params.contrast_recovery, .max = 2.0),
     OPT_FLOAT("contrast_smoothness", "HDR contrast recovery smoothness", color_map_params.contrast_smoothness, .min = 1.0, .max = 32.0),
+    OPT_BOOL("async_luts", "Generate color mapping LUTs asynchronously", color_map_params.async_luts),
+    OPT_BOOL("gpu_luts", "Generate the gamut mapping LUT on the GPU", color_map_params.gpu_luts),
     OPT_BOOL("force_tone_mapping_lut", "Force tone mapping LUT", color_map_params.force_tone_mapping_lut),
     OPT_BOOL("visualize_lut", "Visualize tone mapping LUTs", color_map_params.visualize_lut),
     OPT_FLOAT("visualize_lut_x0", "Visualization rect x0", color_map_params.visualize_rect.x0),
@@ -37,6 +37,9 @@ int pl_mutex_destroy(pl_mutex *mutex);
 int pl_mutex_lock(pl_mutex *mutex);
 int pl_mutex_unlock(pl_mutex *mutex);
 
+// Returns 0 if the lock was acquired, nonzero if it was held by another thread
+int pl_mutex_trylock(pl_mutex *mutex);
+
 typedef void pl_cond;
 int pl_cond_init(pl_cond *cond);
 int pl_cond_destroy(pl_cond *cond);
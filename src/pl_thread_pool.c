@@ -0,0 +1,328 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+
+#include "common.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
+
+#ifdef PL_HAVE_WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Upper limit on the number of worker threads per pool
+#define MAX_THREADS 64
+
+// Idle worker threads exit after this long (in nanoseconds)
+#define IDLE_TIMEOUT UINT64_C(2000000000)
+
+// Number of chunks to split work into, per thread, for load balancing
+#define CHUNKS_PER_THREAD 4
+
+struct job {
+    struct job *next_job;   // next job in the queue
+    pl_parallel_fn fn;
+    void *priv;
+    int count;
+    int chunk_size;
+    int num_chunks;
+    int next;               // next chunk to claim
+    int done;               // number of completed chunks
+};
+
+struct pl_thread_job_t {
+    pl_thread_pool pool;    // NULL if the job already ran synchronously
+    struct job job;
+};
+
+struct worker {
+    struct pl_thread_pool_t *pool;
+    pl_thread thread;
+    bool running;           // `thread` is valid and must be joined
+    bool exited;            // thread has exited (but not yet been joined)
+};
+
+struct pl_thread_pool_t {
+    pl_mutex lock;
+    pl_cond wakeup;         // signalled when new work is available
+    pl_cond done;           // broadcast whenever a job completes
+    struct job *jobs;       // jobs with unclaimed chunks, oldest first
+    int num_workers;        // maximum number of worker threads
+    int num_threads;        // currently live worker threads
+    int num_idle;           // worker threads waiting for work
+    bool exit;
+    struct worker workers[MAX_THREADS];
+};
+
+static int num_cpus(void)
+{
+#ifdef PL_HAVE_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return num > 0 ? num : 1;
+#else
+    return 1;
+#endif
+}
+
+pl_thread_pool pl_thread_pool_create(int num_threads)
+{
+    struct pl_thread_pool_t *pool = pl_zalloc_ptr(NULL, pool);
+    if (!num_threads) {
+        // The calling thread also does work, but keep at least one worker
+        // around for `pl_thread_pool_submit`
+        num_threads = PL_MAX(num_cpus() - 1, 1);
+    }
+    pool->num_workers = PL_CLAMP(num_threads, 0, MAX_THREADS);
+    for (int i = 0; i < MAX_THREADS; i++)
+        pool->workers[i].pool = pool;
+
+    pl_mutex_init(&pool->lock);
+    int ret = pl_cond_init(&pool->wakeup);
+    if (ret != 0)
+        goto error_wakeup;
+    ret = pl_cond_init(&pool->done);
+    if (ret != 0)
+        goto error_done;
+
+    return pool;
+
+error_done:
+    pl_cond_destroy(&pool->wakeup);
+error_wakeup:
+    pl_mutex_destroy(&pool->lock);
+    pl_free(pool);
+    return NULL;
+}
+
+void pl_thread_pool_destroy(pl_thread_pool *ptr)
+{
+    pl_thread_pool pool = *ptr;
+    if (!pool)
+        return;
+
+    pl_mutex_lock(&pool->lock);
+    pl_assert(!pool->jobs);
+    pool->exit = true;
+    pl_cond_broadcast(&pool->wakeup);
+    pl_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (pool->workers[i].running)
+            pl_thread_join(pool->workers[i].thread);
+    }
+
+    pl_cond_destroy(&pool->done);
+    pl_cond_destroy(&pool->wakeup);
+    pl_mutex_destroy(&pool->lock);
+    pl_free_ptr((void **) ptr);
+}
+
+int pl_thread_pool_size(pl_thread_pool pool)
+{
+    return pool ? pool->num_workers + 1 : 1;
+}
+
+static pl_static_mutex global_lock = PL_STATIC_MUTEX_INITIALIZER;
+static pl_thread_pool global_pool;
+
+pl_thread_pool pl_thread_pool_get(void)
+{
+    pl_static_mutex_lock(&global_lock);
+    if (!global_pool)
+        global_pool = pl_thread_pool_create(0);
+    pl_thread_pool pool = global_pool;
+    pl_static_mutex_unlock(&global_lock);
+    return pool;
+}
+
+// Claims and runs a single chunk of `job`. Must be called with the lock held,
+// and only while `job` still has unclaimed chunks.
+static void run_chunk(pl_thread_pool pool, struct job *job)
+{
+    pl_assert(job->next < job->num_chunks);
+    const int idx = job->next++;
+    if (job->next == job->num_chunks) {
+        // Fully claimed, remove it from the queue
+        struct job **link = &pool->jobs;
+        while (*link != job)
+            link = &(*link)->next_job;
+        *link = job->next_job;
+    }
+
+    const int start = idx * job->chunk_size;
+    const int end = PL_MIN(start + job->chunk_size, job->count);
+    pl_mutex_unlock(&pool->lock);
+    job->fn(job->priv, start, end);
+    pl_mutex_lock(&pool->lock);
+
+    if (++job->done == job->num_chunks)
+        pl_cond_broadcast(&pool->done);
+}
+
+static PL_THREAD_VOID worker_thread(void *arg)
+{
+    struct worker *worker = arg;
+    pl_thread_pool pool = worker->pool;
+
+    pl_mutex_lock(&pool->lock);
+    while (!pool->exit) {
+        if (pool->jobs) {
+            run_chunk(pool, pool->jobs);
+            continue;
+        }
+
+        pool->num_idle++;
+        int ret = pl_cond_timedwait(&pool->wakeup, &pool->lock, IDLE_TIMEOUT);
+        pool->num_idle--;
+        if (ret == ETIMEDOUT && !pool->jobs)
+            break;
+    }
+
+    pool->num_threads--;
+    worker->exited = true;
+    pl_mutex_unlock(&pool->lock);
+    PL_THREAD_RETURN();
+}
+
+// Make sure up to `num` worker threads are available to pick up work. Must be
+// called with the lock held.
+static void spawn_workers(pl_thread_pool pool, int num)
+{
+    num = PL_MIN(num, pool->num_workers) - pool->num_idle;
+    for (int i = 0; i < MAX_THREADS && num > 0; i++) {
+        if (pool->num_threads == pool->num_workers)
+            return;
+
+        struct worker *worker = &pool->workers[i];
+        if (worker->running && !worker->exited)
+            continue;
+        if (worker->running) {
+            // Thread has already exited, so this will not block
+            pl_thread_join(worker->thread);
+            worker->running = false;
+        }
+
+        if (pl_thread_create(&worker->thread, worker_thread, worker) != 0)
+            return; // the calling thread will just pick up the slack
+
+        worker->running = true;
+        worker->exited = false;
+        pool->num_threads++;
+        num--;
+    }
+}
+
+// Appends `job` to the queue, waking up to `num_threads` workers for it. Must
+// be called with the lock held.
+static void push_job(pl_thread_pool pool, struct job *job, int num_threads)
+{
+    struct job **link = &pool->jobs;
+    while (*link)
+        link = &(*link)->next_job;
+    *link = job;
+
+    spawn_workers(pool, num_threads);
+    pl_cond_broadcast(&pool->wakeup);
+}
+
+// Helps out with any unclaimed chunks of `job`, then waits for the remaining
+// chunks to complete. Must be called with the lock held.
+static void finish_job(pl_thread_pool pool, struct job *job)
+{
+    while (job->next < job->num_chunks)
+        run_chunk(pool, job);
+    while (job->done < job->num_chunks)
+        pl_cond_wait(&pool->done, &pool->lock);
+}
+
+void pl_parallel_for(pl_thread_pool pool, int count, int min_chunk,
+                     pl_parallel_fn fn, void *priv)
+{
+    if (count <= 0)
+        return;
+
+    pool = PL_DEF(pool, pl_thread_pool_get());
+    const int max_chunks = pl_thread_pool_size(pool) * CHUNKS_PER_THREAD;
+    int num_chunks = PL_MIN(PL_DIV_UP(count, PL_MAX(min_chunk, 1)), max_chunks);
+    if (num_chunks <= 1 || !pool || !pool->num_workers) {
+        fn(priv, 0, count);
+        return;
+    }
+
+    const int chunk_size = PL_DIV_UP(count, num_chunks);
+    num_chunks = PL_DIV_UP(count, chunk_size);
+    struct job job = {
+        .fn         = fn,
+        .priv       = priv,
+        .count      = count,
+        .chunk_size = chunk_size,
+        .num_chunks = num_chunks,
+    };
+
+    pl_mutex_lock(&pool->lock);
+    push_job(pool, &job, num_chunks - 1);
+    finish_job(pool, &job);
+    pl_mutex_unlock(&pool->lock);
+}
+
+pl_thread_job pl_thread_pool_submit(pl_thread_pool pool, pl_parallel_fn fn,
+                                    void *priv)
+{
+    struct pl_thread_job_t *job = pl_zalloc_ptr(NULL, job);
+    job->job = (struct job) {
+        .fn         = fn,
+        .priv       = priv,
+        .count      = 1,
+        .chunk_size = 1,
+        .num_chunks = 1,
+    };
+
+    pool = PL_DEF(pool, pl_thread_pool_get());
+    if (!pool || !pool->num_workers) {
+        fn(priv, 0, 1);
+        return job;
+    }
+
+    job->pool = pool;
+    pl_mutex_lock(&pool->lock);
+    push_job(pool, &job->job, 1);
+    pl_mutex_unlock(&pool->lock);
+    return job;
+}
+
+void pl_thread_job_wait(pl_thread_job *ptr)
+{
+    struct pl_thread_job_t *job = *ptr;
+    if (!job)
+        return;
+
+    pl_thread_pool pool = job->pool;
+    if (pool) {
+        pl_mutex_lock(&pool->lock);
+        finish_job(pool, &job->job);
+        pl_mutex_unlock(&pool->lock);
+    }
+
+    pl_free_ptr((void **) ptr);
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+
+// Simple pool of worker threads for data-parallel CPU work (e.g. LUT
+// generation). Worker threads are spawned lazily, on demand, and exit again
+// after being idle for a while, so an unused pool costs nothing.
+//
+// Thread-safety: Safe
+typedef struct pl_thread_pool_t *pl_thread_pool;
+
+// Create a new thread pool with up to `num_threads` worker threads. If this
+// is 0, the number of worker threads is derived from the number of CPUs (but
+// is at least 1). A pool without any worker threads just runs all work on the
+// calling thread.
+// Returns NULL on failure.
+pl_thread_pool pl_thread_pool_create(int num_threads);
+
+// Destroys a thread pool, waiting for all worker threads to exit. The pool
+// must not be in use by any other thread.
+void pl_thread_pool_destroy(pl_thread_pool *pool);
+
+// Returns the number of threads (including the calling thread) which
+// `pl_parallel_for` may distribute work over.
+int pl_thread_pool_size(pl_thread_pool pool);
+
+// Returns a process-wide shared thread pool, created on first use. This
+// may return NULL if creating the pool failed.
+pl_thread_pool pl_thread_pool_get(void);
+
+typedef void (*pl_parallel_fn)(void *priv, int start, int end);
+
+// Calls `fn(priv, start, end)` over disjoint sub-ranges covering [0, count),
+// each (except the last) spanning at least `min_chunk` items, distributed
+// over the worker threads of `pool` as well as the calling thread. Returns
+// once all sub-ranges have been processed. `pool` may be NULL, which uses
+// the shared pool from `pl_thread_pool_get`.
+//
+// Note: If the work is too small to split, or no worker threads are
+// available, `fn` is simply called directly on the full range.
+void pl_parallel_for(pl_thread_pool pool, int count, int min_chunk,
+                     pl_parallel_fn fn, void *priv);
+
+// Handle to a job submitted using `pl_thread_pool_submit`
+typedef struct pl_thread_job_t *pl_thread_job;
+
+// Calls `fn(priv, 0, 1)` asynchronously on a worker thread of `pool` (or the
+// shared pool, if NULL). The returned job must eventually be passed to
+// `pl_thread_job_wait`. If no worker threads are available, `fn` is instead
+// called directly, before returning.
+pl_thread_job pl_thread_pool_submit(pl_thread_pool pool, pl_parallel_fn fn,
+                                    void *priv);
+
+// Waits for `job` to complete and frees it. If no worker thread has picked up
+// the job yet, it is run on the calling thread instead.
+void pl_thread_job_wait(pl_thread_job *job);
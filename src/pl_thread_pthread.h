@@ -65,6 +65,7 @@ static inline int pl_mutex_init_type_internal(pl_mutex *mutex, enum pl_mutex_typ
 #define pl_mutex_destroy    pthread_mutex_destroy
 #define pl_mutex_lock       pthread_mutex_lock
 #define pl_mutex_unlock     pthread_mutex_unlock
+#define pl_mutex_trylock    pthread_mutex_trylock
 
 static inline int pl_cond_init(pl_cond *cond)
 {
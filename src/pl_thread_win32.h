@@ -54,6 +54,11 @@ static inline int pl_mutex_unlock(pl_mutex *mutex)
     return 0;
 }
 
+static inline int pl_mutex_trylock(pl_mutex *mutex)
+{
+    return TryEnterCriticalSection(mutex) ? 0 : EBUSY;
+}
+
 static inline int pl_cond_init(pl_cond *cond)
 {
     InitializeConditionVariable(cond);
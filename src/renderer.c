@@ -34,8 +34,21 @@ struct cached_frame {
     pl_tex tex;
     int comps;
     bool evict; // for garbage collection
+    bool degraded; // rendered using the `async_compile` fallback params
+    bool incomplete; // dispatches were discarded while rendering it
 };
 
+// Intermediate texture, pooled across frames
+struct fbo {
+    pl_tex tex;
+    uint64_t last_used; // value of `pl_renderer_t.fbo_frame` when last used
+};
+
+static inline size_t fbo_size(pl_tex tex)
+{
+    return (size_t) tex->params.w * tex->params.h * tex->params.format->texel_size;
+}
+
 struct sampler {
     pl_shader_obj upscaler_state;
     pl_shader_obj downscaler_state;
@@ -45,6 +58,16 @@ struct osd_vertex {
     float pos[2];
     float coord[2];
     float color[4];
+    float slot; // only used when drawing from a texture table
+    float rect[4]; // only used when drawing from an atlas
+};
+
+struct osd_entry {
+    struct pl_overlay ol;
+    pl_transform2x2 tf;
+    int x, y; // offset inside the atlas
+    int slot; // index inside the texture table
+    bool blit; // first use of `ol.tex` within the batch
 };
 
 struct icc_state {
@@ -69,7 +92,9 @@ struct pl_renderer_t {
     pl_shader_obj grain_state[4];
     pl_shader_obj lut_state[3];
     pl_shader_obj icc_state[2];
-    PL_ARRAY(pl_tex) fbos;
+    PL_ARRAY(struct fbo) fbos;
+    uint64_t fbo_frame; // incremented for every rendering pass
+    struct pl_renderer_fbo_stats fbo_stats;
     struct sampler sampler_main;
     struct sampler sampler_contrast;
     struct sampler samplers_src[4];
@@ -78,7 +103,12 @@ struct pl_renderer_t {
     // Temporary storage for vertex/index data
     PL_ARRAY(struct osd_vertex) osd_vertices;
     PL_ARRAY(uint16_t) osd_indices;
-    struct pl_vertex_attrib osd_attribs[3];
+    struct pl_vertex_attrib osd_attribs[5];
+
+    // Overlay batching state, see `draw_overlays`
+    PL_ARRAY(struct osd_entry) osd_batch;
+    PL_ARRAY(pl_tex) osd_atlases;
+    struct pl_renderer_overlay_stats osd_stats;
 
     // Frame cache (for frame mixing / interpolation)
     PL_ARRAY(struct cached_frame) frames;
@@ -87,6 +117,12 @@ struct pl_renderer_t {
     // For debugging / logging purposes
     int prev_dither;
 
+    // `async_compile` state: `async_pending` is set once a frame rendered
+    // with the full params ran into passes that were still compiling, and
+    // `degraded` while rendering a frame with the fallback params instead
+    bool async_pending;
+    bool degraded;
+
     // For backwards compatibility
     struct icc_state icc_fallback[2];
 };
@@ -124,6 +160,14 @@ pl_renderer pl_renderer_create(pl_log log, pl_gpu gpu)
                 .name = "osd_color",
                 .offset = offsetof(struct osd_vertex, color),
                 .fmt = pl_find_vertex_fmt(gpu, PL_FMT_FLOAT, 4),
+            }, {
+                .name = "osd_slot",
+                .offset = offsetof(struct osd_vertex, slot),
+                .fmt = pl_find_vertex_fmt(gpu, PL_FMT_FLOAT, 1),
+            }, {
+                .name = "osd_rect",
+                .offset = offsetof(struct osd_vertex, rect),
+                .fmt = pl_find_vertex_fmt(gpu, PL_FMT_FLOAT, 4),
             }
         },
     };
@@ -146,11 +190,13 @@ void pl_renderer_destroy(pl_renderer *p_rr)
 
     // Free all intermediate FBOs
     for (int i = 0; i < rr->fbos.num; i++)
-        pl_tex_destroy(rr->gpu, &rr->fbos.elem[i]);
+        pl_tex_destroy(rr->gpu, &rr->fbos.elem[i].tex);
     for (int i = 0; i < rr->frames.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frames.elem[i].tex);
     for (int i = 0; i < rr->frame_fbos.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frame_fbos.elem[i]);
+    for (int i = 0; i < rr->osd_atlases.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->osd_atlases.elem[i]);
 
     // Free all shader resource objects
     pl_shader_obj_destroy(&rr->tone_map_state);
@@ -188,12 +234,41 @@ void pl_renderer_load(pl_renderer rr, const uint8_t *cache)
     pl_cache_load(pl_gpu_cache(rr->gpu), cache, SIZE_MAX);
 }
 
+struct pl_renderer_fbo_stats pl_renderer_get_fbo_stats(pl_renderer rr)
+{
+    struct pl_renderer_fbo_stats stats = rr->fbo_stats;
+    for (int i = 0; i < rr->fbos.num; i++) {
+        pl_tex tex = rr->fbos.elem[i].tex;
+        if (!tex)
+            continue;
+        stats.num_fbos++;
+        stats.vram_bytes += fbo_size(tex);
+    }
+
+    return stats;
+}
+
+struct pl_renderer_overlay_stats pl_renderer_get_overlay_stats(pl_renderer rr)
+{
+    struct pl_renderer_overlay_stats stats = rr->osd_stats;
+    for (int i = 0; i < rr->osd_atlases.num; i++) {
+        stats.num_atlases++;
+        stats.atlas_bytes += fbo_size(rr->osd_atlases.elem[i]);
+    }
+
+    return stats;
+}
+
 void pl_renderer_flush_cache(pl_renderer rr)
 {
     for (int i = 0; i < rr->frames.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frames.elem[i].tex);
     rr->frames.num = 0;
 
+    for (int i = 0; i < rr->osd_atlases.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->osd_atlases.elem[i]);
+    rr->osd_atlases.num = 0;
+
     pl_reset_detected_peak(rr->tone_map_state);
 }
 
@@ -366,7 +441,7 @@ struct pass_state {
 
     // Metadata for `rr->fbos`
     pl_fmt fbofmt[5];
-    bool *fbos_used;
+    uint8_t *fbo_state; // enum fbo_state
     bool need_peak_fbo; // need indirection for peak detection
 
     // Map of acquired frames
@@ -440,8 +515,40 @@ static void info_callback(void *priv, const struct pl_dispatch_info *dinfo)
     pass->info.index++;
 }
 
+// Textures idle for this many rendering passes are released
+#define FBO_MAX_AGE 16
+
+// Lifetime of each texture in `rr->fbos` during the current pass. Textures
+// are released as soon as the shader consuming their contents has been
+// dispatched, which allows later intermediates of the same size to alias
+// onto the same texture instead of requiring separate allocations.
+enum fbo_state {
+    FBO_UNUSED = 0, // not used so far during this pass
+    FBO_LIVE,       // holds an intermediate result
+    FBO_CONSUMED,   // sampled by the shader currently being dispatched
+    FBO_RELEASED,   // contents no longer needed, may be aliased
+    FBO_PINNED,     // exposed to user hooks, live until the end of the pass
+};
+
+static inline int fbo_size_class(int size)
+{
+    return size > 1 ? PL_LOG2(size - 1) + 1 : 0;
+}
+
+// Rounds up the size of a padded texture. Each octave is split into 8 steps
+// of at least 16 texels, so at most 1/8 of each dimension is wasted
+static inline int fbo_padded_size(int size)
+{
+    const int step = 1 << PL_MAX((int) PL_LOG2(size) - 3, 4);
+    return PL_ALIGN2(size, step);
+}
+
+// If `padded` is true, the returned texture may be bigger than requested, in
+// which case the caller must only ever access the top left `w` x `h` texels.
+// This allows textures to be reused as-is even when the size of their
+// contents changes slightly, e.g. on every frame during animated zooming.
 static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
-                      int comps, pl_debug_tag debug_tag)
+                      int comps, bool padded, pl_debug_tag debug_tag)
 {
     pl_renderer rr = pass->rr;
     comps = PL_DEF(comps, 4);
@@ -449,9 +556,20 @@ static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
     if (!fmt)
         return NULL;
 
+    // Accept existing textures up to one size class bigger than needed, to
+    // avoid reallocating them back and forth near the class boundaries
+    const int max_dim = PL_MIN(rr->gpu->limits.max_tex_2d_dim, (uint32_t) INT_MAX);
+    int alloc_w = w, alloc_h = h, max_w = w, max_h = h;
+    if (padded) {
+        alloc_w = PL_MAX(w, PL_MIN(fbo_padded_size(w), max_dim));
+        alloc_h = PL_MAX(h, PL_MIN(fbo_padded_size(h), max_dim));
+        max_w = PL_MAX(w, PL_MIN(fbo_padded_size(fbo_padded_size(w) + 1), max_dim));
+        max_h = PL_MAX(h, PL_MIN(fbo_padded_size(fbo_padded_size(h) + 1), max_dim));
+    }
+
     struct pl_tex_params params = {
-        .w          = w,
-        .h          = h,
+        .w          = alloc_w,
+        .h          = alloc_h,
         .format     = fmt,
         .sampleable = true,
         .renderable = true,
@@ -460,18 +578,29 @@ static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
         .debug_tag  = debug_tag,
     };
 
-    int best_idx = -1;
-    int best_diff = 0;
-
-    // Find the best-fitting texture out of rr->fbos
+    // Find a free texture of the right format, preferring a texture of
+    // acceptable size that was already released earlier during this pass,
+    // followed by any other such texture, followed by the nearest size class
+    // (which is thus likely to be a texture that was used for the same
+    // purpose during a previous frame). Released textures are only reused
+    // as-is, since resizing them would cause reallocations on every frame.
+    int best_idx = -1, best_diff = 0;
     for (int i = 0; i < rr->fbos.num; i++) {
-        if (pass->fbos_used[i])
+        const struct fbo *fbo = &rr->fbos.elem[i];
+        const enum fbo_state state = pass->fbo_state[i];
+        if (state != FBO_UNUSED && state != FBO_RELEASED)
+            continue;
+        if (!fbo->tex || fbo->tex->params.format != fmt)
             continue;
 
-        // Orthogonal distance, with penalty for format mismatches
-        int diff = abs(rr->fbos.elem[i]->params.w - w) +
-                   abs(rr->fbos.elem[i]->params.h - h) +
-                   ((rr->fbos.elem[i]->params.format != fmt) ? 1000 : 0);
+        const int fw = fbo->tex->params.w, fh = fbo->tex->params.h;
+        int diff = state == FBO_RELEASED ? 0 : 1;
+        if (fw < w || fw > max_w || fh < h || fh > max_h) {
+            if (state == FBO_RELEASED)
+                continue;
+            diff = 2 + abs(fbo_size_class(fw) - fbo_size_class(w)) +
+                       abs(fbo_size_class(fh) - fbo_size_class(h));
+        }
 
         if (best_idx < 0 || diff < best_diff) {
             best_idx = i;
@@ -479,23 +608,86 @@ static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
         }
     }
 
-    // No texture found at all, add a new one
+    // Nothing of the right format left, add a new texture
     if (best_idx < 0) {
         best_idx = rr->fbos.num;
-        PL_ARRAY_APPEND(rr, rr->fbos, NULL);
-        pl_grow(pass->tmp, &pass->fbos_used, rr->fbos.num * sizeof(bool));
-        pass->fbos_used[best_idx] = false;
+        PL_ARRAY_APPEND(rr, rr->fbos, (struct fbo) {0});
+        pl_grow(pass->tmp, &pass->fbo_state, rr->fbos.num);
+        pass->fbo_state[best_idx] = FBO_UNUSED;
     }
 
-    if (!pl_tex_recreate(rr->gpu, &rr->fbos.elem[best_idx], &params))
+    struct fbo *fbo = &rr->fbos.elem[best_idx];
+    if (fbo->tex && best_diff <= 1) {
+        params.w = fbo->tex->params.w;
+        params.h = fbo->tex->params.h;
+        rr->fbo_stats.hits++;
+    } else {
+        rr->fbo_stats.misses++;
+    }
+
+    if (!pl_tex_recreate(rr->gpu, &fbo->tex, &params))
         return NULL;
 
-    pass->fbos_used[best_idx] = true;
-    return rr->fbos.elem[best_idx];
+    const size_t size = fbo_size(fbo->tex);
+    if (pass->fbo_state[best_idx] == FBO_UNUSED)
+        rr->fbo_stats.frame_bytes += size;
+    rr->fbo_stats.unaliased_bytes += size;
+
+    pass->fbo_state[best_idx] = FBO_LIVE;
+    fbo->last_used = rr->fbo_frame;
+    return fbo->tex;
+}
+
+// Marks all live textures as pinned for the rest of the pass
+static void pin_fbos(struct pass_state *pass)
+{
+    for (int i = 0; i < pass->rr->fbos.num; i++) {
+        if (pass->fbo_state[i] == FBO_LIVE)
+            pass->fbo_state[i] = FBO_PINNED;
+    }
+}
+
+// Marks the live textures sampled by `sh` as consumed
+static void consume_fbos(struct pass_state *pass, const pl_shader sh)
+{
+    pl_renderer rr = pass->rr;
+    for (int n = 0; n < sh->descs.num; n++) {
+        const struct pl_shader_desc *sd = &sh->descs.elem[n];
+        if (sd->desc.type != PL_DESC_SAMPLED_TEX)
+            continue;
+
+        for (int j = 0; j < pl_desc_elems(&sd->desc); j++) {
+            pl_tex tex = pl_desc_tex(&sd->desc, &sd->binding, j);
+            for (int i = 0; i < rr->fbos.num; i++) {
+                if (rr->fbos.elem[i].tex != tex)
+                    continue;
+                if (pass->fbo_state[i] == FBO_LIVE && tex != pass->img.tex)
+                    pass->fbo_state[i] = FBO_CONSUMED;
+            }
+        }
+    }
+}
+
+// Releases (or restores) all consumed textures after dispatching
+static void release_fbos(struct pass_state *pass, bool ok)
+{
+    for (int i = 0; i < pass->rr->fbos.num; i++) {
+        if (pass->fbo_state[i] == FBO_CONSUMED)
+            pass->fbo_state[i] = ok ? FBO_RELEASED : FBO_LIVE;
+    }
+}
+
+// Region of `img->tex` holding the contents of `img`
+static inline pl_rect2d img_bounds(const struct img *img)
+{
+    return (pl_rect2d) { .x1 = img->w, .y1 = img->h };
 }
 
-// Forcibly convert an img to `tex`, dispatching where necessary
-static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag tag)
+// Forcibly convert an img to `tex`, dispatching where necessary. If `padded`
+// is true, the texture may be bigger than `img` (see `get_fbo`), so it must be
+// sampled using `img_bounds`.
+static pl_tex _img_tex(struct pass_state *pass, struct img *img, bool padded,
+                       pl_debug_tag tag)
 {
     if (img->tex) {
         pl_assert(!img->sh);
@@ -503,7 +695,7 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
     }
 
     pl_renderer rr = pass->rr;
-    pl_tex tex = get_fbo(pass, img->w, img->h, img->fmt, img->comps, tag);
+    pl_tex tex = get_fbo(pass, img->w, img->h, img->fmt, img->comps, padded, tag);
     img->fmt = NULL;
 
     if (!tex) {
@@ -515,11 +707,17 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
     }
 
     pl_assert(img->sh);
+    consume_fbos(pass, img->sh);
     bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
         .shader = &img->sh,
         .target = tex,
+        .rect   = img_bounds(img),
     ));
 
+    // Discarded dispatches (see `async_compile`) never wrote their output,
+    // so keep the inputs around as well
+    release_fbos(pass, ok && !pl_dispatch_pending(rr->dp));
+
     const char *err_msg = img->err_msg;
     enum pl_render_error err_enum = img->err_enum;
     pl_tex err_tex = img->err_tex;
@@ -539,7 +737,8 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
     return img->tex;
 }
 
-#define img_tex(pass, img) _img_tex(pass, img, PL_DEBUG_TAG)
+#define img_tex(pass, img) _img_tex(pass, img, false, PL_DEBUG_TAG)
+#define img_tex_padded(pass, img) _img_tex(pass, img, true, PL_DEBUG_TAG)
 
 // Forcibly convert an img to `sh`, sampling where necessary
 static pl_shader img_sh(struct pass_state *pass, struct img *img)
@@ -738,10 +937,16 @@ static void dispatch_sampler(struct pass_state *pass, pl_shader sh,
         ok = pl_shader_sample_polar(sh, src, &fparams);
     } else if (info.dir_sep[0] && info.dir_sep[1]) {
         // Scaling is needed in both directions
+        pl_rect2d bounds = src->bounds;
+        if (!pl_rect_w(bounds) || !pl_rect_h(bounds))
+            bounds = (pl_rect2d) { .x1 = src->tex->params.w, .y1 = src->tex->params.h };
+
         struct pl_sample_src src1 = *src, src2 = *src;
-        src1.new_w = src->tex->params.w;
-        src1.rect.x0 = 0;
-        src1.rect.x1 = src1.new_w;;
+        src1.new_w = pl_rect_w(bounds);
+        src1.rect.x0 = bounds.x0;
+        src1.rect.x1 = bounds.x1;
+        src2.rect.x0 -= bounds.x0;
+        src2.rect.x1 -= bounds.x0;
         src2.rect.y0 = 0;
         src2.rect.y1 = src1.new_h;
 
@@ -759,7 +964,8 @@ static void dispatch_sampler(struct pass_state *pass, pl_shader sh,
             .comps = src->components,
         };
 
-        src2.tex = img_tex(pass, &img);
+        src2.tex = img_tex_padded(pass, &img);
+        src2.bounds = img_bounds(&img);
         src2.scale = 1.0;
         ok = src2.tex && pl_shader_sample_ortho2(sh, &src2, &fparams);
     } else {
@@ -800,111 +1006,178 @@ static void swizzle_color(pl_shader sh, int comps, const int comp_map[4],
         GLSL("color.a = "$".a; \n", orig);
 }
 
-// `scale` adapts from `pass->dst_rect` to the plane being rendered to
-static void draw_overlays(struct pass_state *pass, pl_tex fbo,
-                          int comps, const int comp_map[4],
-                          const struct pl_overlay *overlays, int num,
-                          struct pl_color_space color, struct pl_color_repr repr,
-                          const pl_transform2x2 *output_shift)
+// Overlays which are compatible with each other are copied into a shared
+// atlas texture (one per texture format), and drawn using a single draw call.
+// Textures larger than half of this are always drawn on their own.
+#define OSD_ATLAS_MAX 4096
+
+static bool osd_batchable(const struct pl_overlay *ol, int max_dim)
 {
-    pl_renderer rr = pass->rr;
-    if (num <= 0 || (rr->errors & PL_RENDER_ERR_OVERLAY))
-        return;
+    const struct pl_tex_params *params = &ol->tex->params;
+    return params->blit_src && params->h && !params->d &&
+           (params->format->caps & PL_FMT_CAP_BLITTABLE) &&
+           params->w <= max_dim / 2 && params->h <= max_dim / 2;
+}
 
-    enum pl_fmt_caps caps = fbo->params.format->caps;
-    if (!(rr->errors & PL_RENDER_ERR_BLENDING) &&
-        !(caps & PL_FMT_CAP_BLENDABLE))
-    {
-        PL_WARN(rr, "Trying to draw an overlay to a non-blendable target. "
-                "Alpha blending is disabled, results may be incorrect!");
-        rr->errors |= PL_RENDER_ERR_BLENDING;
+// When the GPU supports arrays of textures, overlays are instead sampled
+// directly from their own textures, which are bound as a table of this many
+// elements. This avoids the copies into the atlas, and keeps the shader the
+// same regardless of the number of textures drawn.
+#define OSD_TABLE_SIZE 8
+
+static bool osd_use_table(pl_renderer rr, const struct pl_overlay *ol)
+{
+    const enum pl_fmt_type type = ol->tex->params.format->type;
+    return rr->gpu->limits.max_tex_array >= OSD_TABLE_SIZE &&
+           pl_tex_params_dimension(ol->tex->params) == 2 &&
+           ol->tex->sampler_type == PL_SAMPLER_NORMAL &&
+           type != PL_FMT_UINT && type != PL_FMT_SINT;
+}
+
+static bool osd_compatible(const struct pl_overlay *a, const struct pl_overlay *b)
+{
+    return a->mode == b->mode &&
+           a->tex->params.format == b->tex->params.format &&
+           pl_color_repr_equal(&a->repr, &b->repr) &&
+           pl_color_space_equal(&a->color, &b->color);
+}
+
+static pl_tex osd_get_atlas(pl_renderer rr, pl_fmt fmt, int w, int h)
+{
+    int idx = 0;
+    while (idx < rr->osd_atlases.num && rr->osd_atlases.elem[idx]->params.format != fmt)
+        idx++;
+
+    if (idx == rr->osd_atlases.num) {
+        PL_ARRAY_APPEND(rr, rr->osd_atlases, NULL);
+    } else {
+        // Only ever grow the atlas, to avoid re-creating it every frame
+        w = PL_MAX(w, rr->osd_atlases.elem[idx]->params.w);
+        h = PL_MAX(h, rr->osd_atlases.elem[idx]->params.h);
     }
 
-    const struct pl_frame *image = pass->src_ref >= 0 ? &pass->image : NULL;
-    pl_transform2x2 src_to_dst;
-    if (image) {
-        float rx = pl_rect_w(pass->dst_rect) / pl_rect_w(image->crop);
-        float ry = pl_rect_h(pass->dst_rect) / pl_rect_h(image->crop);
-        src_to_dst = (pl_transform2x2) {
-            .mat.m = {{ rx, 0 }, { 0, ry }},
-            .c = {
-                pass->dst_rect.x0 - rx * image->crop.x0,
-                pass->dst_rect.y0 - ry * image->crop.y0,
-            },
-        };
+    pl_tex *atlas = &rr->osd_atlases.elem[idx];
+    bool ok = pl_tex_recreate(rr->gpu, atlas, pl_tex_params(
+        .w = w,
+        .h = h,
+        .format = fmt,
+        .sampleable = true,
+        .blit_dst = true,
+        .debug_tag = PL_DEBUG_TAG,
+    ));
 
-        if (pass->rotation % PL_ROTATION_180 == PL_ROTATION_90) {
-            PL_SWAP(src_to_dst.c[0], src_to_dst.c[1]);
-            src_to_dst.mat = (pl_matrix2x2) {{{ 0, ry }, { rx, 0 }}};
-        }
+    if (!ok) {
+        pl_tex_destroy(rr->gpu, atlas);
+        PL_ARRAY_REMOVE_AT(rr->osd_atlases, idx);
+        return NULL;
     }
 
-    const struct pl_frame *target = &pass->target;
-    pl_rect2df dst_crop = target->crop;
-    pl_rect2df_rotate(&dst_crop, -pass->rotation);
-    pl_rect2df_normalize(&dst_crop);
+    return *atlas;
+}
 
-    for (int n = 0; n < num; n++) {
-        struct pl_overlay ol = overlays[n];
-        if (!ol.num_parts)
-            continue;
+// Draws a batch of mutually compatible overlays
+static bool draw_overlay_batch(struct pass_state *pass, pl_tex fbo,
+                               int comps, const int comp_map[4],
+                               const struct osd_entry *entries, int num,
+                               int atlas_w, int atlas_h,
+                               struct pl_color_space color,
+                               struct pl_color_repr repr)
+{
+    pl_renderer rr = pass->rr;
+    const struct pl_frame *target = &pass->target;
+    if (!num)
+        return true;
 
-        if (!ol.coords) {
-            ol.coords = overlays == target->overlays
-                            ? PL_OVERLAY_COORDS_DST_FRAME
-                            : PL_OVERLAY_COORDS_SRC_FRAME;
+    int num_blits = 0;
+    for (int n = 0; n < num; n++)
+        num_blits += entries[n].blit;
+
+    // Overlays sharing a single texture can be drawn from it directly
+    const struct pl_overlay *first = &entries[0].ol;
+    const bool use_table = osd_use_table(rr, first);
+    pl_tex tex = first->tex, table[OSD_TABLE_SIZE];
+    int num_slots = 0;
+    if (use_table) {
+        for (int n = 0; n < num; n++) {
+            if (entries[n].blit)
+                table[num_slots++] = entries[n].ol.tex;
+        }
+    } else if (num_blits > 1) {
+        tex = osd_get_atlas(rr, first->tex->params.format, atlas_w, atlas_h);
+        if (!tex) {
+            PL_WARN(rr, "Failed creating overlay atlas, drawing overlays "
+                    "individually");
+            for (int n = 0; n < num; n++) {
+                struct osd_entry e = entries[n];
+                e.x = e.y = 0;
+                e.blit = true;
+                if (!draw_overlay_batch(pass, fbo, comps, comp_map, &e, 1,
+                                        0, 0, color, repr))
+                    return false;
+            }
+            return true;
         }
 
-        pl_transform2x2 tf = pl_transform2x2_identity;
-        switch (ol.coords) {
-            case PL_OVERLAY_COORDS_SRC_CROP:
-                if (!image)
-                    continue;
-                tf.c[0] = image->crop.x0;
-                tf.c[1] = image->crop.y0;
-                // fall through
-            case PL_OVERLAY_COORDS_SRC_FRAME:
-                if (!image)
-                    continue;
-                pl_transform2x2_rmul(&src_to_dst, &tf);
-                break;
-            case PL_OVERLAY_COORDS_DST_CROP:
-                tf.c[0] = dst_crop.x0;
-                tf.c[1] = dst_crop.y0;
-                break;
-            case PL_OVERLAY_COORDS_DST_FRAME:
-                break;
-            case PL_OVERLAY_COORDS_AUTO:
-            case PL_OVERLAY_COORDS_COUNT:
-                pl_unreachable();
+        for (int n = 0; n < num; n++) {
+            if (!entries[n].blit)
+                continue;
+            pl_tex src = entries[n].ol.tex;
+            pl_tex_blit(rr->gpu, pl_tex_blit_params(
+                .src = src,
+                .dst = tex,
+                .dst_rc = {
+                    .x0 = entries[n].x,
+                    .y0 = entries[n].y,
+                    .x1 = entries[n].x + src->params.w,
+                    .y1 = entries[n].y + src->params.h,
+                },
+            ));
         }
 
-        if (output_shift)
-            pl_transform2x2_rmul(output_shift, &tf);
+        rr->osd_stats.atlas_blits += num_blits;
+    }
+
+    // Construct vertex/index buffers
+    rr->osd_vertices.num = 0;
+    rr->osd_indices.num = 0;
+    for (int n = 0; n < num; n++) {
+        const struct osd_entry *e = &entries[n];
+        pl_tex src = e->ol.tex;
+        const pl_tex ctex = use_table ? src : tex;
+        const float tw = ctex->params.w, th = ctex->params.h;
+        const float ox = e->x, oy = e->y;
+
+        // Keeps sampling within this overlay's region of the atlas, matching
+        // the clamping behavior of sampling from the texture directly
+        const float rect[4] = {
+            (ox + 0.5f) / tw,
+            (oy + 0.5f) / th,
+            (ox + src->params.w - 0.5f) / tw,
+            (oy + src->params.h - 0.5f) / th,
+        };
 
-        // Construct vertex/index buffers
-        rr->osd_vertices.num = 0;
-        rr->osd_indices.num = 0;
-        for (int i = 0; i < ol.num_parts; i++) {
-            const struct pl_overlay_part *part = &ol.parts[i];
+        for (int i = 0; i < e->ol.num_parts; i++) {
+            const struct pl_overlay_part *part = &e->ol.parts[i];
 
 #define EMIT_VERT(x, y)                                                         \
             do {                                                                \
                 float pos[2] = { part->dst.x, part->dst.y };                    \
-                pl_transform2x2_apply(&tf, pos);                                \
+                pl_transform2x2_apply(&e->tf, pos);                             \
                 PL_ARRAY_APPEND(rr, rr->osd_vertices, (struct osd_vertex) {     \
                     .pos = {                                                    \
                         2.0 * (pos[0] / fbo->params.w) - 1.0,                   \
                         2.0 * (pos[1] / fbo->params.h) - 1.0,                   \
                     },                                                          \
                     .coord = {                                                  \
-                        part->src.x / ol.tex->params.w,                         \
-                        part->src.y / ol.tex->params.h,                         \
+                        (ox + part->src.x) / tw,                                \
+                        (oy + part->src.y) / th,                                \
                     },                                                          \
                     .color = {                                                  \
                         part->color[0], part->color[1],                         \
                         part->color[2], part->color[3],                         \
                     },                                                          \
+                    .slot = e->slot,                                            \
+                    .rect = { rect[0], rect[1], rect[2], rect[3] },             \
                 });                                                             \
             } while (0)
 
@@ -920,82 +1193,268 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
             PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
             PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 3);
         }
+    }
 
-        // Draw parts
-        pl_shader sh = pl_dispatch_begin(rr->dp);
-        ident_t tex = sh_desc(sh, (struct pl_shader_desc) {
+    // Draw parts
+    pl_shader sh = pl_dispatch_begin(rr->dp);
+    const enum pl_tex_sample_mode sample_mode =
+        (tex->params.format->caps & PL_FMT_CAP_LINEAR) ? PL_TEX_SAMPLE_LINEAR
+                                                       : PL_TEX_SAMPLE_NEAREST;
+
+    // Overlays from a table are always drawn using it, even if there is only
+    // a single texture, to avoid generating different shaders
+    const bool use_atlas = !use_table && tex != first->tex;
+    sh_describe(sh, use_table ? "overlay table" : use_atlas ? "overlay atlas" : "overlay");
+    GLSL("// overlay \n");
+    if (use_table) {
+        ident_t osd_table = sh_bind_table(sh, table, num_slots, OSD_TABLE_SIZE,
+                                          PL_TEX_ADDRESS_CLAMP, sample_mode,
+                                          "osd_table");
+        if (!osd_table) {
+            pl_dispatch_abort(rr->dp, &sh);
+            return false;
+        }
+        GLSL("vec4 osd_sample = "$"(int(osd_slot + 0.5), coord); \n", osd_table);
+    } else {
+        ident_t osd_tex = sh_desc(sh, (struct pl_shader_desc) {
             .desc = {
                 .name = "osd_tex",
                 .type = PL_DESC_SAMPLED_TEX,
             },
             .binding = {
-                .object = ol.tex,
-                .sample_mode = (ol.tex->params.format->caps & PL_FMT_CAP_LINEAR)
-                    ? PL_TEX_SAMPLE_LINEAR
-                    : PL_TEX_SAMPLE_NEAREST,
+                .object = tex,
+                .sample_mode = sample_mode,
             },
         });
 
-        sh_describe(sh, "overlay");
-        GLSL("// overlay \n");
+        if (use_atlas) {
+            GLSL("vec2 osd_coord = clamp(coord, osd_rect.xy, osd_rect.zw); \n");
+        } else {
+            GLSL("vec2 osd_coord = coord; \n");
+        }
+        GLSL("vec4 osd_sample = textureLod("$", osd_coord, 0.0); \n", osd_tex);
+    }
 
-        switch (ol.mode) {
-        case PL_OVERLAY_NORMAL:
-            GLSL("vec4 color = textureLod("$", coord, 0.0); \n", tex);
-            break;
-        case PL_OVERLAY_MONOCHROME:
-            GLSL("vec4 color = osd_color; \n");
-            break;
-        case PL_OVERLAY_MODE_COUNT:
-            pl_unreachable();
-        };
+    switch (first->mode) {
+    case PL_OVERLAY_NORMAL:
+        GLSL("vec4 color = osd_sample; \n");
+        break;
+    case PL_OVERLAY_MONOCHROME:
+        GLSL("vec4 color = osd_color; \n");
+        break;
+    case PL_OVERLAY_MODE_COUNT:
+        pl_unreachable();
+    };
 
-        static const struct pl_color_map_params osd_params = {
-            PL_COLOR_MAP_DEFAULTS
-            .tone_mapping_function = &pl_tone_map_linear,
-            .gamut_mapping         = &pl_gamut_map_saturation,
-        };
+    static const struct pl_color_map_params osd_params = {
+        PL_COLOR_MAP_DEFAULTS
+        .tone_mapping_function = &pl_tone_map_linear,
+        .gamut_mapping         = &pl_gamut_map_saturation,
+    };
 
-        sh->output = PL_SHADER_SIG_COLOR;
-        pl_shader_decode_color(sh, &ol.repr, NULL);
-        if (target->icc)
-            color.transfer = PL_COLOR_TRC_LINEAR;
-        pl_shader_color_map_ex(sh, &osd_params, pl_color_map_args(ol.color, color));
-        if (target->icc)
-            pl_icc_encode(sh, target->icc, &rr->icc_state[ICC_TARGET]);
+    struct pl_color_repr ol_repr = first->repr;
+    sh->output = PL_SHADER_SIG_COLOR;
+    pl_shader_decode_color(sh, &ol_repr, NULL);
+    if (target->icc)
+        color.transfer = PL_COLOR_TRC_LINEAR;
+    pl_shader_color_map_ex(sh, &osd_params, pl_color_map_args(first->color, color));
+    if (target->icc)
+        pl_icc_encode(sh, target->icc, &rr->icc_state[ICC_TARGET]);
+
+    bool premul = repr.alpha == PL_ALPHA_PREMULTIPLIED;
+    pl_shader_encode_color(sh, &repr);
+    if (first->mode == PL_OVERLAY_MONOCHROME) {
+        GLSL("color.%s *= osd_sample.r; \n", premul ? "rgba" : "a");
+    }
 
-        bool premul = repr.alpha == PL_ALPHA_PREMULTIPLIED;
-        pl_shader_encode_color(sh, &repr);
-        if (ol.mode == PL_OVERLAY_MONOCHROME) {
-            GLSL("color.%s *= textureLod("$", coord, 0.0).r; \n",
-                 premul ? "rgba" : "a", tex);
-        }
+    swizzle_color(sh, comps, comp_map, true);
+
+    struct pl_blend_params blend_params = {
+        .src_rgb = premul ? PL_BLEND_ONE : PL_BLEND_SRC_ALPHA,
+        .src_alpha = PL_BLEND_ONE,
+        .dst_rgb = PL_BLEND_ONE_MINUS_SRC_ALPHA,
+        .dst_alpha = PL_BLEND_ONE_MINUS_SRC_ALPHA,
+    };
+
+    // The attributes are ordered such that unneeded ones can be cut off
+    int num_attribs = first->mode == PL_OVERLAY_NORMAL ? 2 : 3;
+    if (use_table)
+        num_attribs = 4;
+    if (use_atlas)
+        num_attribs = 5;
 
-        swizzle_color(sh, comps, comp_map, true);
+    bool ok = pl_dispatch_vertex(rr->dp, pl_dispatch_vertex_params(
+        .shader = &sh,
+        .target = fbo,
+        .blend_params = (rr->errors & PL_RENDER_ERR_BLENDING)
+                        ? NULL : &blend_params,
+        .vertex_stride = sizeof(struct osd_vertex),
+        .num_vertex_attribs = num_attribs,
+        .vertex_attribs = rr->osd_attribs,
+        .vertex_position_idx = 0,
+        .vertex_coords = PL_COORDS_NORMALIZED,
+        .vertex_type = PL_PRIM_TRIANGLE_LIST,
+        .vertex_count = rr->osd_indices.num,
+        .vertex_data = rr->osd_vertices.elem,
+        .index_data = rr->osd_indices.elem,
+    ));
+
+    if (ok) {
+        rr->osd_stats.overlays += num;
+        rr->osd_stats.draws++;
+        rr->osd_stats.draws_saved += num - 1;
+    }
 
-        struct pl_blend_params blend_params = {
-            .src_rgb = premul ? PL_BLEND_ONE : PL_BLEND_SRC_ALPHA,
-            .src_alpha = PL_BLEND_ONE,
-            .dst_rgb = PL_BLEND_ONE_MINUS_SRC_ALPHA,
-            .dst_alpha = PL_BLEND_ONE_MINUS_SRC_ALPHA,
+    return ok;
+}
+
+// `scale` adapts from `pass->dst_rect` to the plane being rendered to
+static void draw_overlays(struct pass_state *pass, pl_tex fbo,
+                          int comps, const int comp_map[4],
+                          const struct pl_overlay *overlays, int num,
+                          struct pl_color_space color, struct pl_color_repr repr,
+                          const pl_transform2x2 *output_shift)
+{
+    pl_renderer rr = pass->rr;
+    if (num <= 0 || (rr->errors & PL_RENDER_ERR_OVERLAY))
+        return;
+
+    enum pl_fmt_caps caps = fbo->params.format->caps;
+    if (!(rr->errors & PL_RENDER_ERR_BLENDING) &&
+        !(caps & PL_FMT_CAP_BLENDABLE))
+    {
+        PL_WARN(rr, "Trying to draw an overlay to a non-blendable target. "
+                "Alpha blending is disabled, results may be incorrect!");
+        rr->errors |= PL_RENDER_ERR_BLENDING;
+    }
+
+    const struct pl_frame *image = pass->src_ref >= 0 ? &pass->image : NULL;
+    pl_transform2x2 src_to_dst;
+    if (image) {
+        float rx = pl_rect_w(pass->dst_rect) / pl_rect_w(image->crop);
+        float ry = pl_rect_h(pass->dst_rect) / pl_rect_h(image->crop);
+        src_to_dst = (pl_transform2x2) {
+            .mat.m = {{ rx, 0 }, { 0, ry }},
+            .c = {
+                pass->dst_rect.x0 - rx * image->crop.x0,
+                pass->dst_rect.y0 - ry * image->crop.y0,
+            },
         };
 
-        bool ok = pl_dispatch_vertex(rr->dp, pl_dispatch_vertex_params(
-            .shader = &sh,
-            .target = fbo,
-            .blend_params = (rr->errors & PL_RENDER_ERR_BLENDING)
-                            ? NULL : &blend_params,
-            .vertex_stride = sizeof(struct osd_vertex),
-            .num_vertex_attribs = ol.mode == PL_OVERLAY_NORMAL ? 2 : 3,
-            .vertex_attribs = rr->osd_attribs,
-            .vertex_position_idx = 0,
-            .vertex_coords = PL_COORDS_NORMALIZED,
-            .vertex_type = PL_PRIM_TRIANGLE_LIST,
-            .vertex_count = rr->osd_indices.num,
-            .vertex_data = rr->osd_vertices.elem,
-            .index_data = rr->osd_indices.elem,
-        ));
+        if (pass->rotation % PL_ROTATION_180 == PL_ROTATION_90) {
+            PL_SWAP(src_to_dst.c[0], src_to_dst.c[1]);
+            src_to_dst.mat = (pl_matrix2x2) {{{ 0, ry }, { rx, 0 }}};
+        }
+    }
+
+    const struct pl_frame *target = &pass->target;
+    pl_rect2df dst_crop = target->crop;
+    pl_rect2df_rotate(&dst_crop, -pass->rotation);
+    pl_rect2df_normalize(&dst_crop);
+
+    const int max_dim = PL_MIN(rr->gpu->limits.max_tex_2d_dim, OSD_ATLAS_MAX);
+    int n = 0;
+    while (n < num) {
+        // Gather consecutive compatible overlays into a batch, packing their
+        // textures into rows of the atlas (or slots of the table) as we go
+        rr->osd_batch.num = 0;
+        int atlas_w = 0, atlas_h = 0, row_x = 0, row_y = 0, num_verts = 0;
+        int num_slots = 0;
+        for (; n < num; n++) {
+            struct osd_entry e = { .ol = overlays[n] };
+            struct pl_overlay *ol = &e.ol;
+            if (!ol->num_parts)
+                continue;
+
+            if (!ol->coords) {
+                ol->coords = overlays == target->overlays
+                                ? PL_OVERLAY_COORDS_DST_FRAME
+                                : PL_OVERLAY_COORDS_SRC_FRAME;
+            }
+
+            e.tf = pl_transform2x2_identity;
+            switch (ol->coords) {
+                case PL_OVERLAY_COORDS_SRC_CROP:
+                    if (!image)
+                        continue;
+                    e.tf.c[0] = image->crop.x0;
+                    e.tf.c[1] = image->crop.y0;
+                    // fall through
+                case PL_OVERLAY_COORDS_SRC_FRAME:
+                    if (!image)
+                        continue;
+                    pl_transform2x2_rmul(&src_to_dst, &e.tf);
+                    break;
+                case PL_OVERLAY_COORDS_DST_CROP:
+                    e.tf.c[0] = dst_crop.x0;
+                    e.tf.c[1] = dst_crop.y0;
+                    break;
+                case PL_OVERLAY_COORDS_DST_FRAME:
+                    break;
+                case PL_OVERLAY_COORDS_AUTO:
+                case PL_OVERLAY_COORDS_COUNT:
+                    pl_unreachable();
+            }
+
+            if (output_shift)
+                pl_transform2x2_rmul(output_shift, &e.tf);
+
+            const int w = ol->tex->params.w, h = ol->tex->params.h;
+            const struct osd_entry *prev = NULL;
+            if (rr->osd_batch.num) {
+                const struct pl_overlay *first = &rr->osd_batch.elem[0].ol;
+                const bool use_table = osd_use_table(rr, first);
+                bool batchable = use_table ? osd_use_table(rr, ol)
+                                           : osd_batchable(first, max_dim) &&
+                                             osd_batchable(ol, max_dim);
+                if (!batchable || !osd_compatible(first, ol))
+                    break;
+
+                // Vertices are indexed using 16-bit indices
+                if (num_verts + 4 * ol->num_parts > UINT16_MAX + 1)
+                    break;
+
+                // Textures used more than once are only copied (or bound) once
+                for (int i = 0; i < rr->osd_batch.num; i++) {
+                    if (rr->osd_batch.elem[i].ol.tex == ol->tex) {
+                        prev = &rr->osd_batch.elem[i];
+                        break;
+                    }
+                }
+
+                if (use_table) {
+                    if (!prev && num_slots == OSD_TABLE_SIZE)
+                        break; // table is full
+                } else {
+                    if (!prev && row_x + w > max_dim) {
+                        row_x = 0;
+                        row_y = atlas_h;
+                    }
+                    if (!prev && row_y + h > max_dim)
+                        break; // atlas is full
+                }
+            }
 
+            num_verts += 4 * ol->num_parts;
+            if (prev) {
+                e.x = prev->x;
+                e.y = prev->y;
+                e.slot = prev->slot;
+            } else {
+                e.slot = num_slots++;
+                e.x = row_x;
+                e.y = row_y;
+                e.blit = true;
+                row_x += w;
+                atlas_w = PL_MAX(atlas_w, row_x);
+                atlas_h = PL_MAX(atlas_h, row_y + h);
+            }
+            PL_ARRAY_APPEND(rr, rr->osd_batch, e);
+        }
+
+        bool ok = draw_overlay_batch(pass, fbo, comps, comp_map,
+                                     rr->osd_batch.elem, rr->osd_batch.num,
+                                     atlas_w, atlas_h, color, repr);
         if (!ok) {
             PL_ERR(rr, "Failed rendering overlays!");
             rr->errors |= PL_RENDER_ERR_OVERLAY;
@@ -1008,7 +1467,9 @@ static pl_tex get_hook_tex(void *priv, int width, int height)
 {
     struct pass_state *pass = priv;
 
-    return get_fbo(pass, width, height, NULL, 4, PL_DEBUG_TAG);
+    pl_tex tex = get_fbo(pass, width, height, NULL, 4, false, PL_DEBUG_TAG);
+    pin_fbos(pass);
+    return tex;
 }
 
 // Returns if any hook was applied (even if there were errors)
@@ -1078,6 +1539,8 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
             pl_unreachable();
         }
 
+        // Hooks may hold on to any texture they get to see
+        pin_fbos(pass);
         struct pl_hook_res res = hook->hook(hook->priv, &hparams);
         if (res.failed) {
             PL_ERR(rr, "Failed executing hook, disabling");
@@ -1992,7 +2455,8 @@ static bool pass_scale_main(struct pass_state *pass)
 
     pass_hook(pass, img, PL_HOOK_PRE_KERNEL);
 
-    src.tex = img_tex(pass, img);
+    src.tex = img_tex_padded(pass, img);
+    src.bounds = img_bounds(img);
     if (!src.tex)
         return false;
     pass->need_peak_fbo = false;
@@ -2043,8 +2507,8 @@ static pl_tex get_feature_map(struct pass_state *pass)
     const float ratio = cparams->contrast_smoothness;
     const int cr_w = ceilf(abs(pl_rect_w(pass->dst_rect)) / ratio);
     const int cr_h = ceilf(abs(pl_rect_h(pass->dst_rect)) / ratio);
-    pl_tex inter_tex = get_fbo(pass, img->w, img->h, NULL, 1, PL_DEBUG_TAG);
-    pl_tex out_tex   = get_fbo(pass, cr_w, cr_h, NULL, 1, PL_DEBUG_TAG);
+    pl_tex inter_tex = get_fbo(pass, img->w, img->h, NULL, 1, false, PL_DEBUG_TAG);
+    pl_tex out_tex   = get_fbo(pass, cr_w, cr_h, NULL, 1, false, PL_DEBUG_TAG);
     if (!inter_tex || !out_tex)
         goto error;
 
@@ -2238,8 +2702,8 @@ static bool pass_error_diffusion(struct pass_state *pass, pl_shader *sh,
     };
 
     // Create temporary framebuffers
-    edpars.input_tex = get_fbo(pass, out_w, out_h, fmt, comps, PL_DEBUG_TAG);
-    edpars.output_tex = get_fbo(pass, out_w, out_h, fmt, comps, PL_DEBUG_TAG);
+    edpars.input_tex = get_fbo(pass, out_w, out_h, fmt, comps, false, PL_DEBUG_TAG);
+    edpars.output_tex = get_fbo(pass, out_w, out_h, fmt, comps, false, PL_DEBUG_TAG);
     if (!edpars.input_tex || !edpars.output_tex)
         goto error;
 
@@ -2474,7 +2938,8 @@ static bool pass_output_target(struct pass_state *pass)
 
             // Planar output, so we need to sample from an intermediate FBO
             struct pl_sample_src src = {
-                .tex        = img_tex(pass, img),
+                .tex        = img_tex_padded(pass, img),
+                .bounds     = img_bounds(img),
                 .new_w      = rx1 - rx0,
                 .new_h      = ry1 - ry0,
                 .rect = {
@@ -3011,15 +3476,28 @@ static void pass_begin_frame(struct pass_state *pass)
 
     pl_dispatch_callback(rr->dp, pass, info_callback);
     pl_dispatch_reset_frame(rr->dp);
+    pass->info.degraded = rr->degraded;
 
     for (int i = 0; i < params->num_hooks; i++) {
         if (params->hooks[i]->reset)
             params->hooks[i]->reset(params->hooks[i]->priv);
     }
 
-    size_t size = rr->fbos.num * sizeof(bool);
-    pass->fbos_used = pl_realloc(pass->tmp, pass->fbos_used, size);
-    memset(pass->fbos_used, 0, size);
+    // Release textures which haven't been used in a while
+    rr->fbo_frame++;
+    for (int i = rr->fbos.num - 1; i >= 0; i--) {
+        struct fbo *fbo = &rr->fbos.elem[i];
+        if (rr->fbo_frame - fbo->last_used > FBO_MAX_AGE) {
+            pl_tex_destroy(rr->gpu, &fbo->tex);
+            PL_ARRAY_REMOVE_AT(rr->fbos, i);
+        }
+    }
+
+    size_t size = rr->fbos.num * sizeof(pass->fbo_state[0]);
+    pass->fbo_state = pl_realloc(pass->tmp, pass->fbo_state, size);
+    memset(pass->fbo_state, FBO_UNUSED, size);
+    rr->fbo_stats.frame_bytes = 0;
+    rr->fbo_stats.unaliased_bytes = 0;
 }
 
 static bool draw_empty_overlays(pl_renderer rr,
@@ -3076,11 +3554,10 @@ static bool draw_empty_overlays(pl_renderer rr,
     return true;
 }
 
-bool pl_render_image(pl_renderer rr, const struct pl_frame *pimage,
-                     const struct pl_frame *ptarget,
-                     const struct pl_render_params *params)
+static bool render_image(pl_renderer rr, const struct pl_frame *pimage,
+                         const struct pl_frame *ptarget,
+                         const struct pl_render_params *params)
 {
-    params = PL_DEF(params, &pl_render_default_params);
     pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
     if (!pimage)
         return draw_empty_overlays(rr, ptarget, params);
@@ -3244,6 +3721,7 @@ static struct params_info render_params_info(const struct pl_render_params *para
 
     // Clear out other irrelevant fields
     CLEAR(params.dynamic_constants);
+    CLEAR(params.async_compile);
     CLEAR(params.info_callback);
     CLEAR(params.info_priv);
 
@@ -3253,14 +3731,13 @@ static struct params_info render_params_info(const struct pl_render_params *para
 
 #define MAX_MIX_FRAMES 16
 
-bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
-                         const struct pl_frame *ptarget,
-                         const struct pl_render_params *params)
+static bool render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                             const struct pl_frame *ptarget,
+                             const struct pl_render_params *params)
 {
     if (!images->num_frames)
-        return pl_render_image(rr, NULL, ptarget, params);
+        return render_image(rr, NULL, ptarget, params);
 
-    params = PL_DEF(params, &pl_render_default_params);
     struct params_info par_info = render_params_info(params);
     pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
 
@@ -3419,7 +3896,8 @@ retry:
 
         // Check to see if we can blindly reuse this cache entry. This is the
         // case if either the params are compatible, or the user doesn't care
-        bool can_reuse = f->tex;
+        bool can_reuse = f->tex && !f->incomplete &&
+                         (rr->degraded || !f->degraded);
         bool strict_reuse = skip_cache || single_frame ||
                             !params->preserve_mixing_cache;
         if (can_reuse && strict_reuse) {
@@ -3524,6 +4002,8 @@ retry:
             f->color = inter_pass.img.color;
             f->comps = inter_pass.img.comps;
             f->profile = target->profile;
+            f->degraded = rr->degraded;
+            f->incomplete = pl_dispatch_pending(rr->dp);
             // fall through
 
 inter_pass_error:
@@ -3641,12 +4121,98 @@ fail:
 
 fallback:
     pass_uninit(&pass);
-    return pl_render_image(rr, refimg, ptarget, params);
+    return render_image(rr, refimg, ptarget, params);
 
 error: // for parameter validation failures
     return false;
 }
 
+// Returns the cheaper configuration used while shaders for `params` are
+// still being compiled in the background
+static struct pl_render_params async_fallback_params(const struct pl_render_params *params)
+{
+    struct pl_render_params fallback = *params;
+    fallback.upscaler = fallback.downscaler = NULL;
+    fallback.plane_upscaler = fallback.plane_downscaler = NULL;
+    fallback.frame_mixer = NULL;
+    fallback.deband_params = NULL;
+    fallback.sigmoid_params = NULL;
+    fallback.peak_detect_params = NULL;
+    fallback.error_diffusion = NULL;
+    return fallback;
+}
+
+// Decides whether to attempt rendering the next frame with the full params,
+// which is the case unless passes required by them are already known to still
+// be compiling. If so, enables background compilation for that attempt.
+static bool async_begin(pl_renderer rr)
+{
+    if (rr->async_pending && pl_dispatch_num_pending(rr->dp))
+        return false;
+
+    rr->async_pending = false;
+    pl_dispatch_mark_async(rr->dp, true);
+    return true;
+}
+
+// Returns whether the attempt started by `async_begin` succeeded, i.e. no
+// dispatch had to be discarded because its pass was still compiling
+static bool async_end(pl_renderer rr)
+{
+    bool pending = pl_dispatch_pending(rr->dp);
+    pl_dispatch_mark_async(rr->dp, false);
+    if (pending) {
+        PL_TRACE(rr, "Shaders still compiling, using fallback params until done");
+        rr->async_pending = true;
+    }
+
+    return !pending;
+}
+
+bool pl_render_image(pl_renderer rr, const struct pl_frame *pimage,
+                     const struct pl_frame *ptarget,
+                     const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    if (!params->async_compile)
+        return render_image(rr, pimage, ptarget, params);
+
+    if (async_begin(rr)) {
+        bool ok = render_image(rr, pimage, ptarget, params);
+        if (async_end(rr))
+            return ok;
+    }
+
+    // The fallback passes are compiled synchronously, so this always
+    // renders the complete frame
+    const struct pl_render_params fallback = async_fallback_params(params);
+    rr->degraded = true;
+    bool ok = render_image(rr, pimage, ptarget, &fallback);
+    rr->degraded = false;
+    return ok;
+}
+
+bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                         const struct pl_frame *ptarget,
+                         const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    if (!params->async_compile)
+        return render_image_mix(rr, images, ptarget, params);
+
+    if (async_begin(rr)) {
+        bool ok = render_image_mix(rr, images, ptarget, params);
+        if (async_end(rr))
+            return ok;
+    }
+
+    const struct pl_render_params fallback = async_fallback_params(params);
+    rr->degraded = true;
+    bool ok = render_image_mix(rr, images, ptarget, &fallback);
+    rr->degraded = false;
+    return ok;
+}
+
 void pl_frames_infer_mix(pl_renderer rr, const struct pl_frame_mix *mix,
                          struct pl_frame *target, struct pl_frame *out_ref)
 {
@@ -377,9 +377,17 @@ ident_t sh_desc(pl_shader sh, struct pl_shader_desc sd)
         }
         break;
 
+    case PL_DESC_SAMPLED_TEX:
+        pl_assert(!sd.num_buffer_vars);
+        if (sd.desc.count) {
+            sd.binding.object = sh_memdup(sh, sd.binding.object,
+                                          sd.desc.count * sizeof(pl_tex),
+                                          alignof(pl_tex));
+        }
+        break;
+
     case PL_DESC_BUF_TEXEL_UNIFORM:
     case PL_DESC_BUF_TEXEL_STORAGE:
-    case PL_DESC_SAMPLED_TEX:
     case PL_DESC_STORAGE_IMG:
         pl_assert(!sd.num_buffer_vars);
         break;
@@ -572,6 +580,67 @@ ident_t sh_bind(pl_shader sh, pl_tex tex,
     return itex;
 }
 
+ident_t sh_bind_table(pl_shader sh, const pl_tex *texs, int num, int size,
+                      enum pl_tex_address_mode address_mode,
+                      enum pl_tex_sample_mode sample_mode,
+                      const char *name)
+{
+    pl_gpu gpu = SH_GPU(sh);
+    pl_assert(num > 0 && num <= size);
+    if (!gpu || gpu->limits.max_tex_array < (uint32_t) size) {
+        SH_FAIL(sh, "Failed binding texture table '%s': arrays of %d "
+                "textures not supported!", name, size);
+        return NULL_IDENT;
+    }
+
+    pl_tex *table = sh_alloc(sh, size * sizeof(pl_tex), alignof(pl_tex));
+    for (int i = 0; i < size; i++) {
+        pl_tex tex = table[i] = texs[PL_MIN(i, num - 1)];
+        enum pl_fmt_type type = tex->params.format->type;
+        if (pl_tex_params_dimension(tex->params) != 2 ||
+            tex->sampler_type != PL_SAMPLER_NORMAL ||
+            type == PL_FMT_UINT || type == PL_FMT_SINT)
+        {
+            SH_FAIL(sh, "Failed binding texture table '%s': texture %d is "
+                    "not a normal 2D texture!", name, i);
+            return NULL_IDENT;
+        }
+
+        if (!tex->params.sampleable) {
+            SH_FAIL(sh, "Failed binding texture table '%s': texture %d not "
+                    "sampleable!", name, i);
+            return NULL_IDENT;
+        }
+    }
+
+    ident_t itex = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name = name,
+            .type = PL_DESC_SAMPLED_TEX,
+            .count = size,
+        },
+        .binding = {
+            .object = table,
+            .address_mode = address_mode,
+            .sample_mode = sample_mode,
+        },
+    });
+
+    // Without support for non-uniform indexing, select the texture by
+    // branching on the index, so that every array access is constant
+    ident_t fn = sh_fresh(sh, "sample_table");
+    GLSLH("vec4 "$"(int idx, vec2 pos) { \n", fn);
+    if (sh_glsl(sh).nonuniform_indexing) {
+        GLSLH("return textureLod("$"[nonuniformEXT(idx)], pos, 0.0); \n", itex);
+    } else {
+        for (int i = 0; i < size - 1; i++)
+            GLSLH("if (idx == %d) return textureLod("$"[%d], pos, 0.0); \n", i, itex, i);
+        GLSLH("return textureLod("$"[%d], pos, 0.0); \n", itex, size - 1);
+    }
+    GLSLH("} \n");
+    return fn;
+}
+
 bool sh_buf_desc_append(void *alloc, pl_gpu gpu,
                         struct pl_shader_desc *buf_desc,
                         struct pl_var_layout *out_layout,
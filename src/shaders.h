@@ -202,6 +202,19 @@ ident_t sh_bind(pl_shader sh, pl_tex tex,
                 const char *name, const pl_rect2df *rect,
                 ident_t *out_pos, ident_t *out_pt);
 
+// Bind a table of textures as a single array descriptor of `size` elements.
+// Elements past the first `num` repeat the last texture, so the generated
+// shader only depends on `size`, and not on the number of textures. Returns
+// a function `vec4 fn(int idx, vec2 pos)`, which samples the `idx`-th texture
+// at normalized coordinates `pos`. `idx` does not need to be uniform. All
+// textures must be sampleable 2D textures with normal samplers and a
+// non-integer format. Requires `size <= gpu->limits.max_tex_array`. Returns
+// NULL on failure.
+ident_t sh_bind_table(pl_shader sh, const pl_tex *texs, int num, int size,
+                      enum pl_tex_address_mode address_mode,
+                      enum pl_tex_sample_mode sample_mode,
+                      const char *name);
+
 // Incrementally build up a buffer by adding new variable elements to the
 // buffer, resizing buf.buffer_vars if necessary. Returns whether or not the
 // variable could be successfully added (which may fail if you try exceeding
@@ -332,6 +345,16 @@ struct sh_lut_params {
     // cache. Requires `signature` to be set (and uniquely identify the LUT).
     pl_cache cache;
 
+    // If true, updates to an existing texture LUT (which don't change its
+    // size or format) are generated on a background thread, while the
+    // previous contents of the LUT remain in use. Once ready, the new data is
+    // uploaded to a second texture, which is then swapped in. If an update is
+    // still outstanding after `max_stale` calls, `sh_lut` blocks on it.
+    //
+    // Note: Requires `priv_size`, and `fill` must be thread-safe.
+    bool async;
+    int max_stale; // defaults to 4
+
     // Will be called with a zero-initialized buffer whenever the data needs to
     // be computed, which happens whenever the size is changed, the shader
     // object is invalidated, or `update` is set to true.
@@ -340,6 +363,23 @@ struct sh_lut_params {
     void (*fill)(void *data, const struct sh_lut_params *params);
     void *priv;
 
+    // Optional alternative to `fill` for SH_LUT_TEXTURE, which generates the
+    // contents of `tex` directly on the GPU. `tex` is created `host_writable`,
+    // and additionally `storable` if supported by the format. Returns false to
+    // fall back to `fill`. LUTs generated this way bypass `cache`, and this is
+    // not used for `async` updates.
+    bool (*fill_gpu)(pl_gpu gpu, pl_tex tex, const struct sh_lut_params *params);
+
+    // Size of the (trivially copyable) struct pointed to by `priv`. Needed
+    // for `async`, which must keep a private copy of `priv` around.
+    size_t priv_size;
+
+    // If set, receives a copy of the `priv` that the LUT currently in use was
+    // generated from. This only differs from `priv` while an asynchronous
+    // update is still outstanding, and should be used for anything that has
+    // to match the contents of the LUT. Requires `priv_size`.
+    void *priv_used;
+
     // Debug tag to track LUT source
     pl_debug_tag debug_tag;
 };
@@ -19,6 +19,7 @@
 
 #include "cache.h"
 #include "shaders.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/shaders/colorspace.h>
 
@@ -1016,6 +1017,8 @@ struct sh_color_map_obj {
     // Gamut map state
     struct {
         pl_shader_obj lut;
+        uint64_t signature; // of the most recently requested params
+        int stable;         // number of calls since `signature` changed
     } gamut;
 
     // Peak detection state
@@ -1028,10 +1031,15 @@ struct sh_color_map_obj {
     } peak;
 };
 
+// Number of calls with unchanged parameters after which a progressively
+// generated gamut LUT is refined to full resolution
+#define GAMUT_LUT_REFINE_DELAY 8
+
 // Excluding size, since this is checked by sh_lut
-static uint64_t gamut_map_signature(const struct pl_gamut_map_params *par)
+static uint64_t gamut_map_signature(const struct pl_gamut_map_params *par,
+                                    bool coarse)
 {
-    uint64_t sig = CACHE_KEY_GAMUT_LUT;
+    uint64_t sig = coarse ? CACHE_KEY_GAMUT_COARSE : CACHE_KEY_GAMUT_LUT;
     pl_hash_merge(&sig, pl_str0_hash(par->function->name));
     pl_hash_merge(&sig, pl_var_hash(par->input_gamut));
     pl_hash_merge(&sig, pl_var_hash(par->output_gamut));
@@ -1642,29 +1650,428 @@ static void fill_tone_lut(void *data, const struct sh_lut_params *params)
     pl_tone_map_generate(data, lut_params);
 }
 
-static void fill_gamut_lut(void *data, const struct sh_lut_params *params)
+typedef void (*gamut_map_gen_fn)(float *out, const struct pl_gamut_map_params *params);
+
+static void encode_gamut_lut(void *data, const struct sh_lut_params *params,
+                             gamut_map_gen_fn generate)
 {
     const struct pl_gamut_map_params *lut_params = params->priv;
     const int lut_size = params->width * params->height * params->depth;
     void *tmp = pl_alloc(NULL, lut_size * sizeof(float) * lut_params->lut_stride);
-    pl_gamut_map_generate(tmp, lut_params);
+    generate(tmp, lut_params);
 
     // Convert to 16-bit unsigned integer for GPU texture
     const float *in = tmp;
     uint16_t *out = data;
     pl_assert(lut_params->lut_stride == 3);
     pl_assert(params->comps == 4);
+    // Clamp to avoid wrapping around for colors outside the representable
+    // range, matching the GPU behavior (see `fill_gamut_lut_gpu`)
+    #define ENCODE(x) roundf(PL_CLAMP(x, 0.0f, 1.0f) * UINT16_MAX)
     for (int i = 0; i < lut_size; i++) {
-        out[0] = roundf(in[0] * UINT16_MAX);
-        out[1] = roundf(in[1] * UINT16_MAX + (UINT16_MAX >> 1));
-        out[2] = roundf(in[2] * UINT16_MAX + (UINT16_MAX >> 1));
+        out[0] = ENCODE(in[0]);
+        out[1] = ENCODE(in[1] + (UINT16_MAX >> 1) / (float) UINT16_MAX);
+        out[2] = ENCODE(in[2] + (UINT16_MAX >> 1) / (float) UINT16_MAX);
         in  += 3;
         out += 4;
     }
+    #undef ENCODE
+
+    pl_free(tmp);
+}
+
+static void fill_gamut_lut(void *data, const struct sh_lut_params *params)
+{
+    encode_gamut_lut(data, params, pl_gamut_map_generate);
+}
+
+struct upsample_args {
+    const struct pl_gamut_map_params *params;
+    const struct pl_gamut_map_params *coarse;
+    const float *in;
+    float *out;
+};
+
+// Position of sample `i` of an axis with `size` samples, on the grid of
+// an axis with `coarse` samples spanning the same range
+static inline void coarse_pos(int i, int size, int coarse, int *idx, float *frac)
+{
+    const float x = (float) i * (coarse - 1) / PL_MAX(size - 1, 1);
+    *idx = PL_MIN((int) x, coarse - 2);
+    *frac = x - *idx;
+}
+
+static void upsample_gamut_lut(void *priv, int start, int end)
+{
+    const struct upsample_args *args = priv;
+    const struct pl_gamut_map_params *par = args->params, *cpar = args->coarse;
+    const int cI = cpar->lut_size_I, cC = cpar->lut_size_C;
+    const int stride = par->lut_stride;
+
+    for (int h = start; h < end; h++) {
+        int h0, C0, I0;
+        float fh, fC, fI;
+        coarse_pos(h, par->lut_size_h, cpar->lut_size_h, &h0, &fh);
+        for (int C = 0; C < par->lut_size_C; C++) {
+            coarse_pos(C, par->lut_size_C, cC, &C0, &fC);
+            float *out = args->out + ((size_t) h * par->lut_size_C + C) *
+                                     par->lut_size_I * stride;
+            for (int I = 0; I < par->lut_size_I; I++, out += stride) {
+                coarse_pos(I, par->lut_size_I, cI, &I0, &fI);
+                const float *in = args->in + (((size_t) h0 * cC + C0) * cI + I0) * 3;
+                const size_t dI = 3, dC = cI * dI, dh = cC * dC;
+                for (int c = 0; c < 3; c++) {
+                    const float *p = &in[c];
+                    const float v0 = PL_MIX(PL_MIX(p[0],       p[dI],       fI),
+                                            PL_MIX(p[dC],      p[dC + dI],  fI), fC);
+                    const float v1 = PL_MIX(PL_MIX(p[dh],      p[dh + dI],  fI),
+                                            PL_MIX(p[dh + dC], p[dh + dC + dI], fI), fC);
+                    out[c] = PL_MIX(v0, v1, fh);
+                }
+            }
+        }
+    }
+}
 
+// Generates the LUT at half resolution (per axis), and upsamples it. For odd
+// LUT sizes, every other sample is thus exact.
+static void gamut_map_generate_coarse(float *out, const struct pl_gamut_map_params *params)
+{
+    struct pl_gamut_map_params coarse = *params;
+    coarse.lut_size_I = PL_MAX((params->lut_size_I + 1) / 2, 2);
+    coarse.lut_size_C = PL_MAX((params->lut_size_C + 1) / 2, 2);
+    coarse.lut_size_h = PL_MAX((params->lut_size_h + 1) / 2, 2);
+    coarse.lut_stride = 3;
+
+    const size_t size = (size_t) coarse.lut_size_I * coarse.lut_size_C *
+                        coarse.lut_size_h * coarse.lut_stride;
+    float *tmp = pl_alloc(NULL, size * sizeof(float));
+    pl_gamut_map_generate(tmp, &coarse);
+
+    struct upsample_args args = { params, &coarse, tmp, out };
+    pl_parallel_for(NULL, params->lut_size_h, 1, upsample_gamut_lut, &args);
     pl_free(tmp);
 }
 
+static void fill_gamut_lut_coarse(void *data, const struct sh_lut_params *params)
+{
+    encode_gamut_lut(data, params, gamut_map_generate_coarse);
+}
+
+static bool gamut_map_gpu_supported(pl_gpu gpu, const struct pl_gamut_map_function *fun)
+{
+    // Needs non-constant loop bounds and integer arithmetic
+    if (!gpu || gpu->glsl.version < (gpu->glsl.gles ? 300 : 130))
+        return false;
+
+    return fun == &pl_gamut_map_perceptual  ||
+           fun == &pl_gamut_map_relative    ||
+           fun == &pl_gamut_map_saturation  ||
+           fun == &pl_gamut_map_absolute    ||
+           fun == &pl_gamut_map_desaturate  ||
+           fun == &pl_gamut_map_highlight;
+}
+
+// GLSL port of the gamut mapping functions from `gamut_mapping.c`. Defines
+// `vec4 gamut_lut(ivec3 pos)`, which returns the encoded LUT entry at `pos`
+// (see `fill_gamut_lut`).
+static void gamut_lut_glsl(pl_shader sh, const struct pl_gamut_map_params *params)
+{
+    const struct pl_gamut_map_function *fun = params->function;
+    const struct pl_gamut_map_constants *c = &params->constants;
+    const float epsilon = 1e-6f;
+    const float min_rgb = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, params->min_luma);
+    const float max_rgb = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, params->max_luma);
+
+    GLSLH("#define MIN_LUMA "$"                                             \n"
+          "#define MAX_LUMA "$"                                             \n"
+          "#define MIN_RGB "$"                                              \n"
+          "#define MAX_RGB "$"                                              \n"
+          "#define MAX_DELTA 5e-5                                           \n"
+          "vec3 pq_eotf(vec3 x) {                                           \n"
+          "    x = pow(clamp(x, 0.0, 1.0), vec3(1.0/%f));                   \n"
+          "    x = max(x - vec3(%f), 0.0) / (vec3(%f) - %f * x);            \n"
+          "    return pow(x, vec3(1.0/%f));                                 \n"
+          "}                                                                \n"
+          "vec3 pq_oetf(vec3 x) {                                           \n"
+          "    x = pow(max(x, 0.0), vec3(%f));                              \n"
+          "    x = (vec3(%f) + %f * x) / (vec3(1.0) + %f * x);              \n"
+          "    return pow(x, vec3(%f));                                     \n"
+          "}                                                                \n"
+          "vec3 ipt2rgb(vec3 ipt, mat3 lms2rgb) {                           \n"
+          "    return lms2rgb * pq_eotf("$" * ipt);                         \n"
+          "}                                                                \n"
+          "vec3 rgb2ipt(vec3 rgb, mat3 rgb2lms) {                           \n"
+          "    return "$" * pq_oetf(rgb2lms * rgb);                         \n"
+          "}                                                                \n"
+          "vec3 ipt2ich(vec3 ipt) {                                         \n"
+          "    return vec3(ipt.x, length(ipt.yz), atan(ipt.z, ipt.y));      \n"
+          "}                                                                \n"
+          "vec3 ich2ipt(vec3 ich) {                                         \n"
+          "    return vec3(ich.x, ich.y * cos(ich.z), ich.y * sin(ich.z));  \n"
+          "}                                                                \n"
+          "bool ingamut(vec3 ipt, mat3 lms2rgb) {                           \n"
+          "    vec3 lmspq = "$" * ipt;                                      \n"
+          "    if (any(lessThan(lmspq, vec3(MIN_LUMA))) ||                  \n"
+          "        any(greaterThan(lmspq, vec3(MAX_LUMA))))                 \n"
+          "        return false;                                            \n"
+          "    vec3 rgb = lms2rgb * pq_eotf(lmspq);                         \n"
+          "    return all(greaterThanEqual(rgb, vec3(MIN_RGB))) &&          \n"
+          "           all(lessThanEqual(rgb, vec3(MAX_RGB)));               \n"
+          "}                                                                \n"
+          // Find gamut intersection using specified bounds
+          "vec3 desat_bounded(float I, float h, float Cmin, float Cmax,     \n"
+          "                   mat3 lms2rgb) {                               \n"
+          "    if (I <= MIN_LUMA)                                           \n"
+          "        return vec3(MIN_LUMA, 0.0, h);                           \n"
+          "    if (I >= MAX_LUMA)                                           \n"
+          "        return vec3(MAX_LUMA, 0.0, h);                           \n"
+          "    float maxDI = I * MAX_DELTA;                                 \n"
+          "    vec3 res = vec3(I, (Cmin + Cmax) / 2.0, h);                  \n"
+          "    int i = 0;                                                   \n"
+          "    do {                                                         \n"
+          "        if (ingamut(ich2ipt(res), lms2rgb)) {                    \n"
+          "            Cmin = res.y;                                        \n"
+          "        } else {                                                 \n"
+          "            Cmax = res.y;                                        \n"
+          "        }                                                        \n"
+          "        res.y = (Cmin + Cmax) / 2.0;                             \n"
+          "    } while (Cmax - Cmin > maxDI && ++i < 32);                   \n"
+          "    return res;                                                  \n"
+          "}                                                                \n"
+          // Finds maximally saturated in-gamut color (for given hue)
+          "vec3 saturate(float hue, mat3 lms2rgb) {                         \n"
+          "    const float invphi = 0.6180339887498948;                     \n"
+          "    const float invphi2 = 0.38196601125010515;                   \n"
+          "    vec3 lo = vec3(MIN_LUMA, 0.0, hue);                          \n"
+          "    vec3 hi = vec3(MAX_LUMA, 0.0, hue);                          \n"
+          "    float de = hi.x - lo.x;                                      \n"
+          "    vec3 a = desat_bounded(lo.x + invphi2 * de, hue, 0.0, 0.5,   \n"
+          "                           lms2rgb);                             \n"
+          "    vec3 b = desat_bounded(lo.x + invphi * de, hue, 0.0, 0.5,    \n"
+          "                           lms2rgb);                             \n"
+          "    while (de > MAX_DELTA) {                                     \n"
+          "        de *= invphi;                                            \n"
+          "        if (a.y > b.y) {                                         \n"
+          "            hi = b;                                              \n"
+          "            b = a;                                               \n"
+          "            a = desat_bounded(lo.x + invphi2 * de, hue,          \n"
+          "                              lo.y - MAX_DELTA, 0.5, lms2rgb);   \n"
+          "        } else {                                                 \n"
+          "            lo = a;                                              \n"
+          "            a = b;                                               \n"
+          "            b = desat_bounded(lo.x + invphi * de, hue,           \n"
+          "                              hi.y - MAX_DELTA, 0.5, lms2rgb);   \n"
+          "        }                                                        \n"
+          "    }                                                            \n"
+          "    return a.y > b.y ? a : b;                                    \n"
+          "}                                                                \n"
+          "vec3 mix_exp(vec3 ich, float x, float gamma, float base) {       \n"
+          "    return vec3(base + (ich.x - base) * pow(x, gamma),           \n"
+          "                ich.y * x, ich.z);                               \n"
+          "}                                                                \n"
+          // Clip a color along the exponential curve given by `gamma`
+          "vec3 clip_gamma(vec3 ipt, float gamma, mat3 lms2rgb) {           \n"
+          "    if (ipt.x <= MIN_LUMA)                                       \n"
+          "        return vec3(MIN_LUMA, 0.0, 0.0);                         \n"
+          "    if (ingamut(ipt, lms2rgb))                                   \n"
+          "        return ipt;                                              \n"
+          "    vec3 ich = ipt2ich(ipt);                                     \n"
+          "    if (gamma == 0.0)                                            \n"
+          "        return ich2ipt(desat_bounded(ich.x, ich.z, 0.0, ich.y,   \n"
+          "                                     lms2rgb));                  \n"
+          "    float maxDI = max(ich.x * MAX_DELTA, 1e-7);                  \n"
+          "    vec3 peak = saturate(ich.z, lms2rgb);                        \n"
+          "    float Irel = max((ich.x - MIN_LUMA) / (peak.x - MIN_LUMA), 0.0);\n"
+          "    gamma *= pow(Irel, 3.0) * min(ich.y / peak.y, 1.0);          \n"
+          "    float lo = 0.0, hi = 1.0, x = 0.5;                           \n"
+          "    int i = 0;                                                   \n"
+          "    do {                                                         \n"
+          "        vec3 test = mix_exp(ich, x, gamma, peak.x);              \n"
+          "        if (ingamut(ich2ipt(test), lms2rgb)) {                   \n"
+          "            lo = x;                                              \n"
+          "        } else {                                                 \n"
+          "            hi = x;                                              \n"
+          "        }                                                        \n"
+          "        x = (lo + hi) / 2.0;                                     \n"
+          "    } while (hi - lo > maxDI && ++i < 32);                       \n"
+          "    return ich2ipt(mix_exp(ich, x, gamma, peak.x));              \n"
+          "}                                                                \n",
+          SH_FLOAT(params->min_luma), SH_FLOAT(params->max_luma),
+          SH_FLOAT(min_rgb / 10000 - epsilon), SH_FLOAT(max_rgb / 10000 + epsilon),
+          PQ_M2, PQ_C1, PQ_C2, PQ_C3, PQ_M1,
+          PQ_M1, PQ_C1, PQ_C2, PQ_C3, PQ_M2,
+          SH_MAT3(pl_ipt_ipt2lms), SH_MAT3(pl_ipt_lms2ipt),
+          SH_MAT3(pl_ipt_ipt2lms));
+
+    ident_t src_lms2rgb = SH_MAT3(pl_ipt_lms2rgb(&params->input_gamut));
+    ident_t dst_lms2rgb = SH_MAT3(pl_ipt_lms2rgb(&params->output_gamut));
+    ident_t dst_rgb2lms = SH_MAT3(pl_ipt_rgb2lms(&params->output_gamut));
+    const float gamma = PL_CLAMP(c->colorimetric_gamma, 0.0f, 10.0f);
+
+    // Same sampling grid as `pl_gamut_map_generate`
+    GLSLH("vec4 gamut_lut(ivec3 pos) {                                      \n"
+          "    vec3 x = vec3(pos) / vec3(%d.0, %d.0, %d.0);                 \n"
+          "    float I = mix(MIN_LUMA, MAX_LUMA, x.x);                      \n"
+          "    float C = mix(0.0, 0.5, x.y);                                \n"
+          "    float h = mix(%f, %f, x.z);                                  \n"
+          "    vec3 ipt = vec3(I, C * cos(h), C * sin(h));                  \n",
+          params->lut_size_I - 1, params->lut_size_C - 1, params->lut_size_h - 1,
+          -M_PI, M_PI);
+
+    if (fun == &pl_gamut_map_perceptual) {
+        const float knee = PL_CLAMP(c->softclip_knee, 0.0f, 1.0f);
+        GLSLH("    vec3 mapped = rgb2ipt(ipt2rgb(ipt, "$"), "$");           \n"
+              "    vec3 ich = ipt2ich(ipt);                                 \n"
+              // Protect in gamut region
+              "    float maxC = max(saturate(ich.z, "$").y,                 \n"
+              "                     saturate(ich.z, "$").y);                \n"
+              "    float k = clamp((ich.y / maxC - "$") / "$", 0.0, 1.0);   \n"
+              "    k = k * k * (3.0 - 2.0 * k) * "$";                       \n"
+              "    ipt = mix(ipt, mapped, k);                               \n"
+              // Softclip in RGB (simple mobius function)
+              "    vec3 rgb = ipt2rgb(ipt, "$");                            \n"
+              "    float peak = max(max(rgb.r, rgb.g), rgb.b) / MAX_RGB;    \n"
+              "    const float j = "$";                                     \n"
+              "    if (peak > 1.0) {                                        \n"
+              "        float a = -j*j * (peak - 1.0) / (j*j - 2.0*j + peak);\n"
+              "        float b = (j*j - 2.0*j*peak + peak) /                \n"
+              "                  max(1e-6, peak - 1.0);                     \n"
+              "        float scale = (b*b + 2.0*b*j + j*j) / (b - a);       \n"
+              "        vec3 v = min(rgb / MAX_RGB, vec3(peak));             \n"
+              "        vec3 clipped = scale * (v + vec3(a)) / (v + vec3(b));\n"
+              "        rgb = mix(rgb, clipped * MAX_RGB,                    \n"
+              "                  greaterThan(v, vec3(j)));                  \n"
+              "    }                                                        \n"
+              "    rgb = max(rgb, vec3(MIN_RGB));                           \n"
+              "    ipt = rgb2ipt(rgb, "$");                                 \n",
+              src_lms2rgb, dst_rgb2lms, src_lms2rgb, dst_lms2rgb,
+              SH_FLOAT(PL_CLAMP(c->perceptual_deadzone, 0.0f, 1.0f)),
+              SH_FLOAT(PL_MAX(1.0f - c->perceptual_deadzone, 1e-6f)),
+              SH_FLOAT(PL_CLAMP(c->perceptual_strength, 0.0f, 1.0f)),
+              dst_lms2rgb, SH_FLOAT(knee), dst_rgb2lms);
+    } else if (fun == &pl_gamut_map_relative) {
+        GLSLH("    ipt = clip_gamma(ipt, "$", "$");                         \n",
+              SH_FLOAT(gamma), dst_lms2rgb);
+    } else if (fun == &pl_gamut_map_desaturate) {
+        GLSLH("    ipt = clip_gamma(ipt, 0.0, "$");                         \n",
+              dst_lms2rgb);
+    } else if (fun == &pl_gamut_map_saturation) {
+        GLSLH("    ipt = rgb2ipt(ipt2rgb(ipt, "$"), "$");                   \n",
+              src_lms2rgb, dst_rgb2lms);
+    } else if (fun == &pl_gamut_map_absolute) {
+        pl_matrix3x3 adapt = pl_get_adaptation_matrix(params->output_gamut.white,
+                                                      params->input_gamut.white);
+        GLSLH("    vec3 rgb = "$" * ipt2rgb(ipt, "$");                      \n"
+              "    ipt = clip_gamma(rgb2ipt(rgb, "$"), "$", "$");           \n",
+              SH_MAT3(adapt), dst_lms2rgb, dst_rgb2lms,
+              SH_FLOAT(gamma), dst_lms2rgb);
+    } else if (fun == &pl_gamut_map_highlight) {
+        GLSLH("    if (!ingamut(ipt, "$")) {                                \n"
+              "        ipt.x = min(ipt.x + 0.1, 1.0);                       \n"
+              "        ipt.yz = clamp(-1.2 * ipt.yz, -0.5, 0.5);            \n"
+              "    }                                                        \n",
+              dst_lms2rgb);
+    } else {
+        pl_unreachable();
+    }
+
+    GLSLH("    return vec4(ipt.x, ipt.yz + vec2(32767.0/65535.0), 0.0);     \n"
+          "}                                                                \n");
+}
+
+static bool fill_gamut_lut_gpu(pl_gpu gpu, pl_tex tex, const struct sh_lut_params *params)
+{
+    const struct pl_gamut_map_params *lut_params = params->priv;
+    pl_dispatch dp = pl_gpu_dispatch(gpu);
+    pl_shader sh = pl_dispatch_begin(dp);
+
+    // Write directly into the 3DLUT, if possible
+    const int bw = 8, bh = 8;
+    if (tex->params.storable && sh_try_compute(sh, bw, bh, false, 0)) {
+        gamut_lut_glsl(sh, lut_params);
+        ident_t lut = sh_desc(sh, (struct pl_shader_desc) {
+            .binding.object = tex,
+            .desc = {
+                .name   = "lut",
+                .type   = PL_DESC_STORAGE_IMG,
+                .access = PL_DESC_ACCESS_WRITEONLY,
+            },
+        });
+
+        GLSL("ivec3 pos = ivec3(gl_GlobalInvocationID);             \n"
+             "if (pos.x < %d && pos.y < %d)                         \n"
+             "    imageStore("$", pos, gamut_lut(pos));             \n",
+             tex->params.w, tex->params.h, lut);
+
+        return pl_dispatch_compute(dp, pl_dispatch_compute_params(
+            .shader = &sh,
+            .dispatch_size = {
+                PL_DIV_UP(tex->params.w, bw),
+                PL_DIV_UP(tex->params.h, bh),
+                tex->params.d,
+            },
+        ));
+    }
+
+    // Otherwise, render all slices of the 3DLUT stacked on top of each other
+    // into a 2D texture with the same memory layout, then copy it over
+    const int w = tex->params.w, h = tex->params.h, d = tex->params.d;
+    const size_t pitch = w * tex->params.format->texel_size;
+    bool ok = tex->params.format->caps & PL_FMT_CAP_RENDERABLE;
+    ok &= gpu->limits.buf_transfer && h * d <= gpu->limits.max_tex_2d_dim;
+    ok &= pitch % PL_DEF(gpu->limits.align_tex_xfer_pitch, 1) == 0;
+    if (!ok) {
+        pl_dispatch_abort(dp, &sh);
+        return false;
+    }
+
+    pl_buf buf = NULL;
+    pl_tex slices = pl_tex_create(gpu, pl_tex_params(
+        .w              = w,
+        .h              = h * d,
+        .format         = tex->params.format,
+        .renderable     = true,
+        .host_readable  = true,
+        .debug_tag      = PL_DEBUG_TAG,
+    ));
+    if (!slices)
+        goto error;
+
+    sh->output = PL_SHADER_SIG_COLOR;
+    gamut_lut_glsl(sh, lut_params);
+    GLSL("ivec2 xy = ivec2(gl_FragCoord.xy);                        \n"
+         "vec4 color = gamut_lut(ivec3(xy.x, xy.y %% %d, xy.y / %d)); \n",
+         h, h);
+
+    ok = pl_dispatch_finish(dp, pl_dispatch_params(
+        .shader = &sh,
+        .target = slices,
+    ));
+
+    buf = pl_buf_pool_get(gpu, pl_buf_params( .size = pitch * h * d ));
+    ok = ok && buf;
+    ok = ok && pl_tex_download(gpu, pl_tex_transfer_params(
+        .tex        = slices,
+        .buf        = buf,
+        .row_pitch  = pitch,
+    ));
+    ok = ok && pl_tex_upload(gpu, pl_tex_transfer_params(
+        .tex        = tex,
+        .buf        = buf,
+        .row_pitch  = pitch,
+        .depth_pitch = pitch * h,
+    ));
+
+    pl_buf_pool_put(gpu, &buf);
+    pl_tex_destroy(gpu, &slices);
+    return ok;
+
+error:
+    pl_dispatch_abort(dp, &sh);
+    return false;
+}
+
 void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *params,
                             const struct pl_color_map_args *args)
 {
@@ -1907,6 +2314,7 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         } else {
 
             pl_assert(obj);
+            struct pl_tone_map_params lut_tone;
             ident_t lut = sh_lut(sh, sh_lut_params(
                 .object     = &obj->tone.lut,
                 .var_type   = PL_VAR_FLOAT,
@@ -1916,8 +2324,11 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
                 .comps      = 1,
                 .update     = !pl_tone_map_params_equal(&tone, &obj->tone.params),
                 .dynamic    = tone.input_avg > 0, // dynamic metadata
+                .async      = params->async_luts,
                 .fill       = fill_tone_lut,
                 .priv       = &tone,
+                .priv_size  = sizeof(tone),
+                .priv_used  = &lut_tone,
             ));
             obj->tone.params = tone;
             if (!lut) {
@@ -1925,10 +2336,11 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
                 return;
             }
 
-            const float lut_range = tone.input_max - tone.input_min;
+            // The LUT may lag behind `tone` while being updated asynchronously
+            const float lut_range = lut_tone.input_max - lut_tone.input_min;
             GLSL("#define tone_map(x) ("$"("$" * (x) + "$")) \n",
                  lut, SH_FLOAT_DYN(1.0f / lut_range),
-                 SH_FLOAT_DYN(-tone.input_min / lut_range));
+                 SH_FLOAT_DYN(-lut_tone.input_min / lut_range));
 
         }
 
@@ -1993,6 +2405,23 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         sh_describef(sh, "gamut map (%s)", fun->name);
 
         pl_assert(obj);
+        const bool gpu_lut = params->gpu_luts &&
+                             gamut_map_gpu_supported(SH_GPU(sh), fun);
+
+        // Generate a coarse LUT while the params keep changing, and only
+        // refine it once they have settled down
+        bool coarse = false;
+        if (params->lut3d_progressive && !gpu_lut) {
+            const uint64_t signature = gamut_map_signature(&gamut, false);
+            if (signature != obj->gamut.signature) {
+                obj->gamut.signature = signature;
+                obj->gamut.stable = 0;
+            }
+            coarse = obj->gamut.stable < GAMUT_LUT_REFINE_DELAY;
+            obj->gamut.stable += coarse;
+        }
+
+        struct pl_gamut_map_params lut_gamut;
         ident_t lut = sh_lut(sh, sh_lut_params(
             .object     = &obj->gamut.lut,
             .var_type   = PL_VAR_FLOAT,
@@ -2003,10 +2432,14 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
             .height     = gamut.lut_size_C,
             .depth      = gamut.lut_size_h,
             .comps      = 4,
-            .signature  = gamut_map_signature(&gamut),
+            .signature  = gamut_map_signature(&gamut, coarse),
             .cache      = SH_CACHE(sh),
-            .fill       = fill_gamut_lut,
+            .async      = params->async_luts && !gpu_lut,
+            .fill       = coarse ? fill_gamut_lut_coarse : fill_gamut_lut,
+            .fill_gpu   = gpu_lut ? fill_gamut_lut_gpu : NULL,
             .priv       = &gamut,
+            .priv_size  = sizeof(gamut),
+            .priv_used  = &lut_gamut,
         ));
         if (!lut) {
             SH_FAIL(sh, "Failed generating gamut-mapping LUT!");
@@ -2014,7 +2447,7 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         }
 
         // 3D LUT lookup (in ICh space)
-        const float lut_range = gamut.max_luma - gamut.min_luma;
+        const float lut_range = lut_gamut.max_luma - lut_gamut.min_luma;
         GLSL("vec3 idx;                             \n"
              "idx.x = "$" * ipt.x + "$";            \n"
              "idx.y = 2.0 * length(ipt.yz);         \n"
@@ -2022,7 +2455,7 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
              "ipt = "$"(idx).xyz;                   \n"
              "ipt.yz -= vec2(32768.0/65535.0);      \n",
              SH_FLOAT(1.0f / lut_range),
-             SH_FLOAT(-gamut.min_luma / lut_range),
+             SH_FLOAT(-lut_gamut.min_luma / lut_range),
              0.5f / M_PI, lut);
 
         if (params->show_clipping) {
@@ -2033,7 +2466,7 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         if (params->visualize_lut) {
             visualize_gamut_map(sh, params->visualize_rect, lut,
                                 params->visualize_hue, params->visualize_theta,
-                                &gamut);
+                                &lut_gamut);
         }
     }
 
@@ -17,6 +17,7 @@
 
 #include "shaders.h"
 #include "shaders/film_grain.h"
+#include "pl_thread_pool.h"
 
 static const int8_t Gaussian_LUT[2048+4];
 static const uint32_t Seed_LUT[256];
@@ -105,26 +106,41 @@ static void generate_slice(float *out, size_t out_width, uint8_t h, uint8_t v,
     }
 }
 
-static void fill_grain_lut(void *data, const struct sh_lut_params *params)
+struct fill_args {
+    float *out;
+    int stride;
+};
+
+// Generates the slices [start, end), in row-major order over the 13x13 grid
+static void fill_slices(void *priv, int start, int end)
 {
+    const struct fill_args *args = priv;
     struct {
         int8_t grain[64][64];
         int16_t tmp[64][64];
     } *tmp = pl_alloc_ptr(NULL, tmp);
 
-    float *out = data;
-    assert(params->var_type == PL_VAR_FLOAT);
-
-    for (int h = 0; h < 13; h++) {
-        for (int v = 0; v < 13; v++) {
-            float *slice = out + (h * 64) * params->width + (v * 64);
-            generate_slice(slice, params->width, h, v, tmp->grain, tmp->tmp);
-        }
+    for (int i = start; i < end; i++) {
+        const int h = i / 13, v = i % 13;
+        float *slice = args->out + (h * 64) * args->stride + (v * 64);
+        generate_slice(slice, args->stride, h, v, tmp->grain, tmp->tmp);
     }
 
     pl_free(tmp);
 }
 
+static void fill_grain_lut(void *data, const struct sh_lut_params *params)
+{
+    assert(params->var_type == PL_VAR_FLOAT);
+    struct fill_args args = {
+        .out    = data,
+        .stride = params->width,
+    };
+
+    // All slices are independent of each other
+    pl_parallel_for(NULL, 13 * 13, 4, fill_slices, &args);
+}
+
 bool pl_needs_fg_h274(const struct pl_film_grain_params *params)
 {
     const struct pl_h274_grain_data *data = &params->data.params.h274;
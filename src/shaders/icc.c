@@ -17,6 +17,7 @@
 
 #include <math.h>
 #include "shaders.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/tone_mapping.h>
 #include <libplacebo/shaders/icc.h>
@@ -566,28 +567,22 @@ bool pl_icc_update(pl_log log, pl_icc_object *out_icc,
     return true;
 }
 
-static void fill_lut(void *datap, const struct sh_lut_params *params, bool decode)
-{
-    pl_icc_object icc = params->priv;
-    struct icc_priv *p = PL_PRIV(icc);
-    cmsHPROFILE srcp = decode ? p->profile : p->approx;
-    cmsHPROFILE dstp = decode ? p->approx  : p->profile;
-    int s_r = params->width, s_g = params->height, s_b = params->depth;
-
-    pl_clock_t start = pl_clock_now();
-    cmsHTRANSFORM tf = cmsCreateTransformTHR(p->cms, srcp, TYPE_RGB_16,
-                                             dstp, TYPE_RGBA_16,
-                                             icc->params.intent,
-                                             cmsFLAGS_BLACKPOINTCOMPENSATION |
-                                             cmsFLAGS_NOCACHE | cmsFLAGS_NOOPTIMIZE);
-    if (!tf)
-        return;
+struct fill_args {
+    pl_icc_object icc;
+    cmsHTRANSFORM tf;
+    uint16_t *data;
+    int s_r, s_g, s_b;
+};
 
-    pl_clock_t after_transform = pl_clock_now();
-    pl_log_cpu_time(p->log, start, after_transform, "creating ICC transform");
+// Fills the slices [start, end) of the 3DLUT along the blue axis
+static void fill_slices(void *priv, int start, int end)
+{
+    const struct fill_args *args = priv;
+    pl_icc_object icc = args->icc;
+    const int s_r = args->s_r, s_g = args->s_g, s_b = args->s_b;
 
     uint16_t *tmp = pl_alloc(NULL, s_r * 3 * sizeof(tmp[0]));
-    for (int b = 0; b < s_b; b++) {
+    for (int b = start; b < end; b++) {
         for (int g = 0; g < s_g; g++) {
             // Transform a single line of the output buffer
             for (int r = 0; r < s_r; r++) {
@@ -597,8 +592,8 @@ static void fill_lut(void *datap, const struct sh_lut_params *params, bool decod
             }
 
             size_t offset = (b * s_g + g) * s_r * 4;
-            uint16_t *data = ((uint16_t *) datap) + offset;
-            cmsDoTransform(tf, tmp, data, s_r);
+            uint16_t *data = args->data + offset;
+            cmsDoTransform(args->tf, tmp, data, s_r);
 
             if (!icc->params.force_bpc)
                 continue;
@@ -619,9 +614,43 @@ static void fill_lut(void *datap, const struct sh_lut_params *params, bool decod
         }
     }
 
+    pl_free(tmp);
+}
+
+static void fill_lut(void *datap, const struct sh_lut_params *params, bool decode)
+{
+    pl_icc_object icc = params->priv;
+    struct icc_priv *p = PL_PRIV(icc);
+    cmsHPROFILE srcp = decode ? p->profile : p->approx;
+    cmsHPROFILE dstp = decode ? p->approx  : p->profile;
+
+    pl_clock_t start = pl_clock_now();
+    cmsHTRANSFORM tf = cmsCreateTransformTHR(p->cms, srcp, TYPE_RGB_16,
+                                             dstp, TYPE_RGBA_16,
+                                             icc->params.intent,
+                                             cmsFLAGS_BLACKPOINTCOMPENSATION |
+                                             cmsFLAGS_NOCACHE | cmsFLAGS_NOOPTIMIZE);
+    if (!tf)
+        return;
+
+    pl_clock_t after_transform = pl_clock_now();
+    pl_log_cpu_time(p->log, start, after_transform, "creating ICC transform");
+
+    // Transforms created with cmsFLAGS_NOCACHE are safe to share between
+    // threads, so split the work up along the blue axis
+    struct fill_args args = {
+        .icc  = icc,
+        .tf   = tf,
+        .data = datap,
+        .s_r  = params->width,
+        .s_g  = params->height,
+        .s_b  = params->depth,
+    };
+
+    pl_parallel_for(NULL, args.s_b, 1, fill_slices, &args);
+
     pl_log_cpu_time(p->log, after_transform, pl_clock_now(), "generating ICC 3DLUT");
     cmsDeleteTransform(tf);
-    pl_free(tmp);
 }
 
 static void fill_decode(void *datap, const struct sh_lut_params *params)
@@ -19,6 +19,8 @@
 #include <ctype.h>
 
 #include "shaders.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/shaders/lut.h>
 
@@ -294,6 +296,20 @@ static ident_t texel_scale(pl_shader sh, int lut_size, bool normalized)
     return name;
 }
 
+// State for asynchronous LUT updates
+struct sh_lut_async {
+    pl_mutex lock;
+    pl_thread_job job;              // outstanding job on the shared pool
+    bool done;                      // set by `job` once `obj` is filled
+    int age;                        // number of `sh_lut` calls since started
+    struct sh_lut_params params;    // params of the current job, owns `priv`
+    pl_cache_obj obj;
+
+    // Most recent update requested while `job` was still busy
+    bool pending;
+    struct sh_lut_params pending_params;
+};
+
 struct sh_lut_obj {
     enum sh_lut_type type;
     enum sh_lut_method method;
@@ -307,14 +323,37 @@ struct sh_lut_obj {
     pl_tex tex;
     pl_str str;
     void *data;
+
+    void *priv;                     // copy of the `priv` used to generate this
+    pl_tex tex_back;                // back buffer for asynchronous updates
+    struct sh_lut_async *async;
 };
 
+static void async_reset(struct sh_lut_async *async)
+{
+    pl_thread_job_wait(&async->job);
+
+    pl_cache_obj_free(&async->obj);
+    pl_free(async->params.priv);
+    pl_free(async->pending_params.priv);
+    async->params.priv = async->pending_params.priv = NULL;
+    async->pending = false;
+}
+
 static void sh_lut_uninit(pl_gpu gpu, void *ptr)
 {
     struct sh_lut_obj *lut = ptr;
+    if (lut->async) {
+        async_reset(lut->async);
+        pl_mutex_destroy(&lut->async->lock);
+        pl_free(lut->async);
+    }
+
     pl_tex_destroy(gpu, &lut->tex);
+    pl_tex_destroy(gpu, &lut->tex_back);
     pl_free(lut->str.buf);
     pl_free(lut->data);
+    pl_free(lut->priv);
 
     *lut = (struct sh_lut_obj) {0};
 }
@@ -323,6 +362,157 @@ static void sh_lut_uninit(pl_gpu gpu, void *ptr)
 #define SH_LUT_MAX_LITERAL_SOFT 64
 #define SH_LUT_MAX_LITERAL_HARD 256
 
+// Default for `sh_lut_params.max_stale`
+#define SH_LUT_MAX_STALE 4
+
+static void async_fill(void *priv, int start, int end)
+{
+    struct sh_lut_async *async = priv;
+    async->params.fill(async->obj.data, &async->params);
+
+    pl_mutex_lock(&async->lock);
+    async->done = true;
+    pl_mutex_unlock(&async->lock);
+}
+
+// Uploads the result of a finished job to the back buffer and swaps it in
+static void async_finish(pl_shader sh, struct sh_lut_obj *lut, pl_cache cache)
+{
+    pl_gpu gpu = SH_GPU(sh);
+    struct sh_lut_async *async = lut->async;
+    pl_thread_job_wait(&async->job);
+
+    struct pl_tex_params tex_params = lut->tex->params;
+    tex_params.host_writable = true;
+    tex_params.initial_data = NULL;
+    bool ok = pl_tex_recreate(gpu, &lut->tex_back, &tex_params);
+    if (ok) {
+        ok = pl_tex_upload(gpu, pl_tex_transfer_params(
+            .tex = lut->tex_back,
+            .ptr = async->obj.data,
+        ));
+    }
+
+    if (!ok) {
+        PL_ERR(sh, "Failed uploading asynchronously generated LUT!");
+        pl_cache_obj_free(&async->obj);
+        pl_free(async->params.priv);
+        async->params.priv = NULL;
+        return;
+    }
+
+    PL_TRACE(sh, "Asynchronous LUT update (0x%"PRIx64") done after %d calls",
+             async->params.signature, async->age);
+    PL_SWAP(lut->tex, lut->tex_back);
+    pl_free(lut->priv);
+    lut->priv = async->params.priv;
+    lut->signature = async->params.signature;
+    async->params.priv = NULL;
+    pl_cache_set(cache, &async->obj);
+}
+
+// Starts generating a LUT for `job`, taking over ownership of `job.priv`
+static void async_start(pl_shader sh, struct sh_lut_obj *lut,
+                        const struct sh_lut_params *job, size_t size)
+{
+    struct sh_lut_async *async = lut->async;
+    pl_assert(!async->job);
+    async->params = *job;
+    async->done = false;
+    async->age = 0;
+    async->obj = (pl_cache_obj) { .key = CACHE_KEY_SH_LUT ^ job->signature };
+
+    if (pl_cache_get(job->cache, &async->obj) && async->obj.size == size) {
+        PL_DEBUG(sh, "Re-using cached LUT (0x%"PRIx64") with size %zu",
+                 async->obj.key, async->obj.size);
+        async_finish(sh, lut, job->cache);
+        return;
+    }
+
+    PL_DEBUG(sh, "LUT invalidated, regenerating asynchronously..");
+    pl_cache_obj_resize(NULL, &async->obj, size);
+    memset(async->obj.data, 0, size);
+    async->job = pl_thread_pool_submit(NULL, async_fill, async);
+}
+
+// Handles `sh_lut_params.async`. Returns whether a synchronous update of
+// `lut` is (still) required.
+static bool update_async(pl_shader sh, struct sh_lut_obj *lut,
+                         const struct sh_lut_params *params,
+                         bool can_async, bool update, size_t size)
+{
+    struct sh_lut_async *async = lut->async;
+    if (!can_async) {
+        if (async && (async->job || async->pending)) {
+            // Outstanding updates can't be applied anymore, so discard them
+            // and make sure the LUT reflects the current params instead
+            async_reset(async);
+            return true;
+        }
+        return update;
+    }
+
+    if (!async) {
+        async = lut->async = pl_zalloc_ptr(NULL, async);
+        pl_mutex_init(&async->lock);
+    }
+
+    if (async->job) {
+        pl_mutex_lock(&async->lock);
+        bool done = async->done;
+        pl_mutex_unlock(&async->lock);
+
+        // Bound the staleness of the LUT by blocking on overdue updates
+        if (done || ++async->age >= PL_DEF(params->max_stale, SH_LUT_MAX_STALE)) {
+            async_finish(sh, lut, params->cache);
+            if (async->pending) {
+                async->pending = false;
+                async->pending_params.cache = params->cache;
+                async_start(sh, lut, &async->pending_params, size);
+                async->pending_params.priv = NULL;
+            }
+        }
+    }
+
+    // Figure out whether this update was already requested
+    uint64_t signature = lut->signature;
+    if (async->pending) {
+        signature = async->pending_params.signature;
+    } else if (async->job) {
+        signature = async->params.signature;
+    }
+
+    if (!params->update && params->signature == signature)
+        return false;
+
+    struct sh_lut_params job = *params;
+    job.object = NULL;
+    job.priv = pl_memdup(NULL, params->priv, params->priv_size);
+    job.priv_used = NULL;
+
+    if (async->job) {
+        // Supersedes any previously pending update
+        pl_free(async->pending_params.priv);
+        async->pending_params = job;
+        async->pending = true;
+    } else {
+        async_start(sh, lut, &job, size);
+    }
+
+    return false;
+}
+
+static void fill_lut_cpu(pl_shader sh, const struct sh_lut_params *params,
+                         pl_cache_obj *obj, size_t size)
+{
+    PL_DEBUG(sh, "LUT invalidated, regenerating..");
+    pl_cache_obj_resize(NULL, obj, size);
+    memset(obj->data, 0, size);
+    pl_clock_t start = pl_clock_now();
+    params->fill(obj->data, params);
+    pl_log_cpu_time(sh->log, start, pl_clock_now(), "generating shader LUT");
+}
+
 ident_t sh_lut(pl_shader sh, const struct sh_lut_params *params)
 {
     pl_gpu gpu = SH_GPU(sh);
@@ -463,30 +653,38 @@ next_dim: ; // `continue` out of the inner loop
     }
 
     // Reinitialize the existing LUT if needed
-    update |= type != lut->type;
-    update |= method != lut->method;
+    bool reshape = type != lut->type || method != lut->method ||
+                   vartype != lut->vartype || params->fmt != lut->fmt ||
+                   params->width != lut->width || params->height != lut->height ||
+                   params->depth != lut->depth || params->comps != lut->comps;
+    update |= reshape;
+
+    size_t el_size = params->comps * pl_var_type_size(vartype);
+    if (type == SH_LUT_TEXTURE)
+        el_size = texfmt->texel_size;
+    size_t buf_size = size * el_size;
+
+    if (params->async || lut->async) {
+        bool can_async = params->async && params->priv_size && !reshape &&
+                         type == SH_LUT_TEXTURE && lut->tex && !lut->error;
+        update = update_async(sh, lut, params, can_async, update, buf_size);
+    }
 
     if (update) {
         if (params->dynamic)
             pl_log_level_cap(sh->log, PL_LOG_TRACE);
 
-        size_t el_size = params->comps * pl_var_type_size(vartype);
-        if (type == SH_LUT_TEXTURE)
-            el_size = texfmt->texel_size;
-
-        size_t buf_size = size * el_size;
+        // Generating on the GPU is deferred until the texture exists
+        bool try_gpu = params->fill_gpu && type == SH_LUT_TEXTURE && texdim && texfmt;
         if (pl_cache_get(params->cache, &obj) && obj.size == buf_size) {
             PL_DEBUG(sh, "Re-using cached LUT (0x%"PRIx64") with size %zu",
                      obj.key, obj.size);
-        } else {
-            PL_DEBUG(sh, "LUT invalidated, regenerating..");
-            pl_cache_obj_resize(NULL, &obj, buf_size);
-            pl_clock_t start = pl_clock_now();
-            params->fill(obj.data, params);
-            pl_log_cpu_time(sh->log, start, pl_clock_now(), "generating shader LUT");
+            try_gpu = false;
+        } else if (!try_gpu) {
+            fill_lut_cpu(sh, params, &obj, buf_size);
         }
 
-        pl_assert(obj.data && obj.size);
+        pl_assert(try_gpu || (obj.data && obj.size));
         if (params->dynamic)
             pl_log_level_cap(sh->log, PL_LOG_NONE);
 
@@ -502,20 +700,31 @@ next_dim: ; // `continue` out of the inner loop
                 goto error;
             }
 
+            const bool upload = params->dynamic || try_gpu;
             struct pl_tex_params tex_params = {
                 .w              = params->width,
                 .h              = PL_DEF(params->height, texdim >= 2 ? 1 : 0),
                 .d              = PL_DEF(params->depth,  texdim >= 3 ? 1 : 0),
                 .format         = texfmt,
                 .sampleable     = true,
-                .host_writable  = params->dynamic,
-                .initial_data   = params->dynamic ? NULL : obj.data,
+                .storable       = try_gpu && (texfmt->caps & PL_FMT_CAP_STORABLE),
+                .host_writable  = upload,
+                .initial_data   = upload ? NULL : obj.data,
                 .debug_tag      = params->debug_tag,
             };
 
             bool ok;
-            if (params->dynamic) {
+            if (upload) {
                 ok = pl_tex_recreate(gpu, &lut->tex, &tex_params);
+                if (ok && try_gpu) {
+                    if (params->fill_gpu(gpu, lut->tex, params)) {
+                        PL_DEBUG(sh, "Generated LUT on the GPU");
+                        break;
+                    }
+                    PL_DEBUG(sh, "Failed generating LUT on the GPU, "
+                             "falling back to the CPU..");
+                    fill_lut_cpu(sh, params, &obj, buf_size);
+                }
                 if (ok) {
                     ok = pl_tex_upload(gpu, pl_tex_transfer_params(
                         .tex = lut->tex,
@@ -597,7 +806,15 @@ next_dim: ; // `continue` out of the inner loop
         lut->depth = params->depth;
         lut->comps = params->comps;
         lut->signature = params->signature;
-        pl_cache_set(params->cache, &obj);
+        pl_free(lut->priv);
+        lut->priv = pl_memdup(NULL, params->priv, params->priv_size);
+        if (obj.size)
+            pl_cache_set(params->cache, &obj);
+    }
+
+    if (params->priv_used) {
+        pl_assert(params->priv_size);
+        memcpy(params->priv_used, PL_DEF(lut->priv, params->priv), params->priv_size);
     }
 
     // Done updating, generate the GLSL
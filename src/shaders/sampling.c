@@ -41,9 +41,30 @@ enum filter {
     FASTEST,
 };
 
-// Helper function to compute the src/dst sizes and upscaling ratios
+// Returns the region of `src->tex` that may be sampled from
+static inline pl_rect2d src_bounds(const struct pl_sample_src *src)
+{
+    if (pl_rect_w(src->bounds) && pl_rect_h(src->bounds))
+        return src->bounds;
+
+    return (pl_rect2d) { .x1 = src->tex->params.w, .y1 = src->tex->params.h };
+}
+
+// Whether texture accesses must be clamped to `src->bounds`
+static inline bool src_bounded(const struct pl_sample_src *src)
+{
+    if (!src->tex)
+        return false;
+
+    const pl_rect2d bounds = src_bounds(src);
+    return bounds.x0 > 0 || bounds.y0 > 0 ||
+           bounds.x1 < src->tex->params.w || bounds.y1 < src->tex->params.h;
+}
+
+// Helper function to compute the src/dst sizes and upscaling ratios. All
+// texture coordinates must be passed through the function named by `clamp`
 static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
-                      ident_t *src_tex, ident_t *pos, ident_t *pt,
+                      ident_t *src_tex, ident_t *pos, ident_t *pt, ident_t *clamp,
                       float *ratio_x, float *ratio_y, uint8_t *comp_mask,
                       float *scale, bool resizeable,
                       enum filter filter)
@@ -93,6 +114,19 @@ static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
         }
     }
 
+    pl_rect2df rect = src->rect;
+    if (src_bounded(src)) {
+        const pl_rect2d bounds = src_bounds(src);
+        if (!src_w) {
+            rect.x0 = bounds.x0;
+            src_w = pl_rect_w(bounds);
+        }
+        if (!src_h) {
+            rect.y0 = bounds.y0;
+            src_h = pl_rect_h(bounds);
+        }
+    }
+
     src_w = PL_DEF(src_w, src_params(src).w);
     src_h = PL_DEF(src_h, src_params(src).h);
     pl_assert(src_w && src_h);
@@ -130,13 +164,8 @@ static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
         return false;
 
     if (src->tex) {
-        pl_rect2df rect = {
-            .x0 = src->rect.x0,
-            .y0 = src->rect.y0,
-            .x1 = src->rect.x0 + src_w,
-            .y1 = src->rect.y0 + src_h,
-        };
-
+        rect.x1 = rect.x0 + src_w;
+        rect.y1 = rect.y0 + src_h;
         *src_tex = sh_bind(sh, src->tex, src->address_mode, sample_mode,
                            "src_tex", &rect, pos, pt);
     } else {
@@ -173,6 +202,30 @@ static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
               *src_tex, *pos);
     }
 
+    *clamp = sh_fresh(sh, "clamp");
+    if (src_bounded(src)) {
+        // Clamping to the outermost texel centers exactly reproduces
+        // PL_TEX_ADDRESS_CLAMP for both nearest and linear sampling
+        const pl_rect2d bounds = src_bounds(src);
+        float sx = 1.0 / src->tex->params.w, sy = 1.0 / src->tex->params.h;
+        if (src->tex->sampler_type == PL_SAMPLER_RECT)
+            sx = sy = 1.0;
+
+        ident_t lim = sh_var(sh, (struct pl_shader_var) {
+            .var = pl_var_vec4("bounds"),
+            .data = &(float[4]) {
+                sx * (bounds.x0 + 0.5f), sy * (bounds.y0 + 0.5f),
+                sx * (bounds.x1 - 0.5f), sy * (bounds.y1 - 0.5f),
+            },
+            .dynamic = true,
+        });
+
+        GLSLH("vec2 "$"(vec2 p) { return clamp(p, "$".xy, "$".zw); } \n",
+              *clamp, lim, lim);
+    } else {
+        GLSLH("vec2 "$"(vec2 p) { return p; } \n", *clamp);
+    }
+
     return true;
 }
 
@@ -180,9 +233,9 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
                       const struct pl_deband_params *params)
 {
     float scale;
-    ident_t tex, pos, pt;
+    ident_t tex, pos, pt, clamp;
     uint8_t mask;
-    if (!setup_src(sh, src, &tex, &pos, &pt, NULL, NULL, &mask, &scale, false, LINEAR))
+    if (!setup_src(sh, src, &tex, &pos, &pt, &clamp, NULL, NULL, &mask, &scale, false, LINEAR))
         return;
 
     params = PL_DEF(params, &pl_deband_default_params);
@@ -191,8 +244,8 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
          "// pl_shader_deband               \n"
          "{                                 \n"
          "vec2 pos = "$", pt = "$";         \n"
-         "color = textureLod("$", pos, 0.0);\n",
-         pos, pt, tex);
+         "color = textureLod("$", "$"(pos), 0.0);\n",
+         pos, pt, tex, clamp);
 
     mask &= ~0x8u; // ignore alpha channel
     uint8_t num_comps = sh_num_comps(mask);
@@ -206,9 +259,9 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
     }
 
     GLSL("#define GET(X, Y)                                   \\\n"
-         "    (textureLod("$", pos + pt * vec2(X, Y), 0.0).%s)  \n"
-         "#define T %s                                          \n",
-         tex, swiz, sh_float_type(mask));
+         "    (textureLod("$", "$"(pos + pt * vec2(X, Y)), 0.0).%s)  \n"
+         "#define T %s                                               \n",
+         tex, clamp, swiz, sh_float_type(mask));
 
     ident_t prng = sh_prng(sh, true, NULL);
     GLSL("T avg, diff, bound;   \n"
@@ -273,49 +326,49 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
 bool pl_shader_sample_direct(pl_shader sh, const struct pl_sample_src *src)
 {
     float scale;
-    ident_t tex, pos;
-    if (!setup_src(sh, src, &tex, &pos, NULL, NULL, NULL, NULL, &scale, true, BEST))
+    ident_t tex, pos, clamp;
+    if (!setup_src(sh, src, &tex, &pos, NULL, &clamp, NULL, NULL, NULL, &scale, true, BEST))
         return false;
 
     GLSL("// pl_shader_sample_direct                            \n"
-         "vec4 color = vec4("$") * textureLod("$", "$", 0.0);   \n",
-         SH_FLOAT(scale), tex, pos);
+         "vec4 color = vec4("$") * textureLod("$", "$"("$"), 0.0);  \n",
+         SH_FLOAT(scale), tex, clamp, pos);
     return true;
 }
 
 bool pl_shader_sample_nearest(pl_shader sh, const struct pl_sample_src *src)
 {
     float scale;
-    ident_t tex, pos;
-    if (!setup_src(sh, src, &tex, &pos,  NULL, NULL, NULL, NULL, &scale, true, NEAREST))
+    ident_t tex, pos, clamp;
+    if (!setup_src(sh, src, &tex, &pos, NULL, &clamp, NULL, NULL, NULL, &scale, true, NEAREST))
         return false;
 
     sh_describe(sh, "nearest");
     GLSL("// pl_shader_sample_nearest                           \n"
-         "vec4 color = vec4("$") * textureLod("$", "$", 0.0);   \n",
-         SH_FLOAT(scale), tex, pos);
+         "vec4 color = vec4("$") * textureLod("$", "$"("$"), 0.0);  \n",
+         SH_FLOAT(scale), tex, clamp, pos);
     return true;
 }
 
 bool pl_shader_sample_bilinear(pl_shader sh, const struct pl_sample_src *src)
 {
     float scale;
-    ident_t tex, pos;
-    if (!setup_src(sh, src, &tex, &pos, NULL, NULL, NULL, NULL, &scale, true, LINEAR))
+    ident_t tex, pos, clamp;
+    if (!setup_src(sh, src, &tex, &pos, NULL, &clamp, NULL, NULL, NULL, &scale, true, LINEAR))
         return false;
 
     sh_describe(sh, "bilinear");
     GLSL("// pl_shader_sample_bilinear                          \n"
-         "vec4 color = vec4("$") * textureLod("$", "$", 0.0);   \n",
-         SH_FLOAT(scale), tex, pos);
+         "vec4 color = vec4("$") * textureLod("$", "$"("$"), 0.0);  \n",
+         SH_FLOAT(scale), tex, clamp, pos);
     return true;
 }
 
 bool pl_shader_sample_bicubic(pl_shader sh, const struct pl_sample_src *src)
 {
-    ident_t tex, pos, pt;
+    ident_t tex, pos, pt, clamp;
     float rx, ry, scale;
-    if (!setup_src(sh, src, &tex, &pos, &pt, &rx, &ry, NULL, &scale, true, LINEAR))
+    if (!setup_src(sh, src, &tex, &pos, &pt, &clamp, &rx, &ry, NULL, &scale, true, LINEAR))
         return false;
 
     if (rx < 1 || ry < 1) {
@@ -328,32 +381,32 @@ bool pl_shader_sample_bicubic(pl_shader sh, const struct pl_sample_src *src)
     //   'Efficient GPU-Based Texture Interpolation using Uniform B-Splines'
 
     sh_describe(sh, "bicubic");
-#pragma GLSL /* pl_shader_sample_bicubic */         \
-    vec4 color;                                     \
-    {                                               \
-    vec2 pos = $pos;                                \
-    vec2 size = vec2(textureSize($tex, 0));         \
-    vec2 frac  = fract(pos * size + vec2(0.5));     \
-    vec2 frac2 = frac * frac;                       \
-    vec2 inv   = vec2(1.0) - frac;                  \
-    vec2 inv2  = inv * inv;                         \
-    /* compute filter weights directly */           \
-    vec2 w0 = 1.0/6.0 * inv2 * inv;                 \
-    vec2 w1 = 2.0/3.0 - 0.5 * frac2 * (2.0 - frac); \
-    vec2 w2 = 2.0/3.0 - 0.5 * inv2  * (2.0 - inv);  \
-    vec2 w3 = 1.0/6.0 * frac2 * frac;               \
-    vec4 g = vec4(w0 + w1, w2 + w3);                \
-    vec4 h = vec4(w1, w3) / g + inv.xyxy;           \
-    h.xy -= vec2(2.0);                              \
-    /* sample four corners, then interpolate */     \
-    vec4 p = pos.xyxy + $pt.xyxy * h;               \
-    vec4 c00 = textureLod($tex, p.xy, 0.0);         \
-    vec4 c01 = textureLod($tex, p.xw, 0.0);         \
-    vec4 c0 = mix(c01, c00, g.y);                   \
-    vec4 c10 = textureLod($tex, p.zy, 0.0);         \
-    vec4 c11 = textureLod($tex, p.zw, 0.0);         \
-    vec4 c1 = mix(c11, c10, g.y);                   \
-    color = ${float:scale} * mix(c1, c0, g.x);      \
+#pragma GLSL /* pl_shader_sample_bicubic */          \
+    vec4 color;                                      \
+    {                                                \
+    vec2 pos = $pos;                                 \
+    vec2 size = vec2(textureSize($tex, 0));          \
+    vec2 frac  = fract(pos * size + vec2(0.5));      \
+    vec2 frac2 = frac * frac;                        \
+    vec2 inv   = vec2(1.0) - frac;                   \
+    vec2 inv2  = inv * inv;                          \
+    /* compute filter weights directly */            \
+    vec2 w0 = 1.0/6.0 * inv2 * inv;                  \
+    vec2 w1 = 2.0/3.0 - 0.5 * frac2 * (2.0 - frac);  \
+    vec2 w2 = 2.0/3.0 - 0.5 * inv2  * (2.0 - inv);   \
+    vec2 w3 = 1.0/6.0 * frac2 * frac;                \
+    vec4 g = vec4(w0 + w1, w2 + w3);                 \
+    vec4 h = vec4(w1, w3) / g + inv.xyxy;            \
+    h.xy -= vec2(2.0);                               \
+    /* sample four corners, then interpolate */      \
+    vec4 p = pos.xyxy + $pt.xyxy * h;                \
+    vec4 c00 = textureLod($tex, $clamp(p.xy), 0.0);  \
+    vec4 c01 = textureLod($tex, $clamp(p.xw), 0.0);  \
+    vec4 c0 = mix(c01, c00, g.y);                    \
+    vec4 c10 = textureLod($tex, $clamp(p.zy), 0.0);  \
+    vec4 c11 = textureLod($tex, $clamp(p.zw), 0.0);  \
+    vec4 c1 = mix(c11, c10, g.y);                    \
+    color = ${float:scale} * mix(c1, c0, g.x);       \
     }
 
     return true;
@@ -361,9 +414,9 @@ bool pl_shader_sample_bicubic(pl_shader sh, const struct pl_sample_src *src)
 
 bool pl_shader_sample_hermite(pl_shader sh, const struct pl_sample_src *src)
 {
-    ident_t tex, pos, pt;
+    ident_t tex, pos, pt, clamp;
     float rx, ry, scale;
-    if (!setup_src(sh, src, &tex, &pos, &pt, &rx, &ry, NULL, &scale, true, LINEAR))
+    if (!setup_src(sh, src, &tex, &pos, &pt, &clamp, &rx, &ry, NULL, &scale, true, LINEAR))
         return false;
 
     if (rx < 1 || ry < 1) {
@@ -372,14 +425,14 @@ bool pl_shader_sample_hermite(pl_shader sh, const struct pl_sample_src *src)
     }
 
     sh_describe(sh, "hermite");
-#pragma GLSL /* pl_shader_sample_hermite */              \
-    vec4 color;                                          \
-    {                                                    \
-    vec2 pos  = $pos;                                    \
-    vec2 size = vec2(textureSize($tex, 0));              \
-    vec2 frac = fract(pos * size + vec2(0.5));           \
-    pos += $pt * (smoothstep(0.0, 1.0, frac) - frac);    \
-    color = ${float:scale} * textureLod($tex, pos, 0.0); \
+#pragma GLSL /* pl_shader_sample_hermite */                      \
+    vec4 color;                                                  \
+    {                                                            \
+    vec2 pos  = $pos;                                            \
+    vec2 size = vec2(textureSize($tex, 0));                      \
+    vec2 frac = fract(pos * size + vec2(0.5));                   \
+    pos += $pt * (smoothstep(0.0, 1.0, frac) - frac);            \
+    color = ${float:scale} * textureLod($tex, $clamp(pos), 0.0); \
     }
 
     return true;
@@ -387,9 +440,9 @@ bool pl_shader_sample_hermite(pl_shader sh, const struct pl_sample_src *src)
 
 bool pl_shader_sample_gaussian(pl_shader sh, const struct pl_sample_src *src)
 {
-    ident_t tex, pos, pt;
+    ident_t tex, pos, pt, clamp;
     float rx, ry, scale;
-    if (!setup_src(sh, src, &tex, &pos, &pt, &rx, &ry, NULL, &scale, true, LINEAR))
+    if (!setup_src(sh, src, &tex, &pos, &pt, &clamp, &rx, &ry, NULL, &scale, true, LINEAR))
         return false;
 
     if (rx < 1 || ry < 1) {
@@ -398,32 +451,32 @@ bool pl_shader_sample_gaussian(pl_shader sh, const struct pl_sample_src *src)
     }
 
     sh_describe(sh, "gaussian");
-#pragma GLSL /* pl_shader_sample_gaussian */        \
-    vec4 color;                                     \
-    {                                               \
-    vec2 pos  = $pos;                               \
-    vec2 size = vec2(textureSize($tex, 0));         \
-    vec2 off  = -fract(pos * size + vec2(0.5));     \
-    vec2 off2 = -2.0 * off * off;                   \
-    /* compute gaussian weights */                  \
-    vec2 w0 = exp(off2 + 4.0 * off - vec2(2.0));    \
-    vec2 w1 = exp(off2);                            \
-    vec2 w2 = exp(off2 - 4.0 * off - vec2(2.0));    \
-    vec2 w3 = exp(off2 - 8.0 * off - vec2(8.0));    \
-    vec4 g = vec4(w0 + w1, w2 + w3);                \
-    vec4 h = vec4(w1, w3) / g;                      \
-    h.xy -= vec2(1.0);                              \
-    h.zw += vec2(1.0);                              \
-    g.xy /= g.xy + g.zw; /* explicitly normalize */ \
-    /* sample four corners, then interpolate */     \
-    vec4 p = pos.xyxy + $pt.xyxy * (h + off.xyxy);  \
-    vec4 c00 = textureLod($tex, p.xy, 0.0);         \
-    vec4 c01 = textureLod($tex, p.xw, 0.0);         \
-    vec4 c0 = mix(c01, c00, g.y);                   \
-    vec4 c10 = textureLod($tex, p.zy, 0.0);         \
-    vec4 c11 = textureLod($tex, p.zw, 0.0);         \
-    vec4 c1 = mix(c11, c10, g.y);                   \
-    color = ${float:scale} * mix(c1, c0, g.x);      \
+#pragma GLSL /* pl_shader_sample_gaussian */         \
+    vec4 color;                                      \
+    {                                                \
+    vec2 pos  = $pos;                                \
+    vec2 size = vec2(textureSize($tex, 0));          \
+    vec2 off  = -fract(pos * size + vec2(0.5));      \
+    vec2 off2 = -2.0 * off * off;                    \
+    /* compute gaussian weights */                   \
+    vec2 w0 = exp(off2 + 4.0 * off - vec2(2.0));     \
+    vec2 w1 = exp(off2);                             \
+    vec2 w2 = exp(off2 - 4.0 * off - vec2(2.0));     \
+    vec2 w3 = exp(off2 - 8.0 * off - vec2(8.0));     \
+    vec4 g = vec4(w0 + w1, w2 + w3);                 \
+    vec4 h = vec4(w1, w3) / g;                       \
+    h.xy -= vec2(1.0);                               \
+    h.zw += vec2(1.0);                               \
+    g.xy /= g.xy + g.zw; /* explicitly normalize */  \
+    /* sample four corners, then interpolate */      \
+    vec4 p = pos.xyxy + $pt.xyxy * (h + off.xyxy);   \
+    vec4 c00 = textureLod($tex, $clamp(p.xy), 0.0);  \
+    vec4 c01 = textureLod($tex, $clamp(p.xw), 0.0);  \
+    vec4 c0 = mix(c01, c00, g.y);                    \
+    vec4 c10 = textureLod($tex, $clamp(p.zy), 0.0);  \
+    vec4 c11 = textureLod($tex, $clamp(p.zw), 0.0);  \
+    vec4 c1 = mix(c11, c10, g.y);                    \
+    color = ${float:scale} * mix(c1, c0, g.x);       \
     }
 
     return true;
@@ -432,35 +485,35 @@ bool pl_shader_sample_gaussian(pl_shader sh, const struct pl_sample_src *src)
 bool pl_shader_sample_oversample(pl_shader sh, const struct pl_sample_src *src,
                                  float threshold)
 {
-    ident_t tex, pos, pt;
+    ident_t tex, pos, pt, clamp;
     float rx, ry, scale;
-    if (!setup_src(sh, src, &tex, &pos, &pt, &rx, &ry, NULL, &scale, true, LINEAR))
+    if (!setup_src(sh, src, &tex, &pos, &pt, &clamp, &rx, &ry, NULL, &scale, true, LINEAR))
         return false;
 
     threshold = PL_CLAMP(threshold, 0.0f, 0.5f);
     sh_describe(sh, "oversample");
-    #pragma GLSL /* pl_shader_sample_oversample */       \
-    vec4 color;                                          \
-    {                                                    \
-    vec2 pos = $pos;                                     \
-    vec2 size = vec2(textureSize($tex, 0));              \
-    /* Round the position to the nearest pixel */        \
-    vec2 fcoord = fract(pos * size - vec2(0.5));         \
-    float rx = ${dynamic float:rx};                      \
-    float ry = ${dynamic float:ry};                      \
-    vec2 coeff = (fcoord - vec2(0.5)) * vec2(rx, ry);    \
-    coeff = clamp(coeff + vec2(0.5), 0.0, 1.0);          \
-    @if (threshold > 0) {                                \
-        float thresh = ${float:threshold};               \
-        coeff = mix(coeff, vec2(0.0),                    \
-            lessThan(coeff, vec2(thresh)));              \
-        coeff = mix(coeff, vec2(1.0),                    \
-            greaterThan(coeff, vec2(1.0 - thresh)));     \
-    @}                                                   \
-                                                         \
-    /* Compute the right output blend of colors */       \
-    pos += (coeff - fcoord) * $pt;                       \
-    color = ${float:scale} * textureLod($tex, pos, 0.0); \
+    #pragma GLSL /* pl_shader_sample_oversample */               \
+    vec4 color;                                                  \
+    {                                                            \
+    vec2 pos = $pos;                                             \
+    vec2 size = vec2(textureSize($tex, 0));                      \
+    /* Round the position to the nearest pixel */                \
+    vec2 fcoord = fract(pos * size - vec2(0.5));                 \
+    float rx = ${dynamic float:rx};                              \
+    float ry = ${dynamic float:ry};                              \
+    vec2 coeff = (fcoord - vec2(0.5)) * vec2(rx, ry);            \
+    coeff = clamp(coeff + vec2(0.5), 0.0, 1.0);                  \
+    @if (threshold > 0) {                                        \
+        float thresh = ${float:threshold};                       \
+        coeff = mix(coeff, vec2(0.0),                            \
+            lessThan(coeff, vec2(thresh)));                      \
+        coeff = mix(coeff, vec2(1.0),                            \
+            greaterThan(coeff, vec2(1.0 - thresh)));             \
+    @}                                                           \
+                                                                 \
+    /* Compute the right output blend of colors */               \
+    pos += (coeff - fcoord) * $pt;                               \
+    color = ${float:scale} * textureLod($tex, $clamp(pos), 0.0); \
     }
 
     return true;
@@ -497,7 +550,7 @@ static void describe_filter(pl_shader sh, const struct pl_filter_config *cfg,
 // If `in` is set, takes the pixel from inX[idx] where X is the component,
 // `in` is the given identifier, and `idx` must be defined by the caller
 static void polar_sample(pl_shader sh, pl_filter filter,
-                         ident_t tex, ident_t lut, ident_t radius,
+                         ident_t tex, ident_t clamp, ident_t lut, ident_t radius,
                          int x, int y, uint8_t comp_mask, ident_t in,
                          bool use_ar, ident_t scale)
 {
@@ -517,39 +570,39 @@ static void polar_sample(pl_shader sh, pl_filter filter,
     const float ar_radius = filter->radius_zero;
     use_ar &= dmin < ar_radius;
 
-#pragma GLSL                                                    \
-    offset = ivec2(${const int: x}, ${const int: y});           \
-    d = length(vec2(offset) - fcoord);                          \
-    @if (maybe_skippable)                                       \
-        if (d < $radius) {                                      \
-    w = $lut(d * 1.0 / $radius);                                \
-    wsum += w;                                                  \
-    @if (in != NULL_IDENT) {                                    \
-        @for (c : comp_mask)                                    \
-            c[@c] = ${in}_@c[idx];                              \
-    @} else {                                                   \
-        c = textureLod($tex, base + pt * vec2(offset), 0.0);    \
-    @}                                                          \
-    @for (c : comp_mask)                                        \
-        color[@c] += w * c[@c];                                 \
-    @if (use_ar) {                                              \
-        if (d <= ${const float: ar_radius}) {                   \
-            @for (c : comp_mask) {                              \
-                cc = vec2($scale * c[@c]);                      \
-                cc.x = 1.0 - cc.x;                              \
-                ww = cc + vec2(0.10);                           \
-                ww = ww * ww;                                   \
-                ww = ww * ww;                                   \
-                ww = ww * ww;                                   \
-                ww = ww * ww;                                   \
-                ww = ww * ww;                                   \
-                ww = w * ww;                                    \
-                ar@c += ww * cc;                                \
-                wwsum@c += ww;                                  \
-            @}                                                  \
-        }                                                       \
-    @}                                                          \
-    @if (maybe_skippable)                                       \
+#pragma GLSL                                                         \
+    offset = ivec2(${const int: x}, ${const int: y});                \
+    d = length(vec2(offset) - fcoord);                               \
+    @if (maybe_skippable)                                            \
+        if (d < $radius) {                                           \
+    w = $lut(d * 1.0 / $radius);                                     \
+    wsum += w;                                                       \
+    @if (in != NULL_IDENT) {                                         \
+        @for (c : comp_mask)                                         \
+            c[@c] = ${in}_@c[idx];                                   \
+    @} else {                                                        \
+        c = textureLod($tex, $clamp(base + pt * vec2(offset)), 0.0); \
+    @}                                                               \
+    @for (c : comp_mask)                                             \
+        color[@c] += w * c[@c];                                      \
+    @if (use_ar) {                                                   \
+        if (d <= ${const float: ar_radius}) {                        \
+            @for (c : comp_mask) {                                   \
+                cc = vec2($scale * c[@c]);                           \
+                cc.x = 1.0 - cc.x;                                   \
+                ww = cc + vec2(0.10);                                \
+                ww = ww * ww;                                        \
+                ww = ww * ww;                                        \
+                ww = ww * ww;                                        \
+                ww = ww * ww;                                        \
+                ww = ww * ww;                                        \
+                ww = w * ww;                                         \
+                ar@c += ww * cc;                                     \
+                wwsum@c += ww;                                       \
+            @}                                                       \
+        }                                                            \
+    @}                                                               \
+    @if (maybe_skippable)                                            \
         }
 }
 
@@ -591,8 +644,8 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
 
     uint8_t cmask;
     float rx, ry, scalef;
-    ident_t src_tex, pos, pt, scale;
-    if (!setup_src(sh, src, &src_tex, &pos, &pt, &rx, &ry, &cmask, &scalef, false, FASTEST))
+    ident_t src_tex, pos, pt, clamp, scale;
+    if (!setup_src(sh, src, &src_tex, &pos, &pt, &clamp, &rx, &ry, &cmask, &scalef, false, FASTEST))
         return false;
 
     struct sh_sampler_obj *obj;
@@ -741,8 +794,8 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
         // Load all relevant texels into shmem
         GLSL("for (int y = int(gl_LocalInvocationID.y); y < "$"; y += %d) {     \n"
              "for (int x = int(gl_LocalInvocationID.x); x < "$"; x += %d) {     \n"
-             "c = textureLod("$", "$"_base + pt * vec2(x - %d, y - %d), 0.0);   \n",
-             ih_c, bh, iw_c, bw, src_tex, in, offset, offset);
+             "c = textureLod("$", "$"("$"_base + pt * vec2(x - %d, y - %d)), 0.0); \n",
+             ih_c, bh, iw_c, bw, src_tex, clamp, in, offset, offset);
 
         for (uint8_t comps = cmask; comps;) {
             uint8_t c = __builtin_ctz(comps);
@@ -759,7 +812,7 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
             for (int x = 1 - bound; x <= bound; x++) {
                 GLSL("idx = "$" * rel.y + rel.x + "$" * %d + %d; \n",
                      sizew_c, sizew_c, y + offset, x + offset);
-                polar_sample(sh, obj->filter, src_tex, lut, radius_c,
+                polar_sample(sh, obj->filter, src_tex, clamp, lut, radius_c,
                              x, y, cmask, in, use_ar, scale);
             }
         }
@@ -805,6 +858,7 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
                 use_gather &= PL_MAX(x, y) <= sh_glsl(sh).max_gather_offset;
                 use_gather &= PL_MIN(x, y) >= sh_glsl(sh).min_gather_offset;
                 use_gather &= !src->tex || src->tex->params.format->gatherable;
+                use_gather &= !src_bounded(src); // gathering can't be clamped
 
                 // Gathering from components other than the R channel requires
                 // support for GLSL 400, which introduces the overload of
@@ -817,7 +871,7 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
 
                 if (!use_gather) {
                     // Switch to direct sampling instead
-                    polar_sample(sh, obj->filter, src_tex, lut, radius_c,
+                    polar_sample(sh, obj->filter, src_tex, clamp, lut, radius_c,
                                  x, y, cmask, NULL_IDENT, use_ar, scale);
                     continue;
                 }
@@ -857,7 +911,7 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
                         continue; // next subpixel
 
                     GLSL("idx = %d;\n", p);
-                    polar_sample(sh, obj->filter, src_tex, lut, radius_c,
+                    polar_sample(sh, obj->filter, src_tex, clamp, lut, radius_c,
                                  x+xo[p], y+yo[p], cmask, in, use_ar, scale);
                 }
 
@@ -936,8 +990,8 @@ bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
 
     uint8_t comps;
     float ratio[SEP_PASSES], scale;
-    ident_t src_tex, pos, pt;
-    if (!setup_src(sh, src, &src_tex, &pos, &pt,
+    ident_t src_tex, pos, pt, clamp;
+    if (!setup_src(sh, src, &src_tex, &pos, &pt, &clamp,
                    &ratio[SEP_HORIZ], &ratio[SEP_VERT],
                    &comps, &scale, false, LINEAR))
         return false;
@@ -1058,7 +1112,8 @@ bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
         @if @(n % 4 == 0)                                                       \
             ws = $lut(vec2(float(@n / 4) / ${const float: denom}, fcoord));     \
         @if @(vars.use_ar && (n == vars.n / 2 - 1 || n == vars.n / 2)) {        \
-            c = textureLod($src_tex, base + pt * @n.0, 0.0).${swizzle: comps};  \
+            c = textureLod($src_tex, $clamp(base + pt * @n.0),                  \
+                           0.0).${swizzle: comps};                              \
             ca += ws[@n % 4] * c;                                               \
             lo = min(lo, c);                                                    \
             hi = max(hi, c);                                                    \
@@ -1066,11 +1121,13 @@ bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
             @if (use_linear) {                                                  \
                 @if @(n % 2 == 0) {                                             \
                     off = @n.0 + ws[@n % 4 + 1];                                \
-                    ca += ws[@n % 4] * textureLod($src_tex, base + pt * off,    \
+                    ca += ws[@n % 4] * textureLod($src_tex,                     \
+                                                  $clamp(base + pt * off),      \
                                                   0.0).${swizzle: comps};       \
                 @}                                                              \
             @} else {                                                           \
-                ca += ws[@n % 4] * textureLod($src_tex, base + pt * @n.0,       \
+                ca += ws[@n % 4] * textureLod($src_tex,                         \
+                                              $clamp(base + pt * @n.0),         \
                                               0.0).${swizzle: comps};           \
             @}                                                                  \
         @}                                                                      \
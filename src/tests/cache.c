@@ -1,4 +1,5 @@
 #include "tests.h"
+#include "pl_thread.h"
 
 #include <libplacebo/cache.h>
 
@@ -12,6 +13,19 @@ static pl_cache_obj lookup_foobar(void *priv, uint64_t key)
     };
 }
 
+struct membuf {
+    uint8_t data[1024];
+    size_t size;
+};
+
+static void write_membuf(void *priv, size_t size, const void *ptr)
+{
+    struct membuf *buf = priv;
+    REQUIRE(buf->size + size <= sizeof(buf->data));
+    memcpy(buf->data + buf->size, ptr, size);
+    buf->size += size;
+}
+
 static void update_count(void *priv, pl_cache_obj obj)
 {
     int *count = priv;
@@ -180,6 +194,138 @@ int main()
     pl_cache_obj_free(&obj5);
     pl_cache_obj_free(&obj6);
 
+    // Test many objects, forcing the hash table to grow
+    pl_cache test3 = pl_cache_create(pl_cache_params(
+        .log            = log,
+        .max_total_size = 1000 * sizeof(uint64_t),
+    ));
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        pl_cache_obj obj = { .key = i * KEY1, .data = &i, .size = sizeof(i) };
+        REQUIRE(pl_cache_try_set(test3, &obj));
+    }
+    REQUIRE_CMP(pl_cache_objects(test3), ==, 1000, "d");
+    REQUIRE_CMP(pl_cache_size(test3), ==, 1000 * sizeof(uint64_t), "zu");
+
+    for (uint64_t i = 0; i < 1000; i += 7) {
+        pl_cache_obj obj = { .key = i * KEY1 };
+        REQUIRE(pl_cache_get(test3, &obj));
+        REQUIRE_MEMEQ(obj.data, &i, sizeof(i));
+        pl_cache_obj_free(&obj);
+    }
+    REQUIRE_CMP(pl_cache_objects(test3), ==, 1000 - 143, "d");
+
+    // Touching the oldest object should protect it from being evicted
+    pl_cache_obj oldest = { .key = 1 * KEY1 };
+    REQUIRE(pl_cache_get(test3, &oldest));
+    pl_cache_set(test3, &oldest);
+    for (uint64_t i = 1000; i < 1000 + 143 + 2; i++) {
+        pl_cache_obj obj = { .key = i * KEY1, .data = &i, .size = sizeof(i) };
+        REQUIRE(pl_cache_try_set(test3, &obj));
+    }
+    REQUIRE_CMP(pl_cache_objects(test3), ==, 1000, "d");
+    oldest = (pl_cache_obj) { .key = 1 * KEY1 };
+    REQUIRE(pl_cache_get(test3, &oldest));
+    pl_cache_obj_free(&oldest);
+    pl_cache_obj evicted = { .key = 2 * KEY1 };
+    REQUIRE(!pl_cache_get(test3, &evicted));
+    pl_cache_destroy(&test3);
+
+    // Test sharded cache
+    test3 = pl_cache_create(pl_cache_params(
+        .log            = log,
+        .num_shards     = 3,
+        .max_total_size = 4 * 100 * sizeof(uint64_t),
+    ));
+    REQUIRE_CMP(test3->params.num_shards, ==, 4, "d");
+    REQUIRE_CMP(test3->params.max_object_size, ==, 100 * sizeof(uint64_t), "zu");
+
+    for (uint64_t i = 0; i < 100; i++) {
+        pl_cache_obj obj = { .key = i * KEY2, .data = &i, .size = sizeof(i) };
+        REQUIRE(pl_cache_try_set(test3, &obj));
+    }
+    REQUIRE_CMP(pl_cache_objects(test3), ==, 100, "d");
+    REQUIRE_CMP(pl_cache_size(test3), ==, 100 * sizeof(uint64_t), "zu");
+
+    size_t saved_size = pl_cache_save(test3, NULL, 0);
+    uint8_t *saved = malloc(saved_size);
+    REQUIRE_CMP(pl_cache_save(test3, saved, saved_size), ==, saved_size, "zu");
+    test2 = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE_CMP(pl_cache_load(test2, saved, saved_size), ==, 100, "d");
+    free(saved);
+
+    for (uint64_t i = 0; i < 100; i++) {
+        pl_cache_obj obj = { .key = i * KEY2 };
+        REQUIRE(pl_cache_get(test3, &obj));
+        REQUIRE_MEMEQ(obj.data, &i, sizeof(i));
+        pl_cache_obj_free(&obj);
+        REQUIRE(pl_cache_get(test2, &obj));
+        REQUIRE_MEMEQ(obj.data, &i, sizeof(i));
+        pl_cache_obj_free(&obj);
+    }
+    REQUIRE_CMP(pl_cache_objects(test3), ==, 0, "d");
+    REQUIRE_CMP(pl_cache_contention(test3), ==, 0, PRIu64);
+    pl_cache_destroy(&test2);
+    pl_cache_destroy(&test3);
+
+    // Test memory-mapped format
+    test3 = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE(pl_cache_try_set(test3, &(pl_cache_obj) { .key = KEY1, .data = "abc",  .size = 3 }));
+    REQUIRE(pl_cache_try_set(test3, &(pl_cache_obj) { .key = KEY2, .data = "de",   .size = 2 }));
+    REQUIRE(pl_cache_try_set(test3, &(pl_cache_obj) { .key = KEY3, .data = "xyzw", .size = 4 }));
+    static struct membuf mapped;
+    REQUIRE_CMP(pl_cache_save_mapped_ex(test3, write_membuf, &mapped), ==, 3, "d");
+    REQUIRE_CMP(mapped.size, ==, 128 + 3 * 64, "zu"); // aligned header + objects
+    REQUIRE_CMP(pl_cache_save_mapped_ex(test3, write_membuf, &(struct membuf) {0}), ==, 3, "d");
+
+    test2 = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE_CMP(pl_cache_load_mapped(test2, mapped.data, mapped.size), ==, 3, "d");
+    REQUIRE_CMP(pl_cache_size(test2), ==, 9, "zu");
+    obj1 = (pl_cache_obj) { .key = KEY1 };
+    REQUIRE(pl_cache_get(test2, &obj1));
+    REQUIRE(obj1.data != &mapped.data[128]); // copied on retrieval
+    REQUIRE_MEMEQ(obj1.data, "abc", 3);
+    pl_cache_set(test2, &obj1);
+    mapped.data[128 + 2 * 64] = 'X'; // corrupt KEY3
+    obj3 = (pl_cache_obj) { .key = KEY3 };
+    REQUIRE(!pl_cache_get(test2, &obj3));
+    obj2 = (pl_cache_obj) { .key = KEY2 };
+    REQUIRE(pl_cache_get(test2, &obj2));
+    REQUIRE_MEMEQ(obj2.data, "de", 2);
+    pl_cache_obj_free(&obj2);
+    REQUIRE_CMP(pl_cache_objects(test2), ==, 1, "d");
+    pl_cache_destroy(&test2);
+
+    // Legacy format should be accepted as well
+    mapped.size = pl_cache_save(test3, mapped.data, sizeof(mapped.data));
+    test2 = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE_CMP(pl_cache_load_mapped(test2, mapped.data, mapped.size), ==, 3, "d");
+    REQUIRE_CMP(pl_cache_load_mapped(test2, mapped.data, 5), <, 0, "d");
+    pl_cache_destroy(&test2);
+
+    static const char *mapped_path = "test_cache_mapped.bin";
+    FILE *file = fopen(mapped_path, "wb");
+    REQUIRE(file);
+    REQUIRE_CMP(pl_cache_save_mapped_file(test3, file), ==, 3, "d");
+    fclose(file);
+    test2 = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE_CMP(pl_cache_load_mapped_file(test2, mapped_path), ==, 3, "d");
+    obj3 = (pl_cache_obj) { .key = KEY3 };
+    REQUIRE(pl_cache_get(test2, &obj3));
+    REQUIRE_MEMEQ(obj3.data, "xyzw", 4);
+    pl_cache_set(test2, &obj3);
+
+    // Retrieved objects must outlive the mapping
+    pl_cache_reset(test2);
+    REQUIRE_CMP(pl_cache_load_mapped_file(test2, mapped_path), ==, 3, "d");
+    obj2 = (pl_cache_obj) { .key = KEY2 };
+    REQUIRE(pl_cache_get(test2, &obj2));
+    pl_cache_destroy(&test2);
+    REQUIRE_MEMEQ(obj2.data, "de", 2);
+    pl_cache_obj_free(&obj2);
+    remove(mapped_path);
+    pl_cache_destroy(&test3);
+
     // Test callback API
     int num_objects = 0;
     test2 = pl_cache_create(pl_cache_params(
@@ -209,6 +355,103 @@ int main()
     REQUIRE_CMP(num_objects, ==, 1, "d");
     pl_cache_destroy(&test2);
 
+    // Test journaled backend
+    static const char *journal_path = "test_cache_journal.bin";
+    remove(journal_path);
+    pl_cache_journal journal = pl_cache_journal_create(pl_cache_journal_params(
+        .log  = log,
+        .path = journal_path,
+    ));
+    REQUIRE(journal);
+    const size_t journal_empty = pl_cache_journal_size(journal);
+
+    test2 = pl_cache_create(pl_cache_params(
+        .log  = log,
+        .get  = pl_cache_journal_get,
+        .set  = pl_cache_journal_set,
+        .priv = journal,
+    ));
+    pl_cache_set(test2, &(pl_cache_obj) { .key = KEY1, .data = "abc",  .size = 3 });
+    pl_cache_set(test2, &(pl_cache_obj) { .key = KEY2, .data = "de",   .size = 2 });
+    pl_cache_set(test2, &(pl_cache_obj) { .key = KEY3, .data = "xyzw", .size = 4 });
+    const size_t journal_full = pl_cache_journal_size(journal);
+    REQUIRE(journal_full > journal_empty);
+
+    // Re-inserting unmodified objects should not grow the journal
+    obj1 = (pl_cache_obj) { .key = KEY1 };
+    REQUIRE(pl_cache_get(test2, &obj1));
+    pl_cache_set(test2, &obj1);
+    REQUIRE_CMP(pl_cache_journal_size(journal), ==, journal_full, "zu");
+
+    pl_cache_set(test2, &(pl_cache_obj) { .key = KEY2 }); // delete KEY2
+    pl_cache_set(test2, &(pl_cache_obj) { .key = KEY3, .data = "uvw", .size = 3 });
+    pl_cache_destroy(&test2);
+    pl_cache_journal_destroy(&journal);
+
+    // Append some garbage, simulating a torn write
+    file = fopen(journal_path, "ab");
+    REQUIRE(file);
+    fwrite("garbage", 1, 7, file);
+    fclose(file);
+
+    journal = pl_cache_journal_create(pl_cache_journal_params(
+        .log  = log,
+        .path = journal_path,
+    ));
+    REQUIRE(journal);
+    REQUIRE(pl_cache_journal_size(journal) < journal_full); // compacted
+    test2 = pl_cache_create(pl_cache_params(
+        .log  = log,
+        .get  = pl_cache_journal_get,
+        .set  = pl_cache_journal_set,
+        .priv = journal,
+    ));
+    REQUIRE_CMP(pl_cache_objects(test2), ==, 0, "d");
+    obj1 = (pl_cache_obj) { .key = KEY1 };
+    obj2 = (pl_cache_obj) { .key = KEY2 };
+    obj3 = (pl_cache_obj) { .key = KEY3 };
+    REQUIRE(pl_cache_get(test2, &obj1));
+    REQUIRE(!pl_cache_get(test2, &obj2));
+    REQUIRE(pl_cache_get(test2, &obj3));
+    REQUIRE_MEMEQ(obj1.data, "abc", 3);
+    REQUIRE_CMP(obj3.size, ==, 3, "zu");
+    REQUIRE_MEMEQ(obj3.data, "uvw", 3);
+    pl_cache_set(test2, &obj1);
+    pl_cache_set(test2, &obj3);
+
+    pl_cache_set(test2, &(pl_cache_obj) { .key = KEY3 }); // delete KEY3
+    REQUIRE(pl_cache_journal_compact(journal));
+    REQUIRE_CMP(pl_cache_journal_size(journal), ==, journal_empty + 24 + 4, "zu");
+    obj1 = (pl_cache_obj) { .key = KEY1 };
+    REQUIRE(pl_cache_get(test2, &obj1));
+    REQUIRE_MEMEQ(obj1.data, "abc", 3);
+    pl_cache_obj_free(&obj1);
+    pl_cache_destroy(&test2);
+    pl_cache_journal_destroy(&journal);
+    remove(journal_path);
+
+    // With a threshold of 0, stale records should never be compacted away
+    journal = pl_cache_journal_create(pl_cache_journal_params(
+        .log  = log,
+        .path = journal_path,
+        .compact_threshold = 0,
+    ));
+    REQUIRE(journal);
+    pl_cache_journal_set(journal, (pl_cache_obj) { .key = KEY1, .data = "abc", .size = 3 });
+    const size_t journal_record = pl_cache_journal_size(journal) - journal_empty;
+    for (int i = 0; i < 64; i++) {
+        pl_cache_journal_set(journal, (pl_cache_obj) {
+            .key = KEY1,
+            .data = (i & 1) ? "abc" : "def",
+            .size = 3,
+        });
+    }
+    pl_thread_sleep(1e-2);
+    REQUIRE_CMP(pl_cache_journal_size(journal), ==,
+                journal_empty + 65 * journal_record, "zu");
+    pl_cache_journal_destroy(&journal);
+    remove(journal_path);
+
     pl_cache_destroy(&test);
     pl_log_destroy(&log);
     return 0;
@@ -1,6 +1,654 @@
 #include "gpu_tests.h"
 
 #include <libplacebo/dummy.h>
+#include <libplacebo/renderer.h>
+#include <libplacebo/utils/upload.h>
+
+static void upload_done(void *priv)
+{
+    (*(int *) priv)++;
+}
+
+#define QUEUE_PRODUCERS 4
+#define QUEUE_FRAMES    50
+
+struct producer {
+    pl_queue queue;
+    const struct pl_source_frame *frames;
+    int start, stride, num;
+};
+
+static bool frame_map_slow(pl_gpu gpu, pl_tex *tex,
+                           const struct pl_source_frame *src,
+                           struct pl_frame *out_frame)
+{
+    pl_thread_sleep(1e-4); // simulate an upload
+    return frame_passthrough(gpu, tex, src, out_frame);
+}
+
+static PL_THREAD_VOID producer_thread(void *arg)
+{
+    struct producer *pr = arg;
+    for (int i = pr->start; i < pr->num; i += pr->stride)
+        pl_queue_push(pr->queue, &pr->frames[i]);
+    PL_THREAD_RETURN();
+}
+
+// Push frames from several threads at once, both ahead of and concurrently
+// with consuming them
+static void queue_tests(pl_gpu gpu)
+{
+    static struct pl_frame image = {0};
+    const int num_frames = QUEUE_PRODUCERS * QUEUE_FRAMES;
+    const float frame_duration = 1.0 / 24.0;
+    struct pl_source_frame frames[QUEUE_PRODUCERS * QUEUE_FRAMES];
+    for (int i = 0; i < num_frames; i++) {
+        frames[i] = (struct pl_source_frame) {
+            .pts = i * frame_duration,
+            .duration = frame_duration,
+            .map = frame_passthrough,
+            .frame_data = &image,
+        };
+    }
+
+    pl_queue queue = pl_queue_create(gpu);
+    struct producer producers[QUEUE_PRODUCERS];
+    pl_thread threads[QUEUE_PRODUCERS];
+    for (int i = 0; i < QUEUE_PRODUCERS; i++) {
+        producers[i] = (struct producer) {
+            .queue = queue,
+            .frames = frames,
+            .start = i,
+            .stride = QUEUE_PRODUCERS,
+            .num = num_frames,
+        };
+        REQUIRE(!pl_thread_create(&threads[i], producer_thread, &producers[i]));
+    }
+    for (int i = 0; i < QUEUE_PRODUCERS; i++)
+        pl_thread_join(threads[i]);
+    pl_queue_push(queue, NULL);
+
+    REQUIRE_CMP(pl_queue_num_frames(queue), ==, num_frames, "d");
+    for (int i = 0; i < num_frames; i++) {
+        struct pl_source_frame src;
+        REQUIRE(pl_queue_peek(queue, i, &src));
+        REQUIRE_FEQ(src.pts, frames[i].pts, 1e-6);
+    }
+
+    struct pl_queue_stats stats = pl_queue_get_stats(queue);
+    REQUIRE_CMP(stats.pushed_async + stats.pushed_locked, ==, (uint64_t) num_frames, PRIu64);
+    REQUIRE_CMP(stats.pushed_async, >, 0, PRIu64);
+    REQUIRE_CMP(stats.rendered, ==, 0, PRIu64);
+
+    struct pl_queue_params qparams = { .timeout = UINT64_MAX };
+    struct pl_frame_mix mix;
+    enum pl_queue_status ret;
+    while ((ret = pl_queue_update(queue, &mix, &qparams)) != PL_QUEUE_EOF) {
+        REQUIRE_CMP(ret, ==, PL_QUEUE_OK, "u");
+        REQUIRE_CMP(mix.num_frames, >=, 1, "d");
+        qparams.pts += frame_duration;
+    }
+
+    stats = pl_queue_get_stats(queue);
+    REQUIRE_CMP(stats.rendered, ==, (uint64_t) num_frames, PRIu64);
+    REQUIRE_CMP(stats.latency_avg, >, 0.0, "f");
+    REQUIRE_CMP(stats.latency_max, >=, stats.latency_avg, "f");
+
+    // Consume while a single producer is still pushing, so that the
+    // renderer has to block waiting for lock-free pushes
+    pl_queue_reset(queue);
+    stats = pl_queue_get_stats(queue);
+    REQUIRE_CMP(stats.rendered, ==, 0, PRIu64);
+
+    producers[0].stride = 1;
+    REQUIRE(!pl_thread_create(&threads[0], producer_thread, &producers[0]));
+    qparams.pts = 0.0;
+    for (int i = 0; i < num_frames; i++) {
+        REQUIRE_CMP(pl_queue_update(queue, &mix, &qparams), ==, PL_QUEUE_OK, "u");
+        REQUIRE_CMP(mix.num_frames, >=, 1, "d");
+        qparams.pts += frame_duration;
+    }
+    pl_thread_join(threads[0]);
+
+    pl_queue_push(queue, NULL);
+    while ((ret = pl_queue_update(queue, &mix, &qparams)) != PL_QUEUE_EOF) {
+        REQUIRE_CMP(ret, ==, PL_QUEUE_OK, "u");
+        qparams.pts += frame_duration;
+    }
+    stats = pl_queue_get_stats(queue);
+    REQUIRE_CMP(stats.pushed_async + stats.pushed_locked, ==, (uint64_t) num_frames, PRIu64);
+    REQUIRE_CMP(stats.rendered, ==, (uint64_t) num_frames, PRIu64);
+    REQUIRE_CMP(stats.mapped_async, ==, 0, PRIu64);
+
+    // Map frames ahead of time on background threads
+    pl_queue_reset(queue);
+    for (int i = 0; i < num_frames; i++) {
+        frames[i].map = frame_map_slow;
+        pl_queue_push(queue, &frames[i]);
+    }
+    pl_queue_push(queue, NULL);
+
+    qparams = (struct pl_queue_params) {
+        .vsync_duration = frame_duration,
+        .map_threads = 2,
+    };
+    while ((ret = pl_queue_update(queue, &mix, &qparams)) != PL_QUEUE_EOF) {
+        REQUIRE_CMP(ret, ==, PL_QUEUE_OK, "u");
+        REQUIRE_CMP(mix.num_frames, >=, 1, "d");
+        pl_thread_sleep(1e-3); // simulate rendering
+        qparams.pts += frame_duration;
+    }
+
+    stats = pl_queue_get_stats(queue);
+    REQUIRE_CMP(stats.rendered, ==, (uint64_t) num_frames, PRIu64);
+    REQUIRE_CMP(stats.mapped_async, >, 0, PRIu64);
+    REQUIRE_CMP(stats.mapped_async + stats.mapped_sync, ==, (uint64_t) num_frames, PRIu64);
+
+    pl_queue_destroy(&queue);
+}
+
+// Upload plane layouts without any matching texture format, which forces
+// them through the CPU conversion path
+static void upload_tests(pl_gpu gpu)
+{
+    enum { w = 37, h = 19 };
+    pl_tex tex = NULL;
+    struct pl_plane plane;
+    int done = 0;
+
+    // rgb565, converted to 8-bit components
+    uint16_t rgb565[w * h];
+    for (int i = 0; i < w * h; i++)
+        rgb565[i] = (i * 7919u) & 0xFFFF;
+
+    struct pl_plane_data data = {
+        .type           = PL_FMT_UNORM,
+        .width          = w,
+        .height         = h,
+        .pixel_stride   = sizeof(uint16_t),
+        .pixels         = rgb565,
+        .callback       = upload_done,
+        .priv           = &done,
+    };
+
+    pl_plane_data_from_mask(&data, (uint64_t[4]){ 0xF800, 0x07E0, 0x001F });
+    REQUIRE(!pl_plane_find_fmt(gpu, NULL, &data));
+    REQUIRE(pl_upload_plane(gpu, &plane, &tex, &data));
+    REQUIRE_CMP(done, ==, 1, "d");
+    REQUIRE_CMP(tex->params.format->texel_size, ==, 3, "zu");
+    REQUIRE_CMP(plane.components, ==, 3, "d");
+    for (int c = 0; c < 3; c++)
+        REQUIRE_CMP(plane.component_mapping[c], ==, data.component_map[c], "d");
+
+    const uint8_t *rgb8 = pl_tex_dummy_data(tex);
+    for (int i = 0; i < w * h; i++) {
+        const int r = rgb565[i] >> 11, g = (rgb565[i] >> 5) & 0x3F, b = rgb565[i] & 0x1F;
+        const int in[3] = { b, g, r }, max[3] = { 31, 63, 31 };
+        for (int c = 0; c < 3; c++) {
+            REQUIRE_FEQ(rgb8[3 * i + c] / 255.0, in[c] / (double) max[c], 0.5 / 255);
+        }
+    }
+
+    // x2rgb10, converted to 16-bit components
+    uint32_t rgb10[w * h];
+    for (int i = 0; i < w * h; i++)
+        rgb10[i] = i * 2654435761u;
+
+    data.pixel_stride = sizeof(uint32_t);
+    data.pixels = rgb10;
+    pl_plane_data_from_mask(&data, (uint64_t[4]){ 0x3FF00000, 0xFFC00, 0x3FF });
+    REQUIRE(pl_upload_plane(gpu, &plane, &tex, &data));
+    REQUIRE_CMP(done, ==, 2, "d");
+    REQUIRE_CMP(tex->params.format->texel_size, ==, 6, "zu");
+
+    const uint16_t *rgb16 = (uint16_t *) pl_tex_dummy_data(tex);
+    for (int i = 0; i < w * h; i++) {
+        for (int c = 0; c < 3; c++) {
+            const int in = (rgb10[i] >> (10 * c)) & 0x3FF;
+            REQUIRE_FEQ(rgb16[3 * i + c] / 65535.0, in / 1023.0, 0.5 / 65535);
+        }
+    }
+
+    // Both conversions should have shared the same staging buffer
+    struct pl_buf_pool_stats stats = pl_buf_pool_stats(gpu);
+    REQUIRE_CMP(stats.misses, ==, 1, PRIu64);
+    REQUIRE_CMP(stats.hits, ==, 1, PRIu64);
+    REQUIRE_CMP(stats.num_pooled, ==, 1, "d");
+    REQUIRE_CMP(stats.bytes_recycled, ==, stats.pooled_bytes, PRIu64);
+
+    // Byte-swapped data needs compute shaders, or else conversion
+    if (!gpu->limits.max_ssbo_size) {
+        uint8_t rgba16be[w * h * 8];
+        for (int i = 0; i < sizeof(rgba16be); i++)
+            rgba16be[i] = i * 13;
+
+        data.pixel_stride = 8;
+        data.pixels = rgba16be;
+        data.swapped = true;
+        pl_plane_data_from_mask(&data, (uint64_t[4]){ 0xFFFF, 0xFFFF0000,
+                                                      0xFFFF00000000,
+                                                      0xFFFF000000000000 });
+        REQUIRE(pl_upload_plane(gpu, &plane, &tex, &data));
+        REQUIRE_CMP(done, ==, 3, "d");
+
+        rgb16 = (uint16_t *) pl_tex_dummy_data(tex);
+        for (int i = 0; i < w * h * 4; i++) {
+            const int in = rgba16be[2 * i] << 8 | rgba16be[2 * i + 1];
+            REQUIRE_CMP(rgb16[i], ==, in, "d");
+        }
+    }
+
+    pl_tex_destroy(gpu, &tex);
+}
+
+// Returns the gamut mapping 3DLUT generated by `pl_shader_color_map_ex`
+static const uint16_t *get_gamut_lut(pl_gpu gpu, pl_shader sh, pl_shader_obj *state,
+                                     const struct pl_color_map_params *params)
+{
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+    pl_shader_color_map_ex(sh, params, pl_color_map_args(
+        .src    = pl_color_space_bt2020_hlg,
+        .dst    = pl_color_space_srgb,
+        .state  = state,
+    ));
+
+    const struct pl_shader_res *res = pl_shader_finalize(sh);
+    REQUIRE(res);
+    for (int n = 0; n < res->num_descriptors; n++) {
+        pl_tex tex = res->descriptors[n].binding.object;
+        if (res->descriptors[n].desc.type == PL_DESC_SAMPLED_TEX && tex->params.d)
+            return (uint16_t *) pl_tex_dummy_data(tex);
+    }
+
+    return NULL;
+}
+
+// Progressive gamut LUTs should start out as an upsampled version of the
+// full LUT, and eventually converge to it
+static void progressive_lut_tests(pl_gpu gpu)
+{
+    enum { size_I = 9, size_C = 7, size_h = 17 };
+    pl_shader sh = pl_shader_alloc(gpu->log, NULL);
+    struct pl_color_map_params params = pl_color_map_default_params;
+    params.lut3d_size[0] = size_I;
+    params.lut3d_size[1] = size_C;
+    params.lut3d_size[2] = size_h;
+
+    pl_shader_obj ref_state = NULL, state = NULL;
+    const uint16_t (*ref)[size_C][size_I][4], (*lut)[size_C][size_I][4];
+    ref = (void *) get_gamut_lut(gpu, sh, &ref_state, &params);
+    params.lut3d_progressive = true;
+    lut = (void *) get_gamut_lut(gpu, sh, &state, &params);
+    REQUIRE(ref && lut);
+
+    int num_exact = 0;
+    for (int h = 0; h < size_h; h++) {
+        for (int C = 0; C < size_C; C++) {
+            for (int I = 0; I < size_I; I++) {
+                bool exact = !memcmp(lut[h][C][I], ref[h][C][I], 3 * sizeof(uint16_t));
+                if (h % 2 == 0 && C % 2 == 0 && I % 2 == 0)
+                    REQUIRE(exact);
+                num_exact += exact;
+            }
+        }
+    }
+    REQUIRE_CMP(num_exact, <, size_I * size_C * size_h, "d");
+
+    int calls = 1;
+    while (memcmp(lut, ref, sizeof(*ref) * size_h) && calls < 100) {
+        lut = (void *) get_gamut_lut(gpu, sh, &state, &params);
+        calls++;
+    }
+    REQUIRE_CMP(calls, >, 1, "d");
+    REQUIRE_CMP(calls, <, 100, "d");
+
+    pl_shader_obj_destroy(&ref_state);
+    pl_shader_obj_destroy(&state);
+    pl_shader_free(&sh);
+}
+
+#ifdef PL_HAVE_CPU_EXEC
+
+// Upscale a flat image through the full rendering pipeline, which should
+// preserve the color (up to dithering noise)
+static void cpu_render_tests(pl_gpu gpu)
+{
+    enum { src_w = 64, src_h = 48, dst_w = 160, dst_h = 120 };
+    static uint8_t src[src_h][src_w][4], dst[dst_h][dst_w][4];
+    static const uint8_t color[4] = { 64, 128, 192, 255 };
+    for (int y = 0; y < src_h; y++) {
+        for (int x = 0; x < src_w; x++)
+            memcpy(src[y][x], color, sizeof(color));
+    }
+
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba8");
+    REQUIRE(fmt);
+    pl_tex img = pl_tex_create(gpu, pl_tex_params(
+        .w = src_w,
+        .h = src_h,
+        .format = fmt,
+        .sampleable = true,
+        .initial_data = src,
+    ));
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .w = dst_w,
+        .h = dst_h,
+        .format = fmt,
+        .renderable = true,
+        .host_readable = true,
+        .blit_dst = true,
+    ));
+
+    REQUIRE(img && fbo);
+    pl_renderer rr = pl_renderer_create(gpu->log, gpu);
+    struct pl_frame image, target;
+    pl_frame_from_swapchain(&target, &(struct pl_swapchain_frame) {
+        .fbo = fbo,
+        .flipped = false,
+        .color_repr = pl_color_repr_rgb,
+        .color_space = pl_color_space_srgb,
+    });
+
+    image = (struct pl_frame) {
+        .num_planes = 1,
+        .planes = {{
+            .texture = img,
+            .components = 4,
+            .component_mapping = {0, 1, 2, 3},
+        }},
+        .repr = pl_color_repr_rgb,
+        .color = pl_color_space_srgb,
+    };
+
+    // Render twice, to measure the time without shader compilation
+    struct pl_renderer_fbo_stats stats[2];
+    for (int i = 0; i < 2; i++) {
+        pl_clock_t start = pl_clock_now();
+        REQUIRE(pl_render_image(rr, &image, &target, &pl_render_high_quality_params));
+        pl_gpu_finish(gpu);
+        stats[i] = pl_renderer_get_fbo_stats(rr);
+        if (i) {
+            printf("Rendered %dx%d -> %dx%d on the CPU in %.3f ms\n", src_w, src_h,
+                   dst_w, dst_h, pl_clock_diff(pl_clock_now(), start) * 1e3);
+        }
+    }
+
+    // The second pass should have reused all intermediate textures
+    REQUIRE_CMP(stats[0].misses, >, 0, PRIu64);
+    REQUIRE_CMP(stats[1].misses, ==, stats[0].misses, PRIu64);
+    REQUIRE_CMP(stats[1].hits, >, stats[0].hits, PRIu64);
+    REQUIRE_CMP(stats[1].num_fbos, ==, stats[0].misses, "d");
+    REQUIRE_CMP(stats[1].vram_bytes, >=, src_w * src_h * 4, "zu");
+    REQUIRE_CMP(stats[1].frame_bytes, ==, stats[1].vram_bytes, "zu");
+    REQUIRE_CMP(stats[1].frame_bytes, <=, stats[1].unaliased_bytes, "zu");
+
+#define CHECK_COLOR()                                                       \
+    do {                                                                    \
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(                \
+            .tex = fbo,                                                     \
+            .ptr = dst,                                                     \
+        )));                                                                \
+        for (int y = 0; y < dst_h; y++) {                                   \
+            for (int x = 0; x < dst_w; x++) {                               \
+                for (int c = 0; c < 4; c++)                                 \
+                    REQUIRE_CMP(abs(dst[y][x][c] - color[c]), <=, 2, "d");  \
+            }                                                               \
+        }                                                                   \
+    } while (0)
+
+    CHECK_COLOR();
+
+    // With `async_compile`, a fresh renderer has to use the fallback params
+    // until its shaders are compiled, but every frame must still be complete
+    pl_renderer arr = pl_renderer_create(gpu->log, gpu);
+    struct pl_render_params params = pl_render_high_quality_params;
+    struct async_info ai;
+    params.async_compile = true;
+    params.info_callback = async_info_cb;
+    params.info_priv = &ai;
+    pl_clock_t start = pl_clock_now();
+    for (int i = 0;; i++) {
+        ai = (struct async_info) {0};
+        pl_tex_clear(gpu, fbo, (float[4]) {0});
+        REQUIRE(pl_render_image(arr, &image, &target, &params));
+        REQUIRE(ai.degraded || i > 0);
+        CHECK_COLOR();
+        if (!ai.degraded) {
+            printf("Rendered %d degraded frames while compiling shaders\n", i);
+            break;
+        }
+        REQUIRE_CMP(pl_clock_diff(pl_clock_now(), start), <, 60.0, "f");
+        pl_thread_sleep(0.01);
+    }
+    pl_renderer_destroy(&arr);
+
+    // Render a differently colored image first, to make sure that none of
+    // the stale contents of the intermediate textures bleed into later frames
+    static uint8_t src2[src_h][src_w][4];
+    memset(src2, 0xFF, sizeof(src2));
+    struct pl_frame image2 = image;
+    image2.planes[0].texture = pl_tex_create(gpu, pl_tex_params(
+        .w = src_w,
+        .h = src_h,
+        .format = fmt,
+        .sampleable = true,
+        .initial_data = src2,
+    ));
+    REQUIRE(image2.planes[0].texture);
+    REQUIRE(pl_render_image(rr, &image2, &target, &pl_render_high_quality_params));
+    pl_tex_destroy(gpu, &image2.planes[0].texture);
+
+    // Intermediate textures are padded to coarser size classes, so small
+    // changes to the crop (e.g. while zooming) reuse the same textures, and
+    // only their valid region is ever sampled. Only the first cropped frame
+    // may require textures not needed by the uncropped frames.
+    struct pl_frame cropped = image;
+    for (int i = 0; i <= 4; i++) {
+        cropped.crop = (pl_rect2df) { 0, 0, src_w - 2 * i - 1, src_h - i - 1 };
+        pl_tex_clear(gpu, fbo, (float[4]) {0});
+        REQUIRE(pl_render_image(rr, &cropped, &target, &pl_render_high_quality_params));
+        CHECK_COLOR();
+        stats[0] = stats[1];
+        stats[1] = pl_renderer_get_fbo_stats(rr);
+        if (i > 0) {
+            REQUIRE_CMP(stats[1].misses, ==, stats[0].misses, PRIu64);
+            REQUIRE_CMP(stats[1].num_fbos, ==, stats[0].num_fbos, "d");
+        }
+    }
+#undef CHECK_COLOR
+
+    pl_renderer_destroy(&rr);
+    pl_tex_destroy(gpu, &img);
+    pl_tex_destroy(gpu, &fbo);
+}
+
+// Render several overlays, which should get batched into a single draw
+static void overlay_tests(pl_gpu gpu)
+{
+    enum { w = 32, h = 8, ol_size = 4 };
+    static const uint8_t colors[2][4] = {{ 255, 0, 0, 255 }, { 0, 255, 0, 255 }};
+    static uint8_t ol_data[2][ol_size][ol_size][4], dst[h][w][4];
+    for (int i = 0; i < 2; i++) {
+        for (int y = 0; y < ol_size; y++) {
+            for (int x = 0; x < ol_size; x++)
+                memcpy(ol_data[i][y][x], colors[i], sizeof(colors[i]));
+        }
+    }
+
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba8");
+    REQUIRE(fmt);
+    pl_tex ol_tex[2];
+    for (int i = 0; i < 2; i++) {
+        ol_tex[i] = pl_tex_create(gpu, pl_tex_params(
+            .w = ol_size,
+            .h = ol_size,
+            .format = fmt,
+            .sampleable = true,
+            .blit_src = true,
+            .initial_data = ol_data[i],
+        ));
+        REQUIRE(ol_tex[i]);
+    }
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .w = w,
+        .h = h,
+        .format = fmt,
+        .renderable = true,
+        .blit_dst = true,
+        .host_readable = true,
+    ));
+    REQUIRE(fbo);
+
+    // Overlays alternating between both textures, each covering 8x8 pixels,
+    // except for the rightmost block which is left empty
+    struct pl_overlay_part parts[3];
+    struct pl_overlay overlays[3];
+    for (int i = 0; i < 3; i++) {
+        parts[i] = (struct pl_overlay_part) {
+            .src = { 0, 0, ol_size, ol_size },
+            .dst = { 8 * i, 0, 8 * (i + 1), h },
+        };
+        overlays[i] = (struct pl_overlay) {
+            .tex = ol_tex[i % 2],
+            .mode = PL_OVERLAY_NORMAL,
+            .coords = PL_OVERLAY_COORDS_DST_FRAME,
+            .repr = pl_color_repr_rgb,
+            .color = pl_color_space_srgb,
+            .parts = &parts[i],
+            .num_parts = 1,
+        };
+    }
+
+    struct pl_frame target;
+    pl_frame_from_swapchain(&target, &(struct pl_swapchain_frame) {
+        .fbo = fbo,
+        .flipped = false,
+        .color_repr = pl_color_repr_rgb,
+        .color_space = pl_color_space_srgb,
+    });
+    target.overlays = overlays;
+    target.num_overlays = 3;
+
+    // With support for texture arrays, overlays are sampled from a table of
+    // their own textures instead of being copied into an atlas
+    const bool use_table = gpu->limits.max_tex_array >= 8;
+    printf("testing overlay batching (%s)\n", use_table ? "table" : "atlas");
+    pl_renderer rr = pl_renderer_create(gpu->log, gpu);
+    REQUIRE(pl_render_image(rr, NULL, &target, &pl_render_default_params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+    REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params( .tex = fbo, .ptr = dst )));
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const int block = x / 8;
+            for (int c = 0; c < 4; c++) {
+                int ref = block < 3 ? colors[block % 2][c] : (c == 3 ? 255 : 0);
+                REQUIRE_CMP(abs(dst[y][x][c] - ref), <=, 2, "d");
+            }
+        }
+    }
+
+    struct pl_renderer_overlay_stats stats = pl_renderer_get_overlay_stats(rr);
+    REQUIRE_CMP(stats.overlays, ==, (uint64_t) 3, PRIu64);
+    REQUIRE_CMP(stats.draws, ==, (uint64_t) 1, PRIu64);
+    REQUIRE_CMP(stats.draws_saved, ==, (uint64_t) 2, PRIu64);
+    if (use_table) {
+        REQUIRE_CMP(stats.atlas_blits, ==, (uint64_t) 0, PRIu64);
+        REQUIRE_CMP(stats.num_atlases, ==, 0, "d");
+    } else {
+        REQUIRE_CMP(stats.atlas_blits, ==, (uint64_t) 2, PRIu64); // deduplicated
+        REQUIRE_CMP(stats.num_atlases, ==, 1, "d");
+        REQUIRE_CMP(stats.atlas_bytes, >=, (size_t) 2 * ol_size * ol_size * 4, "zu");
+    }
+
+    // Overlays sharing a texture are batched without needing an atlas
+    overlays[1].tex = ol_tex[0];
+    REQUIRE(pl_render_image(rr, NULL, &target, &pl_render_default_params));
+    struct pl_renderer_overlay_stats stats1 = pl_renderer_get_overlay_stats(rr);
+    REQUIRE_CMP(stats1.draws - stats.draws, ==, (uint64_t) 1, PRIu64);
+    REQUIRE_CMP(stats1.atlas_blits, ==, stats.atlas_blits, PRIu64);
+    REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params( .tex = fbo, .ptr = dst )));
+    for (int x = 0; x < 24; x++) {
+        for (int c = 0; c < 4; c++)
+            REQUIRE_CMP(abs(dst[h / 2][x][c] - colors[0][c]), <=, 2, "d");
+    }
+
+    pl_renderer_flush_cache(rr);
+    REQUIRE_CMP(pl_renderer_get_overlay_stats(rr).num_atlases, ==, 0, "d");
+    stats = pl_renderer_get_overlay_stats(rr);
+
+    // Overlays that can't be blitted are still drawn, but only batched when
+    // they don't need to be copied into an atlas
+    pl_tex plain = pl_tex_create(gpu, pl_tex_params(
+        .w = ol_size,
+        .h = ol_size,
+        .format = fmt,
+        .sampleable = true,
+        .initial_data = ol_data[0],
+    ));
+    REQUIRE(plain);
+    overlays[1].tex = plain;
+    REQUIRE(pl_render_image(rr, NULL, &target, &pl_render_default_params));
+    struct pl_renderer_overlay_stats stats2 = pl_renderer_get_overlay_stats(rr);
+    REQUIRE_CMP(stats2.overlays - stats.overlays, ==, (uint64_t) 3, PRIu64);
+    if (use_table) {
+        REQUIRE_CMP(stats2.draws - stats.draws, ==, (uint64_t) 1, PRIu64);
+        REQUIRE_CMP(stats2.draws_saved - stats.draws_saved, ==, (uint64_t) 2, PRIu64);
+    } else {
+        REQUIRE_CMP(stats2.draws - stats.draws, ==, (uint64_t) 3, PRIu64);
+        REQUIRE_CMP(stats2.draws_saved, ==, stats.draws_saved, PRIu64);
+    }
+
+    pl_renderer_destroy(&rr);
+    pl_tex_destroy(gpu, &plain);
+    pl_tex_destroy(gpu, &ol_tex[0]);
+    pl_tex_destroy(gpu, &ol_tex[1]);
+    pl_tex_destroy(gpu, &fbo);
+}
+
+// Compare gamut mapping 3DLUTs generated on the GPU against the CPU version
+static void gamut_lut_tests(pl_gpu gpu)
+{
+    enum { size_I = 9, size_C = 7, size_h = 17 };
+    enum { num = size_I * size_C * size_h * 4 };
+    pl_shader sh = pl_shader_alloc(gpu->log, NULL);
+
+    for (int i = 0; i < pl_num_gamut_map_functions; i++) {
+        struct pl_color_map_params params = pl_color_map_default_params;
+        params.gamut_mapping = pl_gamut_map_functions[i];
+        params.lut3d_size[0] = size_I;
+        params.lut3d_size[1] = size_C;
+        params.lut3d_size[2] = size_h;
+        params.force_tone_mapping_lut = true; // avoid fast paths
+
+        pl_shader_obj cpu_state = NULL, gpu_state = NULL;
+        const uint16_t *cpu_lut = get_gamut_lut(gpu, sh, &cpu_state, &params);
+        params.gpu_luts = true;
+        const uint16_t *gpu_lut = get_gamut_lut(gpu, sh, &gpu_state, &params);
+        if (params.gamut_mapping == &pl_gamut_map_clip) {
+            REQUIRE(!cpu_lut && !gpu_lut);
+        } else {
+            REQUIRE(cpu_lut && gpu_lut);
+            double max_err = 0.0;
+            for (int n = 0; n < num; n++) {
+                if (n % 4 < 3) // the fourth component is unused
+                    max_err = PL_MAX(max_err, abs(cpu_lut[n] - gpu_lut[n]) / 65535.0);
+            }
+            printf("Gamut LUT (%s): max GPU/CPU error %f\n",
+                   params.gamut_mapping->name, max_err);
+            REQUIRE_CMP(max_err, <=, 1e-3, "f");
+        }
+
+        pl_shader_obj_destroy(&cpu_state);
+        pl_shader_obj_destroy(&gpu_state);
+    }
+
+    pl_shader_free(&sh);
+}
+
+#endif // PL_HAVE_CPU_EXEC
 
 int main()
 {
@@ -8,6 +656,16 @@ int main()
     pl_gpu gpu = pl_gpu_dummy_create(log, NULL);
     pl_buffer_tests(gpu);
     pl_texture_tests(gpu);
+    upload_tests(gpu);
+    progressive_lut_tests(gpu);
+    pl_lut_async_tests(gpu);
+    queue_tests(gpu);
+
+    struct pl_gpu_dummy_params params = pl_gpu_dummy_default_params;
+    params.limits.max_ssbo_size = 0;
+    pl_gpu gpu_nossbo = pl_gpu_dummy_create(log, &params);
+    upload_tests(gpu_nossbo);
+    pl_gpu_dummy_destroy(&gpu_nossbo);
 
     // Attempt creating a shader and accessing the resulting LUT
     pl_tex dummy = pl_tex_dummy_create(gpu, pl_tex_dummy_params(
@@ -66,5 +724,39 @@ int main()
     pl_shader_obj_destroy(&lut);
     pl_tex_destroy(gpu, &dummy);
     pl_gpu_dummy_destroy(&gpu);
+
+#ifdef PL_HAVE_CPU_EXEC
+    // Run actual shaders using the CPU backend
+    gpu = pl_gpu_dummy_create(log, pl_gpu_dummy_params( .execute = true ));
+    REQUIRE(gpu);
+    pl_shader_tests(gpu);
+    pl_bounded_sampling_tests(gpu);
+    pl_texture_table_tests(gpu);
+    cpu_render_tests(gpu);
+    overlay_tests(gpu);
+    gamut_lut_tests(gpu);
+    pl_gpu_dummy_destroy(&gpu);
+
+    // Texture tables indexed using `nonuniformEXT`, and overlays drawn from
+    // an atlas on GPUs without support for texture arrays
+    params = pl_gpu_dummy_default_params;
+    params.execute = true;
+    params.glsl.nonuniform_indexing = true;
+    gpu = pl_gpu_dummy_create(log, &params);
+    REQUIRE(gpu);
+    pl_texture_table_tests(gpu);
+    pl_gpu_dummy_destroy(&gpu);
+
+    params = pl_gpu_dummy_default_params;
+    params.execute = true;
+    params.limits.max_tex_array = 0;
+    gpu = pl_gpu_dummy_create(log, &params);
+    REQUIRE(gpu);
+    overlay_tests(gpu);
+    pl_gpu_dummy_destroy(&gpu);
+#else
+    REQUIRE(!pl_gpu_dummy_create(log, pl_gpu_dummy_params( .execute = true )));
+#endif
+
     pl_log_destroy(&log);
 }
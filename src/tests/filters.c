@@ -74,8 +74,32 @@ int main()
 
         }
 
+        // Generating the same filter again should give identical results
+        pl_filter flt2 = pl_filter_generate(log, &flt->params);
+        REQUIRE(flt2);
+        REQUIRE_CMP(flt2->radius, ==, flt->radius, "f");
+        REQUIRE_CMP(flt2->row_size, ==, flt->row_size, "d");
+        const int stride = conf->polar ? 1 : flt->row_stride;
+        REQUIRE_MEMEQ(flt2->weights, flt->weights,
+                      flt->params.lut_entries * stride * sizeof(float));
+        pl_filter_free(&flt2);
+
         pl_filter_free(&flt);
     }
 
+    // Changing any parameter must not reuse previously generated weights
+    struct pl_filter_config blurred = pl_filter_lanczos;
+    blurred.blur = 2.0f;
+    pl_filter sharp = pl_filter_generate(log, pl_filter_params(
+        .config = pl_filter_lanczos, .lut_entries = 64, .cutoff = 1e-3,
+    ));
+    pl_filter blurry = pl_filter_generate(log, pl_filter_params(
+        .config = blurred, .lut_entries = 64, .cutoff = 1e-3,
+    ));
+    REQUIRE(sharp && blurry);
+    REQUIRE_CMP(blurry->row_size, >, sharp->row_size, "d");
+    pl_filter_free(&sharp);
+    pl_filter_free(&blurry);
+
     pl_log_destroy(&log);
 }
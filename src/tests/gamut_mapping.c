@@ -0,0 +1,151 @@
+#include "tests.h"
+#include "log.h"
+#include "gamut_mapping.h"
+
+#define NUM 4099 // deliberately not a multiple of any vector size
+#define BENCH_NUM (1 << 16)
+
+static void fill_ipt(float *I, float *P, float *T, int num)
+{
+    for (int i = 0; i < num; i++) {
+        const float x = (float) i / (num - 1);
+        I[i] = x;
+        P[i] = 0.5f * sinf(97.0f * x);
+        T[i] = 0.5f * cosf(61.0f * x);
+    }
+}
+
+static void fill_rgb(float *R, float *G, float *B, int num)
+{
+    for (int i = 0; i < num; i++) {
+        const float x = (float) i / (num - 1);
+        R[i] = powf(x, 2.2f);
+        G[i] = 0.5f + 0.5f * sinf(37.0f * x);
+        B[i] = 1e-3f * (i % 101) - 0.01f;
+    }
+}
+
+static void require_close(const float *a, const float *b, int num, float eps)
+{
+    for (int i = 0; i < num; i++)
+        REQUIRE_FEQ(a[i], b[i], eps);
+}
+
+int main()
+{
+    pl_log log = pl_test_logger();
+    const struct pl_gamut_kernels *ref = pl_gamut_kernels[0];
+    const pl_matrix3x3 rgb2lms = pl_ipt_rgb2lms(pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020));
+    const pl_matrix3x3 lms2rgb = pl_ipt_lms2rgb(pl_raw_primaries_get(PL_COLOR_PRIM_BT_709));
+    const struct pl_gamut_bounds bounds = {
+        .lms2rgb  = lms2rgb,
+        .min_luma = 0.0f,
+        .max_luma = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 1000.0f),
+        .min_rgb  = -1e-6f,
+        .max_rgb  = 0.1f + 1e-6f,
+    };
+
+    static float ref_x[3][NUM], x[3][NUM];
+    static uint8_t ref_ok[NUM], ok[NUM];
+
+    REQUIRE(pl_gamut_kernels_get());
+    REQUIRE(pl_gamut_kernels_get()->supported());
+
+    // Test all vectorized kernels against the scalar reference
+    for (int k = 1; pl_gamut_kernels[k]; k++) {
+        const struct pl_gamut_kernels *kern = pl_gamut_kernels[k];
+        if (!kern->supported()) {
+            printf("Skipping unsupported gamut kernels: %s\n", kern->name);
+            continue;
+        }
+
+        printf("Testing gamut kernels: %s\n", kern->name);
+
+        fill_ipt(ref_x[0], ref_x[1], ref_x[2], NUM);
+        fill_ipt(x[0], x[1], x[2], NUM);
+        ref->ipt2rgb(ref_x[0], ref_x[1], ref_x[2], NUM, &lms2rgb);
+        kern->ipt2rgb(x[0], x[1], x[2], NUM, &lms2rgb);
+        for (int c = 0; c < 3; c++)
+            require_close(ref_x[c], x[c], NUM, 1e-5);
+
+        fill_rgb(ref_x[0], ref_x[1], ref_x[2], NUM);
+        fill_rgb(x[0], x[1], x[2], NUM);
+        ref->rgb2ipt(ref_x[0], ref_x[1], ref_x[2], NUM, &rgb2lms);
+        kern->rgb2ipt(x[0], x[1], x[2], NUM, &rgb2lms);
+        for (int c = 0; c < 3; c++)
+            require_close(ref_x[c], x[c], NUM, 1e-4);
+
+        fill_rgb(ref_x[0], ref_x[1], ref_x[2], NUM);
+        fill_rgb(x[0], x[1], x[2], NUM);
+        ref->pq_oetf(ref_x[0], NUM);
+        kern->pq_oetf(x[0], NUM);
+        require_close(ref_x[0], x[0], NUM, 1e-4);
+        ref->pq_eotf(ref_x[1], NUM);
+        kern->pq_eotf(x[1], NUM);
+        require_close(ref_x[1], x[1], NUM, 1e-6);
+
+        // Results may only differ for colors right on the gamut boundary
+        fill_ipt(x[0], x[1], x[2], NUM);
+        ref->ingamut(ref_ok, x[0], x[1], x[2], NUM, &bounds);
+        kern->ingamut(ok, x[0], x[1], x[2], NUM, &bounds);
+        int num_ok = 0, mismatches = 0;
+        for (int i = 0; i < NUM; i++) {
+            num_ok += ref_ok[i];
+            mismatches += ref_ok[i] != ok[i];
+        }
+        REQUIRE_CMP(num_ok, >, 0, "d");
+        REQUIRE_CMP(num_ok, <, NUM, "d");
+        REQUIRE_CMP(mismatches, <=, NUM / 1000, "d");
+    }
+
+    // Benchmark all supported kernels on a round trip through RGB
+    float *bench = malloc(3 * BENCH_NUM * sizeof(float));
+    if (!bench)
+        goto done;
+
+    for (int k = 0; pl_gamut_kernels[k]; k++) {
+        const struct pl_gamut_kernels *kern = pl_gamut_kernels[k];
+        if (!kern->supported())
+            continue;
+
+        float *I = bench, *P = I + BENCH_NUM, *T = P + BENCH_NUM;
+        fill_ipt(I, P, T, BENCH_NUM);
+        pl_clock_t start = pl_clock_now();
+        kern->ipt2rgb(I, P, T, BENCH_NUM, &lms2rgb);
+        kern->rgb2ipt(I, P, T, BENCH_NUM, &rgb2lms);
+        pl_clock_t stop = pl_clock_now();
+        printf("Gamut kernels %s: %.3f ms for %d colors\n", kern->name,
+               pl_clock_diff(stop, start) * 1e3, BENCH_NUM);
+    }
+
+    free(bench);
+
+    // Benchmark full LUT generation, using the best available kernels
+    for (int i = 0; i < pl_num_gamut_map_functions; i++) {
+        struct pl_gamut_map_params params = {
+            .function     = pl_gamut_map_functions[i],
+            .input_gamut  = *pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020),
+            .output_gamut = *pl_raw_primaries_get(PL_COLOR_PRIM_BT_709),
+            .min_luma     = 0.0f,
+            .max_luma     = bounds.max_luma,
+            .lut_size_I   = 33,
+            .lut_size_C   = 17,
+            .lut_size_h   = 48,
+            .lut_stride   = 3,
+        };
+
+        float *lut = malloc(33 * 17 * 48 * 3 * sizeof(float));
+        if (!lut)
+            break;
+
+        pl_clock_t start = pl_clock_now();
+        pl_gamut_map_generate(lut, &params);
+        pl_clock_t stop = pl_clock_now();
+        printf("Gamut mapping function %s: %.3f ms\n", params.function->name,
+               pl_clock_diff(stop, start) * 1e3);
+        free(lut);
+    }
+
+done:
+    pl_log_destroy(&log);
+}
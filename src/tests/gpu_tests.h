@@ -1,5 +1,9 @@
 #include "tests.h"
 #include "shaders.h"
+#include "dispatch.h"
+#include "pl_thread.h"
+
+#include <stdatomic.h>
 
 #include <libplacebo/renderer.h>
 #include <libplacebo/utils/frame_queue.h>
@@ -312,6 +316,96 @@ static void pl_planar_tests(pl_gpu gpu)
     pl_tex_destroy(gpu, &tex);
 }
 
+static void dispatch_info_cb(void *priv, const struct pl_dispatch_info *info)
+{
+    struct pl_dispatch_info *out = priv;
+    out->cache_hits = info->cache_hits;
+    out->cache_misses = info->cache_misses;
+}
+
+struct gated_lut {
+    float value;
+    atomic_bool *open; // `fill` blocks until this is set
+};
+
+static void gated_lut_fill(void *data, const struct sh_lut_params *params)
+{
+    const struct gated_lut *priv = params->priv;
+    while (!atomic_load(priv->open))
+        pl_thread_sleep(1e-3);
+
+    float *out = data;
+    for (int i = 0; i < params->width * params->comps; i++)
+        out[i] = priv->value;
+}
+
+// Asynchronous LUT updates should keep using the previous LUT until the new
+// one is ready, but never for more than `max_stale` calls
+static void pl_lut_async_tests(pl_gpu gpu)
+{
+    enum { max_stale = 3 };
+    atomic_bool open = true;
+    pl_shader sh = pl_shader_alloc(gpu->log, pl_shader_params( .gpu = gpu ));
+    pl_shader_obj obj = NULL;
+    struct gated_lut priv = { .value = 1.0f, .open = &open }, used = {0};
+
+#define LUT_CALL(sig)                                                       \
+    do {                                                                    \
+        pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));                \
+        REQUIRE(sh_lut(sh, sh_lut_params(                                   \
+            .object     = &obj,                                             \
+            .var_type   = PL_VAR_FLOAT,                                     \
+            .lut_type   = SH_LUT_TEXTURE,                                   \
+            .width      = 64,                                               \
+            .comps      = 1,                                                \
+            .signature  = (sig),                                            \
+            .async      = true,                                             \
+            .max_stale  = max_stale,                                        \
+            .fill       = gated_lut_fill,                                   \
+            .priv       = &priv,                                            \
+            .priv_size  = sizeof(priv),                                     \
+            .priv_used  = &used,                                            \
+        )));                                                                \
+        REQUIRE_CMP(sh->descs.num, ==, 1, "d");                             \
+        tex = sh->descs.elem[0].binding.object;                             \
+    } while (0)
+
+    // The initial LUT is always generated synchronously
+    pl_tex tex, old_tex;
+    LUT_CALL(1);
+    REQUIRE_CMP(used.value, ==, 1.0f, "f");
+    old_tex = tex;
+
+    // While the update is blocked, the old LUT must remain in use
+    atomic_store(&open, false);
+    priv.value = 2.0f;
+    for (int i = 0; i < max_stale; i++) {
+        LUT_CALL(2);
+        REQUIRE_CMP(used.value, ==, 1.0f, "f");
+        REQUIRE(tex == old_tex);
+    }
+
+    // Once unblocked, the new LUT must be swapped in within `max_stale` calls
+    // of being requested
+    atomic_store(&open, true);
+    for (int sig = 2; sig <= 3; sig++) {
+        priv.value = sig;
+        int calls = 0;
+        do {
+            LUT_CALL(sig);
+            calls++;
+        } while (used.value != sig && calls <= max_stale + 1);
+        REQUIRE_CMP(used.value, ==, (float) sig, "f");
+        REQUIRE_CMP(calls, <=, max_stale + 1, "d");
+        REQUIRE(tex != old_tex);
+        old_tex = tex;
+    }
+#undef LUT_CALL
+
+    pl_shader_obj_destroy(&obj);
+    pl_shader_free(&sh);
+}
+
 static void pl_shader_tests(pl_gpu gpu)
 {
     if (gpu->glsl.version < 410)
@@ -592,6 +686,7 @@ static void pl_shader_tests(pl_gpu gpu)
     }
 
     // Repeat this a few times to test the caching
+    struct pl_dispatch_info dinfo = {0};
     pl_cache cache = pl_cache_create(pl_cache_params( .log = gpu->log ));
     pl_gpu_set_cache(gpu, cache);
     for (int i = 0; i < 10; i++) {
@@ -613,6 +708,7 @@ static void pl_shader_tests(pl_gpu gpu)
             REQUIRE_CMP(pl_dispatch_save(dp, cache_data), ==, size, "zu");
             REQUIRE_CMP(pl_str_hash((pl_str) { cache_data, size }), ==, hash, PRIu64);
             free(cache_data);
+            pl_dispatch_callback(dp, &dinfo, dispatch_info_cb);
         }
 
         sh = pl_dispatch_begin(dp);
@@ -636,6 +732,11 @@ static void pl_shader_tests(pl_gpu gpu)
         TEST_FBO_PATTERN(1e-6, "deband iter %d", i);
     }
 
+    // Only the first pass after recreating the dispatch should be generated
+    REQUIRE_CMP(dinfo.cache_misses, ==, 1, PRIu64);
+    REQUIRE_CMP(dinfo.cache_hits, ==, 4, PRIu64);
+    pl_dispatch_callback(dp, NULL, NULL);
+
     pl_gpu_set_cache(gpu, NULL);
     pl_cache_destroy(&cache);
 
@@ -887,6 +988,250 @@ error:
     pl_tex_destroy(gpu, &fbo);
 }
 
+enum bounded_sampler {
+    BOUNDED_DIRECT,
+    BOUNDED_NEAREST,
+    BOUNDED_BILINEAR,
+    BOUNDED_BICUBIC,
+    BOUNDED_HERMITE,
+    BOUNDED_GAUSSIAN,
+    BOUNDED_OVERSAMPLE,
+    BOUNDED_POLAR,
+    BOUNDED_POLAR_FRAG,
+    BOUNDED_ORTHO,
+    BOUNDED_DEBAND,
+    BOUNDED_COUNT,
+};
+
+static bool sample_bounded(pl_shader sh, enum bounded_sampler type,
+                           const struct pl_sample_src *src, pl_shader_obj *lut)
+{
+    switch (type) {
+    case BOUNDED_DIRECT:     return pl_shader_sample_direct(sh, src);
+    case BOUNDED_NEAREST:    return pl_shader_sample_nearest(sh, src);
+    case BOUNDED_BILINEAR:   return pl_shader_sample_bilinear(sh, src);
+    case BOUNDED_BICUBIC:    return pl_shader_sample_bicubic(sh, src);
+    case BOUNDED_HERMITE:    return pl_shader_sample_hermite(sh, src);
+    case BOUNDED_GAUSSIAN:   return pl_shader_sample_gaussian(sh, src);
+    case BOUNDED_OVERSAMPLE: return pl_shader_sample_oversample(sh, src, 0.0f);
+    case BOUNDED_POLAR:
+    case BOUNDED_POLAR_FRAG:
+        return pl_shader_sample_polar(sh, src, pl_sample_filter_params(
+            .filter     = pl_filter_ewa_lanczos,
+            .lut        = lut,
+            .no_compute = type == BOUNDED_POLAR_FRAG,
+        ));
+    case BOUNDED_ORTHO:
+        return pl_shader_sample_ortho2(sh, src, pl_sample_filter_params(
+            .filter = pl_filter_lanczos,
+            .lut    = lut,
+        ));
+    case BOUNDED_DEBAND:
+        pl_shader_deband(sh, src, pl_deband_params( .grain = 0.0 ));
+        return true;
+    case BOUNDED_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+}
+
+// Sampling an image stored inside a bigger texture with `pl_sample_src.bounds`
+// must give the same result as sampling it from a texture of its own
+static void pl_bounded_sampling_tests(pl_gpu gpu)
+{
+    enum { W = 6, H = 5, PAD_W = 16, PAD_H = 8, OUT_W = 13, OUT_H = 11 };
+    const enum pl_fmt_caps caps = PL_FMT_CAP_LINEAR | PL_FMT_CAP_RENDERABLE |
+                                  PL_FMT_CAP_HOST_READABLE;
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32, caps);
+    if (!fmt)
+        return;
+
+    static float img[H][W][4], padded[PAD_H][PAD_W][4], out[2][OUT_H][OUT_W][4];
+    for (int y = 0; y < PAD_H; y++) {
+        for (int x = 0; x < PAD_W; x++) {
+            for (int c = 0; c < 4; c++) {
+                // Fill the rest of the texture with values far out of range
+                const float v = ((x * 7 + y * 3 + c) % 11) / 10.0f;
+                padded[y][x][c] = x < W && y < H ? v : 100.0f;
+                if (x < W && y < H)
+                    img[y][x][c] = v;
+            }
+        }
+    }
+
+    pl_tex src[2], dst;
+    src[0] = pl_tex_create(gpu, pl_tex_params(
+        .w = W,
+        .h = H,
+        .format = fmt,
+        .sampleable = true,
+        .initial_data = img,
+    ));
+    src[1] = pl_tex_create(gpu, pl_tex_params(
+        .w = PAD_W,
+        .h = PAD_H,
+        .format = fmt,
+        .sampleable = true,
+        .initial_data = padded,
+    ));
+    dst = pl_tex_create(gpu, pl_tex_params(
+        .w = OUT_W,
+        .h = OUT_H,
+        .format = fmt,
+        .renderable = true,
+        .storable = fmt->caps & PL_FMT_CAP_STORABLE,
+        .host_readable = true,
+    ));
+    REQUIRE(src[0] && src[1] && dst);
+
+    pl_dispatch dp = pl_dispatch_create(gpu->log, gpu);
+    pl_shader_obj lut[2] = {0};
+    for (enum bounded_sampler type = 0; type < BOUNDED_COUNT; type++) {
+        int out_w = OUT_W, out_h = OUT_H;
+        if (type == BOUNDED_ORTHO)
+            out_h = H; // only scales in one direction
+        if (type == BOUNDED_DEBAND)
+            out_w = W, out_h = H;
+        if (type == BOUNDED_POLAR && !dst->params.storable)
+            continue;
+
+        for (int i = 0; i < 2; i++) {
+            pl_shader sh = pl_dispatch_begin(dp);
+            REQUIRE(sample_bounded(sh, type, pl_sample_src(
+                .tex    = src[i],
+                .bounds = { 0, 0, W, H },
+                .new_w  = out_w,
+                .new_h  = out_h,
+            ), &lut[i]));
+            REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+                .shader = &sh,
+                .target = dst,
+                .rect   = { 0, 0, out_w, out_h },
+            )));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = dst,
+                .ptr = out[i],
+            )));
+        }
+
+        for (int y = 0; y < out_h; y++) {
+            for (int x = 0; x < out_w; x++) {
+                for (int c = 0; c < 4; c++) {
+                    const float diff = fabsf(out[0][y][x][c] - out[1][y][x][c]);
+                    REQUIRE_CMP(diff, <=, 1e-4, "f");
+                }
+            }
+        }
+
+        pl_shader_obj_destroy(&lut[0]);
+        pl_shader_obj_destroy(&lut[1]);
+    }
+
+    // Without `bounds`, the padding bleeds into the edges of the image
+    pl_shader sh = pl_dispatch_begin(dp);
+    REQUIRE(pl_shader_sample_bilinear(sh, pl_sample_src(
+        .tex    = src[1],
+        .rect   = { 0, 0, W, H },
+        .new_w  = OUT_W,
+        .new_h  = OUT_H,
+    )));
+    REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+        .shader = &sh,
+        .target = dst,
+    )));
+    REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+        .tex = dst,
+        .ptr = out[1],
+    )));
+    REQUIRE_CMP(out[1][OUT_H - 1][OUT_W - 1][0], >, 1.0f, "f");
+
+    pl_dispatch_destroy(&dp);
+    pl_tex_destroy(gpu, &src[0]);
+    pl_tex_destroy(gpu, &src[1]);
+    pl_tex_destroy(gpu, &dst);
+}
+
+// Textures bound as a table are sampled by (non-uniform) index, and generate
+// the same pass regardless of the number of textures in the table
+static void pl_texture_table_tests(pl_gpu gpu)
+{
+    enum { SIZE = 8, H = 3 };
+    if (gpu->limits.max_tex_array < SIZE)
+        return;
+
+    const enum pl_fmt_caps caps = PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE;
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32, caps);
+    if (!fmt)
+        return;
+
+    static float colors[SIZE][4], out[H][SIZE][4];
+    pl_tex src[SIZE], dst;
+    for (int i = 0; i < SIZE; i++) {
+        colors[i][0] = i / (float) SIZE;
+        colors[i][1] = 1.0f - i / (float) SIZE;
+        colors[i][2] = (i % 3) / 2.0f;
+        colors[i][3] = 1.0f;
+        src[i] = pl_tex_create(gpu, pl_tex_params(
+            .w = 1,
+            .h = 1,
+            .format = fmt,
+            .sampleable = true,
+            .initial_data = colors[i],
+        ));
+        REQUIRE(src[i]);
+    }
+
+    dst = pl_tex_create(gpu, pl_tex_params(
+        .w = SIZE,
+        .h = H,
+        .format = fmt,
+        .renderable = true,
+        .storable = fmt->caps & PL_FMT_CAP_STORABLE,
+        .host_readable = true,
+    ));
+    REQUIRE(dst);
+
+    pl_dispatch dp = pl_dispatch_create(gpu->log, gpu);
+    int num_passes = 0;
+    for (int num = 1; num <= SIZE; num++) {
+        // Each column samples a different texture, past the end of the
+        // table this repeats the last texture
+        pl_shader sh = pl_dispatch_begin(dp);
+        ident_t pos = sh_attr_vec2(sh, "pos", &(pl_rect2df) { 0, 0, SIZE, H });
+        ident_t fn = sh_bind_table(sh, src, num, SIZE, PL_TEX_ADDRESS_CLAMP,
+                                   PL_TEX_SAMPLE_NEAREST, "table");
+        REQUIRE(pos && fn);
+        sh->output = PL_SHADER_SIG_COLOR;
+        GLSL("vec4 color = "$"(int("$".x), vec2(0.5)); \n", fn, pos);
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = dst,
+        )));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = dst,
+            .ptr = out,
+        )));
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                const float *ref = colors[PL_MIN(x, num - 1)];
+                for (int c = 0; c < 4; c++)
+                    REQUIRE_FEQ(out[y][x][c], ref[c], 1e-6);
+            }
+        }
+
+        if (num == 1)
+            num_passes = pl_dispatch_num_passes(dp);
+        REQUIRE_CMP(pl_dispatch_num_passes(dp), ==, num_passes, "d");
+    }
+
+    pl_dispatch_destroy(&dp);
+    for (int i = 0; i < SIZE; i++)
+        pl_tex_destroy(gpu, &src[i]);
+    pl_tex_destroy(gpu, &dst);
+}
+
 static const char *user_shader_tests[] = {
     // Test hooking, saving and loading
     "// Example of a comment at the beginning                               \n"
@@ -1043,6 +1388,18 @@ static void render_info_cb(void *priv, const struct pl_render_info *info)
            info->pass->shader->description);
 }
 
+struct async_info {
+    int num_passes;
+    bool degraded;
+};
+
+static void async_info_cb(void *priv, const struct pl_render_info *info)
+{
+    struct async_info *ai = priv;
+    ai->degraded |= info->degraded;
+    ai->num_passes++;
+}
+
 static void pl_render_tests(pl_gpu gpu)
 {
     pl_tex img_tex = NULL, fbo = NULL;
@@ -1103,6 +1460,38 @@ static void pl_render_tests(pl_gpu gpu)
     REQUIRE(pl_render_image(rr, &image, &target, NULL));
     REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
 
+    // Test background shader compilation, which should eventually catch up
+    if (gpu->limits.thread_safe) {
+        struct async_info ai = {0};
+        struct pl_render_params params = pl_render_high_quality_params;
+        params.info_callback = async_info_cb;
+        params.info_priv = &ai;
+        for (int i = 0; i < 2; i++) {
+            ai = (struct async_info) {0};
+            REQUIRE(pl_render_image(rr, &image, &target, &params));
+        }
+        const int num_passes = ai.num_passes;
+
+        // Use a fresh renderer, so all shaders have to be compiled again. The
+        // first frame can't possibly use the full params, and must therefore
+        // be rendered with the fallback params instead
+        pl_renderer arr = pl_renderer_create(gpu->log, gpu);
+        params.async_compile = true;
+        for (int i = 0; i < 100; i++) {
+            ai = (struct async_info) {0};
+            REQUIRE(pl_render_image(arr, &image, &target, &params));
+            REQUIRE(ai.degraded || i > 0);
+            if (!ai.degraded)
+                break;
+            pl_gpu_finish(gpu);
+            pl_thread_sleep(0.01);
+        }
+        REQUIRE(!ai.degraded);
+        REQUIRE_CMP(ai.num_passes, ==, num_passes, "d");
+        REQUIRE(pl_renderer_get_errors(arr).errors == PL_RENDER_ERR_NONE);
+        pl_renderer_destroy(&arr);
+    }
+
     // TODO: embed a reference texture and ensure it matches
 
     // Test a bunch of different params
@@ -1166,9 +1555,23 @@ static void pl_render_tests(pl_gpu gpu)
     // Test HDR tone mapping
     image.color = pl_color_space_hdr10;
     TEST_PARAMS(color_map, visualize_lut, true);
+    TEST_PARAMS(color_map, gpu_luts, true);
     if (gpu->limits.max_ssbo_size)
         TEST_PARAMS(peak_detect, allow_delayed, true);
 
+    // Test asynchronous LUT updates in response to changing metadata
+    struct pl_color_map_params cmap_params = pl_color_map_default_params;
+    cmap_params.async_luts = true;
+    struct pl_render_params async_params = pl_render_default_params;
+    async_params.color_map_params = &cmap_params;
+    for (int i = 0; i < 10; i++) {
+        image.color.hdr.max_luma = 1000 + 200 * i;
+        REQUIRE(pl_render_image(rr, &image, &target, &async_params));
+        pl_gpu_flush(gpu);
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    }
+    image.color = pl_color_space_hdr10;
+
     // Test inverse tone-mapping and pure BPC
     image.color.hdr.max_luma = 1000;
     target.color.hdr.max_luma = 4000;
@@ -1725,7 +2128,10 @@ static void gpu_shader_tests(pl_gpu gpu)
     pl_texture_tests(gpu);
     pl_planar_tests(gpu);
     pl_shader_tests(gpu);
+    pl_lut_async_tests(gpu);
     pl_scaler_tests(gpu);
+    pl_bounded_sampling_tests(gpu);
+    pl_texture_table_tests(gpu);
     pl_render_tests(gpu);
     pl_ycbcr_tests(gpu);
 
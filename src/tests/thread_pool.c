@@ -0,0 +1,145 @@
+#include "tests.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
+
+#include <stdatomic.h>
+
+#define COUNT 10000
+
+struct sum_args {
+    pl_mutex lock;
+    uint8_t visited[COUNT];
+    uint64_t sum;
+    int min_chunk;
+};
+
+static void sum_range(void *priv, int start, int end)
+{
+    struct sum_args *args = priv;
+    REQUIRE_CMP(start, <, end, "d");
+    REQUIRE_CMP(end, <=, COUNT, "d");
+    if (end != COUNT)
+        REQUIRE_CMP(end - start, >=, args->min_chunk, "d");
+
+    uint64_t sum = 0;
+    for (int i = start; i < end; i++) {
+        args->visited[i]++;
+        sum += i;
+    }
+
+    pl_mutex_lock(&args->lock);
+    args->sum += sum;
+    pl_mutex_unlock(&args->lock);
+}
+
+static void test_pool(pl_thread_pool pool)
+{
+    static const int chunks[] = { 0, 1, 7, 100, COUNT, 2 * COUNT };
+    for (int n = 0; n < PL_ARRAY_SIZE(chunks); n++) {
+        struct sum_args args = { .min_chunk = chunks[n] };
+        pl_mutex_init(&args.lock);
+        pl_parallel_for(pool, COUNT, args.min_chunk, sum_range, &args);
+        pl_mutex_destroy(&args.lock);
+
+        REQUIRE_CMP(args.sum, ==, (uint64_t) COUNT * (COUNT - 1) / 2, PRIu64);
+        for (int i = 0; i < COUNT; i++)
+            REQUIRE_CMP(args.visited[i], ==, 1, "u");
+    }
+
+    // Empty ranges should never call the function
+    pl_parallel_for(pool, 0, 1, NULL, NULL);
+}
+
+struct nested_args {
+    pl_thread_pool pool;
+    int count;
+    pl_mutex lock;
+};
+
+static void count_range(void *priv, int start, int end)
+{
+    struct nested_args *args = priv;
+    pl_mutex_lock(&args->lock);
+    args->count += end - start;
+    pl_mutex_unlock(&args->lock);
+}
+
+static void nested_range(void *priv, int start, int end)
+{
+    struct nested_args *args = priv;
+    for (int i = start; i < end; i++)
+        pl_parallel_for(args->pool, 100, 1, count_range, args);
+}
+
+struct async_args {
+    atomic_bool *open;
+    int done;
+};
+
+static void async_job(void *priv, int start, int end)
+{
+    struct async_args *args = priv;
+    REQUIRE_CMP(start, ==, 0, "d");
+    REQUIRE_CMP(end, ==, 1, "d");
+    while (args->open && !atomic_load(args->open))
+        pl_thread_sleep(1e-3);
+    args->done++;
+}
+
+static void test_submit(pl_thread_pool pool)
+{
+    // Jobs are picked up in the background, without waiting for them
+    atomic_bool open = false;
+    struct async_args args = { .open = &open };
+    pl_thread_job job = pl_thread_pool_submit(pool, async_job, &args);
+    REQUIRE(job);
+    atomic_store(&open, true);
+    pl_thread_job_wait(&job);
+    REQUIRE(!job);
+    REQUIRE_CMP(args.done, ==, 1, "d");
+
+    // Waiting on jobs which weren't started yet runs them directly
+    args = (struct async_args) {0};
+    pl_thread_job jobs[8];
+    for (int i = 0; i < PL_ARRAY_SIZE(jobs); i++)
+        jobs[i] = pl_thread_pool_submit(pool, async_job, &args);
+    for (int i = 0; i < PL_ARRAY_SIZE(jobs); i++)
+        pl_thread_job_wait(&jobs[i]);
+    REQUIRE_CMP(args.done, ==, PL_ARRAY_SIZE(jobs), "d");
+}
+
+int main()
+{
+    pl_thread_pool pool = pl_thread_pool_create(4);
+    REQUIRE(pool);
+    REQUIRE_CMP(pl_thread_pool_size(pool), ==, 5, "d");
+    test_pool(pool);
+
+    // Calling back into the same pool from a worker must not deadlock
+    struct nested_args args = { .pool = pool };
+    pl_mutex_init(&args.lock);
+    pl_parallel_for(pool, 16, 1, nested_range, &args);
+    pl_mutex_destroy(&args.lock);
+    REQUIRE_CMP(args.count, ==, 16 * 100, "d");
+    test_submit(pool);
+    pl_thread_pool_destroy(&pool);
+    REQUIRE(!pool);
+
+    // Pools without any worker threads run everything on the calling thread
+    pool = pl_thread_pool_create(-1);
+    REQUIRE(pool);
+    REQUIRE_CMP(pl_thread_pool_size(pool), ==, 1, "d");
+    test_pool(pool);
+    struct async_args sync_args = {0};
+    pl_thread_job job = pl_thread_pool_submit(pool, async_job, &sync_args);
+    REQUIRE_CMP(sync_args.done, ==, 1, "d");
+    pl_thread_job_wait(&job);
+    pl_thread_pool_destroy(&pool);
+
+    // Shared pool
+    REQUIRE(pl_thread_pool_get());
+    REQUIRE_CMP(pl_thread_pool_get(), ==, pl_thread_pool_get(), "p");
+    REQUIRE_CMP(pl_thread_pool_size(pl_thread_pool_get()), >=, 2, "d");
+    test_pool(NULL);
+    test_submit(NULL);
+}
@@ -0,0 +1,147 @@
+#include "tests.h"
+#include "utils/plane_conv.h"
+
+#define W 77 // deliberately not a multiple of any vector size
+#define H 5
+#define BENCH_W 1920
+#define BENCH_H 1080
+
+// rgb24 -> rgba8
+static void setup_rgb24(struct plane_conv *conv, struct pl_plane_data *data,
+                        const uint8_t *src, uint8_t *dst, int w, int h)
+{
+    *data = (struct pl_plane_data) {
+        .type           = PL_FMT_UNORM,
+        .width          = w,
+        .height         = h,
+        .pixel_stride   = 3,
+        .row_stride     = 3 * w + 5,
+    };
+
+    *conv = (struct plane_conv) {
+        .data       = data,
+        .num        = 3,
+        .size       = { 8, 8, 8 },
+        .offset     = { 0, 8, 16 },
+        .depth      = 8,
+        .texel_size = 4,
+        .src        = src,
+        .dst        = dst,
+        .dst_stride = 4 * w,
+    };
+}
+
+// rgb48be -> rgb16
+static void setup_rgb48be(struct plane_conv *conv, struct pl_plane_data *data,
+                          const uint8_t *src, uint8_t *dst, int w, int h)
+{
+    *data = (struct pl_plane_data) {
+        .type           = PL_FMT_UNORM,
+        .width          = w,
+        .height         = h,
+        .pixel_stride   = 6,
+        .row_stride     = 6 * w + 2,
+        .swapped        = true,
+    };
+
+    *conv = (struct plane_conv) {
+        .data       = data,
+        .num        = 3,
+        .size       = { 16, 16, 16 },
+        .offset     = { 0, 16, 32 },
+        .depth      = 16,
+        .texel_size = 6,
+        .swap       = true,
+        .src        = src,
+        .dst        = dst,
+        .dst_stride = 6 * w,
+    };
+}
+
+static const struct {
+    const char *name;
+    void (*setup)(struct plane_conv *conv, struct pl_plane_data *data,
+                  const uint8_t *src, uint8_t *dst, int w, int h);
+    int src_bpp, dst_bpp;
+} layouts[] = {
+    { "rgb24",   setup_rgb24,   3, 4 },
+    { "rgb48be", setup_rgb48be, 6, 6 },
+};
+
+static void fill_src(uint8_t *src, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        src[i] = i * 2654435761u >> 24;
+}
+
+int main()
+{
+    const struct pl_conv_kernels *ref = pl_conv_kernels[0];
+    REQUIRE(ref->supported());
+    REQUIRE(pl_conv_kernels_get());
+
+    // All supported kernels must produce the same output as the scalar
+    // reference, including for any pixels left over at the end of each row
+    for (int l = 0; l < PL_ARRAY_SIZE(layouts); l++) {
+        uint8_t src[H * (W * 6 + 5)], ref_dst[H * W * 6], dst[H * W * 6];
+        fill_src(src, sizeof(src));
+
+        for (int k = 1; pl_conv_kernels[k]; k++) {
+            const struct pl_conv_kernels *kern = pl_conv_kernels[k];
+            if (!kern->supported())
+                continue;
+
+            for (int w = 1; w <= W; w++) {
+                struct pl_plane_data data;
+                struct plane_conv conv;
+                memset(dst, 0xAA, sizeof(dst));
+                layouts[l].setup(&conv, &data, src, ref_dst, w, H);
+                REQUIRE(ref->convert(&conv, 0, H));
+                conv.dst = dst;
+                REQUIRE(kern->convert(&conv, 0, H));
+                REQUIRE(!memcmp(dst, ref_dst, H * w * layouts[l].dst_bpp));
+            }
+        }
+    }
+
+    // Layouts without a fast path must be rejected by the vectorized kernels
+    for (int k = 1; pl_conv_kernels[k]; k++) {
+        struct pl_plane_data data;
+        struct plane_conv conv;
+        setup_rgb48be(&conv, &data, NULL, NULL, W, H);
+        conv.swap = data.swapped = false;
+        REQUIRE(!pl_conv_kernels[k]->convert(&conv, 0, H));
+    }
+
+    // Benchmark all supported kernels on a full HD frame
+    for (int l = 0; l < PL_ARRAY_SIZE(layouts); l++) {
+        const size_t src_size = (size_t) BENCH_H * (BENCH_W * layouts[l].src_bpp + 5);
+        uint8_t *src = malloc(src_size);
+        uint8_t *dst = malloc((size_t) BENCH_H * BENCH_W * layouts[l].dst_bpp);
+        if (!src || !dst) {
+            free(src);
+            free(dst);
+            break;
+        }
+
+        fill_src(src, src_size);
+        for (int k = 0; pl_conv_kernels[k]; k++) {
+            const struct pl_conv_kernels *kern = pl_conv_kernels[k];
+            if (!kern->supported())
+                continue;
+
+            struct pl_plane_data data;
+            struct plane_conv conv;
+            layouts[l].setup(&conv, &data, src, dst, BENCH_W, BENCH_H);
+            pl_clock_t start = pl_clock_now();
+            REQUIRE(kern->convert(&conv, 0, BENCH_H));
+            pl_clock_t stop = pl_clock_now();
+            printf("Plane conversion %s (%s): %.3f ms for %dx%d pixels\n",
+                   layouts[l].name, kern->name, pl_clock_diff(stop, start) * 1e3,
+                   BENCH_W, BENCH_H);
+        }
+
+        free(src);
+        free(dst);
+    }
+}
@@ -106,6 +106,150 @@ static void vulkan_interop_tests(pl_vulkan pl_vk,
     }
 }
 
+static void sample_passes(pl_dispatch dp, pl_tex src, pl_tex fbo, int num)
+{
+    for (int i = 0; i < num; i++) {
+        pl_shader sh = pl_dispatch_begin(dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+    }
+}
+
+static void vulkan_descriptor_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    struct pl_vk *p = PL_PRIV(gpu);
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8,
+                             PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE);
+    if (!fmt)
+        return;
+
+    printf("testing vulkan descriptor pools\n");
+    pl_tex src = pl_tex_create(gpu, pl_tex_params(
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .sampleable = true,
+    ));
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .renderable = true,
+    ));
+    REQUIRE(src && fbo);
+
+    // Force the use of descriptor sets, and run the same pass more often than
+    // there are initially allocated sets, without waiting for completion
+    uint32_t max_push_descriptors = p->max_push_descriptors;
+    p->max_push_descriptors = 0;
+
+    pl_dispatch dp = pl_dispatch_create(gpu->log, gpu);
+    pl_gpu_flush(gpu);
+    struct pl_vulkan_stats before = pl_vulkan_get_stats(vk);
+    sample_passes(dp, src, fbo, 64);
+
+    // Each growth step doubles the number of sets
+    pl_gpu_flush(gpu);
+    struct pl_vulkan_stats after = pl_vulkan_get_stats(vk);
+    uint64_t grows = after.descriptor_pool_grows - before.descriptor_pool_grows;
+    REQUIRE_CMP(after.descriptor_sets - before.descriptor_sets, ==, 16 << grows, "d");
+
+    // Every pass ends its own command, but these should be submitted in batches
+    REQUIRE_CMP(after.frame_cmds, >=, 64, "d");
+    REQUIRE_CMP(after.frame_submits, <, after.frame_cmds, "d");
+    REQUIRE_CMP(after.submitted_cmds - before.submitted_cmds, >=,
+                (uint64_t) after.frame_cmds, PRIu64);
+
+    // All sets are free again, and were last written with the same texture,
+    // so running the pass again should skip re-writing it
+    pl_gpu_finish(gpu);
+    before = pl_vulkan_get_stats(vk);
+    sample_passes(dp, src, fbo, 16);
+    after = pl_vulkan_get_stats(vk);
+    uint64_t writes = after.descriptor_writes - before.descriptor_writes;
+    uint64_t skipped = after.descriptor_writes_skipped - before.descriptor_writes_skipped;
+    REQUIRE_CMP(writes + skipped, >=, (uint64_t) 16, PRIu64);
+    REQUIRE_CMP(skipped, >=, (uint64_t) 16, PRIu64);
+
+    pl_gpu_finish(gpu);
+    pl_dispatch_destroy(&dp);
+    p->max_push_descriptors = max_push_descriptors;
+    pl_tex_destroy(gpu, &src);
+    pl_tex_destroy(gpu, &fbo);
+}
+
+static void vulkan_malloc_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = vk->gpu;
+    struct pl_vk *p = PL_PRIV(gpu);
+    printf("testing vulkan memory allocator\n");
+
+    // Mirror the alignment requirements `vk_buf_create` and `vk_malloc_slice`
+    // impose on plain buffers, to figure out the size of their buddy blocks
+    const VkPhysicalDeviceLimits *limits = &p->vk->props.limits;
+    size_t align = pl_lcm(limits->optimalBufferCopyOffsetAlignment,
+                          p->min_texel_alignment);
+    align = pl_lcm(align, limits->bufferImageGranularity);
+    align = pl_lcm(align, limits->nonCoherentAtomSize);
+    const size_t block = PL_ALIGN_POT(PL_ALIGN(256, align) + align - (align & -align));
+    const bool buddy = block <= 2048;
+
+    pl_gpu_finish(gpu);
+    struct pl_vulkan_stats before = pl_vulkan_get_stats(vk);
+
+    // Lots of small buffers, which should share slabs
+    static pl_buf bufs[1024];
+    for (int i = 0; i < PL_ARRAY_SIZE(bufs); i++) {
+        bufs[i] = pl_buf_create(gpu, pl_buf_params(
+            .size = 256,
+            .memory_type = PL_BUF_MEM_DEVICE,
+        ));
+        REQUIRE(bufs[i]);
+    }
+
+    struct pl_vulkan_stats after = pl_vulkan_get_stats(vk);
+    REQUIRE_CMP(after.memory_used - before.memory_used, >=,
+                PL_ARRAY_SIZE(bufs) * (size_t) 256, "zu");
+    REQUIRE_CMP(after.memory_used, <=, after.memory_allocated, "zu");
+    if (buddy) {
+        // Far less than one 4 KB page per buffer
+        REQUIRE_CMP(after.memory_allocated - before.memory_allocated, <=,
+                    PL_ARRAY_SIZE(bufs) * (size_t) 4096 / 2, "zu");
+    } else {
+        printf("alignment of %zu bytes too large for buddy blocks, "
+               "skipping some checks\n", align);
+    }
+
+    // Leave only a few buffers alive, so that every slab becomes sparse, and
+    // all but one of them can be drained
+    for (int i = 0; i < PL_ARRAY_SIZE(bufs); i++) {
+        if (i % 64)
+            pl_buf_destroy(gpu, &bufs[i]);
+    }
+
+    pl_gpu_flush(gpu);
+    after = pl_vulkan_get_stats(vk);
+    if (buddy) {
+        REQUIRE(after.memory_slabs_draining > before.memory_slabs_draining ||
+                after.memory_reclaimed > before.memory_reclaimed);
+    }
+
+    // Drained slabs are released as soon as they become empty
+    for (int i = 0; i < PL_ARRAY_SIZE(bufs); i++)
+        pl_buf_destroy(gpu, &bufs[i]);
+    pl_gpu_finish(gpu);
+    pl_gpu_flush(gpu);
+    after = pl_vulkan_get_stats(vk);
+    REQUIRE_CMP(after.memory_used, ==, before.memory_used, "zu");
+    if (buddy)
+        REQUIRE_CMP(after.memory_reclaimed, >, before.memory_reclaimed, PRIu64);
+}
+
 static void vulkan_swapchain_tests(pl_vulkan vk, VkSurfaceKHR surf)
 {
     if (!surf)
@@ -233,6 +377,8 @@ int main()
             continue;
 
         gpu_shader_tests(vk->gpu);
+        vulkan_descriptor_tests(vk);
+        vulkan_malloc_tests(vk);
         vulkan_swapchain_tests(vk, surf);
 
         // Print heap statistics
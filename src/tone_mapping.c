@@ -18,6 +18,7 @@
 #include <math.h>
 
 #include "common.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/tone_mapping.h>
 
@@ -142,26 +143,46 @@ static void map_lut(float *lut, const struct pl_tone_map_params *params)
     }
 }
 
-void pl_tone_map_generate(float *out, const struct pl_tone_map_params *params)
+struct generate_args {
+    const struct pl_tone_map_params *params;
+    const struct pl_tone_map_params *fixed;
+    float *out;
+};
+
+static void generate(void *priv, int start, int end)
 {
-    struct pl_tone_map_params fixed = fix_params(params);
+    const struct generate_args *args = priv;
+    const struct pl_tone_map_params *params = args->params;
+    struct pl_tone_map_params fixed = *args->fixed;
+    float *out = args->out + start;
+    const int count = end - start;
 
     // Generate input values evenly spaced in `params->input_scaling`
-    for (size_t i = 0; i < params->lut_size; i++) {
-        float x = (float) i / (params->lut_size - 1);
+    for (int i = 0; i < count; i++) {
+        float x = (float) (start + i) / (params->lut_size - 1);
         x = PL_MIX(params->input_min, params->input_max, x);
         out[i] = pl_hdr_rescale(params->input_scaling, fixed.function->scaling, x);
     }
 
+    fixed.lut_size = count;
     map_lut(out, &fixed);
 
     // Sanitize outputs and adapt back to `params->scaling`
-    for (size_t i = 0; i < params->lut_size; i++) {
+    for (int i = 0; i < count; i++) {
         float x = PL_CLAMP(out[i], fixed.output_min, fixed.output_max);
         out[i] = pl_hdr_rescale(fixed.function->scaling, params->output_scaling, x);
     }
 }
 
+void pl_tone_map_generate(float *out, const struct pl_tone_map_params *params)
+{
+    struct pl_tone_map_params fixed = fix_params(params);
+    struct generate_args args = { params, &fixed, out };
+
+    // Only worth splitting up for fairly large LUTs
+    pl_parallel_for(NULL, params->lut_size, 1024, generate, &args);
+}
+
 float pl_tone_map_sample(float x, const struct pl_tone_map_params *params)
 {
     struct pl_tone_map_params fixed = fix_params(params);
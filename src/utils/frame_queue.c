@@ -20,6 +20,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "pl_clock.h"
 #include "pl_thread.h"
 
 #include <libplacebo/utils/frame_queue.h>
@@ -36,8 +37,13 @@ struct entry {
     struct pl_frame frame;
     uint64_t signature;
     bool mapped;
+    bool mapping; // currently being mapped by a worker thread
     bool ok;
 
+    // Time at which this frame was pushed, cleared once it has been returned
+    // as part of a frame mix (for latency statistics)
+    pl_clock_t pushed;
+
     // for interlaced frames
     enum pl_field field;
     struct entry *primary;
@@ -60,6 +66,31 @@ struct entry {
 // Maximum number of not-yet-mapped frames to allow queueing in advance
 #define PREFETCH_FRAMES 2
 
+// Default number of upcoming frames to map in the background
+#define MAP_AHEAD_FRAMES 4
+
+// Number of frames the lock-free ingress ring can hold before pushes fall
+// back to taking `lock_weak` (must be a power of two)
+#define INGRESS_SLOTS 64
+
+// Bounded multi-producer, single-consumer ring buffer of pushed frames. Each
+// slot's `seq` tracks its state: `seq == pos` means the slot is free for
+// the producer claiming position `pos`, `seq == pos + 1` means it holds the
+// frame pushed at `pos`. Producers claim positions by advancing `tail`; the
+// consumer is whoever holds `lock_weak`.
+struct ingress_slot {
+    atomic_size_t seq;
+    struct pl_source_frame src;
+    pl_clock_t pushed;
+};
+
+struct ingress {
+    struct ingress_slot slots[INGRESS_SLOTS];
+    atomic_size_t tail;
+    size_t head;        // guarded by `lock_weak`
+    atomic_int waiters; // number of threads waiting on `wakeup` for frames
+};
+
 struct pool {
     float samples[MAX_SAMPLES];
     float estimate;
@@ -79,11 +110,23 @@ struct pl_queue_t {
     // remain more or less valid (with the exception of adding new members).
     //
     // In particular, `pl_queue_reset` and `pl_queue_update` will take
-    // the strong lock, while `pl_queue_push_*` will only take the weak
-    // lock.
+    // the strong lock, while `pl_queue_push_block` will only take the weak
+    // lock. `pl_queue_push` normally takes no lock at all, and instead hands
+    // frames over via the `ingress` ring, which gets drained into `queue`
+    // by anybody holding the weak lock.
     pl_mutex lock_strong;
     pl_mutex lock_weak;
     pl_cond wakeup;
+    struct ingress *ingress;
+
+    // Worker threads mapping upcoming frames in the background. These take
+    // `lock_weak` to pick frames, but release it while calling `map`.
+    PL_ARRAY(pl_thread) mappers;
+    pl_cond map_wakeup; // signalled when there may be new frames to map
+    pl_cond map_done;   // signalled when a worker finishes mapping a frame
+    int map_ahead;
+    bool map_exit;
+    bool warned_unsafe;
 
     // Frame queue and state
     PL_ARRAY(struct entry *) queue;
@@ -105,6 +148,10 @@ struct pl_queue_t {
 
     // Queue of GPU objects to reuse
     PL_ARRAY(struct cache_entry) cache;
+
+    // Statistics
+    struct pl_queue_stats stats;
+    double latency_sum;
 };
 
 pl_queue pl_queue_create(pl_gpu gpu)
@@ -113,14 +160,23 @@ pl_queue pl_queue_create(pl_gpu gpu)
     *p = (struct pl_queue_t) {
         .gpu = gpu,
         .log = gpu->log,
+        .ingress = pl_zalloc_ptr(p, p->ingress),
     };
 
+    for (size_t i = 0; i < INGRESS_SLOTS; i++)
+        atomic_init(&p->ingress->slots[i].seq, i);
+    atomic_init(&p->ingress->tail, 0);
+    atomic_init(&p->ingress->waiters, 0);
+
     pl_mutex_init(&p->lock_strong);
     pl_mutex_init(&p->lock_weak);
-    int ret = pl_cond_init(&p->wakeup);
-    if (ret) {
-        PL_ERR(p, "Failed to init conditional variable: %d", ret);
-        return NULL;
+    pl_cond *conds[] = { &p->wakeup, &p->map_wakeup, &p->map_done };
+    for (int i = 0; i < PL_ARRAY_SIZE(conds); i++) {
+        int ret = pl_cond_init(conds[i]);
+        if (ret) {
+            PL_ERR(p, "Failed to init conditional variable: %d", ret);
+            return NULL;
+        }
     }
     return p;
 }
@@ -185,12 +241,22 @@ static void entry_cull(pl_queue p, struct entry *entry, bool recycle)
     entry_deref(p, &entry, recycle);
 }
 
+static void ingress_drain(pl_queue p);
+
 void pl_queue_destroy(pl_queue *queue)
 {
     pl_queue p = *queue;
     if (!p)
         return;
 
+    pl_mutex_lock(&p->lock_weak);
+    p->map_exit = true;
+    pl_cond_broadcast(&p->map_wakeup);
+    pl_mutex_unlock(&p->lock_weak);
+    for (int i = 0; i < p->mappers.num; i++)
+        pl_thread_join(p->mappers.elem[i]);
+
+    ingress_drain(p);
     for (int n = 0; n < p->queue.num; n++)
         entry_cull(p, p->queue.elem[n], false);
     for (int n = 0; n < p->cache.num; n++) {
@@ -199,6 +265,8 @@ void pl_queue_destroy(pl_queue *queue)
     }
 
     pl_cond_destroy(&p->wakeup);
+    pl_cond_destroy(&p->map_wakeup);
+    pl_cond_destroy(&p->map_done);
     pl_mutex_destroy(&p->lock_weak);
     pl_mutex_destroy(&p->lock_strong);
     pl_free(p);
@@ -210,6 +278,8 @@ void pl_queue_reset(pl_queue p)
     pl_mutex_lock(&p->lock_strong);
     pl_mutex_lock(&p->lock_weak);
 
+    // Frames still in flight belong to the stream being reset, too
+    ingress_drain(p);
     for (int i = 0; i < p->queue.num; i++)
         entry_cull(p, p->queue.elem[i], false);
 
@@ -221,6 +291,13 @@ void pl_queue_reset(pl_queue p)
         .lock_strong = p->lock_strong,
         .lock_weak = p->lock_weak,
         .wakeup = p->wakeup,
+        .ingress = p->ingress,
+
+        // Keep the worker threads running, since they reference `p`
+        .mappers = p->mappers,
+        .map_wakeup = p->map_wakeup,
+        .map_done = p->map_done,
+        .warned_unsafe = p->warned_unsafe,
 
         // Explicitly preserve allocations
         .queue.elem = p->queue.elem,
@@ -271,7 +348,8 @@ static inline void update_estimate(struct pool *pool, float cur)
         pool->estimate = pool->sum / pool->num;
 }
 
-static void queue_push(pl_queue p, const struct pl_source_frame *src)
+static void queue_push(pl_queue p, const struct pl_source_frame *src,
+                       pl_clock_t pushed)
 {
     if (p->eof && !src)
         return; // ignore duplicate EOF
@@ -313,6 +391,7 @@ static void queue_push(pl_queue p, const struct pl_source_frame *src)
         .signature = p->signature++,
         .pts = src->pts,
         .src = *src,
+        .pushed = pushed,
     };
     pl_rc_init(&entry->rc);
     PL_ARRAY_POP(p->cache, &entry->cache);
@@ -399,12 +478,84 @@ static void queue_push(pl_queue p, const struct pl_source_frame *src)
     }
 
     p->want_frame = false;
+    if (p->mappers.num)
+        pl_cond_signal(&p->map_wakeup);
+}
+
+// Moves all frames from the ingress ring into the queue. Must be called with
+// `lock_weak` held, which makes the caller the ring's sole consumer.
+static void ingress_drain(pl_queue p)
+{
+    struct ingress *in = p->ingress;
+    for (;;) {
+        struct ingress_slot *slot = &in->slots[in->head % INGRESS_SLOTS];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != in->head + 1)
+            break; // empty, or the producer is still writing this slot
+
+        struct pl_source_frame src = slot->src;
+        pl_clock_t pushed = slot->pushed;
+        atomic_store_explicit(&slot->seq, in->head + INGRESS_SLOTS,
+                              memory_order_release);
+        in->head++;
+
+        p->stats.pushed_async++;
+        queue_push(p, &src, pushed);
+    }
+}
+
+// Returns false if the ring is full
+static bool ingress_push(struct ingress *in, const struct pl_source_frame *src)
+{
+    struct ingress_slot *slot;
+    size_t pos = atomic_load_explicit(&in->tail, memory_order_relaxed);
+    for (;;) {
+        slot = &in->slots[pos % INGRESS_SLOTS];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t) (seq - pos);
+        if (diff < 0)
+            return false;
+
+        if (diff > 0) {
+            // Another producer claimed this position in the meantime
+            pos = atomic_load_explicit(&in->tail, memory_order_relaxed);
+            continue;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&in->tail, &pos, pos + 1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+            break;
+    }
+
+    slot->src = *src;
+    slot->pushed = pl_clock_now();
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return true;
 }
 
 void pl_queue_push(pl_queue p, const struct pl_source_frame *frame)
 {
+    struct ingress *in = p->ingress;
+    if (frame && ingress_push(in, frame)) {
+        // Pairs with the fence in `get_frame`. Either the waiting thread sees
+        // this frame when draining, or we see it waiting and wake it up.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!atomic_load_explicit(&in->waiters, memory_order_relaxed))
+            return;
+
+        pl_mutex_lock(&p->lock_weak);
+        ingress_drain(p);
+        pl_mutex_unlock(&p->lock_weak);
+        return;
+    }
+
+    // EOF, or the ring is full. Drain it first to preserve the push order
     pl_mutex_lock(&p->lock_weak);
-    queue_push(p, frame);
+    ingress_drain(p);
+    if (frame)
+        p->stats.pushed_locked++;
+    queue_push(p, frame, pl_clock_now());
     pl_mutex_unlock(&p->lock_weak);
 }
 
@@ -437,10 +588,12 @@ bool pl_queue_push_block(pl_queue p, uint64_t timeout,
                          const struct pl_source_frame *frame)
 {
     pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
     if (!timeout || !frame || p->eof)
         goto skip_blocking;
 
     while (!queue_has_room(p) && !p->eof) {
+        ingress_drain(p);
         if (pl_cond_timedwait(&p->wakeup, &p->lock_weak, timeout) == ETIMEDOUT) {
             pl_mutex_unlock(&p->lock_weak);
             return false;
@@ -449,7 +602,10 @@ bool pl_queue_push_block(pl_queue p, uint64_t timeout,
 
 skip_blocking:
 
-    queue_push(p, frame);
+    ingress_drain(p);
+    if (frame)
+        p->stats.pushed_locked++;
+    queue_push(p, frame, pl_clock_now());
     pl_mutex_unlock(&p->lock_weak);
     return true;
 }
@@ -488,11 +644,24 @@ static enum pl_queue_status get_frame(pl_queue p, const struct pl_queue_params *
         p->want_frame = true;
         pl_cond_signal(&p->wakeup);
 
+        // Make lock-free pushes from now on wake us up, see `pl_queue_push`
+        struct ingress *in = p->ingress;
+        atomic_fetch_add(&in->waiters, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        enum pl_queue_status ret = PL_QUEUE_OK;
+        ingress_drain(p);
         while (p->want_frame) {
-            if (pl_cond_timedwait(&p->wakeup, &p->lock_weak, params->timeout) == ETIMEDOUT)
-                return PL_QUEUE_MORE;
+            if (pl_cond_timedwait(&p->wakeup, &p->lock_weak, params->timeout) == ETIMEDOUT) {
+                ret = PL_QUEUE_MORE;
+                break;
+            }
+            ingress_drain(p);
         }
 
+        atomic_fetch_sub(&in->waiters, 1);
+        if (ret == PL_QUEUE_MORE)
+            return ret;
         return p->eof ? PL_QUEUE_EOF : PL_QUEUE_OK;
     }
 
@@ -501,26 +670,34 @@ static enum pl_queue_status get_frame(pl_queue p, const struct pl_queue_params *
     pl_mutex_unlock(&p->lock_weak);
 
     struct pl_source_frame src;
-    enum pl_queue_status ret;
-    switch ((ret = params->get_frame(&src, params))) {
+    enum pl_queue_status ret = params->get_frame(&src, params);
+    pl_clock_t pushed = pl_clock_now();
+    pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
+
+    switch (ret) {
     case PL_QUEUE_OK:
-        pl_queue_push(p, &src);
+        p->stats.pushed_locked++;
+        queue_push(p, &src, pushed);
         break;
     case PL_QUEUE_EOF:
-        pl_queue_push(p, NULL);
+        queue_push(p, NULL, pushed);
         break;
     case PL_QUEUE_MORE:
     case PL_QUEUE_ERR:
         break;
     }
 
-    pl_mutex_lock(&p->lock_weak);
     return ret;
 }
 
 static inline bool map_frame(pl_queue p, struct entry *entry)
 {
+    while (entry->mapping)
+        pl_cond_wait(&p->map_done, &p->lock_weak);
+
     if (!entry->mapped) {
+        p->stats.mapped_sync++;
         PL_TRACE(p, "Mapping frame id %"PRIu64" with PTS %f",
                  entry->signature, entry->pts);
         entry->mapped = true;
@@ -534,6 +711,88 @@ static inline bool map_frame(pl_queue p, struct entry *entry)
     return entry->ok;
 }
 
+// Returns the next frame within the look-ahead window which still needs to be
+// mapped, or NULL if there is none
+static struct entry *next_map_job(pl_queue p)
+{
+    int window = PL_MIN(p->queue.num, p->map_ahead + 1);
+    for (int i = 0; i < window; i++) {
+        struct entry *entry = p->queue.elem[i];
+        entry = PL_DEF(entry->primary, entry);
+        if (!entry->mapped && !entry->mapping)
+            return entry;
+    }
+
+    return NULL;
+}
+
+static PL_THREAD_VOID map_thread(void *arg)
+{
+    pl_queue p = arg;
+    pl_mutex_lock(&p->lock_weak);
+    while (!p->map_exit) {
+        ingress_drain(p);
+        struct entry *entry = next_map_job(p);
+        if (!entry) {
+            pl_cond_wait(&p->map_wakeup, &p->lock_weak);
+            continue;
+        }
+
+        // Hold a reference, since the frame may be culled in the meantime.
+        // Each frame has its own set of cached textures, so mapping it does
+        // not conflict with frames being mapped by other threads.
+        PL_TRACE(p, "Mapping frame id %"PRIu64" with PTS %f in the background",
+                 entry->signature, entry->pts);
+        entry_ref(entry);
+        entry->mapping = true;
+        pl_mutex_unlock(&p->lock_weak);
+
+        bool ok = entry->src.map(p->gpu, entry->cache.tex, &entry->src,
+                                 &entry->frame);
+
+        pl_mutex_lock(&p->lock_weak);
+        if (!ok)
+            PL_ERR(p, "Failed mapping frame id %"PRIu64" with PTS %f",
+                   entry->signature, entry->pts);
+        entry->ok = ok;
+        entry->mapped = true;
+        entry->mapping = false;
+        p->stats.mapped_async++;
+        pl_cond_broadcast(&p->map_done);
+        entry_deref(p, &entry, true);
+    }
+
+    pl_mutex_unlock(&p->lock_weak);
+    PL_THREAD_RETURN();
+}
+
+static void update_mappers(pl_queue p, const struct pl_queue_params *params)
+{
+    if (params->map_threads > p->mappers.num && !p->gpu->limits.thread_safe) {
+        if (!p->warned_unsafe) {
+            PL_WARN(p, "Requested %d threads for mapping frames, but the GPU "
+                    "is not thread-safe! Mapping frames synchronously...",
+                    params->map_threads);
+            p->warned_unsafe = true;
+        }
+        p->map_ahead = 0;
+        return;
+    }
+
+    while (p->mappers.num < params->map_threads) {
+        pl_thread thread;
+        if (pl_thread_create(&thread, map_thread, p)) {
+            PL_ERR(p, "Failed creating frame mapping thread!");
+            break;
+        }
+        PL_ARRAY_APPEND(p, p->mappers, thread);
+    }
+
+    p->map_ahead = 0;
+    if (params->map_threads > 0)
+        p->map_ahead = PL_DEF(params->map_ahead, MAP_AHEAD_FRAMES);
+}
+
 static bool map_entry(pl_queue p, struct entry *entry)
 {
     bool ok = map_frame(p, entry->primary ? entry->primary : entry);
@@ -558,6 +817,27 @@ static bool map_entry(pl_queue p, struct entry *entry)
     return true;
 }
 
+// Appends a mapped entry to the frame mix under construction
+static void mix_append(pl_queue p, struct entry *entry, float ts)
+{
+    PL_ARRAY_APPEND(p, p->tmp_sig, entry->signature);
+    PL_ARRAY_APPEND(p, p->tmp_frame, &entry->frame);
+    PL_ARRAY_APPEND(p, p->tmp_ts, ts);
+
+    if (!entry->pushed)
+        return; // already accounted for, or second field
+
+    double latency = pl_clock_diff(pl_clock_now(), entry->pushed);
+    entry->pushed = 0;
+
+    struct pl_queue_stats *stats = &p->stats;
+    stats->rendered++;
+    stats->latency_last = latency;
+    stats->latency_max = PL_MAX(stats->latency_max, latency);
+    p->latency_sum += latency;
+    stats->latency_avg = p->latency_sum / stats->rendered;
+}
+
 static bool entry_complete(struct entry *entry)
 {
     return entry->field ? !!entry->next : true;
@@ -672,9 +952,7 @@ static inline enum pl_queue_status point(pl_queue p, struct pl_frame_mix *mix,
 
     // Return a mix containing only this single frame
     p->tmp_sig.num = p->tmp_ts.num = p->tmp_frame.num = 0;
-    PL_ARRAY_APPEND(p, p->tmp_sig, entry->signature);
-    PL_ARRAY_APPEND(p, p->tmp_frame, &entry->frame);
-    PL_ARRAY_APPEND(p, p->tmp_ts, 0.0);
+    mix_append(p, entry, 0.0);
     *mix = (struct pl_frame_mix) {
         .num_frames = 1,
         .frames = p->tmp_frame.elem,
@@ -750,9 +1028,7 @@ static enum pl_queue_status oversample(pl_queue p, struct pl_frame_mix *mix,
         if (!map_entry(p, entries[i]))
             return PL_QUEUE_ERR;
         float ts = (entries[i]->pts - params->pts) / p->fps.estimate;
-        PL_ARRAY_APPEND(p, p->tmp_sig, entries[i]->signature);
-        PL_ARRAY_APPEND(p, p->tmp_frame, &entries[i]->frame);
-        PL_ARRAY_APPEND(p, p->tmp_ts, ts);
+        mix_append(p, entries[i], ts);
     }
 
     *mix = (struct pl_frame_mix) {
@@ -873,9 +1149,7 @@ done: ;
         if (!map_entry(p, entry))
             return PL_QUEUE_ERR;
         float ts = (entry->pts - params->pts) / p->fps.estimate;
-        PL_ARRAY_APPEND(p, p->tmp_sig, entry->signature);
-        PL_ARRAY_APPEND(p, p->tmp_frame, &entry->frame);
-        PL_ARRAY_APPEND(p, p->tmp_ts, ts);
+        mix_append(p, entry, ts);
     }
 
     *mix = (struct pl_frame_mix) {
@@ -931,6 +1205,8 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
 {
     pl_mutex_lock(&p->lock_strong);
     pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
+    update_mappers(p, params);
     default_estimate(&p->vps, params->vsync_duration);
 
     float delta = params->pts - p->prev_pts;
@@ -989,6 +1265,10 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
         ret = nearest(p, out_mix, params);
     }
 
+    // Frames may have been culled, so the look-ahead window has moved
+    if (p->map_ahead)
+        pl_cond_broadcast(&p->map_wakeup);
+
     pl_cond_signal(&p->wakeup);
     pl_mutex_unlock(&p->lock_weak);
     pl_mutex_unlock(&p->lock_strong);
@@ -998,6 +1278,7 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
 float pl_queue_estimate_fps(pl_queue p)
 {
     pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
     float estimate = p->fps.estimate;
     pl_mutex_unlock(&p->lock_weak);
     return estimate ? 1.0f / estimate : 0.0f;
@@ -1014,6 +1295,7 @@ float pl_queue_estimate_vps(pl_queue p)
 int pl_queue_num_frames(pl_queue p)
 {
     pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
     int count = p->queue.num;
     pl_mutex_unlock(&p->lock_weak);
     return count;
@@ -1022,9 +1304,19 @@ int pl_queue_num_frames(pl_queue p)
 bool pl_queue_peek(pl_queue p, int idx, struct pl_source_frame *out)
 {
     pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
     bool ok = idx >= 0 && idx < p->queue.num;
     if (ok)
         *out = p->queue.elem[idx]->src;
     pl_mutex_unlock(&p->lock_weak);
     return ok;
 }
+
+struct pl_queue_stats pl_queue_get_stats(pl_queue p)
+{
+    pl_mutex_lock(&p->lock_weak);
+    ingress_drain(p);
+    struct pl_queue_stats stats = p->stats;
+    pl_mutex_unlock(&p->lock_weak);
+    return stats;
+}
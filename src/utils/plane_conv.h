@@ -0,0 +1,64 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <libplacebo/utils/upload.h>
+
+// Software fallback for plane layouts that don't map onto any texture format,
+// e.g. packed formats with no GPU equivalent or 3-byte texels on GPUs without
+// such formats. The components are unpacked on the CPU and rewritten as plain
+// words of `depth` bits each, rescaling normalized values as needed.
+struct plane_conv {
+    const struct pl_plane_data *data;
+    pl_fmt fmt;
+    int num;            // number of components to convert
+    int size[4];        // bit size of each component
+    int offset[4];      // bit offset of each component inside the pixel
+    int depth;          // bits per output component
+    int texel_size;     // bytes per output texel, including padding
+    bool packed;        // read the whole pixel as a single word
+    bool swap;          // byte-swap each word read from the source
+    const uint8_t *src;
+    uint8_t *dst;
+    size_t dst_stride;
+};
+
+// Row conversion kernels for `struct plane_conv`. Besides the generic scalar
+// implementation, there are vectorized fast paths for common special cases.
+struct pl_conv_kernels {
+    const char *name;
+
+    // Returns whether these kernels can be used on the running CPU.
+    bool (*supported)(void);
+
+    // Converts rows [start, end) of `conv->src` into `conv->dst`. Returns
+    // false without writing anything if the layout of `conv` is not handled
+    // by these kernels, in which case the caller should fall back to the
+    // scalar kernels, which handle every layout.
+    bool (*convert)(const struct plane_conv *conv, int start, int end);
+};
+
+// All kernels compiled into this binary, sorted from slowest to fastest and
+// terminated by NULL. The first entry is the scalar reference implementation,
+// which is always supported.
+extern const struct pl_conv_kernels * const pl_conv_kernels[];
+
+// Returns the fastest set of kernels supported by the running CPU.
+const struct pl_conv_kernels *pl_conv_kernels_get(void);
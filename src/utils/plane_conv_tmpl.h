@@ -0,0 +1,140 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Template for the vectorized plane conversion kernels, included multiple
+// times by upload.c. The including file must define:
+//
+//   KERNEL_NAME:       identifier for this instance, e.g. `ssse3`
+//   KERNEL_VBYTES:     number of bytes per vector, either 16 or 32
+//   KERNEL_TARGET:     function attributes selecting the target ISA
+//   KERNEL_SUPPORTED:  function returning whether the target ISA is available
+//
+// Pixels left over at the end of each row are handled by `convert_row`, so
+// the output is always identical to that of the scalar kernels.
+
+#define KCAT_(a, b) a##_##b
+#define KCAT(a, b) KCAT_(a, b)
+
+#define VBYTES      KERNEL_VBYTES
+#define VINLINE     static inline __attribute__((always_inline)) KERNEL_TARGET
+#define vu8         KCAT(KERNEL_NAME, vu8)
+#define vu16        KCAT(KERNEL_NAME, vu16)
+#define rgb24_rows  KCAT(KERNEL_NAME, rgb24_rows)
+#define swap16_rows KCAT(KERNEL_NAME, swap16_rows)
+
+typedef uint8_t  vu8  __attribute__((vector_size(VBYTES)));
+typedef uint16_t vu16 __attribute__((vector_size(VBYTES)));
+
+// Expands 3-byte pixels into 4-byte pixels, with `z` selecting a zero byte
+#define RGB24_PX(z, i) 3 * (i), 3 * (i) + 1, 3 * (i) + 2, (z)
+#if VBYTES == 16
+# define RGB24_MASK \
+    RGB24_PX(16, 0), RGB24_PX(16, 1), RGB24_PX(16, 2), RGB24_PX(16, 3)
+#elif VBYTES == 32
+# define RGB24_MASK \
+    RGB24_PX(32, 0), RGB24_PX(32, 1), RGB24_PX(32, 2), RGB24_PX(32, 3), \
+    RGB24_PX(32, 4), RGB24_PX(32, 5), RGB24_PX(32, 6), RGB24_PX(32, 7)
+#else
+# error Unsupported vector size!
+#endif
+
+VINLINE void rgb24_rows(const struct plane_conv *conv, int start, int end)
+{
+    const struct pl_plane_data *data = conv->data;
+    const size_t src_stride = PL_DEF(data->row_stride, data->width * 3);
+    const int px = VBYTES / 4; // pixels per iteration
+    const vu8 zero = {0};
+
+    for (int y = start; y < end; y++) {
+        const uint8_t *src = conv->src + y * src_stride;
+        uint8_t *dst = conv->dst + y * conv->dst_stride;
+        int x = 0;
+
+        // Each iteration reads a full vector, of which only 3/4 are used,
+        // so stop early enough to never read past the end of the row
+        for (; 3 * x + VBYTES <= 3 * data->width; x += px) {
+            vu8 in;
+            memcpy(&in, src + 3 * x, sizeof(in));
+            const vu8 out = __builtin_shufflevector(in, zero, RGB24_MASK);
+            memcpy(dst + 4 * x, &out, sizeof(out));
+        }
+
+        convert_row(conv, src + 3 * x, dst + 4 * x, data->width - x);
+    }
+}
+
+VINLINE void swap16_rows(const struct plane_conv *conv, int start, int end)
+{
+    const struct pl_plane_data *data = conv->data;
+    const int words = data->width * conv->num;
+    const size_t src_stride = PL_DEF(data->row_stride, 2 * words);
+    const int vlen = VBYTES / 2;
+
+    for (int y = start; y < end; y++) {
+        const uint8_t *src = conv->src + y * src_stride;
+        uint8_t *dst = conv->dst + y * conv->dst_stride;
+        int i = 0;
+        for (; i + vlen <= words; i += vlen) {
+            vu16 v;
+            memcpy(&v, src + 2 * i, sizeof(v));
+            v = (v << 8) | (v >> 8);
+            memcpy(dst + 2 * i, &v, sizeof(v));
+        }
+
+        for (; i < words; i++) {
+            dst[2 * i + 0] = src[2 * i + 1];
+            dst[2 * i + 1] = src[2 * i + 0];
+        }
+    }
+}
+
+KERNEL_TARGET
+static bool KCAT(KERNEL_NAME, convert)(const struct plane_conv *conv,
+                                       int start, int end)
+{
+    if (conv_is_rgb24(conv)) {
+        rgb24_rows(conv, start, end);
+        return true;
+    } else if (conv_is_swap16(conv)) {
+        swap16_rows(conv, start, end);
+        return true;
+    }
+
+    return false;
+}
+
+static const struct pl_conv_kernels KCAT(kernels, KERNEL_NAME) = {
+    .name       = PL_TOSTRING(KERNEL_NAME),
+    .supported  = KERNEL_SUPPORTED,
+    .convert    = KCAT(KERNEL_NAME, convert),
+};
+
+#undef KCAT_
+#undef KCAT
+#undef VBYTES
+#undef VINLINE
+#undef vu8
+#undef vu16
+#undef rgb24_rows
+#undef swap16_rows
+#undef RGB24_PX
+#undef RGB24_MASK
+
+#undef KERNEL_NAME
+#undef KERNEL_VBYTES
+#undef KERNEL_TARGET
+#undef KERNEL_SUPPORTED
@@ -18,6 +18,10 @@
 #include "log.h"
 #include "common.h"
 #include "gpu.h"
+#include "pl_clock.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
+#include "utils/plane_conv.h"
 
 #include <libplacebo/utils/upload.h>
 
@@ -228,18 +232,385 @@ next_fmt: ; // acts as `continue`
     return NULL;
 }
 
+static pl_fmt find_conv_fmt(pl_gpu gpu, enum pl_fmt_type type, int num, int depth)
+{
+    pl_fmt best = NULL;
+    for (int n = 0; n < gpu->num_formats; n++) {
+        pl_fmt fmt = gpu->formats[n];
+        if (fmt->opaque || fmt->type != type || fmt->num_components < num)
+            continue;
+        if (!(fmt->caps & PL_FMT_CAP_SAMPLEABLE))
+            continue;
+        if (fmt->texel_size * 8 != fmt->num_components * depth)
+            continue;
+
+        for (int i = 0; i < fmt->num_components; i++) {
+            if (fmt->host_bits[i] != depth || fmt->sample_order[i] != i)
+                goto next_fmt;
+        }
+
+        if (!best || fmt->num_components < best->num_components)
+            best = fmt;
+
+next_fmt: ; // acts as `continue`
+    }
+
+    return best;
+}
+
+static pl_fmt setup_conv(pl_gpu gpu, struct plane_conv *conv, int out_map[4],
+                         const struct pl_plane_data *data)
+{
+    *conv = (struct plane_conv) { .data = data, .swap = data->swapped };
+    if (data->pixels) {
+        conv->src = data->pixels;
+    } else if (data->buf->data) {
+        conv->src = data->buf->data + data->buf_offset;
+    } else {
+        PL_TRACE(gpu, "Plane data is not host-accessible, cannot convert it");
+        return NULL;
+    }
+
+    int bits = 0, max_size = 0;
+    bool aligned = true; // all components are equally sized, whole words
+    for (int i = 0; i < PL_ARRAY_SIZE(data->component_size); i++) {
+        out_map[i] = -1;
+        bits += data->component_pad[i];
+        const int size = data->component_size[i];
+        if (!size)
+            continue;
+
+        if (bits % 8 || (size != 8 && size != 16 && size != 32) ||
+            (conv->num && size != conv->size[0]))
+        {
+            aligned = false;
+        }
+
+        out_map[conv->num] = data->component_map[i];
+        conv->size[conv->num] = size;
+        conv->offset[conv->num] = bits;
+        conv->num++;
+        max_size = PL_MAX(max_size, size);
+        bits += size;
+    }
+
+    const size_t stride = data->pixel_stride;
+    if (!conv->num || bits > stride * 8)
+        return NULL;
+
+    if (!aligned) {
+        // Packed layouts are read as a single native-endian word per pixel
+        if (stride != 1 && stride != 2 && stride != 4 && stride != 8)
+            return NULL;
+        if (data->type == PL_FMT_FLOAT)
+            return NULL;
+        conv->packed = true;
+    }
+
+    if (data->type == PL_FMT_SNORM && max_size < 2)
+        return NULL;
+
+    for (int depth = 8; depth <= 32; depth *= 2) {
+        if (depth < max_size || (data->type == PL_FMT_FLOAT && depth != max_size))
+            continue;
+        conv->fmt = find_conv_fmt(gpu, data->type, conv->num, depth);
+        if (conv->fmt) {
+            conv->depth = depth;
+            conv->texel_size = conv->fmt->texel_size;
+            return conv->fmt;
+        }
+    }
+
+    return NULL;
+}
+
+static inline uint64_t load_word(const uint8_t *p, int bytes, bool swap)
+{
+    uint8_t tmp[8];
+    for (int i = 0; i < bytes; i++)
+        tmp[i] = p[swap ? bytes - i - 1 : i];
+
+    switch (bytes) {
+    case 1: return tmp[0];
+    case 2: { uint16_t x; memcpy(&x, tmp, sizeof(x)); return x; }
+    case 4: { uint32_t x; memcpy(&x, tmp, sizeof(x)); return x; }
+    case 8: { uint64_t x; memcpy(&x, tmp, sizeof(x)); return x; }
+    }
+
+    pl_unreachable();
+}
+
+static inline void store_word(uint8_t *p, int bytes, uint64_t x)
+{
+    switch (bytes) {
+    case 1: *p = x; return;
+    case 2: { uint16_t v = x; memcpy(p, &v, sizeof(v)); return; }
+    case 4: { uint32_t v = x; memcpy(p, &v, sizeof(v)); return; }
+    }
+
+    pl_unreachable();
+}
+
+static inline uint64_t conv_comp(enum pl_fmt_type type, uint64_t x, int size,
+                                 int depth)
+{
+    if (size == depth)
+        return x;
+
+    const uint64_t mask = UINT64_MAX >> (64 - depth);
+    switch (type) {
+    case PL_FMT_UINT:
+        return x;
+    case PL_FMT_UNORM: {
+        const uint64_t in_max = UINT64_MAX >> (64 - size);
+        return (x * mask + in_max / 2) / in_max;
+    }
+    case PL_FMT_SINT:
+    case PL_FMT_SNORM: {
+        const int64_t in_max = (INT64_C(1) << (size - 1)) - 1;
+        int64_t v = x > (uint64_t) in_max ? (int64_t) x - 2 * in_max - 2 : (int64_t) x;
+        if (type == PL_FMT_SNORM) {
+            const int64_t out_max = mask >> 1;
+            v = PL_MAX(v, -in_max) * out_max;
+            v = (v + (v < 0 ? -in_max : in_max) / 2) / in_max;
+        }
+        return (uint64_t) v & mask;
+    }
+    case PL_FMT_FLOAT:
+    case PL_FMT_UNKNOWN:
+    case PL_FMT_TYPE_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+}
+
+// Converts `width` pixels of a single row
+static inline void convert_row(const struct plane_conv *conv, const uint8_t *src,
+                               uint8_t *dst, int width)
+{
+    const struct pl_plane_data *data = conv->data;
+    const int out_bytes = conv->depth / 8;
+    const size_t pad_bytes = conv->texel_size - conv->num * out_bytes;
+
+    for (int x = 0; x < width; x++, src += data->pixel_stride) {
+        uint64_t word = 0;
+        if (conv->packed)
+            word = load_word(src, data->pixel_stride, conv->swap);
+
+        for (int i = 0; i < conv->num; i++, dst += out_bytes) {
+            const int size = conv->size[i];
+            uint64_t v;
+            if (conv->packed) {
+                v = (word >> conv->offset[i]) & (UINT64_MAX >> (64 - size));
+            } else {
+                v = load_word(src + conv->offset[i] / 8, size / 8, conv->swap);
+            }
+            store_word(dst, out_bytes, conv_comp(data->type, v, size, conv->depth));
+        }
+
+        memset(dst, 0, pad_bytes);
+        dst += pad_bytes;
+    }
+}
+
+static bool scalar_supported(void)
+{
+    return true;
+}
+
+static bool scalar_convert(const struct plane_conv *conv, int start, int end)
+{
+    const struct pl_plane_data *data = conv->data;
+    const size_t src_stride = PL_DEF(data->row_stride, data->width * data->pixel_stride);
+    for (int y = start; y < end; y++) {
+        convert_row(conv, conv->src + y * src_stride,
+                    conv->dst + y * conv->dst_stride, data->width);
+    }
+
+    return true;
+}
+
+static const struct pl_conv_kernels kernels_scalar = {
+    .name       = "scalar",
+    .supported  = scalar_supported,
+    .convert    = scalar_convert,
+};
+
+// Layouts with vectorized fast paths
+
+// Three 8-bit components, padded out to four (e.g. rgb24 -> rgba8)
+static inline bool conv_is_rgb24(const struct plane_conv *conv)
+{
+    return !conv->packed && conv->num == 3 && conv->depth == 8 &&
+           conv->data->pixel_stride == 3 && conv->texel_size == 4;
+}
+
+// Tightly packed, byte-swapped 16-bit components (e.g. rgba16be)
+static inline bool conv_is_swap16(const struct plane_conv *conv)
+{
+    if (conv->packed || !conv->swap || conv->depth != 16)
+        return false;
+    if (conv->data->pixel_stride != 2 * conv->num || conv->texel_size != 2 * conv->num)
+        return false;
+    for (int i = 0; i < conv->num; i++) {
+        if (conv->size[i] != 16 || conv->offset[i] != 16 * i)
+            return false;
+    }
+    return true;
+}
+
+#ifdef __has_builtin
+# if __has_builtin(__builtin_shufflevector)
+#  define HAVE_CONV_KERNELS
+# endif
+#endif
+
+#ifdef HAVE_CONV_KERNELS
+
+// Vectorized kernels, written using generic vector extensions, and
+// instantiated for SSSE3 (for `pshufb`) and AVX2 on x86, selected at runtime.
+#if defined(__x86_64__) || defined(__i386__)
+
+static bool ssse3_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+# define KERNEL_NAME        ssse3
+# define KERNEL_VBYTES      16
+# define KERNEL_TARGET      __attribute__((target("ssse3")))
+# define KERNEL_SUPPORTED   ssse3_supported
+# include "plane_conv_tmpl.h"
+
+static bool avx2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+# define KERNEL_NAME        avx2
+# define KERNEL_VBYTES      32
+# define KERNEL_TARGET      __attribute__((target("avx2")))
+# define KERNEL_SUPPORTED   avx2_supported
+# include "plane_conv_tmpl.h"
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+# define KERNEL_NAME        neon
+# define KERNEL_VBYTES      16
+# define KERNEL_TARGET
+# define KERNEL_SUPPORTED   scalar_supported
+# include "plane_conv_tmpl.h"
+
+#else
+
+# define KERNEL_NAME        vector
+# define KERNEL_VBYTES      16
+# define KERNEL_TARGET
+# define KERNEL_SUPPORTED   scalar_supported
+# include "plane_conv_tmpl.h"
+
+#endif
+#endif // HAVE_CONV_KERNELS
+
+const struct pl_conv_kernels * const pl_conv_kernels[] = {
+    &kernels_scalar,
+#ifdef HAVE_CONV_KERNELS
+# if defined(__x86_64__) || defined(__i386__)
+    &kernels_ssse3,
+    &kernels_avx2,
+# elif defined(__aarch64__) || defined(__ARM_NEON)
+    &kernels_neon,
+# else
+    &kernels_vector,
+# endif
+#endif
+    NULL
+};
+
+const struct pl_conv_kernels *pl_conv_kernels_get(void)
+{
+    static pl_static_mutex lock = PL_STATIC_MUTEX_INITIALIZER;
+    static const struct pl_conv_kernels *best;
+
+    pl_static_mutex_lock(&lock);
+    if (!best) {
+        for (int i = 0; pl_conv_kernels[i]; i++) {
+            if (pl_conv_kernels[i]->supported())
+                best = pl_conv_kernels[i];
+        }
+    }
+    const struct pl_conv_kernels *kernels = best;
+    pl_static_mutex_unlock(&lock);
+    return kernels;
+}
+
+static void convert_rows(void *priv, int start, int end)
+{
+    const struct plane_conv *conv = priv;
+    if (!pl_conv_kernels_get()->convert(conv, start, end))
+        kernels_scalar.convert(conv, start, end);
+}
+
+static bool upload_converted(pl_gpu gpu, struct plane_conv *conv,
+                             struct pl_tex_transfer_params *params)
+{
+    const struct pl_plane_data *data = conv->data;
+    conv->dst_stride = data->width * conv->texel_size;
+    const size_t size = conv->dst_stride * data->height;
+    pl_clock_t start = pl_clock_now();
+
+    pl_buf buf = NULL;
+    if (gpu->limits.buf_transfer && size <= gpu->limits.max_mapped_size) {
+        buf = pl_buf_pool_get(gpu, pl_buf_params(
+            .size           = size,
+            .host_mapped    = true,
+        ));
+    }
+
+    void *tmp = NULL;
+    conv->dst = buf ? buf->data : (tmp = pl_alloc(NULL, size));
+
+    // Split the work into chunks of roughly 64k pixels each
+    const int min_rows = PL_MAX(1, (1 << 16) / data->width);
+    pl_parallel_for(NULL, data->height, min_rows, convert_rows, conv);
+    pl_log_cpu_time(gpu->log, start, pl_clock_now(), "converting plane data");
+
+    // The source data is no longer needed after conversion
+    if (data->callback)
+        data->callback(data->priv);
+
+    params->row_pitch = conv->dst_stride;
+    params->ptr = tmp;
+    params->buf = buf;
+    params->buf_offset = 0;
+    params->callback = NULL;
+    params->priv = NULL;
+
+    bool ok = pl_tex_upload(gpu, params);
+    pl_buf_pool_put(gpu, &buf);
+    pl_free(tmp);
+    return ok;
+}
+
 bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
                      pl_tex *tex, const struct pl_plane_data *data)
 {
     pl_assert(!data->buf ^ !data->pixels); // exactly one
 
     int out_map[4];
+    struct plane_conv conv = {0};
     pl_fmt fmt = pl_plane_find_fmt(gpu, out_map, data);
+    if (!fmt && (fmt = setup_conv(gpu, &conv, out_map, data))) {
+        PL_DEBUG(gpu, "No texture format matches the plane data layout, "
+                 "converting it to '%s' on the CPU", fmt->name);
+    }
+
     if (!fmt) {
         PL_ERR(gpu, "Failed picking any compatible texture format for a plane!");
         return false;
-
-        // TODO: try soft-converting to a supported format using e.g zimg?
     }
 
     bool ok = pl_tex_recreate(gpu, tex, pl_tex_params(
@@ -279,23 +650,26 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
         .priv       = data->priv,
     };
 
+    if (conv.fmt)
+        return upload_converted(gpu, &conv, &params);
+
     pl_buf swapbuf = NULL;
     if (data->swapped) {
-        const size_t aligned = PL_ALIGN2(pl_tex_transfer_size(&params), 4);
-        swapbuf = pl_buf_create(gpu, pl_buf_params(
+        const size_t size = pl_tex_transfer_size(&params);
+        const size_t aligned = PL_ALIGN2(size, 4);
+        swapbuf = pl_buf_pool_get(gpu, pl_buf_params(
             .size           = aligned,
             .storable       = true,
-            .initial_data   = params.ptr,
-
-            // Note: This may over-read from `ptr` if `ptr` is not aligned to a
-            // word boundary, but the extra texels will be ignored by
-            // `pl_tex_upload` so this UB should be a non-issue in practice.
+            .host_writable  = params.ptr != NULL,
         ));
         if (!swapbuf) {
             PL_ERR(gpu, "Failed creating endian swapping buffer!");
             return false;
         }
 
+        if (params.ptr)
+            pl_buf_write(gpu, swapbuf, 0, params.ptr, size);
+
         struct pl_buf_copy_swap_params swap_params = {
             .src        = swapbuf,
             .dst        = swapbuf,
@@ -323,7 +697,7 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
 
         if (!pl_buf_copy_swap(gpu, &swap_params)) {
             PL_ERR(gpu, "Failed swapping endianness!");
-            pl_buf_destroy(gpu, &swapbuf);
+            pl_buf_pool_put(gpu, &swapbuf);
             return false;
         }
 
@@ -333,7 +707,7 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
     }
 
     ok = pl_tex_upload(gpu, &params);
-    pl_buf_destroy(gpu, &swapbuf);
+    pl_buf_pool_put(gpu, &swapbuf);
     return ok;
 }
 
@@ -111,7 +111,10 @@ void vk_dev_callback(struct vk_ctx *vk, vk_cb callback,
                      const void *priv, const void *arg)
 {
     pl_mutex_lock(&vk->lock);
-    if (vk->cmds_pending.num > 0) {
+    if (vk->cmds_queued.num > 0) {
+        struct vk_cmd *last_cmd = vk->cmds_queued.elem[vk->cmds_queued.num - 1];
+        vk_cmd_callback(last_cmd, callback, priv, arg);
+    } else if (vk->cmds_pending.num > 0) {
         struct vk_cmd *last_cmd = vk->cmds_pending.elem[vk->cmds_pending.num - 1];
         vk_cmd_callback(last_cmd, callback, priv, arg);
     } else {
@@ -402,63 +405,72 @@ error:
     return NULL;
 }
 
-static VkResult vk_queue_submit2(struct vk_ctx *vk, VkQueue queue,
-                                 const VkSubmitInfo2 *info2, VkFence fence)
+// Upper bound on the number of commands to batch together
+#define MAX_QUEUED_CMDS 16
+
+static VkResult vk_queue_submit2(struct vk_ctx *vk, VkQueue queue, int num,
+                                 const VkSubmitInfo2 *infos2, VkFence fence)
 {
     if (vk->QueueSubmit2KHR)
-        return vk->QueueSubmit2KHR(queue, 1, info2, fence);
-
-    const uint32_t num_deps = info2->waitSemaphoreInfoCount;
-    const uint32_t num_sigs = info2->signalSemaphoreInfoCount;
-    const uint32_t num_cmds = info2->commandBufferInfoCount;
+        return vk->QueueSubmit2KHR(queue, num, infos2, fence);
 
     void *tmp = pl_tmp(NULL);
-    VkSemaphore *deps           = pl_calloc_ptr(tmp, num_deps, deps);
-    VkPipelineStageFlags *masks = pl_calloc_ptr(tmp, num_deps, masks);
-    uint64_t *depvals           = pl_calloc_ptr(tmp, num_deps, depvals);
-    VkSemaphore *sigs           = pl_calloc_ptr(tmp, num_sigs, sigs);
-    uint64_t *sigvals           = pl_calloc_ptr(tmp, num_sigs, sigvals);
-    VkCommandBuffer *cmds       = pl_calloc_ptr(tmp, num_cmds, cmds);
-
-    for (int i = 0; i < num_deps; i++) {
-        deps[i] = info2->pWaitSemaphoreInfos[i].semaphore;
-        masks[i] = info2->pWaitSemaphoreInfos[i].stageMask;
-        depvals[i] = info2->pWaitSemaphoreInfos[i].value;
-    }
-    for (int i = 0; i < num_sigs; i++) {
-        sigs[i] = info2->pSignalSemaphoreInfos[i].semaphore;
-        sigvals[i] = info2->pSignalSemaphoreInfos[i].value;
-    }
-    for (int i = 0; i < num_cmds; i++)
-        cmds[i] = info2->pCommandBufferInfos[i].commandBuffer;
-
-    const VkTimelineSemaphoreSubmitInfo tinfo = {
-        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
-        .pNext = info2->pNext,
-        .waitSemaphoreValueCount = num_deps,
-        .pWaitSemaphoreValues = depvals,
-        .signalSemaphoreValueCount = num_sigs,
-        .pSignalSemaphoreValues = sigvals,
-    };
+    VkSubmitInfo *infos = pl_calloc_ptr(tmp, num, infos);
+    VkTimelineSemaphoreSubmitInfo *tinfos = pl_calloc_ptr(tmp, num, tinfos);
+
+    for (int n = 0; n < num; n++) {
+        const VkSubmitInfo2 *info2 = &infos2[n];
+        const uint32_t num_deps = info2->waitSemaphoreInfoCount;
+        const uint32_t num_sigs = info2->signalSemaphoreInfoCount;
+        const uint32_t num_cmds = info2->commandBufferInfoCount;
+
+        VkSemaphore *deps           = pl_calloc_ptr(tmp, num_deps, deps);
+        VkPipelineStageFlags *masks = pl_calloc_ptr(tmp, num_deps, masks);
+        uint64_t *depvals           = pl_calloc_ptr(tmp, num_deps, depvals);
+        VkSemaphore *sigs           = pl_calloc_ptr(tmp, num_sigs, sigs);
+        uint64_t *sigvals           = pl_calloc_ptr(tmp, num_sigs, sigvals);
+        VkCommandBuffer *cmds       = pl_calloc_ptr(tmp, num_cmds, cmds);
+
+        for (int i = 0; i < num_deps; i++) {
+            deps[i] = info2->pWaitSemaphoreInfos[i].semaphore;
+            masks[i] = info2->pWaitSemaphoreInfos[i].stageMask;
+            depvals[i] = info2->pWaitSemaphoreInfos[i].value;
+        }
+        for (int i = 0; i < num_sigs; i++) {
+            sigs[i] = info2->pSignalSemaphoreInfos[i].semaphore;
+            sigvals[i] = info2->pSignalSemaphoreInfos[i].value;
+        }
+        for (int i = 0; i < num_cmds; i++)
+            cmds[i] = info2->pCommandBufferInfos[i].commandBuffer;
+
+        tinfos[n] = (VkTimelineSemaphoreSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = info2->pNext,
+            .waitSemaphoreValueCount = num_deps,
+            .pWaitSemaphoreValues = depvals,
+            .signalSemaphoreValueCount = num_sigs,
+            .pSignalSemaphoreValues = sigvals,
+        };
 
-    const VkSubmitInfo info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = &tinfo,
-        .waitSemaphoreCount = num_deps,
-        .pWaitSemaphores = deps,
-        .pWaitDstStageMask = masks,
-        .commandBufferCount = num_cmds,
-        .pCommandBuffers = cmds,
-        .signalSemaphoreCount = num_sigs,
-        .pSignalSemaphores = sigs,
-    };
+        infos[n] = (VkSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &tinfos[n],
+            .waitSemaphoreCount = num_deps,
+            .pWaitSemaphores = deps,
+            .pWaitDstStageMask = masks,
+            .commandBufferCount = num_cmds,
+            .pCommandBuffers = cmds,
+            .signalSemaphoreCount = num_sigs,
+            .pSignalSemaphores = sigs,
+        };
+    }
 
-    VkResult res = vk->QueueSubmit(queue, 1, &info, fence);
+    VkResult res = vk->QueueSubmit(queue, num, infos, fence);
     pl_free(tmp);
     return res;
 }
 
-bool vk_cmd_submit(struct vk_cmd **pcmd)
+bool vk_cmd_queue(struct vk_cmd **pcmd)
 {
     struct vk_cmd *cmd = *pcmd;
     if (!cmd)
@@ -470,42 +482,14 @@ bool vk_cmd_submit(struct vk_cmd **pcmd)
 
     VK(vk->EndCommandBuffer(cmd->buf));
 
-    VkSubmitInfo2 sinfo = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-        .waitSemaphoreInfoCount = cmd->deps.num,
-        .pWaitSemaphoreInfos = cmd->deps.elem,
-        .signalSemaphoreInfoCount = cmd->sigs.num,
-        .pSignalSemaphoreInfos = cmd->sigs.elem,
-        .commandBufferInfoCount = 1,
-        .pCommandBufferInfos = &(VkCommandBufferSubmitInfo) {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
-            .commandBuffer = cmd->buf,
-        },
-    };
-
-    if (pl_msg_test(vk->log, PL_LOG_TRACE)) {
-        PL_TRACE(vk, "Submitting command %p on queue %p (QF %d):",
-                 (void *) cmd->buf, (void *) cmd->queue, pool->qf);
-        for (int n = 0; n < cmd->deps.num; n++) {
-            PL_TRACE(vk, "    waits on semaphore 0x%"PRIx64" = %"PRIu64,
-                     (uint64_t) cmd->deps.elem[n].semaphore, cmd->deps.elem[n].value);
-        }
-        for (int n = 0; n < cmd->sigs.num; n++) {
-            PL_TRACE(vk, "    signals semaphore 0x%"PRIx64" = %"PRIu64,
-                    (uint64_t) cmd->sigs.elem[n].semaphore, cmd->sigs.elem[n].value);
-        }
-        if (cmd->callbacks.num)
-            PL_TRACE(vk, "    signals %d callbacks", cmd->callbacks.num);
-    }
-
-    vk->lock_queue(vk->queue_ctx, pool->qf, cmd->qindex);
-    VkResult res = vk_queue_submit2(vk, cmd->queue, &sinfo, VK_NULL_HANDLE);
-    vk->unlock_queue(vk->queue_ctx, pool->qf, cmd->qindex);
-    PL_VK_ASSERT(res, "vkQueueSubmit2");
-
     pl_mutex_lock(&vk->lock);
-    PL_ARRAY_APPEND(vk->alloc, vk->cmds_pending, cmd);
+    PL_ARRAY_APPEND(vk->alloc, vk->cmds_queued, cmd);
+    bool flush = vk->cmds_queued.num >= MAX_QUEUED_CMDS;
     pl_mutex_unlock(&vk->lock);
+
+    // Avoid starving the GPU if the user never explicitly flushes
+    if (flush)
+        return vk_flush_commands(vk);
     return true;
 
 error:
@@ -517,6 +501,116 @@ error:
     return false;
 }
 
+bool vk_flush_commands(struct vk_ctx *vk)
+{
+    bool ret = true;
+    pl_mutex_lock(&vk->submit_lock);
+
+    // Commands stay in `cmds_queued` until they're actually submitted, so
+    // that `vk_dev_callback` keeps seeing them in the meantime. New commands
+    // may be queued concurrently, but only ever at the end.
+    for (;;) {
+        pl_mutex_lock(&vk->lock);
+        int num = 0;
+        struct vk_cmd **cmds = vk->cmds_queued.elem;
+        while (num < vk->cmds_queued.num && cmds[num]->queue == cmds[0]->queue)
+            num++;
+
+        PL_ARRAY_RESIZE(vk->alloc, vk->submit_cmds, num);
+        PL_ARRAY_RESIZE(vk->alloc, vk->submit_infos, num);
+        PL_ARRAY_RESIZE(vk->alloc, vk->submit_bufs, num);
+        for (int i = 0; i < num; i++) {
+            struct vk_cmd *cmd = vk->submit_cmds.elem[i] = cmds[i];
+            vk->submit_bufs.elem[i] = (VkCommandBufferSubmitInfo) {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                .commandBuffer = cmd->buf,
+            };
+            vk->submit_infos.elem[i] = (VkSubmitInfo2) {
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                .waitSemaphoreInfoCount = cmd->deps.num,
+                .pWaitSemaphoreInfos = cmd->deps.elem,
+                .signalSemaphoreInfoCount = cmd->sigs.num,
+                .pSignalSemaphoreInfos = cmd->sigs.elem,
+                .commandBufferInfoCount = 1,
+                .pCommandBufferInfos = &vk->submit_bufs.elem[i],
+            };
+        }
+        pl_mutex_unlock(&vk->lock);
+        if (!num)
+            break;
+
+        // The submit arrays are only ever touched with `submit_lock` held, so
+        // they remain valid even while other threads queue more commands
+        cmds = vk->submit_cmds.elem;
+        struct vk_cmd *first = cmds[0];
+        struct vk_cmdpool *pool = first->pool;
+        if (pl_msg_test(vk->log, PL_LOG_TRACE)) {
+            PL_TRACE(vk, "Submitting %d command(s) on queue %p (QF %d):",
+                     num, (void *) first->queue, pool->qf);
+            for (int i = 0; i < num; i++) {
+                struct vk_cmd *cmd = cmds[i];
+                PL_TRACE(vk, "  command %p:", (void *) cmd->buf);
+                for (int n = 0; n < cmd->deps.num; n++) {
+                    PL_TRACE(vk, "    waits on semaphore 0x%"PRIx64" = %"PRIu64,
+                             (uint64_t) cmd->deps.elem[n].semaphore, cmd->deps.elem[n].value);
+                }
+                for (int n = 0; n < cmd->sigs.num; n++) {
+                    PL_TRACE(vk, "    signals semaphore 0x%"PRIx64" = %"PRIu64,
+                            (uint64_t) cmd->sigs.elem[n].semaphore, cmd->sigs.elem[n].value);
+                }
+                if (cmd->callbacks.num)
+                    PL_TRACE(vk, "    signals %d callbacks", cmd->callbacks.num);
+            }
+        }
+
+        vk->lock_queue(vk->queue_ctx, pool->qf, first->qindex);
+        VkResult res = vk_queue_submit2(vk, first->queue, num,
+                                        vk->submit_infos.elem, VK_NULL_HANDLE);
+        vk->unlock_queue(vk->queue_ctx, pool->qf, first->qindex);
+        if (res != VK_SUCCESS) {
+            PL_ERR(vk, "vkQueueSubmit2: %s (%s:%d)", vk_res_str(res),
+                   __FILE__, __LINE__);
+        }
+
+        pl_mutex_lock(&vk->lock);
+        for (int i = 0; i < num; i++) {
+            struct vk_cmd *cmd = cmds[i];
+            if (res == VK_SUCCESS) {
+                PL_ARRAY_APPEND(vk->alloc, vk->cmds_pending, cmd);
+            } else {
+                vk_cmd_reset(cmd);
+                PL_ARRAY_APPEND(cmd->pool, cmd->pool->cmds, cmd);
+            }
+        }
+        PL_ARRAY_REMOVE_RANGE(vk->cmds_queued, 0, num);
+        if (res == VK_SUCCESS) {
+            vk->stats.submits++;
+            vk->stats.submitted_cmds += num;
+            vk->frame_submits++;
+            vk->frame_cmds += num;
+        } else {
+            vk->failed = true;
+            ret = false;
+        }
+        pl_mutex_unlock(&vk->lock);
+    }
+
+    pl_mutex_unlock(&vk->submit_lock);
+    return ret;
+}
+
+bool vk_cmd_submit(struct vk_cmd **pcmd)
+{
+    struct vk_cmd *cmd = *pcmd;
+    if (!cmd)
+        return true;
+
+    struct vk_ctx *vk = cmd->pool->vk;
+    if (!vk_cmd_queue(pcmd))
+        return false;
+    return vk_flush_commands(vk);
+}
+
 bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
 {
     bool ret = false;
@@ -555,6 +649,10 @@ void vk_rotate_queues(struct vk_ctx *vk)
 {
     pl_mutex_lock(&vk->lock);
 
+    vk->stats.frame_submits = vk->frame_submits;
+    vk->stats.frame_cmds = vk->frame_cmds;
+    vk->frame_submits = vk->frame_cmds = 0;
+
     // Rotate the queues to ensure good parallelism across frames
     for (int i = 0; i < vk->pools.num; i++) {
         struct vk_cmdpool *pool = vk->pools.elem[i];
@@ -567,5 +665,6 @@ void vk_rotate_queues(struct vk_ctx *vk)
 
 void vk_wait_idle(struct vk_ctx *vk)
 {
+    vk_flush_commands(vk);
     while (vk_poll_commands(vk, UINT64_MAX)) ;
 }
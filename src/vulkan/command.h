@@ -116,8 +116,20 @@ void vk_cmdpool_destroy(struct vk_cmdpool *pool);
 // Returns NULL on failure.
 struct vk_cmd *vk_cmd_begin(struct vk_cmdpool *pool, pl_debug_tag debug_tag);
 
-// Finish recording a command buffer and submit it for execution. This function
-// takes over ownership of **cmd, and sets *cmd to NULL in doing so.
+// Finish recording a command buffer and queue it for submission, without
+// actually submitting it yet. Queued commands are submitted in order by the
+// next call to `vk_flush_commands`, batched into as few `vkQueueSubmit2` calls
+// as possible. This function takes over ownership of **cmd, and sets *cmd to
+// NULL in doing so.
+bool vk_cmd_queue(struct vk_cmd **cmd);
+
+// Submit all queued commands for execution. Consecutive commands targeting the
+// same VkQueue are submitted together.
+bool vk_flush_commands(struct vk_ctx *vk);
+
+// Finish recording a command buffer and submit it for execution, together
+// with any previously queued commands. Equivalent to `vk_cmd_queue` followed
+// by `vk_flush_commands`.
 bool vk_cmd_submit(struct vk_cmd **cmd);
 
 // Block until some commands complete executing. This is the only function that
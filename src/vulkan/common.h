@@ -87,6 +87,14 @@ struct vk_ctx {
     // Pending commands. These are shared for the entire mpvk_ctx to ensure
     // submission and callbacks are FIFO
     PL_ARRAY(struct vk_cmd *) cmds_pending; // submitted but not completed
+    PL_ARRAY(struct vk_cmd *) cmds_queued;  // recorded but not yet submitted
+
+    // Serializes `vk_flush_commands`, and guards the scratch arrays it uses
+    // to build each batch of submissions
+    pl_mutex submit_lock;
+    PL_ARRAY(struct vk_cmd *) submit_cmds;
+    PL_ARRAY(VkSubmitInfo2) submit_infos;
+    PL_ARRAY(VkCommandBufferSubmitInfo) submit_bufs;
 
     // Pending callbacks that still need to be drained before processing
     // callbacks for the next command (in case commands are recursively being
@@ -94,6 +102,10 @@ struct vk_ctx {
     const struct vk_callback *pending_callbacks;
     int num_pending_callbacks;
 
+    // Statistics, guarded by `lock`
+    struct pl_vulkan_stats stats;
+    int frame_submits, frame_cmds; // current frame, see `vk_rotate_queues`
+
     // Instance-level function pointers
     PL_VK_FUN(CreateDevice);
     PL_VK_FUN(EnumerateDeviceExtensionProperties);
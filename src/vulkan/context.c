@@ -241,6 +241,7 @@ static const VkPhysicalDeviceVulkan12Features recommended_vk12 = {
     .storagePushConstant8 = true,
     .shaderInt8 = true,
     .shaderFloat16 = true,
+    .shaderSampledImageArrayNonUniformIndexing = true,
     .shaderSharedInt64Atomics = true,
     .storageBuffer8BitAccess = true,
     .uniformAndStorageBuffer8BitAccess = true,
@@ -915,6 +916,7 @@ void pl_vulkan_destroy(pl_vulkan *pl_vk)
             PL_DEBUG(vk, "Waiting for remaining commands...");
             pl_gpu_finish((*pl_vk)->gpu);
             pl_assert(vk->cmds_pending.num == 0);
+            pl_assert(vk->cmds_queued.num == 0);
 
             pl_gpu_destroy((*pl_vk)->gpu);
         }
@@ -933,9 +935,20 @@ void pl_vulkan_destroy(pl_vulkan *pl_vk)
 
     pl_vk_inst_destroy(&vk->internal_instance);
     pl_mutex_destroy(&vk->lock);
+    pl_mutex_destroy(&vk->submit_lock);
     pl_free_ptr((void **) pl_vk);
 }
 
+struct pl_vulkan_stats pl_vulkan_get_stats(pl_vulkan pl_vk)
+{
+    struct vk_ctx *vk = PL_PRIV(pl_vk);
+    pl_mutex_lock(&vk->lock);
+    struct pl_vulkan_stats stats = vk->stats;
+    pl_mutex_unlock(&vk->lock);
+    vk_malloc_get_stats(vk->ma, &stats);
+    return stats;
+}
+
 static bool supports_surf(pl_log log, VkInstance inst,
                           PFN_vkGetInstanceProcAddr get_addr,
                           VkPhysicalDevice physd, VkSurfaceKHR surf)
@@ -1438,6 +1451,7 @@ pl_vulkan pl_vulkan_create(pl_log log, const struct pl_vulkan_params *params)
     };
 
     pl_mutex_init_type(&vk->lock, PL_MUTEX_RECURSIVE);
+    pl_mutex_init(&vk->submit_lock);
     if (!vk->GetInstanceProcAddr)
         goto error;
 
@@ -1553,6 +1567,7 @@ pl_vulkan pl_vulkan_import(pl_log log, const struct pl_vulkan_import_params *par
     };
 
     pl_mutex_init_type(&vk->lock, PL_MUTEX_RECURSIVE);
+    pl_mutex_init(&vk->submit_lock);
     if (!vk->GetInstanceProcAddr)
         goto error;
 
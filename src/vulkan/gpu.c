@@ -162,7 +162,7 @@ struct vk_cmd *_begin_cmd(pl_gpu gpu, enum queue_type type, const char *label,
     }
 
     if (!p->cmd || p->cmd->pool != pool) {
-        vk_cmd_submit(&p->cmd);
+        vk_cmd_queue(&p->cmd);
         p->cmd = vk_cmd_begin(pool, label);
         if (!p->cmd) {
             pl_mutex_unlock(&p->recording);
@@ -188,15 +188,17 @@ static void timer_end_cb(void *ptimer, void *pindex)
     timer->pending &= ~timer_bit(index);
 }
 
-bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, bool submit)
+bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, enum cmd_end end)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
     bool ret = true;
     if (!pcmd) {
-        if (submit) {
+        if (end != CMD_END_FINISH) {
             pl_mutex_lock(&p->recording);
-            ret = vk_cmd_submit(&p->cmd);
+            ret = vk_cmd_queue(&p->cmd);
+            if (end == CMD_END_SUBMIT)
+                ret &= vk_flush_commands(vk);
             pl_mutex_unlock(&p->recording);
         }
         return ret;
@@ -226,8 +228,14 @@ bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, bool submit)
     if (vk->CmdEndDebugUtilsLabelEXT && supports_marks(cmd))
         vk->CmdEndDebugUtilsLabelEXT(cmd->buf);
 
-    if (submit)
-        ret = vk_cmd_submit(&p->cmd);
+    switch (end) {
+    case CMD_END_FINISH: break;
+    case CMD_END_QUEUE:  ret = vk_cmd_queue(&p->cmd); break;
+    case CMD_END_SUBMIT:
+        ret = vk_cmd_queue(&p->cmd);
+        ret &= vk_flush_commands(vk);
+        break;
+    }
 
     pl_mutex_unlock(&p->recording);
     return ret;
@@ -504,6 +512,11 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
         gpu->glsl.max_gather_offset = limits.maxTexelGatherOffset;
     }
 
+    const VkPhysicalDeviceVulkan12Features *vk12;
+    vk12 = vk_find_struct(&vk->features, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+    if (vk12 && vk12->shaderSampledImageArrayNonUniformIndexing)
+        gpu->glsl.nonuniform_indexing = true;
+
     const size_t max_size = vk_malloc_avail(vk->ma, 0);
     gpu->limits = (struct pl_gpu_limits) {
         // pl_gpu
@@ -536,6 +549,7 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
 #else
         .align_vertex_stride = 1,
 #endif
+        .max_tex_array      = limits.maxPerStageDescriptorSampledImages,
         .max_dispatch = {
             limits.maxComputeWorkGroupCount[0],
             limits.maxComputeWorkGroupCount[1],
@@ -909,6 +923,7 @@ static const struct pl_gpu_fns pl_fns_vk = {
     .buf_copy               = vk_buf_copy,
     .buf_export             = vk_buf_export,
     .buf_poll               = vk_buf_poll,
+    .buf_busy               = vk_buf_busy,
     .desc_namespace         = vk_desc_namespace,
     .pass_create            = vk_pass_create,
     .pass_destroy           = vk_pass_destroy,
@@ -60,6 +60,9 @@ struct pl_vk {
     uint32_t max_push_descriptors;
     size_t min_texel_alignment;
 
+    // Source of unique IDs for textures and buffers, see `vk_object_id`
+    _Atomic uint64_t object_ids;
+
     // The "currently recording" command. This will be queued and replaced by
     // a new command every time we need to "switch" between queue families.
     pl_mutex recording;
@@ -73,13 +76,29 @@ struct pl_vk {
     bool warned_modless;
 };
 
+// Returns a new nonzero ID, never re-used for the lifetime of the pl_gpu. Used
+// to tell apart objects that may otherwise share the same Vulkan handle values
+static inline uint64_t vk_object_id(pl_gpu gpu)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    return atomic_fetch_add_explicit(&p->object_ids, 1, memory_order_relaxed) + 1;
+}
+
 struct vk_cmd *_begin_cmd(pl_gpu, enum queue_type, const char *label, pl_timer);
-bool _end_cmd(pl_gpu, struct vk_cmd **, bool submit);
+
+enum cmd_end {
+    CMD_END_FINISH, // keep recording into the same command
+    CMD_END_QUEUE,  // end the command, but defer submission (see `vk_cmd_queue`)
+    CMD_END_SUBMIT, // end the command and submit all queued commands
+};
+
+bool _end_cmd(pl_gpu, struct vk_cmd **, enum cmd_end);
 
 #define CMD_BEGIN(type)              _begin_cmd(gpu, type, __func__, NULL)
 #define CMD_BEGIN_TIMED(type, timer) _begin_cmd(gpu, type, __func__, timer)
-#define CMD_FINISH(cmd) _end_cmd(gpu, cmd, false)
-#define CMD_SUBMIT(cmd) _end_cmd(gpu, cmd, true)
+#define CMD_FINISH(cmd) _end_cmd(gpu, cmd, CMD_END_FINISH)
+#define CMD_QUEUE(cmd)  _end_cmd(gpu, cmd, CMD_END_QUEUE)
+#define CMD_SUBMIT(cmd) _end_cmd(gpu, cmd, CMD_END_SUBMIT)
 
 // Helper to fire a callback the next time the `pl_gpu` is in an idle state
 //
@@ -90,6 +109,7 @@ void vk_gpu_idle_callback(pl_gpu, vk_cb, const void *priv, const void *arg);
 
 struct pl_tex_vk {
     pl_rc_t rc;
+    uint64_t id; // unique for the lifetime of the pl_gpu
     bool external_img;
     enum queue_type transfer_queue;
     VkImageType type;
@@ -133,6 +153,7 @@ void vk_tex_barrier(pl_gpu, struct vk_cmd *, pl_tex, VkPipelineStageFlags2,
 
 struct pl_buf_vk {
     pl_rc_t rc;
+    uint64_t id; // unique for the lifetime of the pl_gpu
     struct vk_memslice mem;
     enum queue_type update_queue;
     VkBufferView view; // for texel buffers
@@ -151,6 +172,7 @@ void vk_buf_copy(pl_gpu, pl_buf dst, size_t dst_offset,
                  pl_buf src, size_t src_offset, size_t size);
 bool vk_buf_export(pl_gpu, pl_buf);
 bool vk_buf_poll(pl_gpu, pl_buf, uint64_t timeout);
+bool vk_buf_busy(pl_gpu, pl_buf);
 
 // Helper to ease buffer barrier creation. (`offset` is relative to pl_buf)
 void vk_buf_barrier(pl_gpu, struct vk_cmd *, pl_buf, VkPipelineStageFlags2,
@@ -103,6 +103,7 @@ pl_buf vk_buf_create(pl_gpu gpu, const struct pl_buf_params *params)
 
     struct pl_buf_vk *buf_vk = PL_PRIV(buf);
     pl_rc_init(&buf_vk->rc);
+    buf_vk->id = vk_object_id(gpu);
 
     struct vk_malloc_params mparams = {
         .reqs = {
@@ -329,6 +330,16 @@ bool vk_buf_poll(pl_gpu gpu, pl_buf buf, uint64_t timeout)
     return pl_rc_count(&buf_vk->rc) > 1;
 }
 
+bool vk_buf_busy(pl_gpu gpu, pl_buf buf)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct pl_buf_vk *buf_vk = PL_PRIV(buf);
+
+    // Unlike `vk_buf_poll`, don't force queued commands to be submitted
+    vk_poll_commands(p->vk, 0);
+    return pl_rc_count(&buf_vk->rc) > 1;
+}
+
 void vk_buf_write(pl_gpu gpu, pl_buf buf, size_t offset,
                   const void *data, size_t size)
 {
@@ -19,6 +19,28 @@
 #include "cache.h"
 #include "glsl/spirv.h"
 
+// Last contents written to a descriptor set binding. Since descriptor sets
+// retain their contents between uses, re-writing a binding can be skipped if
+// it still refers to the same object in the same state.
+struct vk_ds_entry {
+    uint64_t id; // of the bound pl_tex/pl_buf, or 0 if never written
+    VkDescriptorImageInfo img;
+    VkDescriptorBufferInfo buf;
+    VkBufferView view;
+};
+
+static bool ds_entry_equal(const struct vk_ds_entry *a, const struct vk_ds_entry *b)
+{
+    return a->id && a->id == b->id &&
+           a->img.sampler == b->img.sampler &&
+           a->img.imageView == b->img.imageView &&
+           a->img.imageLayout == b->img.imageLayout &&
+           a->buf.buffer == b->buf.buffer &&
+           a->buf.offset == b->buf.offset &&
+           a->buf.range == b->buf.range &&
+           a->view == b->view;
+}
+
 // For pl_pass.priv
 struct pl_pass_vk {
     // Pipeline / render pass
@@ -29,11 +51,15 @@ struct pl_pass_vk {
     // Descriptor set (bindings)
     bool use_pushd;
     VkDescriptorSetLayout dsLayout;
-    VkDescriptorPool dsPool;
-    // To keep track of which descriptor sets are and aren't available, we
-    // allocate a fixed number and use a bitmask of all available sets.
-    VkDescriptorSet dss[16];
-    uint16_t dmask;
+    // Descriptor sets are allocated from a growing list of pools, each one
+    // as large as all previous pools combined, and recycled once the command
+    // using them completes. `dsfree` holds the indices (into `dss`) of all
+    // currently available sets, and is guarded by `vk->lock`.
+    PL_ARRAY(VkDescriptorPoolSize) dsPoolSizes; // per descriptor set
+    PL_ARRAY(VkDescriptorPool) dsPools;
+    PL_ARRAY(VkDescriptorSet) dss;
+    PL_ARRAY(struct vk_ds_entry *) dscache; // contents of each set in `dss`
+    PL_ARRAY(int) dsfree;
 
     // For recompilation
     VkVertexInputAttributeDescription *attrs;
@@ -44,6 +70,7 @@ struct pl_pass_vk {
     // For updating
     VkWriteDescriptorSet *dswrite;
     VkDescriptorImageInfo *dsiinfo;
+    int *dsioffset; // first `dsiinfo` entry of each descriptor
     VkDescriptorBufferInfo *dsbinfo;
     VkSpecializationInfo specInfo;
     size_t spec_size;
@@ -65,11 +92,16 @@ static void pass_destroy_cb(pl_gpu gpu, pl_pass pass)
     vk->DestroyRenderPass(vk->dev, pass_vk->renderPass, PL_VK_ALLOC);
     vk->DestroyPipelineLayout(vk->dev, pass_vk->pipeLayout, PL_VK_ALLOC);
     vk->DestroyPipelineCache(vk->dev, pass_vk->cache, PL_VK_ALLOC);
-    vk->DestroyDescriptorPool(vk->dev, pass_vk->dsPool, PL_VK_ALLOC);
+    for (int i = 0; i < pass_vk->dsPools.num; i++)
+        vk->DestroyDescriptorPool(vk->dev, pass_vk->dsPools.elem[i], PL_VK_ALLOC);
     vk->DestroyDescriptorSetLayout(vk->dev, pass_vk->dsLayout, PL_VK_ALLOC);
     vk->DestroyShaderModule(vk->dev, pass_vk->vert, PL_VK_ALLOC);
     vk->DestroyShaderModule(vk->dev, pass_vk->shader, PL_VK_ALLOC);
 
+    pl_mutex_lock(&vk->lock);
+    vk->stats.descriptor_sets -= pass_vk->dss.num;
+    pl_mutex_unlock(&vk->lock);
+
     pl_free((void *) pass);
 }
 
@@ -125,6 +157,79 @@ static void destroy_pipeline(struct vk_ctx *vk, void *pipeline)
     vk->DestroyPipeline(vk->dev, vk_unwrap_handle(pipeline), PL_VK_ALLOC);
 }
 
+// Number of descriptor sets to allocate when creating a pass
+#define NUM_DS_INITIAL 16
+
+// Allocates a new descriptor pool with room for `num` additional descriptor
+// sets, and adds all of them to the list of free sets. Must be called with
+// `vk->lock` held, unless the pass is still being created.
+static bool grow_ds(pl_gpu gpu, pl_pass pass, int num)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    void *tmp = pl_tmp(NULL);
+
+    VkDescriptorPoolSize *sizes = pl_calloc_ptr(tmp, pass_vk->dsPoolSizes.num, sizes);
+    for (int i = 0; i < pass_vk->dsPoolSizes.num; i++) {
+        sizes[i] = pass_vk->dsPoolSizes.elem[i];
+        sizes[i].descriptorCount *= num;
+    }
+
+    VkDescriptorPoolCreateInfo pinfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = num,
+        .pPoolSizes = sizes,
+        .poolSizeCount = pass_vk->dsPoolSizes.num,
+    };
+
+    VK(vk->CreateDescriptorPool(vk->dev, &pinfo, PL_VK_ALLOC, &pool));
+
+    VkDescriptorSetLayout *layouts = pl_calloc_ptr(tmp, num, layouts);
+    for (int i = 0; i < num; i++)
+        layouts[i] = pass_vk->dsLayout;
+
+    VkDescriptorSetAllocateInfo ainfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pool,
+        .descriptorSetCount = num,
+        .pSetLayouts = layouts,
+    };
+
+    int base = pass_vk->dss.num;
+    PL_ARRAY_RESIZE((void *) pass, pass_vk->dss, base + num);
+    VK(vk->AllocateDescriptorSets(vk->dev, &ainfo, &pass_vk->dss.elem[base]));
+    pass_vk->dss.num = base + num;
+    PL_ARRAY_APPEND((void *) pass, pass_vk->dsPools, pool);
+
+    PL_ARRAY_RESIZE((void *) pass, pass_vk->dscache, pass_vk->dss.num);
+    for (int i = 0; i < num; i++) {
+        struct vk_ds_entry *cache;
+        cache = pl_calloc_ptr((void *) pass, pass->params.num_descriptors, cache);
+        pass_vk->dscache.elem[pass_vk->dscache.num++] = cache;
+    }
+
+    // Reserve room for all sets, so `release_ds` never needs to reallocate
+    PL_ARRAY_RESIZE((void *) pass, pass_vk->dsfree, pass_vk->dss.num);
+    for (int i = base + num - 1; i >= base; i--)
+        pass_vk->dsfree.elem[pass_vk->dsfree.num++] = i;
+
+    pl_mutex_lock(&vk->lock);
+    if (base)
+        vk->stats.descriptor_pool_grows++;
+    vk->stats.descriptor_sets += num;
+    pl_mutex_unlock(&vk->lock);
+
+    pl_free(tmp);
+    return true;
+
+error:
+    vk->DestroyDescriptorPool(vk->dev, pool, PL_VK_ALLOC);
+    pl_free(tmp);
+    return false;
+}
+
 static VkResult vk_recreate_pipelines(struct vk_ctx *vk, pl_pass pass,
                                       bool derivable, VkPipeline base,
                                       VkPipeline *out_pipe)
@@ -292,7 +397,6 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     pass->params = pl_pass_params_copy(pass, params);
 
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
-    pass_vk->dmask = -1; // all descriptors available
 
     // temporary allocations
     void *tmp = pl_tmp(NULL);
@@ -300,19 +404,26 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     int num_desc = params->num_descriptors;
     if (!num_desc)
         goto no_descriptors;
-    if (num_desc > vk->props.limits.maxPerStageResources) {
+
+    // Arrays of textures count as one resource per element
+    int num_elems = 0;
+    pass_vk->dsioffset = pl_calloc_ptr(pass, num_desc, pass_vk->dsioffset);
+    for (int i = 0; i < num_desc; i++) {
+        pass_vk->dsioffset[i] = num_elems;
+        num_elems += pl_desc_elems(&params->descriptors[i]);
+    }
+
+    if (num_elems > vk->props.limits.maxPerStageResources) {
         PL_ERR(gpu, "Pass with %d descriptors exceeds the maximum number of "
                "per-stage resources %" PRIu32"!",
-               num_desc, vk->props.limits.maxPerStageResources);
+               num_elems, vk->props.limits.maxPerStageResources);
         goto error;
     }
 
     pass_vk->dswrite = pl_calloc(pass, num_desc, sizeof(VkWriteDescriptorSet));
-    pass_vk->dsiinfo = pl_calloc(pass, num_desc, sizeof(VkDescriptorImageInfo));
+    pass_vk->dsiinfo = pl_calloc(pass, num_elems, sizeof(VkDescriptorImageInfo));
     pass_vk->dsbinfo = pl_calloc(pass, num_desc, sizeof(VkDescriptorBufferInfo));
 
-#define NUM_DS (PL_ARRAY_SIZE(pass_vk->dss))
-
     int dsSize[PL_DESC_TYPE_COUNT] = {0};
     VkDescriptorSetLayoutBinding *bindings = pl_calloc_ptr(tmp, num_desc, bindings);
 
@@ -332,17 +443,19 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
 
     for (int i = 0; i < num_desc; i++) {
         struct pl_desc *desc = &params->descriptors[i];
-        if (!(*dsLimits[desc->type])--) {
+        const uint32_t elems = pl_desc_elems(desc);
+        if (*dsLimits[desc->type] < elems) {
             PL_ERR(gpu, "Pass exceeds the maximum number of per-stage "
                    "descriptors of type %u!", (unsigned) desc->type);
             goto error;
         }
 
-        dsSize[desc->type]++;
+        *dsLimits[desc->type] -= elems;
+        dsSize[desc->type] += elems;
         bindings[i] = (VkDescriptorSetLayoutBinding) {
             .binding = desc->binding,
             .descriptorType = dsType[desc->type],
-            .descriptorCount = 1,
+            .descriptorCount = elems,
             .stageFlags = stageFlags[params->type],
         };
     }
@@ -353,53 +466,30 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
         .bindingCount = num_desc,
     };
 
-    if (p->max_push_descriptors && num_desc <= p->max_push_descriptors) {
+    if (p->max_push_descriptors && num_elems <= p->max_push_descriptors) {
         dinfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
         pass_vk->use_pushd = true;
     } else if (p->max_push_descriptors) {
         PL_INFO(gpu, "Pass with %d descriptors exceeds the maximum push "
                 "descriptor count (%d). Falling back to descriptor sets!",
-                num_desc, p->max_push_descriptors);
+                num_elems, p->max_push_descriptors);
     }
 
     VK(vk->CreateDescriptorSetLayout(vk->dev, &dinfo, PL_VK_ALLOC,
                                      &pass_vk->dsLayout));
 
     if (!pass_vk->use_pushd) {
-        PL_ARRAY(VkDescriptorPoolSize) dsPoolSizes = {0};
-
         for (enum pl_desc_type t = 0; t < PL_DESC_TYPE_COUNT; t++) {
             if (dsSize[t] > 0) {
-                PL_ARRAY_APPEND(tmp, dsPoolSizes, (VkDescriptorPoolSize) {
+                PL_ARRAY_APPEND(pass, pass_vk->dsPoolSizes, (VkDescriptorPoolSize) {
                     .type = dsType[t],
-                    .descriptorCount = dsSize[t] * NUM_DS,
+                    .descriptorCount = dsSize[t],
                 });
             }
         }
 
-        if (dsPoolSizes.num) {
-            VkDescriptorPoolCreateInfo pinfo = {
-                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                .maxSets = NUM_DS,
-                .pPoolSizes = dsPoolSizes.elem,
-                .poolSizeCount = dsPoolSizes.num,
-            };
-
-            VK(vk->CreateDescriptorPool(vk->dev, &pinfo, PL_VK_ALLOC, &pass_vk->dsPool));
-
-            VkDescriptorSetLayout layouts[NUM_DS];
-            for (int i = 0; i < NUM_DS; i++)
-                layouts[i] = pass_vk->dsLayout;
-
-            VkDescriptorSetAllocateInfo ainfo = {
-                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                .descriptorPool = pass_vk->dsPool,
-                .descriptorSetCount = NUM_DS,
-                .pSetLayouts = layouts,
-            };
-
-            VK(vk->AllocateDescriptorSets(vk->dev, &ainfo, pass_vk->dss));
-        }
+        if (pass_vk->dsPoolSizes.num && !grow_ds(gpu, pass, NUM_DS_INITIAL))
+            goto error;
     }
 
 no_descriptors: ;
@@ -615,7 +705,8 @@ static const VkPipelineStageFlags2 shaderStages[] = {
 
 static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
                                  struct pl_desc_binding db,
-                                 VkDescriptorSet ds, int idx)
+                                 VkDescriptorSet ds, int idx,
+                                 struct vk_ds_entry *entry)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
@@ -639,22 +730,34 @@ static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
 
     switch (desc->type) {
     case PL_DESC_SAMPLED_TEX: {
-        pl_tex tex = db.object;
-        struct pl_tex_vk *tex_vk = PL_PRIV(tex);
-
-        vk_tex_barrier(gpu, cmd, tex, shaderStages[pass->params.type],
-                       VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
-                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                       VK_QUEUE_FAMILY_IGNORED);
+        VkDescriptorImageInfo *iinfo = &pass_vk->dsiinfo[pass_vk->dsioffset[idx]];
+        for (int i = 0; i < pl_desc_elems(desc); i++) {
+            pl_tex tex = pl_desc_tex(desc, &db, i);
+            struct pl_tex_vk *tex_vk = PL_PRIV(tex);
+
+            vk_tex_barrier(gpu, cmd, tex, shaderStages[pass->params.type],
+                           VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                           VK_QUEUE_FAMILY_IGNORED);
+
+            iinfo[i] = (VkDescriptorImageInfo) {
+                .sampler = p->samplers[db.sample_mode][db.address_mode],
+                .imageView = tex_vk->view,
+                .imageLayout = tex_vk->layout,
+            };
 
-        VkDescriptorImageInfo *iinfo = &pass_vk->dsiinfo[idx];
-        *iinfo = (VkDescriptorImageInfo) {
-            .sampler = p->samplers[db.sample_mode][db.address_mode],
-            .imageView = tex_vk->view,
-            .imageLayout = tex_vk->layout,
-        };
+            // For arrays, the cache entry tracks the hash of all elements
+            if (i == 0) {
+                entry->id = tex_vk->id;
+                entry->img = iinfo[i];
+            } else {
+                pl_hash_merge(&entry->id, tex_vk->id);
+                pl_hash_merge(&entry->id, tex_vk->layout);
+            }
+        }
 
         wds->pImageInfo = iinfo;
+        wds->descriptorCount = pl_desc_elems(desc);
         return;
     }
     case PL_DESC_STORAGE_IMG: {
@@ -665,13 +768,15 @@ static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
                        storageAccess[desc->access], VK_IMAGE_LAYOUT_GENERAL,
                        VK_QUEUE_FAMILY_IGNORED);
 
-        VkDescriptorImageInfo *iinfo = &pass_vk->dsiinfo[idx];
+        VkDescriptorImageInfo *iinfo = &pass_vk->dsiinfo[pass_vk->dsioffset[idx]];
         *iinfo = (VkDescriptorImageInfo) {
             .imageView = tex_vk->view,
             .imageLayout = tex_vk->layout,
         };
 
         wds->pImageInfo = iinfo;
+        entry->id = tex_vk->id;
+        entry->img = *iinfo;
         return;
     }
     case PL_DESC_BUF_UNIFORM:
@@ -694,6 +799,8 @@ static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
         };
 
         wds->pBufferInfo = binfo;
+        entry->id = buf_vk->id;
+        entry->buf = *binfo;
         return;
     }
     case PL_DESC_BUF_TEXEL_UNIFORM:
@@ -709,6 +816,8 @@ static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
                        access, 0, buf->params.size, false);
 
         wds->pTexelBufferView = &buf_vk->view;
+        entry->id = buf_vk->id;
+        entry->view = buf_vk->view;
         return;
     }
     case PL_DESC_INVALID:
@@ -745,9 +854,10 @@ static void vk_release_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
     pl_unreachable();
 }
 
-static void set_ds(struct pl_pass_vk *pass_vk, void *dsbit)
+static void release_ds(pl_pass pass, void *idx)
 {
-    pass_vk->dmask |= (uintptr_t) dsbit;
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+    PL_ARRAY_APPEND((void *) pass, pass_vk->dsfree, (intptr_t) idx);
 }
 
 static bool need_respec(pl_pass pass, const struct pl_pass_run_params *params)
@@ -791,12 +901,25 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
         pl_log_cpu_time(gpu->log, start, pl_clock_now(), "re-specializing shader");
     }
 
-    if (!pass_vk->use_pushd) {
-        // Wait for a free descriptor set
-        while (!pass_vk->dmask) {
-            PL_TRACE(gpu, "No free descriptor sets! ...blocking (slow path)");
-            vk_poll_commands(vk, 10000000); // 10 ms
+    // Find a free descriptor set to use, growing the pool if all of them
+    // are still in use by pending commands
+    int ds_idx = -1;
+    VkDescriptorSet ds = VK_NULL_HANDLE;
+    struct vk_ds_entry *dscache = NULL;
+    if (pass_vk->dsPoolSizes.num) {
+        pl_mutex_lock(&vk->lock);
+        if (!pass_vk->dsfree.num) {
+            PL_DEBUG(gpu, "No free descriptor sets! Growing pool from %d to "
+                     "%d sets", pass_vk->dss.num, 2 * pass_vk->dss.num);
+            if (!grow_ds(gpu, pass, pass_vk->dss.num)) {
+                pl_mutex_unlock(&vk->lock);
+                goto error;
+            }
         }
+        PL_ARRAY_POP(pass_vk->dsfree, &ds_idx);
+        ds = pass_vk->dss.elem[ds_idx];
+        dscache = pass_vk->dscache.elem[ds_idx];
+        pl_mutex_unlock(&vk->lock);
     }
 
     static const enum queue_type types[] = {
@@ -805,31 +928,41 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     };
 
     struct vk_cmd *cmd = CMD_BEGIN_TIMED(types[pass->params.type], params->timer);
-    if (!cmd)
+    if (!cmd) {
+        if (ds) {
+            pl_mutex_lock(&vk->lock);
+            release_ds(pass, (void *)(intptr_t) ds_idx);
+            pl_mutex_unlock(&vk->lock);
+        }
         goto error;
+    }
 
-    // Find a descriptor set to use
-    VkDescriptorSet ds = VK_NULL_HANDLE;
-    if (!pass_vk->use_pushd) {
-        for (int i = 0; i < PL_ARRAY_SIZE(pass_vk->dss); i++) {
-            uint16_t dsbit = 1u << i;
-            if (pass_vk->dmask & dsbit) {
-                ds = pass_vk->dss[i];
-                pass_vk->dmask &= ~dsbit; // unset
-                vk_cmd_callback(cmd, (vk_cb) set_ds, pass_vk,
-                                (void *)(uintptr_t) dsbit);
-                break;
-            }
+    if (ds)
+        vk_cmd_callback(cmd, (vk_cb) release_ds, pass, (void *)(intptr_t) ds_idx);
+
+    // Update the dswrite structure with all of the new values. When using
+    // descriptor sets, only the bindings that actually changed since this set
+    // was last used need to be written, so compact `dswrite` down to those
+    int num_writes = 0;
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        struct vk_ds_entry entry = {0};
+        vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], ds, i, &entry);
+        if (dscache) {
+            if (ds_entry_equal(&dscache[i], &entry))
+                continue;
+            dscache[i] = entry;
         }
+        pass_vk->dswrite[num_writes++] = pass_vk->dswrite[i];
     }
 
-    // Update the dswrite structure with all of the new values
-    for (int i = 0; i < pass->params.num_descriptors; i++)
-        vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], ds, i);
+    if (ds) {
+        if (num_writes)
+            vk->UpdateDescriptorSets(vk->dev, num_writes, pass_vk->dswrite, 0, NULL);
 
-    if (!pass_vk->use_pushd) {
-        vk->UpdateDescriptorSets(vk->dev, pass->params.num_descriptors,
-                                 pass_vk->dswrite, 0, NULL);
+        pl_mutex_lock(&vk->lock);
+        vk->stats.descriptor_writes += num_writes;
+        vk->stats.descriptor_writes_skipped += pass->params.num_descriptors - num_writes;
+        pl_mutex_unlock(&vk->lock);
     }
 
     // Bind the pipeline, descriptor set, etc.
@@ -956,8 +1089,9 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     for (int i = 0; i < pass->params.num_descriptors; i++)
         vk_release_descriptor(gpu, cmd, pass, params->desc_bindings[i], i);
 
-    // submit this command buffer for better intra-frame granularity
-    CMD_SUBMIT(&cmd);
+    // end this command buffer for better intra-frame granularity, but leave
+    // the actual submission to be batched with subsequent commands
+    CMD_QUEUE(&cmd);
 
 error:
     return;
@@ -130,6 +130,7 @@ static bool vk_init_image(pl_gpu gpu, pl_tex tex, pl_debug_tag debug_tag)
     pl_assert(tex_vk->img);
     PL_VK_NAME(IMAGE, tex_vk->img, debug_tag);
     pl_rc_init(&tex_vk->rc);
+    tex_vk->id = vk_object_id(gpu);
     if (tex_vk->num_planes)
         return true;
     tex_vk->layout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -51,6 +51,22 @@
 // this many invocations of `vk_malloc_garbage_collect` will be released.
 #define MAXIMUM_SLAB_AGE 32
 
+// Small allocations are served by a buddy allocator, which splits slabs of
+// size BUDDY_SLAB_SIZE into power-of-two sized blocks of at least
+// BUDDY_BLOCK_MIN bytes. Allocations which would need blocks larger than
+// BUDDY_BLOCK_MAX are served by regular pages instead. (Default: 256 B - 16 KB)
+#define BUDDY_BLOCK_MIN (1LLU << 8)
+#define BUDDY_BLOCK_MAX (1LLU << 14)
+#define BUDDY_SLAB_SIZE MINIMUM_SLAB_SIZE
+#define BUDDY_LEVELS 11 // log2(BUDDY_SLAB_SIZE / BUDDY_BLOCK_MIN) + 1
+#define BUDDY_MAP_WORDS ((1 << BUDDY_LEVELS) / 64)
+
+// Slabs with less than 1/SPARSE_SLAB_RATIO of their size in use are drained,
+// i.e. new allocations are steered away from them, as long as the rest of the
+// pool has enough free space to absorb their contents. Drained slabs are
+// released as soon as they become empty, rather than after MAXIMUM_SLAB_AGE.
+#define SPARSE_SLAB_RATIO 4
+
 // A single slab represents a contiguous region of allocated memory. Actual
 // allocations are served as pages of this. Slabs are organized into pools,
 // each of which contains a list of slabs of differing page sizes.
@@ -68,6 +84,12 @@ struct vk_slab {
     size_t pagesize;        // size in bytes per page
     size_t used;            // number of bytes actually in use
     uint64_t age;           // timestamp of last use
+    bool draining;          // slab is sparse, avoid allocating from it
+
+    // buddy allocator state (only for slabs serving small allocations)
+    uint64_t *buddymap;     // bitset of free blocks, for each level
+    uint8_t *buddylevel;    // level of the allocation at each minimum block
+    int buddyfree[BUDDY_LEVELS]; // number of free blocks per level
 
     // optional, depends on the memory type:
     VkBuffer buffer;        // buffer spanning the entire slab
@@ -99,8 +121,120 @@ struct vk_malloc {
     size_t maximum_page_size;
     PL_ARRAY(struct vk_pool) pools;
     uint64_t age;
+
+    // defragmentation statistics
+    int num_draining;
+    uint64_t reclaimed;
 };
 
+// Index of the first bit belonging to a given buddy level. Level 0 holds the
+// smallest blocks, while the single block on the top level spans the slab.
+static inline int buddy_base(int level)
+{
+    return (1 << BUDDY_LEVELS) - (1 << (BUDDY_LEVELS - level));
+}
+
+static inline int buddy_count(int level)
+{
+    return 1 << (BUDDY_LEVELS - 1 - level);
+}
+
+static inline int buddy_level(size_t size)
+{
+    int level = 0;
+    while ((BUDDY_BLOCK_MIN << level) < size)
+        level++;
+    return level;
+}
+
+static inline bool buddy_test(const struct vk_slab *slab, int level, int idx)
+{
+    int bit = buddy_base(level) + idx;
+    return (slab->buddymap[bit / 64] >> (bit % 64)) & 1;
+}
+
+static inline void buddy_set(struct vk_slab *slab, int level, int idx, bool free)
+{
+    int bit = buddy_base(level) + idx;
+    uint64_t mask = 1LLU << (bit % 64);
+    if (free) {
+        slab->buddymap[bit / 64] |= mask;
+        slab->buddyfree[level]++;
+    } else {
+        slab->buddymap[bit / 64] &= ~mask;
+        slab->buddyfree[level]--;
+    }
+}
+
+// Returns the index of any free block on the given level, or -1 if none
+static int buddy_find(const struct vk_slab *slab, int level)
+{
+    if (!slab->buddyfree[level])
+        return -1;
+
+    const int start = buddy_base(level), end = start + buddy_count(level);
+    for (int pos = start; pos < end;) {
+        int num = PL_MIN(64 - pos % 64, end - pos);
+        uint64_t word = slab->buddymap[pos / 64] >> (pos % 64);
+        if (num < 64)
+            word &= (1LLU << num) - 1;
+        if (word)
+            return pos - start + __builtin_ctzll(word);
+        pos += num;
+    }
+
+    pl_unreachable();
+}
+
+// Allocates a block on the given level, splitting larger blocks as needed
+static bool buddy_alloc(struct vk_slab *slab, int level, VkDeviceSize *offset)
+{
+    int cur = level, idx = -1;
+    while (cur < BUDDY_LEVELS && (idx = buddy_find(slab, cur)) < 0)
+        cur++;
+    if (idx < 0)
+        return false;
+
+    buddy_set(slab, cur, idx, false);
+    while (cur > level) {
+        // Keep the lower half of the split block, and free the upper half
+        cur--;
+        idx <<= 1;
+        buddy_set(slab, cur, idx + 1, true);
+    }
+
+    *offset = (VkDeviceSize) idx * (BUDDY_BLOCK_MIN << level);
+    return true;
+}
+
+// `offset` may point anywhere inside the allocated block
+static void buddy_free(struct vk_slab *slab, VkDeviceSize offset)
+{
+    int level = slab->buddylevel[offset / BUDDY_BLOCK_MIN];
+    int idx = offset / (BUDDY_BLOCK_MIN << level);
+
+    // Coalesce with the neighbouring block for as long as it's also free
+    while (level < BUDDY_LEVELS - 1 && buddy_test(slab, level, idx ^ 1)) {
+        buddy_set(slab, level, idx ^ 1, false);
+        idx >>= 1;
+        level++;
+    }
+
+    buddy_set(slab, level, idx, true);
+}
+
+// Number of bytes available for new allocations in a (non-dedicated) slab
+static size_t slab_avail(const struct vk_slab *slab)
+{
+    if (!slab->buddymap)
+        return __builtin_popcountll(slab->spacemap) * slab->pagesize;
+
+    size_t avail = 0;
+    for (int i = 0; i < BUDDY_LEVELS; i++)
+        avail += slab->buddyfree[i] * (BUDDY_BLOCK_MIN << i);
+    return avail;
+}
+
 static inline float efficiency(size_t used, size_t total)
 {
     if (!total)
@@ -170,16 +304,26 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
             struct vk_slab *slab = pool->slabs.elem[j];
             pl_mutex_lock(&slab->lock);
 
-            size_t avail = __builtin_popcountll(slab->spacemap) * slab->pagesize;
-            size_t slab_res = slab->size - avail;
-
-            PL_MSG(vk, lev, "    Slab %2d: %8"PRIx64" x %s: "
-                   "%s used %s res %s alloc from heap %d, efficiency %.2f%%  [%s]",
-                   j, slab->spacemap, PRINT_SIZE(slab->pagesize),
-                   PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
-                   PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
-                   efficiency(slab->used, slab_res),
-                   PL_DEF(slab->debug_tag, "unknown"));
+            size_t slab_res = slab->size - slab_avail(slab);
+            const char *drain = slab->draining ? " (draining)" : "";
+
+            if (slab->buddymap) {
+                PL_MSG(vk, lev, "    Slab %2d: buddy blocks >= %s: "
+                       "%s used %s res %s alloc from heap %d, efficiency %.2f%%%s  [%s]",
+                       j, PRINT_SIZE(BUDDY_BLOCK_MIN),
+                       PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
+                       PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
+                       efficiency(slab->used, slab_res), drain,
+                       PL_DEF(slab->debug_tag, "unknown"));
+            } else {
+                PL_MSG(vk, lev, "    Slab %2d: %8"PRIx64" x %s: "
+                       "%s used %s res %s alloc from heap %d, efficiency %.2f%%%s  [%s]",
+                       j, slab->spacemap, PRINT_SIZE(slab->pagesize),
+                       PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
+                       PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
+                       efficiency(slab->used, slab_res), drain,
+                       PL_DEF(slab->debug_tag, "unknown"));
+            }
 
             pool_size += slab->size;
             pool_used += slab->used;
@@ -197,14 +341,18 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
         total_used += pool_used;
         total_res += pool_res;
     }
+    const int num_draining = ma->num_draining;
+    const uint64_t reclaimed = ma->reclaimed;
     pl_mutex_unlock(&ma->lock);
 
     PL_MSG(vk, lev, "Memory summary: %s used %s res %s alloc, "
-           "efficiency %.2f%%, utilization %.2f%%, max page: %s",
+           "efficiency %.2f%%, utilization %.2f%%, max page: %s, "
+           "%d slabs draining, %s reclaimed",
            PRINT_SIZE(total_used), PRINT_SIZE(total_res),
            PRINT_SIZE(total_size), efficiency(total_used, total_res),
            efficiency(total_res, total_size),
-           PRINT_SIZE(ma->maximum_page_size));
+           PRINT_SIZE(ma->maximum_page_size), num_draining,
+           PRINT_SIZE(reclaimed));
 }
 
 static void slab_free(struct vk_ctx *vk, struct vk_slab *slab)
@@ -571,6 +719,46 @@ void vk_malloc_destroy(struct vk_malloc **ma_ptr)
     pl_free_ptr(ma_ptr);
 }
 
+// Marks sparsely used slabs as draining, as long as the remaining slabs of the
+// same kind have enough free space left to absorb their contents.
+//
+// Note: Must be called with `ma->lock` held
+static void pool_drain_sparse(struct vk_malloc *ma, struct vk_pool *pool)
+{
+    struct vk_ctx *vk = ma->vk;
+    size_t avail_pages = 0, avail_blocks = 0;
+    for (int n = 0; n < pool->slabs.num; n++) {
+        struct vk_slab *slab = pool->slabs.elem[n];
+        pl_mutex_lock(&slab->lock);
+        if (!slab->draining)
+            *(slab->buddymap ? &avail_blocks : &avail_pages) += slab_avail(slab);
+        pl_mutex_unlock(&slab->lock);
+    }
+
+    for (int n = 0; n < pool->slabs.num; n++) {
+        struct vk_slab *slab = pool->slabs.elem[n];
+        pl_mutex_lock(&slab->lock);
+        size_t *avail = slab->buddymap ? &avail_blocks : &avail_pages;
+        size_t slab_avail_bytes = slab_avail(slab);
+        size_t reserved = slab->size - slab_avail_bytes;
+        bool sparse = slab->used && slab->used * SPARSE_SLAB_RATIO < slab->size;
+        if (slab->draining || !sparse || *avail < slab_avail_bytes + reserved) {
+            pl_mutex_unlock(&slab->lock);
+            continue;
+        }
+
+        PL_DEBUG(vk, "Draining sparse slab of size %s from pool %d (%s used)",
+                 PRINT_SIZE(slab->size), pool->index, PRINT_SIZE(slab->used));
+
+        // Its free space no longer counts towards the space available to
+        // absorb other slabs, while its contents take up space in the rest
+        *avail -= slab_avail_bytes + reserved;
+        slab->draining = true;
+        ma->num_draining++;
+        pl_mutex_unlock(&slab->lock);
+    }
+}
+
 void vk_malloc_garbage_collect(struct vk_malloc *ma)
 {
     struct vk_ctx *vk = ma->vk;
@@ -583,23 +771,54 @@ void vk_malloc_garbage_collect(struct vk_malloc *ma)
         for (int n = 0; n < pool->slabs.num; n++) {
             struct vk_slab *slab = pool->slabs.elem[n];
             pl_mutex_lock(&slab->lock);
-            if (slab->used || (ma->age - slab->age) <= MAXIMUM_SLAB_AGE) {
+            bool expired = slab->draining || (ma->age - slab->age) > MAXIMUM_SLAB_AGE;
+            if (slab->used || !expired) {
                 pl_mutex_unlock(&slab->lock);
                 continue;
             }
 
-            PL_DEBUG(vk, "Garbage collected slab of size %s from pool %d",
-                     PRINT_SIZE(slab->size), pool->index);
+            if (slab->draining) {
+                PL_DEBUG(vk, "Reclaimed drained slab of size %s from pool %d",
+                         PRINT_SIZE(slab->size), pool->index);
+                ma->reclaimed += slab->size;
+                ma->num_draining--;
+            } else {
+                PL_DEBUG(vk, "Garbage collected slab of size %s from pool %d",
+                         PRINT_SIZE(slab->size), pool->index);
+            }
 
             pl_mutex_unlock(&slab->lock);
             slab_free(ma->vk, slab);
             PL_ARRAY_REMOVE_AT(pool->slabs, n--);
         }
+
+        pool_drain_sparse(ma, pool);
     }
 
     pl_mutex_unlock(&ma->lock);
 }
 
+void vk_malloc_get_stats(struct vk_malloc *ma, struct pl_vulkan_stats *stats)
+{
+    stats->memory_allocated = stats->memory_used = 0;
+
+    pl_mutex_lock(&ma->lock);
+    for (int i = 0; i < ma->pools.num; i++) {
+        const struct vk_pool *pool = &ma->pools.elem[i];
+        for (int n = 0; n < pool->slabs.num; n++) {
+            struct vk_slab *slab = pool->slabs.elem[n];
+            pl_mutex_lock(&slab->lock);
+            stats->memory_allocated += slab->size;
+            stats->memory_used += slab->used;
+            pl_mutex_unlock(&slab->lock);
+        }
+    }
+
+    stats->memory_slabs_draining = ma->num_draining;
+    stats->memory_reclaimed = ma->reclaimed;
+    pl_mutex_unlock(&ma->lock);
+}
+
 pl_handle_caps vk_malloc_handle_caps(const struct vk_malloc *ma, bool import)
 {
     struct vk_ctx *vk = ma->vk;
@@ -629,8 +848,13 @@ void vk_malloc_free(struct vk_malloc *ma, struct vk_memslice *slice)
 
     pl_mutex_lock(&slab->lock);
 
-    int page_idx = slice->offset / slab->pagesize;
-    slab->spacemap |= 0x1LLU << page_idx;
+    if (slab->buddymap) {
+        buddy_free(slab, slice->offset);
+    } else {
+        int page_idx = slice->offset / slab->pagesize;
+        slab->spacemap |= 0x1LLU << page_idx;
+    }
+
     slab->used -= slice->size;
     slab->age = ma->age;
     pl_assert(slab->used >= 0);
@@ -679,6 +903,17 @@ static struct vk_pool *find_pool(struct vk_malloc *ma,
     return &ma->pools.elem[idx];
 }
 
+// Stop draining a slab which turned out to be needed after all
+static void slab_undrain(struct vk_malloc *ma, struct vk_slab *slab)
+{
+    if (!slab->draining)
+        return;
+
+    PL_DEBUG(ma->vk, "Reusing draining slab of size %s", PRINT_SIZE(slab->size));
+    slab->draining = false;
+    ma->num_draining--;
+}
+
 // Returns a suitable memory page from the pool. A new slab will be allocated
 // under the hood, if necessary.
 //
@@ -692,28 +927,34 @@ static struct vk_slab *pool_get_page(struct vk_malloc *ma, struct vk_pool *pool,
     size = PL_ALIGN2(size, PAGE_SIZE_ALIGN);
     const size_t pagesize = PL_ALIGN(size, align);
 
-    for (int i = 0; i < pool->slabs.num; i++) {
-        slab = pool->slabs.elem[i];
-        if (slab->pagesize < size)
-            continue;
-        if (slab->pagesize > pagesize * MINIMUM_PAGE_COUNT) // rough heuristic
-            continue;
-        if (slab->pagesize % align)
-            continue;
+    // Only fall back to draining slabs if no other slab has any space left
+    for (int draining = 0; draining < 2; draining++) {
+        for (int i = 0; i < pool->slabs.num; i++) {
+            slab = pool->slabs.elem[i];
+            if (slab->buddymap || slab->draining != draining)
+                continue;
+            if (slab->pagesize < size)
+                continue;
+            if (slab->pagesize > pagesize * MINIMUM_PAGE_COUNT) // rough heuristic
+                continue;
+            if (slab->pagesize % align)
+                continue;
 
-        pl_mutex_lock(&slab->lock);
-        int page_idx = __builtin_ffsll(slab->spacemap);
-        if (!page_idx--) {
-            pl_mutex_unlock(&slab->lock);
-            // Increase the number of slabs to allocate for new slabs the
-            // more existing full slabs exist for this size range
-            slab_pages = PL_MIN(slab_pages << 1, MAXIMUM_PAGE_COUNT);
-            continue;
-        }
+            pl_mutex_lock(&slab->lock);
+            int page_idx = __builtin_ffsll(slab->spacemap);
+            if (!page_idx--) {
+                pl_mutex_unlock(&slab->lock);
+                // Increase the number of slabs to allocate for new slabs the
+                // more existing full slabs exist for this size range
+                slab_pages = PL_MIN(slab_pages << 1, MAXIMUM_PAGE_COUNT);
+                continue;
+            }
 
-        slab->spacemap ^= 0x1LLU << page_idx;
-        *offset = page_idx * slab->pagesize;
-        return slab;
+            slab->spacemap ^= 0x1LLU << page_idx;
+            *offset = page_idx * slab->pagesize;
+            slab_undrain(ma, slab);
+            return slab;
+        }
     }
 
     // Otherwise, allocate a new vk_slab and append it to the list.
@@ -747,6 +988,78 @@ static struct vk_slab *pool_get_page(struct vk_malloc *ma, struct vk_pool *pool,
     return slab;
 }
 
+// Size needed to serve an allocation from a buddy block. Blocks are naturally
+// aligned to their own size, so this only needs padding for the odd factors
+// of non-power-of-two alignments.
+static inline size_t buddy_block_size(size_t size, size_t align)
+{
+    return PL_ALIGN(size, align) + align - (align & -align);
+}
+
+// Whether an allocation takes up less space as a buddy block than as a page
+static inline bool use_buddy(size_t size, size_t align)
+{
+    size_t block = buddy_block_size(size, align);
+    size_t page = PL_ALIGN(PL_ALIGN2(size, PAGE_SIZE_ALIGN), align);
+    return block <= BUDDY_BLOCK_MAX && (BUDDY_BLOCK_MIN << buddy_level(block)) < page;
+}
+
+// Returns a suitable buddy block from the pool, for allocations satisfying
+// `use_buddy`. A new slab will be allocated under the hood, if necessary.
+//
+// Note: This locks the slab it returns
+static struct vk_slab *pool_get_block(struct vk_malloc *ma, struct vk_pool *pool,
+                                      size_t size, size_t align,
+                                      VkDeviceSize *offset)
+{
+    pl_static_assert(BUDDY_SLAB_SIZE == BUDDY_BLOCK_MIN << (BUDDY_LEVELS - 1));
+    pl_static_assert(BUDDY_BLOCK_MAX <= BUDDY_SLAB_SIZE);
+    pl_assert(buddy_block_size(size, align) <= BUDDY_BLOCK_MAX);
+    const int level = buddy_level(buddy_block_size(size, align));
+
+    struct vk_slab *slab;
+    for (int draining = 0; draining < 2; draining++) {
+        for (int i = 0; i < pool->slabs.num; i++) {
+            slab = pool->slabs.elem[i];
+            if (!slab->buddymap || slab->draining != draining)
+                continue;
+
+            pl_mutex_lock(&slab->lock);
+            if (!buddy_alloc(slab, level, offset)) {
+                pl_mutex_unlock(&slab->lock);
+                continue;
+            }
+
+            slab_undrain(ma, slab);
+            goto done;
+        }
+    }
+
+    struct vk_malloc_params params = pool->params;
+    params.reqs.size = BUDDY_SLAB_SIZE;
+
+    pl_mutex_unlock(&ma->lock);
+    slab = slab_alloc(ma, &params);
+    pl_mutex_lock(&ma->lock);
+    if (!slab)
+        return NULL;
+    pl_mutex_lock(&slab->lock);
+
+    // Start out with a single free block spanning the entire slab
+    slab->buddymap = pl_calloc_ptr(slab, BUDDY_MAP_WORDS, slab->buddymap);
+    slab->buddylevel = pl_calloc_ptr(slab, buddy_count(0), slab->buddylevel);
+    buddy_set(slab, BUDDY_LEVELS - 1, 0, true);
+    PL_ARRAY_APPEND(NULL, pool->slabs, slab);
+
+    bool ok = buddy_alloc(slab, level, offset);
+    pl_assert(ok);
+
+done:
+    *offset = PL_ALIGN(*offset, align);
+    slab->buddylevel[*offset / BUDDY_BLOCK_MIN] = level;
+    return slab;
+}
+
 static bool vk_malloc_import(struct vk_malloc *ma, struct vk_memslice *out,
                              const struct vk_malloc_params *params)
 {
@@ -1017,7 +1330,11 @@ bool vk_malloc_slice(struct vk_malloc *ma, struct vk_memslice *out,
     } else {
         pl_mutex_lock(&ma->lock);
         struct vk_pool *pool = find_pool(ma, params);
-        slab = pool_get_page(ma, pool, size, align, &offset);
+        if (use_buddy(size, align)) {
+            slab = pool_get_block(ma, pool, size, align, &offset);
+        } else {
+            slab = pool_get_page(ma, pool, size, align, &offset);
+        }
         pl_mutex_unlock(&ma->lock);
         if (!slab) {
             PL_ERR(ma->vk, "No slab to serve request for %s bytes (with "
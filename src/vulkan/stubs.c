@@ -52,6 +52,11 @@ pl_vulkan pl_vulkan_get(pl_gpu gpu)
     return NULL;
 }
 
+struct pl_vulkan_stats pl_vulkan_get_stats(pl_vulkan vk)
+{
+    pl_unreachable();
+}
+
 VkPhysicalDevice pl_vulkan_choose_device(pl_log log,
                               const struct pl_vulkan_device_params *params)
 {